@@ -24,9 +24,11 @@
 
 
 #include <stdlib.h>
+#include <thread>
 #include <uv.h>
 
 
+#include "amd/OclTuner.h"
 #include "api/Api.h"
 #include "App.h"
 #include "base/kernel/Signals.h"
@@ -40,6 +42,7 @@
 #include "net/Network.h"
 #include "Summary.h"
 #include "version.h"
+#include "workers/Benchmark.h"
 #include "workers/Workers.h"
 
 
@@ -49,9 +52,17 @@
 
 
 xmrig::App::App(Process *process) :
+    m_benchmark(nullptr),
+    m_closing(false),
+    m_oclReady(false),
+    m_selfTest(false),
+    m_starting(false),
     m_console(nullptr),
     m_httpd(nullptr),
-    m_signals(nullptr)
+    m_exitCode(0),
+    m_tuner(nullptr),
+    m_signals(nullptr),
+    m_selfTestTime(0)
 {
     m_controller = new xmrig::Controller(process);
     if (m_controller->init() != 0) {
@@ -72,6 +83,8 @@ xmrig::App::~App()
 
     delete m_signals;
     delete m_console;
+    delete m_benchmark;
+    delete m_tuner;
     delete m_controller;
 
 #   ifndef XMRIG_NO_HTTPD
@@ -92,13 +105,16 @@ int xmrig::App::exec()
 
     Mem::init(true);
 
-    if (!CryptoNight::init(m_controller->config()->algorithm().algo())) {
-        LOG_ERR("\"%s\" hash self-test failed.", m_controller->config()->algorithm().name());
-        return 1;
-    }
-
     Summary::print(m_controller);
 
+    // mining and benchmark run the self-test together with the OpenCL initialization, see onStartup()
+    if (m_controller->config()->isDryRun() || m_controller->config()->isTune()) {
+        if (!CryptoNight::init(m_controller->config()->algorithm().algo())) {
+            LOG_ERR("\"%s\" hash self-test failed.", m_controller->config()->algorithm().name());
+            return 1;
+        }
+    }
+
     if (m_controller->config()->isDryRun()) {
         LOG_NOTICE("OK");
         return 0;
@@ -123,17 +139,49 @@ int xmrig::App::exec()
         LOG_WARN("Failed to set system timer resolution.");
     }
 
-    if (!m_controller->oclInit() || !Workers::start(m_controller)) {
+    if (m_controller->config()->isTune()) {
+        m_tuner = new OclTuner(m_controller);
+
+        if (!m_controller->oclInit()) {
+            LOG_ERR("Failed to start threads.");
+            return 1;
+        }
+
+        m_tuner->start();
+
+        uv_run(uv_default_loop(), UV_RUN_DEFAULT);
+        uv_loop_close(uv_default_loop());
+
+        return m_tuner->exitCode();
+    }
+
+    if (m_controller->config()->isBench()) {
+        m_benchmark = new Benchmark(m_controller);
+        Workers::setListener(m_benchmark);
+    }
+
+    if (!m_controller->oclInit()) {
         LOG_ERR("Failed to start threads.");
         return 1;
     }
 
-    m_controller->network()->connect();
+    // the pool login runs on the loop while the thread pool builds the OpenCL programs and runs the self-test
+    if (!m_controller->config()->isOffline()) {
+        m_controller->network()->connect();
+    }
+
+    m_starting     = true;
+    m_startup.data = this;
+    uv_queue_work(uv_default_loop(), &m_startup, App::onStartup, App::onStarted);
 
     const int r = uv_run(uv_default_loop(), UV_RUN_DEFAULT);
     uv_loop_close(uv_default_loop());
 
-    return r;
+    if (m_benchmark) {
+        return m_benchmark->exitCode();
+    }
+
+    return m_exitCode ? m_exitCode : r;
 }
 
 
@@ -196,10 +244,87 @@ void xmrig::App::onSignal(int signum)
 }
 
 
+void xmrig::App::started()
+{
+    m_starting = false;
+
+    if (m_closing) {
+        return close();
+    }
+
+    if (!m_selfTest) {
+        LOG_ERR("\"%s\" hash self-test failed.", m_controller->config()->algorithm().name());
+    }
+    else if (!m_oclReady) {
+        LOG_ERR("Failed to start threads.");
+    }
+
+    if (!m_selfTest || !m_oclReady) {
+        m_exitCode = 1;
+
+        return close();
+    }
+
+    LOG_INFO(m_controller->config()->isColors() ? "self-test passed in " WHITE_BOLD("%.3fs") : "self-test passed in %.3fs", m_selfTestTime / 1e9);
+
+    // --opencl-self-test=all only checks the kernels, failures already set the exit code
+    if (m_controller->config()->isOclSelfTestAll()) {
+        return close();
+    }
+
+    Workers::start();
+
+    if (m_benchmark) {
+        m_benchmark->start();
+    }
+}
+
+
 void xmrig::App::close()
 {
-    m_controller->network()->stop();
+    if (m_tuner) {
+        m_tuner->stop();
+        return;
+    }
+
+    if (!m_controller->config()->isOffline()) {
+        m_controller->network()->stop();
+    }
+
+    // the thread pool still uses the controller and the OpenCL contexts, the loop keeps running until it is done
+    if (m_starting) {
+        if (!m_closing) {
+            LOG_INFO("waiting for the OpenCL initialization to finish");
+        }
+
+        m_closing = true;
+        return;
+    }
+
     Workers::stop();
 
     uv_stop(uv_default_loop());
 }
+
+
+void xmrig::App::onStartup(uv_work_t *req)
+{
+    App *app = static_cast<App *>(req->data);
+
+    std::thread selfTest([app]() {
+        const uint64_t timestamp = uv_hrtime();
+
+        app->m_selfTest     = CryptoNight::init(app->m_controller->config()->algorithm().algo());
+        app->m_selfTestTime = uv_hrtime() - timestamp;
+    });
+
+    app->m_oclReady = Workers::init(app->m_controller);
+
+    selfTest.join();
+}
+
+
+void xmrig::App::onStarted(uv_work_t *req, int status)
+{
+    static_cast<App *>(req->data)->started();
+}
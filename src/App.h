@@ -27,12 +27,17 @@
 #define XMRIG_APP_H
 
 
+#include <uv.h>
+
+
 #include "base/kernel/interfaces/ISignalListener.h"
 #include "common/interfaces/IConsoleListener.h"
 
 
+class Benchmark;
 class Console;
 class Httpd;
+class OclTuner;
 
 
 namespace xmrig {
@@ -59,11 +64,24 @@ protected:
 private:
     void background();
     void close();
+    void started();
+
+    static void onStartup(uv_work_t *req);
+    static void onStarted(uv_work_t *req, int status);
 
+    Benchmark *m_benchmark;
+    bool m_closing;
+    bool m_oclReady;
+    bool m_selfTest;
+    bool m_starting;
     Console *m_console;
     Controller *m_controller;
     Httpd *m_httpd;
+    int m_exitCode;
+    OclTuner *m_tuner;
     Signals *m_signals;
+    uint64_t m_selfTestTime;
+    uv_work_t m_startup;
 };
 
 
@@ -71,6 +71,7 @@ void Mem::release(cryptonight_ctx **ctx, size_t count, MemInfo &info)
     release(info);
 
     for (size_t i = 0; i < count; ++i) {
+        freeExecutableMemory(reinterpret_cast<void*>(ctx[i]->generated_code), 0x4000);
         _mm_free(ctx[i]);
     }
 }
@@ -100,6 +100,12 @@ void *Mem::allocateExecutableMemory(size_t size)
 }
 
 
+void Mem::freeExecutableMemory(void *p, size_t size)
+{
+    munmap(p, size);
+}
+
+
 void Mem::protectExecutableMemory(void *p, size_t size)
 {
     mprotect(p, size, PROT_READ | PROT_EXEC);
@@ -191,6 +191,12 @@ void *Mem::allocateExecutableMemory(size_t size)
 }
 
 
+void Mem::freeExecutableMemory(void *p, size_t size)
+{
+    VirtualFree(p, 0, MEM_RELEASE);
+}
+
+
 void Mem::protectExecutableMemory(void *p, size_t size)
 {
     DWORD oldProtect;
@@ -41,17 +41,27 @@
 #include "common/xmrig.h"
 
 
+class OclProfiler;
+class OclScheduler;
+
+
 struct GpuContext
 {
     inline GpuContext() :
         deviceIdx(0),
         rawIntensity(0),
+        intensity(0),
+        targetTime(0),
         workSize(0),
         threads(0),
         stridedIndex(2),
         memChunk(2),
         compMode(1),
         unrollFactor(8),
+        splits(0),
+        pipeline(false),
+        profiling(false),
+        cache(true),
         vendor(xmrig::OCL_VENDOR_UNKNOWN),
         threadIdx(0),
         opencl_ctx(nullptr),
@@ -64,11 +74,25 @@ struct GpuContext
         ExtraBuffers{ nullptr },
         Program(nullptr),
         Kernels{ nullptr },
+        PipelineQueue(nullptr),
+        PipelineBuffers{ nullptr },
+        PipelineEvents{ nullptr },
+        PipelineCounters{ { 0 } },
+        PipelineNonce{ 0 },
+        PipelineHashes{ 0 },
+        PipelineSlot(-1),
+        scheduler(nullptr),
+        profiler(nullptr),
         ProgramCryptonightR(nullptr),
         HeightCryptonightR(0),
         freeMem(0),
         globalMem(0),
         computeUnits(0),
+        startupBuffers(0),
+        startupProgram(0),
+        startupKernels(0),
+        programSource(nullptr),
+        Hashes(0),
         Nonce(0)
     {
         memset(Kernels, 0, sizeof(Kernels));
@@ -77,12 +101,18 @@ struct GpuContext
     /*Input vars*/
     size_t deviceIdx;
     size_t rawIntensity;
+    size_t intensity;     // global size of the next batch, 0 or above rawIntensity means rawIntensity
+    uint32_t targetTime;  // target batch time in milliseconds for the adaptive intensity, 0 to disable
     size_t workSize;
     size_t threads;
     int stridedIndex;
     int memChunk;
     int compMode;
     int unrollFactor;
+    size_t splits;        // cn1 dispatches per batch for the fast job switch, 0 or 1 - a single dispatch
+    bool pipeline;
+    bool profiling;       // command queue with CL_QUEUE_PROFILING_ENABLE and per-kernel timings
+    bool cache;
     xmrig::OclVendor vendor;
 
     /*Output vars*/
@@ -98,14 +128,28 @@ struct GpuContext
     cl_mem ExtraBuffers[6];
     cl_program Program;
     cl_kernel Kernels[32];
+    cl_command_queue PipelineQueue; // final kernels and results of the pipeline, they do not wait behind the next batch
+    cl_mem PipelineBuffers[6];
+    cl_event PipelineEvents[2];
+    cl_uint PipelineCounters[2][4];
+    uint32_t PipelineNonce[2];
+    size_t PipelineHashes[2];
+    int PipelineSlot;
+    OclScheduler *scheduler;
+    OclProfiler *profiler;
     cl_program ProgramCryptonightR;
     uint64_t HeightCryptonightR;
     size_t freeMem;
     size_t globalMem;
     cl_uint computeUnits;
+    int64_t startupBuffers;
+    int64_t startupProgram;
+    int64_t startupKernels;
+    const char *programSource;
     xmrig::String board;
     xmrig::String name;
 
+    size_t Hashes;  // nonces covered by the last completed batch
     uint32_t Nonce;
 };
 
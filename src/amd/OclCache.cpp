@@ -23,9 +23,14 @@
  */
 
 
+#include <condition_variable>
 #include <fstream>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <sstream>
+#include <uv.h>
 
 
 #include "amd/OclCache.h"
@@ -40,6 +45,31 @@
 #include "crypto/CryptoNight_constants.h"
 
 
+namespace {
+
+
+// Contexts with the same source, options and device string produce the same binary, only the first one compiles it.
+struct SharedBuild
+{
+    bool done = false;
+    std::string binary;
+};
+
+
+static std::condition_variable buildsCond;
+static std::map<std::string, std::shared_ptr<SharedBuild> > builds;
+static std::mutex buildsMutex;
+
+
+static void CL_CALLBACK onBuildCompleted(cl_program, void *data)
+{
+    uv_sem_post(static_cast<uv_sem_t *>(data));
+}
+
+
+} // namespace
+
+
 OclCache::OclCache(int index, cl_context opencl_ctx, GpuContext *ctx, const char *source_code, xmrig::Config *config) :
     m_oclCtx(opencl_ctx),
     m_sourceCode(source_code),
@@ -50,19 +80,27 @@ OclCache::OclCache(int index, cl_context opencl_ctx, GpuContext *ctx, const char
 }
 
 
-cl_int OclCache::wait_build(cl_program program, cl_device_id device)
+cl_int OclCache::build(cl_program program, cl_device_id device, const char *options)
 {
-    cl_build_status status;
-    do
-    {
-        if (OclLib::getProgramBuildInfo(program, device, CL_PROGRAM_BUILD_STATUS, sizeof(cl_build_status), &status, nullptr) != CL_SUCCESS) {
-            return OCL_ERR_API;
-        }
+    // Drivers may still invoke the callback after a failed clBuildProgram call, so the semaphore is only freed after a successful wait.
+    uv_sem_t *sem = new uv_sem_t;
+    uv_sem_init(sem, 0);
+
+    cl_int ret = OclLib::buildProgram(program, 1, &device, options, onBuildCompleted, sem);
+    if (ret != CL_SUCCESS) {
+        return ret;
+    }
 
-        sleep(1);
-    } while (status == CL_BUILD_IN_PROGRESS);
+    uv_sem_wait(sem);
+    uv_sem_destroy(sem);
+    delete sem;
+
+    cl_build_status status;
+    if (OclLib::getProgramBuildInfo(program, device, CL_PROGRAM_BUILD_STATUS, sizeof(cl_build_status), &status, nullptr) != CL_SUCCESS) {
+        return OCL_ERR_API;
+    }
 
-    return CL_SUCCESS;
+    return status == CL_BUILD_SUCCESS ? CL_SUCCESS : CL_BUILD_PROGRAM_FAILURE;
 }
 
 
@@ -96,66 +134,73 @@ bool OclCache::load()
         return false;
     }
 
-    std::ifstream clBinFile(m_fileName, std::ofstream::in | std::ofstream::binary);
-
-    if (!m_config->isOclCache() || !clBinFile.good()) {
-        LOG_INFO(m_config->isColors() ? "GPU " WHITE_BOLD("#%zu") " " YELLOW_BOLD("compiling...") :
-                                        "GPU #%zu compiling...", m_ctx->deviceIdx);
-
-        int64_t timeStart = xmrig::steadyTimestamp();
-
-        cl_int ret;
-        m_ctx->Program = OclLib::createProgramWithSource(m_oclCtx, 1, reinterpret_cast<const char**>(&m_sourceCode), nullptr, &ret);
-        if (ret != CL_SUCCESS) {
+    std::string cached;
+    if (m_config->isOclCache() && read(m_fileName, cached)) {
+        if ((m_ctx->Program = createProgram(m_oclCtx, m_ctx->DeviceID, cached)) == nullptr) {
+            LOG_NOTICE("Try to delete file %s", m_fileName.c_str());
             return false;
         }
 
-        if (OclLib::buildProgram(m_ctx->Program, 1, &m_ctx->DeviceID, options) != CL_SUCCESS) {
-            printf("Build log:\n%s\n", OclLib::getProgramBuildLog(m_ctx->Program, m_ctx->DeviceID).data());
-            return false;
+        m_ctx->programSource = "cache";
+        return true;
+    }
+
+    std::shared_ptr<SharedBuild> build;
+    bool owner = false;
+    {
+        std::lock_guard<std::mutex> lock(buildsMutex);
+        std::shared_ptr<SharedBuild> &entry = builds[m_fileName];
+        if (!entry) {
+            entry = std::make_shared<SharedBuild>();
+            owner = true;
         }
 
-        const cl_uint num_devices = numDevices();
-        const int dev_id          = devId(num_devices);
+        build = entry;
+    }
 
-        if (wait_build(m_ctx->Program, m_ctx->DeviceID) != CL_SUCCESS) {
+    if (!owner) {
+        std::unique_lock<std::mutex> lock(buildsMutex);
+        buildsCond.wait(lock, [&build] { return build->done; });
+        lock.unlock();
+
+        if (build->binary.empty() || (m_ctx->Program = createProgram(m_oclCtx, m_ctx->DeviceID, build->binary)) == nullptr) {
+            LOG_ERR("GPU #%zu shared build failed", m_ctx->deviceIdx);
             return false;
         }
 
-        int64_t timeFinish = xmrig::steadyTimestamp();
+        m_ctx->programSource = "shared";
+        return true;
+    }
 
-        LOG_INFO(m_config->isColors() ? "GPU " WHITE_BOLD("#%zu") " " GREEN_BOLD("compilation completed") ", elapsed time " WHITE_BOLD("%.3fs") :
-            "GPU #%zu compilation completed, elapsed time %.3fs", m_ctx->deviceIdx, (timeFinish - timeStart) / 1000.0);
+    std::string binary;
+    const bool result = compile(options, binary) && (!m_config->isOclCache() || write(m_fileName, binary));
 
-        if (!save(dev_id, num_devices)) {
-            return false;
+    {
+        std::lock_guard<std::mutex> lock(buildsMutex);
+        if (result) {
+            build->binary = std::move(binary);
         }
+
+        build->done = true;
     }
-    else {
-        std::ostringstream ss;
-        ss << clBinFile.rdbuf();
-        std::string s = ss.str();
-
-        size_t bin_size = s.size();
-        auto data_ptr = s.data();
-
-        cl_int clStatus;
-        cl_int ret;
-        m_ctx->Program = OclLib::createProgramWithBinary(m_oclCtx, 1, &m_ctx->DeviceID, &bin_size, reinterpret_cast<const unsigned char **>(&data_ptr), &clStatus, &ret);
-        if (ret != CL_SUCCESS) {
-            LOG_NOTICE("Try to delete file %s", m_fileName.c_str());
-            return false;
-        }
 
-        if (OclLib::buildProgram(m_ctx->Program, 1, &m_ctx->DeviceID) != CL_SUCCESS) {
-            LOG_NOTICE("Try to delete file %s", m_fileName.c_str());
-            return false;
-        }
+    buildsCond.notify_all();
+
+    if (result) {
+        m_ctx->programSource = "compiled";
     }
 
-    return true;
+    return result;
 }
 
+
+void OclCache::release()
+{
+    std::lock_guard<std::mutex> lock(buildsMutex);
+    builds.clear();
+}
+
+
 bool OclCache::get_device_string(int platform, cl_device_id device, std::string& result)
 {
     result.clear();
@@ -206,13 +251,9 @@ bool OclCache::prepare(const char *options)
     if (!get_device_string(m_config->platformIndex(), m_ctx->DeviceID, device_string)) {
         return false;
     }
-    calc_hash(device_string, m_sourceCode, options, m_fileName);
-
-#   ifdef _WIN32
-    m_fileName = prefix() + "\\xmrig\\.cache\\" + m_fileName + ".bin";
-#   else
-    m_fileName = prefix() + "/.cache/" + m_fileName + ".bin";
-#   endif
+    std::string hash;
+    calc_hash(device_string, m_sourceCode, options, hash);
+    m_fileName = fileName(hash);
 
 #   ifndef XMRIG_STRICT_OPENCL_CACHE
     LOG_INFO("           CACHE: %s", m_fileName.c_str());
@@ -222,44 +263,132 @@ bool OclCache::prepare(const char *options)
 }
 
 
-bool OclCache::save(int dev_id, cl_uint num_devices) const
+bool OclCache::compile(const char *options, std::string &binary)
 {
-    if (!m_config->isOclCache()) {
-        return true;
+    LOG_INFO(m_config->isColors() ? "GPU " WHITE_BOLD("#%zu") " " YELLOW_BOLD("compiling...") :
+                                    "GPU #%zu compiling...", m_ctx->deviceIdx);
+
+    int64_t timeStart = xmrig::steadyTimestamp();
+
+    cl_int ret;
+    m_ctx->Program = OclLib::createProgramWithSource(m_oclCtx, 1, reinterpret_cast<const char**>(&m_sourceCode), nullptr, &ret);
+    if (ret != CL_SUCCESS) {
+        return false;
     }
 
-    createDirectory();
+    if (build(m_ctx->Program, m_ctx->DeviceID, options) != CL_SUCCESS) {
+        printf("Build log:\n%s\n", OclLib::getProgramBuildLog(m_ctx->Program, m_ctx->DeviceID).data());
+        return false;
+    }
+
+    int64_t timeFinish = xmrig::steadyTimestamp();
+
+    LOG_INFO(m_config->isColors() ? "GPU " WHITE_BOLD("#%zu") " " GREEN_BOLD("compilation completed") ", elapsed time " WHITE_BOLD("%.3fs") :
+        "GPU #%zu compilation completed, elapsed time %.3fs", m_ctx->deviceIdx, (timeFinish - timeStart) / 1000.0);
+
+    return getBinary(m_ctx->Program, m_ctx->DeviceID, binary);
+}
+
+
+cl_program OclCache::createProgram(cl_context opencl_ctx, cl_device_id device, const std::string &binary)
+{
+    size_t bin_size = binary.size();
+    auto data_ptr = binary.data();
+
+    cl_int clStatus;
+    cl_int ret;
+    cl_program program = OclLib::createProgramWithBinary(opencl_ctx, 1, &device, &bin_size, reinterpret_cast<const unsigned char **>(&data_ptr), &clStatus, &ret);
+    if (ret != CL_SUCCESS) {
+        return nullptr;
+    }
+
+    if (build(program, device) != CL_SUCCESS) {
+        OclLib::releaseProgram(program);
+        return nullptr;
+    }
+
+    return program;
+}
+
+
+bool OclCache::getBinary(cl_program program, cl_device_id device, std::string &binary)
+{
+    const cl_uint num_devices = numDevices(program);
+    const int dev_id          = devId(program, device, num_devices);
 
     std::vector<size_t> binary_sizes(num_devices);
-    OclLib::getProgramInfo(m_ctx->Program, CL_PROGRAM_BINARY_SIZES, sizeof(size_t) * binary_sizes.size(), binary_sizes.data());
+    OclLib::getProgramInfo(program, CL_PROGRAM_BINARY_SIZES, sizeof(size_t) * binary_sizes.size(), binary_sizes.data());
 
     std::vector<char*> all_programs(num_devices);
     std::vector<std::vector<char>> program_storage;
 
-    size_t mem_size = 0;
     for (size_t i = 0; i < all_programs.size(); ++i) {
         program_storage.emplace_back(std::vector<char>(binary_sizes[i]));
         all_programs[i] = program_storage[i].data();
-        mem_size += binary_sizes[i];
     }
 
-    if (OclLib::getProgramInfo(m_ctx->Program, CL_PROGRAM_BINARIES, num_devices * sizeof(char*), all_programs.data()) != CL_SUCCESS) {
+    if (OclLib::getProgramInfo(program, CL_PROGRAM_BINARIES, num_devices * sizeof(char*), all_programs.data()) != CL_SUCCESS) {
+        return false;
+    }
+
+    binary.assign(all_programs[dev_id], binary_sizes[dev_id]);
+
+    return !binary.empty();
+}
+
+
+bool OclCache::read(const std::string &fileName, std::string &binary)
+{
+    std::ifstream file_stream(fileName, std::ifstream::in | std::ifstream::binary);
+    if (!file_stream.good()) {
         return false;
     }
 
+    std::ostringstream ss;
+    ss << file_stream.rdbuf();
+    binary = ss.str();
+
+    return !binary.empty();
+}
+
+
+bool OclCache::write(const std::string &fileName, const std::string &binary)
+{
+    createDirectory();
+
     std::ofstream file_stream;
-    file_stream.open(m_fileName, std::ofstream::out | std::ofstream::binary);
-    file_stream.write(all_programs[dev_id], binary_sizes[dev_id]);
+    file_stream.open(fileName, std::ofstream::out | std::ofstream::binary);
+    file_stream.write(binary.data(), binary.size());
     file_stream.close();
 
     return true;
 }
 
 
-cl_uint OclCache::numDevices() const
+std::string OclCache::directory()
+{
+#   ifdef _WIN32
+    return prefix() + "\\xmrig\\.cache";
+#   else
+    return prefix() + "/.cache";
+#   endif
+}
+
+
+std::string OclCache::fileName(const std::string &name, const char *extension)
+{
+#   ifdef _WIN32
+    return directory() + "\\" + name + extension;
+#   else
+    return directory() + "/" + name + extension;
+#   endif
+}
+
+
+cl_uint OclCache::numDevices(cl_program program)
 {
     cl_uint num_devices = 0;
-    OclLib::getProgramInfo(m_ctx->Program, CL_PROGRAM_NUM_DEVICES, sizeof(cl_uint), &num_devices);
+    OclLib::getProgramInfo(program, CL_PROGRAM_NUM_DEVICES, sizeof(cl_uint), &num_devices);
 
     return num_devices;
 }
@@ -300,14 +429,14 @@ size_t OclCache::worksize(const GpuContext *ctx, xmrig::Variant variant)
 }
 
 
-int OclCache::devId(cl_uint num_devices) const
+int OclCache::devId(cl_program program, cl_device_id device, cl_uint num_devices)
 {
     std::vector<cl_device_id> devices_ids(num_devices);
-    OclLib::getProgramInfo(m_ctx->Program, CL_PROGRAM_DEVICES, sizeof(cl_device_id)* devices_ids.size(), devices_ids.data());
+    OclLib::getProgramInfo(program, CL_PROGRAM_DEVICES, sizeof(cl_device_id)* devices_ids.size(), devices_ids.data());
 
     int dev_id = 0;
     for (auto & ocl_device : devices_ids) {
-        if (ocl_device == m_ctx->DeviceID) {
+        if (ocl_device == device) {
             break;
         }
 
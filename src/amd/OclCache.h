@@ -41,22 +41,28 @@ public:
 
     bool load();
 
-    static void getOptions(xmrig::Algo algo, xmrig::Variant variant, const GpuContext* ctx, char* options, size_t options_size);
+    static bool getBinary(cl_program program, cl_device_id device, std::string &binary);
     static bool get_device_string(int platform, cl_device_id device, std::string& result);
-    static void calc_hash(const std::string& device_string, const char* source_code, const char *options, std::string& hash);
-    static cl_int wait_build(cl_program program, cl_device_id device);
+    static bool read(const std::string &fileName, std::string &binary);
+    static bool write(const std::string &fileName, const std::string &binary);
+    static cl_int build(cl_program program, cl_device_id device, const char *options = nullptr);
+    static cl_program createProgram(cl_context opencl_ctx, cl_device_id device, const std::string &binary);
     static int amdDriverMajorVersion(const GpuContext* ctx);
-    static void sleep(size_t ms);
     static size_t worksize(const GpuContext *ctx, xmrig::Variant variant);
+    static std::string directory();
+    static std::string fileName(const std::string &name, const char *extension = ".bin");
+    static void calc_hash(const std::string& device_string, const char* source_code, const char *options, std::string& hash);
+    static void getOptions(xmrig::Algo algo, xmrig::Variant variant, const GpuContext* ctx, char* options, size_t options_size);
+    static void release();
 
 private:
+    bool compile(const char *options, std::string &binary);
     bool prepare(const char *options);
-    bool save(int dev_id, cl_uint num_devices) const;
-    cl_uint numDevices() const;
-    int devId(cl_uint num_devices) const;
-    void createDirectory() const;
 
+    static cl_uint numDevices(cl_program program);
+    static int devId(cl_program program, cl_device_id device, cl_uint num_devices);
     static std::string prefix();
+    static void createDirectory();
 
     cl_context m_oclCtx;
     const char *m_sourceCode;
@@ -22,13 +22,12 @@
  */
 
 #include <sys/stat.h>
-#include <unistd.h>
 
 
 #include "amd/OclCache.h"
 
 
-void OclCache::createDirectory() const
+void OclCache::createDirectory()
 {
     std::string path = prefix() + "/.cache";
     mkdir(path.c_str(), 0744);
@@ -40,8 +39,3 @@ std::string OclCache::prefix()
     return ".";
 }
 
-
-void OclCache::sleep(size_t ms)
-{
-    ::usleep(ms / 1000);
-}
@@ -30,7 +30,7 @@
 #include "amd/OclCache.h"
 
 
-void OclCache::createDirectory() const
+void OclCache::createDirectory()
 {
     std::string path = prefix() + "/xmrig";
     _mkdir(path.c_str());
@@ -50,8 +50,3 @@ std::string OclCache::prefix()
     return ".";
 }
 
-
-void OclCache::sleep(size_t ms)
-{
-    Sleep(ms);
-}
@@ -22,18 +22,24 @@
  *   along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <condition_variable>
 #include <cstring>
+#include <memory>
 #include <mutex>
 #include <sstream>
 #include <string>
 #include <thread>
+#include <uv.h>
 
 
 #include "amd/OclCache.h"
 #include "amd/OclCryptonightR_gen.h"
 #include "amd/OclError.h"
 #include "amd/OclLib.h"
+#include "amd/OclVirtual.h"
 #include "common/log/Log.h"
+#include "common/utils/timestamp.h"
 #include "crypto/CryptoNight_monero.h"
 
 
@@ -78,93 +84,268 @@ static std::string get_code(const V4_Instruction* code, int code_size)
     return s.str();
 }
 
+// One entry per height window, source, options and device string, the compiled binary is shared by all identical devices.
 struct CacheEntry
 {
-    CacheEntry(xmrig::Variant variant, uint64_t height, size_t deviceIdx, std::string&& hash, cl_program program) :
+    CacheEntry(xmrig::Variant variant, uint64_t height, const std::string &hash) :
         variant(variant),
         height(height),
-        deviceIdx(deviceIdx),
-        hash(std::move(hash)),
-        program(program)
+        hash(hash),
+        failed(false),
+        ready(false),
+        requested(xmrig::steadyTimestamp())
     {}
 
+    // Programs belong to an OpenCL context, the same device may be seen again through a new context.
+    struct Program
+    {
+        cl_context context;
+        cl_device_id device;
+        cl_program program;
+    };
+
+    cl_program program(const GpuContext *ctx) const
+    {
+        for (const Program &p : programs) {
+            if (p.context == ctx->opencl_ctx && p.device == ctx->DeviceID) {
+                return p.program;
+            }
+        }
+
+        return nullptr;
+    }
+
+    inline void add(const GpuContext *ctx, cl_program program) { programs.push_back({ ctx->opencl_ctx, ctx->DeviceID, program }); }
+
     xmrig::Variant variant;
     uint64_t height;
-    size_t deviceIdx;
     std::string hash;
-    cl_program program;
+    std::string binary;
+    std::vector<Program> programs;
+    bool failed;
+    bool ready;
+    int64_t requested;
 };
 
-struct BackgroundTaskBase
+struct BackgroundTask
 {
-    virtual ~BackgroundTaskBase() {}
-    virtual void exec() = 0;
-};
-
-template<typename T>
-struct BackgroundTask : public BackgroundTaskBase
-{
-    BackgroundTask(T&& func) : m_func(std::move(func)) {}
-    void exec() override { m_func(); }
+    GpuContext *ctx;
+    xmrig::Variant variant;
+    uint64_t height;
 
-    T m_func;
+    // Heap order, the nearest height window is compiled first.
+    inline bool operator<(const BackgroundTask &other) const { return height > other.height; }
 };
 
+static std::condition_variable CryptonightR_cache_cond;
 static std::mutex CryptonightR_cache_mutex;
-static std::mutex CryptonightR_build_mutex;
-static std::vector<CacheEntry> CryptonightR_cache;
+static std::vector<std::shared_ptr<CacheEntry> > CryptonightR_cache;
+static CryptonightRStats CryptonightR_stats_data = {};
+static int64_t CryptonightR_ready_total = 0;
 
+static std::condition_variable background_done_cond;
+static std::condition_variable background_tasks_cond;
 static std::mutex background_tasks_mutex;
-static std::vector<BackgroundTaskBase*> background_tasks;
-static std::thread* background_thread = nullptr;
+static std::vector<BackgroundTask> background_tasks;
+static std::vector<const GpuContext*> background_running;
+static std::vector<std::thread*> background_threads;
+static size_t background_workers = 1;
+static bool background_stop = false;
+
 
 static void background_thread_proc()
 {
-    std::vector<BackgroundTaskBase*> tasks;
     for (;;) {
-        tasks.clear();
+        BackgroundTask task;
+        {
+            std::unique_lock<std::mutex> lock(background_tasks_mutex);
+            background_tasks_cond.wait(lock, []{ return background_stop || !background_tasks.empty(); });
+
+            if (background_stop) {
+                return;
+            }
+
+            std::pop_heap(background_tasks.begin(), background_tasks.end());
+            task = background_tasks.back();
+            background_tasks.pop_back();
+            background_running.push_back(task.ctx);
+        }
+
+        CryptonightR_get_program(task.ctx, task.variant, task.height, false);
+
         {
             std::lock_guard<std::mutex> g(background_tasks_mutex);
-            background_tasks.swap(tasks);
+            background_running.erase(std::find(background_running.begin(), background_running.end(), task.ctx));
         }
 
-        for (BackgroundTaskBase* task : tasks) {
-            task->exec();
-            delete task;
+        background_done_cond.notify_all();
+    }
+}
+
+
+static void background_exec(GpuContext *ctx, xmrig::Variant variant, uint64_t height)
+{
+    {
+        std::lock_guard<std::mutex> g(background_tasks_mutex);
+        if (background_stop) {
+            return;
         }
 
-        OclCache::sleep(500);
+        for (const BackgroundTask &task : background_tasks) {
+            if (task.ctx == ctx && task.variant == variant && task.height == height) {
+                return;
+            }
+        }
+
+        background_tasks.push_back({ ctx, variant, height });
+        std::push_heap(background_tasks.begin(), background_tasks.end());
+
+        while (background_threads.size() < background_workers) {
+            background_threads.push_back(new std::thread(background_thread_proc));
+        }
     }
+
+    background_tasks_cond.notify_one();
 }
 
-template<typename T>
-static void background_exec(T&& func)
+
+static std::string CryptonightR_file_name(xmrig::Variant variant, uint64_t height, const std::string &hash)
 {
-    BackgroundTaskBase* task = new BackgroundTask<T>(std::move(func));
+    char prefix[64];
+    snprintf(prefix, sizeof(prefix), "cn_r_%d_%" PRIu64 "_", static_cast<int>(variant), height);
 
-    std::lock_guard<std::mutex> g(background_tasks_mutex);
-    background_tasks.push_back(task);
-    if (!background_thread) {
-        background_thread = new std::thread(background_thread_proc);
+    return OclCache::fileName(prefix + hash);
+}
+
+
+// Remove cached binaries of the same variant once they are behind the chain tip, the same rule as for the in-memory cache.
+static void CryptonightR_prune(xmrig::Variant variant, uint64_t height)
+{
+    const std::string directory = OclCache::directory();
+
+    uv_fs_t req;
+    if (uv_fs_scandir(uv_default_loop(), &req, directory.c_str(), 0, nullptr) < 0) {
+        uv_fs_req_cleanup(&req);
+        return;
     }
+
+    uv_dirent_t entry;
+    while (uv_fs_scandir_next(&req, &entry) != UV_EOF) {
+        int entryVariant     = 0;
+        uint64_t entryHeight = 0;
+
+        if (sscanf(entry.name, "cn_r_%d_%" SCNu64 "_", &entryVariant, &entryHeight) != 2) {
+            continue;
+        }
+
+        if (entryVariant != static_cast<int>(variant) || entryHeight + PRECOMPILATION_DEPTH >= height) {
+            continue;
+        }
+
+        const std::string path = directory + "/" + entry.name;
+
+        uv_fs_t unlink;
+        if (uv_fs_unlink(uv_default_loop(), &unlink, path.c_str(), nullptr) == 0) {
+            LOG_DEBUG("CryptonightR: cached program for height %" PRIu64 " removed (old program)", entryHeight);
+        }
+
+        uv_fs_req_cleanup(&unlink);
+    }
+
+    uv_fs_req_cleanup(&req);
+}
+
+
+static cl_program CryptonightR_compile(const GpuContext *ctx, const std::string &source, const std::string &options)
+{
+    cl_int ret;
+    const char* s = source.c_str();
+    cl_program program = OclLib::createProgramWithSource(ctx->opencl_ctx, 1, &s, nullptr, &ret);
+    if (ret != CL_SUCCESS)
+    {
+        LOG_ERR("CryptonightR: clCreateProgramWithSource returned error %s", OclError::toString(ret));
+        return nullptr;
+    }
+
+    ret = OclCache::build(program, ctx->DeviceID, options.c_str());
+    if (ret != CL_SUCCESS) {
+        LOG_ERR("CryptonightR: clBuildProgram returned error %s", OclError::toString(ret));
+        printf("Build log:\n%s\n", OclLib::getProgramBuildLog(program, ctx->DeviceID).data());
+
+        OclLib::releaseProgram(program);
+        return nullptr;
+    }
+
+    return program;
+}
+
+
+// Another device with the same device string already built this window, create the program from its binary.
+static cl_program CryptonightR_share_program(const GpuContext *ctx, const std::shared_ptr<CacheEntry> &entry, const std::string &source, const std::string &options)
+{
+    cl_program program = entry->binary.empty() ? nullptr : OclCache::createProgram(ctx->opencl_ctx, ctx->DeviceID, entry->binary);
+    if (!program && (program = CryptonightR_compile(ctx, source, options)) == nullptr) {
+        return nullptr;
+    }
+
+    OclVirtual::setProgramHeight(program, entry->height * 10);
+
+    std::lock_guard<std::mutex> g(CryptonightR_cache_mutex);
+
+    cl_program existing = entry->program(ctx);
+    if (existing) {
+        OclLib::releaseProgram(program);
+        return existing;
+    }
+
+    entry->add(ctx, program);
+    CryptonightR_stats_data.shared++;
+
+    return program;
 }
 
 
-static cl_program CryptonightR_build_program(const GpuContext *ctx, xmrig::Variant variant, uint64_t height, const std::string &source, const std::string &options, std::string hash)
+static cl_program CryptonightR_build_program(const GpuContext *ctx, xmrig::Variant variant, uint64_t height, const std::string &source, const std::string &options, const std::string &hash)
 {
     std::vector<cl_program> old_programs;
-    old_programs.reserve(32);
+    std::shared_ptr<CacheEntry> entry;
     {
-        std::lock_guard<std::mutex> g(CryptonightR_cache_mutex);
+        std::unique_lock<std::mutex> lock(CryptonightR_cache_mutex);
 
-        // Remove old programs from cache
+        for (const std::shared_ptr<CacheEntry> &e : CryptonightR_cache) {
+            if ((e->variant == variant) && (e->height == height) && (e->hash == hash)) {
+                entry = e;
+                break;
+            }
+        }
+
+        if (entry) {
+            CryptonightR_cache_cond.wait(lock, [&entry]{ return entry->ready || entry->failed; });
+            if (entry->failed) {
+                return nullptr;
+            }
+
+            cl_program program = entry->program(ctx);
+            if (program) {
+                LOG_DEBUG("CryptonightR: program for height %" PRIu64 " found in cache", height);
+                return program;
+            }
+
+            lock.unlock();
+            return CryptonightR_share_program(ctx, entry, source, options);
+        }
+
+        // Remove old programs from cache, entries still being built are removed on a later pass
         for (size_t i = 0; i < CryptonightR_cache.size();)
         {
-            const CacheEntry& entry = CryptonightR_cache[i];
-            if ((entry.variant == variant) && (entry.height + PRECOMPILATION_DEPTH < height))
+            const CacheEntry &e = *CryptonightR_cache[i];
+            if ((e.variant == variant) && (e.height + PRECOMPILATION_DEPTH < height) && e.ready)
             {
-                LOG_DEBUG("CryptonightR: program for height %" PRIu64 " released (old program)", entry.height);
-                old_programs.push_back(entry.program);
+                LOG_DEBUG("CryptonightR: program for height %" PRIu64 " released (old program)", e.height);
+                for (const CacheEntry::Program &p : e.programs) {
+                    old_programs.push_back(p.program);
+                }
+
                 CryptonightR_cache[i] = std::move(CryptonightR_cache.back());
                 CryptonightR_cache.pop_back();
             }
@@ -173,64 +354,78 @@ static cl_program CryptonightR_build_program(const GpuContext *ctx, xmrig::Varia
                 ++i;
             }
         }
+
+        entry = std::make_shared<CacheEntry>(variant, height, hash);
+        CryptonightR_cache.push_back(entry);
     }
 
     for (cl_program p : old_programs) {
         OclLib::releaseProgram(p);
     }
 
-    std::lock_guard<std::mutex> g1(CryptonightR_build_mutex);
+    if (ctx->cache) {
+        CryptonightR_prune(variant, height);
+    }
 
+    const std::string fileName = CryptonightR_file_name(variant, height, hash);
+    std::string binary;
     cl_program program = nullptr;
-    {
-        std::lock_guard<std::mutex> g(CryptonightR_cache_mutex);
+    bool loaded        = false;
 
-        // Check if the cache already has this program (some other thread might have added it first)
-        for (const CacheEntry& entry : CryptonightR_cache)
-        {
-            if ((entry.variant == variant) && (entry.height == height) && (entry.deviceIdx == ctx->deviceIdx) && (entry.hash == hash))
-            {
-                program = entry.program;
-                break;
-            }
+    if (ctx->cache && OclCache::read(fileName, binary)) {
+        program = OclCache::createProgram(ctx->opencl_ctx, ctx->DeviceID, binary);
+        loaded  = program != nullptr;
+
+        if (loaded) {
+            LOG_DEBUG("CryptonightR: programs for heights %" PRIu64 " - %" PRIu64 " loaded from cache", height * 10, height * 10 + 9);
         }
     }
 
-    if (program) {
-        return program;
+    if (!program && (program = CryptonightR_compile(ctx, source, options)) != nullptr) {
+        LOG_DEBUG("CryptonightR: programs for heights %" PRIu64 " - %" PRIu64 " compiled", height * 10, height * 10 + 9);
+
+        if (!OclCache::getBinary(program, ctx->DeviceID, binary)) {
+            binary.clear();
+        }
+        else if (ctx->cache) {
+            OclCache::write(fileName, binary);
+        }
     }
 
-    cl_int ret;
-    const char* s = source.c_str();
-    program = OclLib::createProgramWithSource(ctx->opencl_ctx, 1, &s, nullptr, &ret);
-    if (ret != CL_SUCCESS)
+    OclVirtual::setProgramHeight(program, height * 10);
+
     {
-        LOG_ERR("CryptonightR: clCreateProgramWithSource returned error %s", OclError::toString(ret));
-        return nullptr;
-    }
+        std::lock_guard<std::mutex> g(CryptonightR_cache_mutex);
 
-    ret = OclLib::buildProgram(program, 1, &ctx->DeviceID, options.c_str());
-    if (ret != CL_SUCCESS) {
-        LOG_ERR("CryptonightR: clBuildProgram returned error %s", OclError::toString(ret));
-        printf("Build log:\n%s\n", OclLib::getProgramBuildLog(program, ctx->DeviceID).data());
+        if (program) {
+            const int64_t readyTime = xmrig::steadyTimestamp() - entry->requested;
 
-        OclLib::releaseProgram(program);
-        return nullptr;
-    }
+            entry->binary = std::move(binary);
+            entry->add(ctx, program);
+            entry->ready = true;
 
-    ret = OclCache::wait_build(program, ctx->DeviceID);
-    if (ret != CL_SUCCESS) {
-        OclLib::releaseProgram(program);
-        LOG_ERR("CryptonightR: wait_build returned error %s", OclError::toString(ret));
-        return nullptr;
+            CryptonightRStats &stats = CryptonightR_stats_data;
+            if (loaded) {
+                stats.loaded++;
+            }
+            else {
+                stats.compiled++;
+            }
+
+            CryptonightR_ready_total += readyTime;
+            stats.height       = height * 10;
+            stats.readyTime    = readyTime;
+            stats.readyTimeMax = std::max(stats.readyTimeMax, readyTime);
+            stats.readyTimeAvg = static_cast<double>(CryptonightR_ready_total) / (stats.loaded + stats.compiled);
+        }
+        else {
+            entry->failed = true;
+            CryptonightR_cache.erase(std::remove(CryptonightR_cache.begin(), CryptonightR_cache.end(), entry), CryptonightR_cache.end());
+        }
     }
 
-    LOG_DEBUG("CryptonightR: programs for heights %" PRIu64 " - %" PRIu64 " compiled", height * 10, height * 10 + 9);
+    CryptonightR_cache_cond.notify_all();
 
-    {
-        std::lock_guard<std::mutex> g(CryptonightR_cache_mutex);
-        CryptonightR_cache.emplace_back(variant, height, ctx->deviceIdx, std::move(hash), program);
-    }
     return program;
 }
 
@@ -244,7 +439,7 @@ static bool is_64bit(xmrig::Variant variant)
 cl_program CryptonightR_get_program(GpuContext* ctx, xmrig::Variant variant, uint64_t height, bool background)
 {
     if (background) {
-        background_exec([=](){ CryptonightR_get_program(ctx, variant, height, false); });
+        background_exec(ctx, variant, height);
         return nullptr;
     }
 
@@ -311,19 +506,83 @@ cl_program CryptonightR_get_program(GpuContext* ctx, xmrig::Variant variant, uin
     }
     OclCache::calc_hash(ctx->DeviceString, source, options, hash);
 
+    return CryptonightR_build_program(ctx, variant, height, source, options, hash);
+}
+
+
+void CryptonightR_set_workers(size_t workers)
+{
+    std::lock_guard<std::mutex> g(background_tasks_mutex);
+    background_workers = std::max<size_t>(workers, 1);
+}
+
+
+// Waiting workers would block the destructor of the static condition variable at exit, programs being built are finished first.
+void CryptonightR_stop()
+{
+    std::vector<std::thread*> threads;
+    {
+        std::lock_guard<std::mutex> g(background_tasks_mutex);
+        background_tasks.clear();
+        background_stop = true;
+        threads.swap(background_threads);
+    }
+
+    background_tasks_cond.notify_all();
+
+    for (std::thread *thread : threads) {
+        thread->join();
+        delete thread;
+    }
+}
+
+
+void CryptonightR_release(const GpuContext *ctx)
+{
+    {
+        std::unique_lock<std::mutex> lock(background_tasks_mutex);
+
+        background_tasks.erase(std::remove_if(background_tasks.begin(), background_tasks.end(), [ctx](const BackgroundTask &task) { return task.ctx == ctx; }), background_tasks.end());
+        std::make_heap(background_tasks.begin(), background_tasks.end());
+
+        background_done_cond.wait(lock, [ctx]{ return std::find(background_running.begin(), background_running.end(), ctx) == background_running.end(); });
+    }
+
+    std::vector<cl_program> programs;
     {
         std::lock_guard<std::mutex> g(CryptonightR_cache_mutex);
 
-        // Check if the cache has this program
-        for (const CacheEntry& entry : CryptonightR_cache)
-        {
-            if ((entry.variant == variant) && (entry.height == height) && (entry.deviceIdx == ctx->deviceIdx) && (entry.hash == hash))
-            {
-                LOG_DEBUG("CryptonightR: program for height %" PRIu64 " found in cache", height);
-                return entry.program;
+        for (const std::shared_ptr<CacheEntry> &entry : CryptonightR_cache) {
+            auto &list = entry->programs;
+            for (auto it = list.begin(); it != list.end();) {
+                if (it->context == ctx->opencl_ctx && it->device == ctx->DeviceID) {
+                    programs.push_back(it->program);
+                    it = list.erase(it);
+                }
+                else {
+                    ++it;
+                }
             }
         }
     }
 
-    return CryptonightR_build_program(ctx, variant, height, source, options, hash);
+    for (cl_program program : programs) {
+        OclLib::releaseProgram(program);
+    }
+}
+
+
+CryptonightRStats CryptonightR_stats()
+{
+    CryptonightRStats stats;
+    {
+        std::lock_guard<std::mutex> g(CryptonightR_cache_mutex);
+        stats = CryptonightR_stats_data;
+    }
+
+    std::lock_guard<std::mutex> g(background_tasks_mutex);
+    stats.pending = background_tasks.size();
+    stats.workers = background_workers;
+
+    return stats;
 }
@@ -33,6 +33,23 @@ enum
 };
 static_assert((PRECOMPILATION_DEPTH >= 1) && (PRECOMPILATION_DEPTH <= 10), "Invalid precompilation depth");
 
+struct CryptonightRStats
+{
+    uint64_t compiled;
+    uint64_t loaded;
+    uint64_t shared;
+    uint64_t height;
+    int64_t readyTime;
+    int64_t readyTimeMax;
+    double readyTimeAvg;
+    size_t pending;
+    size_t workers;
+};
+
 cl_program CryptonightR_get_program(GpuContext* ctx, xmrig::Variant variant, uint64_t height, bool background = false);
+CryptonightRStats CryptonightR_stats();
+void CryptonightR_release(const GpuContext *ctx);
+void CryptonightR_set_workers(size_t workers);
+void CryptonightR_stop();
 
 #endif /* XMRIG_OCLCRYPTONIGHTR_GEN_H */
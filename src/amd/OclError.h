@@ -31,6 +31,7 @@
 #define OCL_ERR_SUCCESS    (0)
 #define OCL_ERR_API        (2)
 #define OCL_ERR_BAD_PARAMS (1)
+#define OCL_ERR_MISMATCH   (3)
 
 
 class OclError
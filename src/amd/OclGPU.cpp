@@ -24,12 +24,14 @@
  */
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <iostream>
 #include <math.h>
 #include <regex>
 #include <stdio.h>
 #include <string.h>
+#include <thread>
 #include <vector>
 #include <inttypes.h>
 
@@ -38,10 +40,13 @@
 #include "amd/OclError.h"
 #include "amd/OclGPU.h"
 #include "amd/OclLib.h"
+#include "amd/OclProfiler.h"
+#include "amd/OclScheduler.h"
 #include "amd/OclCryptonightR_gen.h"
 #include "common/log/Log.h"
 #include "common/utils/timestamp.h"
 #include "core/Config.h"
+#include "crypto/CryptoNight.h"
 #include "crypto/CryptoNight_constants.h"
 #include "cryptonight.h"
 
@@ -67,6 +72,98 @@ inline static bool setKernelArgFromExtraBuffers(GpuContext *ctx, size_t kernel,
 }
 
 
+inline static bool setKernelArgFromBuffer(GpuContext *ctx, size_t kernel, cl_uint argument, const cl_mem *buffer)
+{
+    cl_int ret;
+    if ((ret = OclLib::setKernelArg(ctx->Kernels[kernel], argument, sizeof(cl_mem), buffer)) != CL_SUCCESS) {
+        LOG_ERR(kSetKernelArgErr, err_to_str(ret), kernel, argument);
+        return false;
+    }
+
+    return true;
+}
+
+
+// Pipeline slot 0 uses the regular buffers, slot 1 has its own set.
+// Index: 0 - states, 1-4 - branches, 5 - output.
+inline static cl_mem *pipelineBuffer(GpuContext *ctx, int slot, size_t index)
+{
+    if (slot == 1) {
+        return ctx->PipelineBuffers + index;
+    }
+
+    return index == 5 ? &ctx->OutputBuffer : ctx->ExtraBuffers + index + 1;
+}
+
+
+// Global size of the next batch, the adaptive intensity may shrink it below the allocated rawIntensity.
+inline static size_t batchIntensity(const GpuContext *ctx)
+{
+    return ctx->intensity > 0 && ctx->intensity < ctx->rawIntensity ? ctx->intensity : ctx->rawIntensity;
+}
+
+
+// Event of the next command for the profiler, without --opencl-profile commands are enqueued without events.
+inline static cl_event *profile(GpuContext *ctx, OclProfiler::Stage stage)
+{
+    return ctx->profiler ? ctx->profiler->event(stage) : nullptr;
+}
+
+
+// cn1 dispatches of all threads on the same GPU are chained by the device scheduler.
+inline static cl_int enqueueCn1(GpuContext *ctx, int kernel, const size_t *offset, const size_t *global, const size_t *local, cl_event *event = nullptr)
+{
+    if (ctx->scheduler) {
+        return ctx->scheduler->enqueue(ctx->CommandQueues, ctx->Kernels[kernel], 1, offset, global, local, event);
+    }
+
+    return OclLib::enqueueNDRangeKernel(ctx->CommandQueues, ctx->Kernels[kernel], 1, offset, global, local, 0, nullptr, event);
+}
+
+
+// Runs cn1 of one batch as ctx->splits dispatches and checks for a newer job between them, one dispatch stays queued
+// ahead of the one being waited for so the device does not idle. Returns true if the rest of the batch was dropped.
+static bool enqueueCn1Split(GpuContext *ctx, int kernel, size_t g_thd, const size_t *local, XMRAbortFun abort, void *data, cl_int *ret)
+{
+    const size_t w_size = local[0];
+    const size_t chunk  = ((g_thd / ctx->splits + w_size - 1u) / w_size) * w_size;
+    cl_event previous   = nullptr;
+    bool aborted        = false;
+
+    for (size_t start = 0; start < g_thd; start += chunk) {
+        size_t offset   = start;
+        size_t global   = std::min(chunk, g_thd - start);
+        cl_event event  = nullptr;
+
+        if ((*ret = enqueueCn1(ctx, kernel, &offset, &global, local, &event)) != CL_SUCCESS) {
+            break;
+        }
+
+        if (ctx->profiler) {
+            ctx->profiler->add(OclProfiler::Cn1, event);
+        }
+
+        if (previous) {
+            OclLib::waitForEvents(1, &previous);
+            OclLib::releaseEvent(previous);
+        }
+
+        previous = event;
+
+        if (start + chunk < g_thd && abort(data)) {
+            aborted = true;
+            break;
+        }
+    }
+
+    if (previous) {
+        OclLib::releaseEvent(previous);
+    }
+
+    return aborted;
+}
+
+
 inline static int cn0KernelOffset(xmrig::Variant variant)
 {
 #   ifndef XMRIG_NO_CN_GPU
@@ -189,14 +286,18 @@ size_t InitOpenCLGpu(int index, cl_context opencl_ctx, GpuContext* ctx, const ch
 {
     ctx->opencl_ctx = opencl_ctx;
 
-    printGPU(index, ctx, config);
+    int64_t timestamp = xmrig::steadyTimestamp();
 
     cl_int ret;
-    ctx->CommandQueues = OclLib::createCommandQueue(opencl_ctx, ctx->DeviceID, &ret);
+    ctx->CommandQueues = OclLib::createCommandQueue(opencl_ctx, ctx->DeviceID, &ret, ctx->profiling ? CL_QUEUE_PROFILING_ENABLE : 0);
     if (ret != CL_SUCCESS) {
         return OCL_ERR_API;
     }
 
+    if (ctx->profiling) {
+        ctx->profiler = new OclProfiler(ctx->deviceIdx, ctx->threadIdx);
+    }
+
     ctx->InputBuffer = OclLib::createBuffer(opencl_ctx, CL_MEM_READ_ONLY, 128, nullptr, &ret);
     if (ret != CL_SUCCESS) {
         LOG_ERR("Error %s when calling clCreateBuffer to create input buffer.", err_to_str(ret));
@@ -251,11 +352,39 @@ size_t InitOpenCLGpu(int index, cl_context opencl_ctx, GpuContext* ctx, const ch
         return OCL_ERR_API;
     }
 
+    if (ctx->pipeline) {
+        ctx->PipelineQueue = OclLib::createCommandQueue(opencl_ctx, ctx->DeviceID, &ret, ctx->profiling ? CL_QUEUE_PROFILING_ENABLE : 0);
+        if (ret != CL_SUCCESS) {
+            return OCL_ERR_API;
+        }
+
+        // Second set of states, branches and output buffers for the batch in flight, scratchpads are shared
+        const size_t sizes[6] = {
+            200 * g_thd,
+            sizeof(cl_uint) * (g_thd + 2), sizeof(cl_uint) * (g_thd + 2), sizeof(cl_uint) * (g_thd + 2), sizeof(cl_uint) * (g_thd + 2),
+            sizeof(cl_uint) * 0x100
+        };
+
+        for (size_t i = 0; i < 6; ++i) {
+            ctx->PipelineBuffers[i] = OclLib::createBuffer(opencl_ctx, CL_MEM_READ_WRITE, sizes[i], nullptr, &ret);
+            if (ret != CL_SUCCESS) {
+                LOG_ERR("Error %s when calling clCreateBuffer to create pipeline buffer %zu.", err_to_str(ret), i);
+                return OCL_ERR_API;
+            }
+        }
+    }
+
+    ctx->startupBuffers = xmrig::steadyTimestamp() - timestamp;
+    timestamp           = xmrig::steadyTimestamp();
+
     OclCache cache(index, opencl_ctx, ctx, source_code, config);
     if (!cache.load()) {
         return OCL_ERR_API;
     }
 
+    ctx->startupProgram = xmrig::steadyTimestamp() - timestamp;
+    timestamp           = xmrig::steadyTimestamp();
+
     const char *KernelNames[] = {
         "cn0", "cn1", "cn2",
         "Blake", "Groestl", "JH", "Skein",
@@ -280,11 +409,62 @@ size_t InitOpenCLGpu(int index, cl_context opencl_ctx, GpuContext* ctx, const ch
         }
     }
 
+    ctx->startupKernels = xmrig::steadyTimestamp() - timestamp;
+
     ctx->Nonce = 0;
     return 0;
 }
 
 
+static void printStartup(const GpuContext *ctx, xmrig::Config *config)
+{
+    const int64_t total = ctx->startupBuffers + ctx->startupProgram + ctx->startupKernels;
+
+    LOG_INFO(config->isColors() ? WHITE_BOLD("#%02zu") ", GPU " WHITE_BOLD("#%02zu") " ready in " WHITE_BOLD("%.3fs") GRAY(" (buffers %.3fs, program %.3fs %s, kernels %.3fs)")
+                                : "#%02zu, GPU #%02zu ready in %.3fs (buffers %.3fs, program %.3fs %s, kernels %.3fs)",
+             ctx->threadIdx, ctx->deviceIdx, total / 1000.0, ctx->startupBuffers / 1000.0, ctx->startupProgram / 1000.0,
+             ctx->programSource ? ctx->programSource : "n/a", ctx->startupKernels / 1000.0);
+}
+
+
+// Queues, buffers, programs and kernels of all contexts are created concurrently, the pool is bounded by the number of CPU cores.
+static size_t InitOpenCLGpus(const std::vector<GpuContext *> &contexts, cl_context opencl_ctx, const char *source_code, xmrig::Config *config)
+{
+    const size_t cores = std::max(std::thread::hardware_concurrency(), 1u);
+    const size_t count = std::min(contexts.size(), cores);
+
+    std::atomic<size_t> next(0);
+    std::vector<size_t> results(contexts.size(), OCL_ERR_SUCCESS);
+    std::vector<std::thread> pool;
+    pool.reserve(count);
+
+    for (size_t i = 0; i < count; ++i) {
+        pool.emplace_back([&]() {
+            size_t index;
+            while ((index = next.fetch_add(1)) < contexts.size()) {
+                results[index] = InitOpenCLGpu(static_cast<int>(index), opencl_ctx, contexts[index], source_code, config);
+            }
+        });
+    }
+
+    for (std::thread &thread : pool) {
+        thread.join();
+    }
+
+    OclCache::release();
+
+    for (size_t i = 0; i < contexts.size(); ++i) {
+        if (results[i] != OCL_ERR_SUCCESS) {
+            return results[i];
+        }
+
+        printStartup(contexts[i], config);
+    }
+
+    return OCL_ERR_SUCCESS;
+}
+
+
 int OclGPU::findPlatformIdx(xmrig::Config *config)
 {
     assert(config->vendor() > xmrig::OCL_VENDOR_MANUAL);
@@ -544,14 +724,255 @@ size_t InitOpenCL(const std::vector<GpuContext *> &contexts, xmrig::Config *conf
             contexts[i]->compMode = 0;
         }
 
-        if ((ret = InitOpenCLGpu(i, *opencl_ctx, contexts[i], source_code.c_str(), config)) != OCL_ERR_SUCCESS) {
-            return ret;
+        printGPU(static_cast<int>(i), contexts[i], config);
+    }
+
+    const int64_t timestamp = xmrig::steadyTimestamp();
+    const size_t result     = InitOpenCLGpus(contexts, *opencl_ctx, source_code.c_str(), config);
+
+    if (result == OCL_ERR_SUCCESS) {
+        LOG_INFO(config->isColors() ? "OpenCL " WHITE_BOLD("%zu") " threads ready in " WHITE_BOLD("%.3fs") : "OpenCL %zu threads ready in %.3fs",
+                 num_gpus, (xmrig::steadyTimestamp() - timestamp) / 1000.0);
+    }
+
+    return result;
+}
+
+
+static void resetPipeline(GpuContext *ctx)
+{
+    if (!ctx->pipeline) {
+        return;
+    }
+
+    OclLib::finish(ctx->CommandQueues);
+    OclLib::finish(ctx->PipelineQueue);
+
+    for (cl_event &event : ctx->PipelineEvents) {
+        if (event) {
+            OclLib::releaseEvent(event);
+            event = nullptr;
+        }
+    }
+
+    ctx->PipelineSlot = -1;
+}
+
+
+// Enqueue cn0, cn1 and cn2 for the next nonce range into the given slot and start reading the branch counters, without waiting.
+static size_t enqueueBatch(GpuContext *ctx, xmrig::Variant variant, int slot)
+{
+    static const cl_uint zero = 0;
+
+    cl_int ret;
+    const size_t g_intensity = ctx->rawIntensity;
+    const size_t w_size      = OclCache::worksize(ctx, variant);
+    size_t g_thd             = ((batchIntensity(ctx) + w_size - 1u) / w_size) * w_size;
+    const size_t hashes      = std::min(g_thd, g_intensity); // kernels skip work items at or above rawIntensity
+
+    const int cn0_kernel_offset = cn0KernelOffset(variant);
+    const int cn1_kernel_offset = cn1KernelOffset(variant);
+    const int cn2_kernel_offset = cn2KernelOffset(variant);
+    const cl_mem *states        = pipelineBuffer(ctx, slot, 0);
+
+    // Kernel arguments are captured at enqueue time, so the other slot may safely use the same kernels
+    if (!setKernelArgFromBuffer(ctx, cn0_kernel_offset, 2, states) ||
+        !setKernelArgFromBuffer(ctx, cn1_kernel_offset, 1, states) ||
+        !setKernelArgFromBuffer(ctx, cn2_kernel_offset, 1, states)) {
+        return OCL_ERR_API;
+    }
+
+    if (variant == xmrig::VARIANT_GPU) {
+        if (!setKernelArgFromBuffer(ctx, cn0_kernel_offset + 1, 1, states) || !setKernelArgFromBuffer(ctx, cn2_kernel_offset, 2, pipelineBuffer(ctx, slot, 5))) {
+            return OCL_ERR_API;
+        }
+    }
+    else {
+        for (size_t i = 0; i < 4; ++i) {
+            if (!setKernelArgFromBuffer(ctx, cn2_kernel_offset, i + 2, pipelineBuffer(ctx, slot, i + 1))) {
+                return OCL_ERR_API;
+            }
+
+            if ((ret = OclLib::enqueueWriteBuffer(ctx->CommandQueues, *pipelineBuffer(ctx, slot, i + 1), CL_FALSE, sizeof(cl_uint) * g_intensity, sizeof(cl_uint), &zero, 0, nullptr, profile(ctx, OclProfiler::Write))) != CL_SUCCESS) {
+                LOG_ERR("Error %s when calling clEnqueueWriteBuffer to zero branch buffer counter %zu.", err_to_str(ret), i);
+                return OCL_ERR_API;
+            }
+        }
+    }
+
+    if ((ret = OclLib::enqueueWriteBuffer(ctx->CommandQueues, *pipelineBuffer(ctx, slot, 5), CL_FALSE, sizeof(cl_uint) * 0xFF, sizeof(cl_uint), &zero, 0, nullptr, profile(ctx, OclProfiler::Write))) != CL_SUCCESS) {
+        LOG_ERR("Error %s when calling clEnqueueWriteBuffer to fetch results.", err_to_str(ret));
+        return OCL_ERR_API;
+    }
+
+    ctx->PipelineNonce[slot]  = ctx->Nonce;
+    ctx->PipelineHashes[slot] = hashes;
+
+    size_t Nonce[2] = { ctx->Nonce, 1 }, gthreads[2] = { g_thd, 8 }, lthreads[2] = { 8, 8 };
+    if ((ret = OclLib::enqueueNDRangeKernel(ctx->CommandQueues, ctx->Kernels[cn0_kernel_offset], 2, Nonce, gthreads, lthreads, 0, nullptr, profile(ctx, OclProfiler::Cn0))) != CL_SUCCESS) {
+        LOG_ERR("Error %s when calling clEnqueueNDRangeKernel for kernel %d.", err_to_str(ret), cn0_kernel_offset);
+        return OCL_ERR_API;
+    }
+
+    // cn1 takes the index of the first thread as the offset, cn_gpu still takes the nonce
+    size_t tmpNonce = variant == xmrig::VARIANT_GPU ? ctx->Nonce : 0;
+
+    lthreads[0] = w_size;
+    if (variant == xmrig::VARIANT_GPU) {
+        g_thd *= 16;
+        lthreads[0] *= 16;
+
+        size_t thd    = 64;
+        size_t intens = hashes * thd;
+
+        if ((ret = OclLib::enqueueNDRangeKernel(ctx->CommandQueues, ctx->Kernels[cn0_kernel_offset + 1], 1, nullptr, &intens, &thd, 0, nullptr, profile(ctx, OclProfiler::Cn0))) != CL_SUCCESS) {
+            LOG_ERR("Error %s when calling clEnqueueNDRangeKernel for kernel %d.", err_to_str(ret), cn0_kernel_offset + 1);
+            return OCL_ERR_API;
+        }
+    }
+
+    if ((ret = enqueueCn1(ctx, cn1_kernel_offset, &tmpNonce, &g_thd, lthreads, profile(ctx, OclProfiler::Cn1))) != CL_SUCCESS) {
+        LOG_ERR("Error %s when calling clEnqueueNDRangeKernel for kernel %d.", err_to_str(ret), cn1_kernel_offset);
+        return OCL_ERR_API;
+    }
+
+    // cn_gpu writes the results in cn2, its event tells the pipeline queue when they can be read
+    lthreads[0] = 8;
+    if ((ret = OclLib::enqueueNDRangeKernel(ctx->CommandQueues, ctx->Kernels[cn2_kernel_offset], 2, Nonce, gthreads, lthreads, 0, nullptr,
+                                            variant == xmrig::VARIANT_GPU ? ctx->PipelineEvents + slot : profile(ctx, OclProfiler::Cn2))) != CL_SUCCESS) {
+        LOG_ERR("Error %s when calling clEnqueueNDRangeKernel for kernel %d.", err_to_str(ret), cn2_kernel_offset);
+        return OCL_ERR_API;
+    }
+
+    if (variant == xmrig::VARIANT_GPU) {
+        if (ctx->profiler) {
+            ctx->profiler->add(OclProfiler::Cn2, ctx->PipelineEvents[slot]);
+        }
+    }
+    else {
+        // The queue is in-order, so the event of the last read covers all four counters
+        for (size_t i = 0; i < 4; ++i) {
+            if (OclLib::enqueueReadBuffer(ctx->CommandQueues, *pipelineBuffer(ctx, slot, i + 1), CL_FALSE, sizeof(cl_uint) * g_intensity, sizeof(cl_uint),
+                                          ctx->PipelineCounters[slot] + i, 0, nullptr, i == 3 ? ctx->PipelineEvents + slot : profile(ctx, OclProfiler::Read)) != CL_SUCCESS) {
+                return OCL_ERR_API;
+            }
+        }
+
+        if (ctx->profiler) {
+            ctx->profiler->add(OclProfiler::Read, ctx->PipelineEvents[slot]);
+        }
+    }
+
+    ctx->Nonce += static_cast<uint32_t>(hashes);
+
+    OclLib::flush(ctx->CommandQueues);
+
+    return OCL_ERR_SUCCESS;
+}
+
+
+// Wait for the branch counters of the given slot, run the final hash kernels and read the results on the pipeline queue,
+// the main queue meanwhile keeps working on the next batch. Final kernels touch only the buffers of their own slot.
+static size_t finishBatch(GpuContext *ctx, cl_uint *HashOutput, xmrig::Variant variant, int slot)
+{
+    cl_int ret = OclLib::waitForEvents(1, ctx->PipelineEvents + slot);
+
+    OclLib::releaseEvent(ctx->PipelineEvents[slot]);
+    ctx->PipelineEvents[slot] = nullptr;
+
+    if (ret != CL_SUCCESS) {
+        return OCL_ERR_API;
+    }
+
+    if (variant != xmrig::VARIANT_GPU) {
+        size_t w_size = OclCache::worksize(ctx, variant);
+
+        for (int i = 0; i < 4; ++i) {
+            const cl_uint count = ctx->PipelineCounters[slot][i];
+            if (!count) {
+                continue;
+            }
+
+            // States, Branch, Output
+            if (!setKernelArgFromBuffer(ctx, i + 3, 0, pipelineBuffer(ctx, slot, 0)) ||
+                !setKernelArgFromBuffer(ctx, i + 3, 1, pipelineBuffer(ctx, slot, i + 1)) ||
+                !setKernelArgFromBuffer(ctx, i + 3, 2, pipelineBuffer(ctx, slot, 5))) {
+                return OCL_ERR_API;
+            }
+
+            // Threads
+            if ((ret = OclLib::setKernelArg(ctx->Kernels[i + 3], 4, sizeof(cl_uint), &count)) != CL_SUCCESS) {
+                LOG_ERR(kSetKernelArgErr, err_to_str(ret), i + 3, 4);
+                return OCL_ERR_API;
+            }
+
+            size_t threads  = ((count + w_size - 1u) / w_size) * w_size;
+            size_t tmpNonce = ctx->PipelineNonce[slot];
+
+            if ((ret = OclLib::enqueueNDRangeKernel(ctx->PipelineQueue, ctx->Kernels[i + 3], 1, &tmpNonce, &threads, &w_size, 0, nullptr, profile(ctx, static_cast<OclProfiler::Stage>(OclProfiler::Blake + i)))) != CL_SUCCESS) {
+                LOG_ERR("Error %s when calling clEnqueueNDRangeKernel for kernel %d.", err_to_str(ret), i + 3);
+                return OCL_ERR_API;
+            }
+        }
+    }
+
+    if (OclLib::enqueueReadBuffer(ctx->PipelineQueue, *pipelineBuffer(ctx, slot, 5), CL_TRUE, 0, sizeof(cl_uint) * 0x100, HashOutput, 0, nullptr, profile(ctx, OclProfiler::Read)) != CL_SUCCESS) {
+        return OCL_ERR_API;
+    }
+
+    auto & numHashValues = HashOutput[0xFF];
+    // avoid out of memory read, we have only storage for 0xFF results
+    if (numHashValues > 0xFF) {
+        numHashValues = 0xFF;
+    }
+
+    ctx->Hashes = ctx->PipelineHashes[slot];
+
+    return OCL_ERR_SUCCESS;
+}
+
+
+// Two batches are kept in flight: the next batch is queued before the results of the current one are collected,
+// so the GPU works on it during the host round trips of the current one.
+static size_t runPipeline(GpuContext *ctx, cl_uint *HashOutput, xmrig::Variant variant)
+{
+    if (ctx->PipelineSlot < 0) {
+        if (enqueueBatch(ctx, variant, 0) != OCL_ERR_SUCCESS) {
+            resetPipeline(ctx);
+            return OCL_ERR_API;
         }
+
+        ctx->PipelineSlot = 0;
+    }
+
+    const int slot = ctx->PipelineSlot;
+
+    if (enqueueBatch(ctx, variant, slot ^ 1) != OCL_ERR_SUCCESS || finishBatch(ctx, HashOutput, variant, slot) != OCL_ERR_SUCCESS) {
+        resetPipeline(ctx);
+        return OCL_ERR_API;
+    }
+
+    ctx->PipelineSlot = slot ^ 1;
+
+    // commands of the next batch are still running, the profiler keeps them for the next call
+    if (ctx->profiler) {
+        ctx->profiler->collect();
     }
 
     return OCL_ERR_SUCCESS;
 }
 
+
+// Nonces the next XMRRunJob call takes from ctx->Nonce, the first call with the pipeline queues two batches.
+size_t XMRBatchSize(const GpuContext *ctx, xmrig::Variant variant)
+{
+    const size_t w_size = OclCache::worksize(ctx, variant);
+    const size_t hashes = std::min(((batchIntensity(ctx) + w_size - 1u) / w_size) * w_size, ctx->rawIntensity);
+
+    return ctx->pipeline && ctx->PipelineSlot < 0 ? hashes * 2 : hashes;
+}
+
+
 size_t XMRSetJob(GpuContext *ctx, uint8_t *input, size_t input_len, uint64_t target, xmrig::Variant variant, uint64_t height)
 {
     cl_int ret;
@@ -560,12 +981,15 @@ size_t XMRSetJob(GpuContext *ctx, uint8_t *input, size_t input_len, uint64_t tar
         return OCL_ERR_BAD_PARAMS;
     }
 
+    // Batches queued for the previous job are no longer needed, input buffer and kernels are about to change
+    resetPipeline(ctx);
+
     input[input_len] = 0x01;
     memset(input + input_len + 1, 0, 128 - input_len - 1);
     
     cl_uint numThreads = ctx->rawIntensity;
 
-    if ((ret = OclLib::enqueueWriteBuffer(ctx->CommandQueues, ctx->InputBuffer, CL_TRUE, 0, 128, input, 0, nullptr, nullptr)) != CL_SUCCESS) {
+    if ((ret = OclLib::enqueueWriteBuffer(ctx->CommandQueues, ctx->InputBuffer, CL_TRUE, 0, 128, input, 0, nullptr, profile(ctx, OclProfiler::Write))) != CL_SUCCESS) {
         LOG_ERR("Error %s when calling clEnqueueWriteBuffer to fill input buffer.", err_to_str(ret));
         return OCL_ERR_API;
     }
@@ -744,8 +1168,12 @@ size_t XMRSetJob(GpuContext *ctx, uint8_t *input, size_t input_len, uint64_t tar
     return OCL_ERR_SUCCESS;
 }
 
-size_t XMRRunJob(GpuContext *ctx, cl_uint *HashOutput, xmrig::Variant variant)
+size_t XMRRunJob(GpuContext *ctx, cl_uint *HashOutput, xmrig::Variant variant, XMRAbortFun abort, void *data)
 {
+    if (ctx->pipeline) {
+        return runPipeline(ctx, HashOutput, variant);
+    }
+
     cl_int ret;
     cl_uint zero = 0;
     size_t BranchNonces[4];
@@ -754,18 +1182,20 @@ size_t XMRRunJob(GpuContext *ctx, cl_uint *HashOutput, xmrig::Variant variant)
     size_t g_intensity = ctx->rawIntensity;
     size_t w_size = OclCache::worksize(ctx, variant);
     // round up to next multiple of w_size
-    size_t g_thd = ((g_intensity + w_size - 1u) / w_size) * w_size;
+    size_t g_thd = ((batchIntensity(ctx) + w_size - 1u) / w_size) * w_size;
     // number of global threads must be a multiple of the work group size (w_size)
     assert(g_thd % w_size == 0);
+    // kernels skip work items at or above rawIntensity
+    const size_t hashes = std::min(g_thd, g_intensity);
 
     for(int i = 2; i < 6; ++i) {
-        if ((ret = OclLib::enqueueWriteBuffer(ctx->CommandQueues, ctx->ExtraBuffers[i], CL_FALSE, sizeof(cl_uint) * g_intensity, sizeof(cl_uint), &zero, 0, nullptr, nullptr)) != CL_SUCCESS) {
+        if ((ret = OclLib::enqueueWriteBuffer(ctx->CommandQueues, ctx->ExtraBuffers[i], CL_FALSE, sizeof(cl_uint) * g_intensity, sizeof(cl_uint), &zero, 0, nullptr, profile(ctx, OclProfiler::Write))) != CL_SUCCESS) {
             LOG_ERR("Error %s when calling clEnqueueWriteBuffer to zero branch buffer counter %d.", err_to_str(ret), i - 2);
             return OCL_ERR_API;
         }
     }
 
-    if ((ret = OclLib::enqueueWriteBuffer(ctx->CommandQueues, ctx->OutputBuffer, CL_FALSE, sizeof(cl_uint) * 0xFF, sizeof(cl_uint), &zero, 0, nullptr, nullptr)) != CL_SUCCESS) {
+    if ((ret = OclLib::enqueueWriteBuffer(ctx->CommandQueues, ctx->OutputBuffer, CL_FALSE, sizeof(cl_uint) * 0xFF, sizeof(cl_uint), &zero, 0, nullptr, profile(ctx, OclProfiler::Write))) != CL_SUCCESS) {
         LOG_ERR("Error %s when calling clEnqueueWriteBuffer to fetch results.", err_to_str(ret));
         return OCL_ERR_API;
     }
@@ -775,12 +1205,13 @@ size_t XMRRunJob(GpuContext *ctx, cl_uint *HashOutput, xmrig::Variant variant)
     size_t Nonce[2] = { ctx->Nonce, 1 }, gthreads[2] = { g_thd, 8 }, lthreads[2] = { 8, 8 };
     const int cn0_kernel_offset = cn0KernelOffset(variant);
 
-    if ((ret = OclLib::enqueueNDRangeKernel(ctx->CommandQueues, ctx->Kernels[cn0_kernel_offset], 2, Nonce, gthreads, lthreads, 0, nullptr, nullptr)) != CL_SUCCESS) {
+    if ((ret = OclLib::enqueueNDRangeKernel(ctx->CommandQueues, ctx->Kernels[cn0_kernel_offset], 2, Nonce, gthreads, lthreads, 0, nullptr, profile(ctx, OclProfiler::Cn0))) != CL_SUCCESS) {
         LOG_ERR("Error %s when calling clEnqueueNDRangeKernel for kernel %d.", err_to_str(ret), 0);
         return OCL_ERR_API;
     }
 
-    size_t tmpNonce = ctx->Nonce;
+    // cn1 takes the index of the first thread as the offset, cn_gpu still takes the nonce
+    size_t tmpNonce = variant == xmrig::VARIANT_GPU ? ctx->Nonce : 0;
     const int cn1_kernel_offset = cn1KernelOffset(variant);
 
     lthreads[0] = w_size;
@@ -789,15 +1220,32 @@ size_t XMRRunJob(GpuContext *ctx, cl_uint *HashOutput, xmrig::Variant variant)
         lthreads[0] *= 16;
 
         size_t thd = 64;
-        size_t intens = g_intensity * thd;
+        size_t intens = hashes * thd;
 
-        if ((ret = OclLib::enqueueNDRangeKernel(ctx->CommandQueues, ctx->Kernels[cn0_kernel_offset + 1], 1, nullptr, &intens, &thd, 0, nullptr, nullptr)) != CL_SUCCESS) {
+        if ((ret = OclLib::enqueueNDRangeKernel(ctx->CommandQueues, ctx->Kernels[cn0_kernel_offset + 1], 1, nullptr, &intens, &thd, 0, nullptr, profile(ctx, OclProfiler::Cn0))) != CL_SUCCESS) {
             LOG_ERR("Error %s when calling clEnqueueNDRangeKernel for kernel %d.", err_to_str(ret), cn0_kernel_offset + 1);
             return OCL_ERR_API;
         }
     }
 
-    if ((ret = OclLib::enqueueNDRangeKernel(ctx->CommandQueues, ctx->Kernels[cn1_kernel_offset], 1, &tmpNonce, &g_thd, lthreads, 0, nullptr, nullptr)) != CL_SUCCESS) {
+    if (abort && ctx->splits > 1 && variant != xmrig::VARIANT_GPU) {
+        if (enqueueCn1Split(ctx, cn1_kernel_offset, g_thd, lthreads, abort, data, &ret)) {
+            // a newer job is published, cn2 and the final hashes of this batch would only produce stale shares
+            if (ctx->scheduler) {
+                ctx->scheduler->addAborted();
+            }
+
+            HashOutput[0xFF] = 0;
+            ctx->Hashes      = 0;
+
+            return OCL_ERR_SUCCESS;
+        }
+    }
+    else {
+        ret = enqueueCn1(ctx, cn1_kernel_offset, &tmpNonce, &g_thd, lthreads, profile(ctx, OclProfiler::Cn1));
+    }
+
+    if (ret != CL_SUCCESS) {
         LOG_ERR("Error %s when calling clEnqueueNDRangeKernel for kernel %d.", err_to_str(ret), 1);
         return OCL_ERR_API;
     }
@@ -805,25 +1253,25 @@ size_t XMRRunJob(GpuContext *ctx, cl_uint *HashOutput, xmrig::Variant variant)
     const int cn2_kernel_offset = cn2KernelOffset(variant);
 
     lthreads[0] = 8;
-    if ((ret = OclLib::enqueueNDRangeKernel(ctx->CommandQueues, ctx->Kernels[cn2_kernel_offset], 2, Nonce, gthreads, lthreads, 0, nullptr, nullptr)) != CL_SUCCESS) {
+    if ((ret = OclLib::enqueueNDRangeKernel(ctx->CommandQueues, ctx->Kernels[cn2_kernel_offset], 2, Nonce, gthreads, lthreads, 0, nullptr, profile(ctx, OclProfiler::Cn2))) != CL_SUCCESS) {
         LOG_ERR("Error %s when calling clEnqueueNDRangeKernel for kernel %d.", err_to_str(ret), 2);
         return OCL_ERR_API;
     }
 
     if (variant != xmrig::VARIANT_GPU) {
-        if (OclLib::enqueueReadBuffer(ctx->CommandQueues, ctx->ExtraBuffers[2], CL_FALSE, sizeof(cl_uint) * g_intensity, sizeof(cl_uint), BranchNonces, 0, nullptr, nullptr) != CL_SUCCESS) {
+        if (OclLib::enqueueReadBuffer(ctx->CommandQueues, ctx->ExtraBuffers[2], CL_FALSE, sizeof(cl_uint) * g_intensity, sizeof(cl_uint), BranchNonces, 0, nullptr, profile(ctx, OclProfiler::Read)) != CL_SUCCESS) {
             return OCL_ERR_API;
         }
 
-        if (OclLib::enqueueReadBuffer(ctx->CommandQueues, ctx->ExtraBuffers[3], CL_FALSE, sizeof(cl_uint) * g_intensity, sizeof(cl_uint), BranchNonces + 1, 0, nullptr, nullptr) != CL_SUCCESS) {
+        if (OclLib::enqueueReadBuffer(ctx->CommandQueues, ctx->ExtraBuffers[3], CL_FALSE, sizeof(cl_uint) * g_intensity, sizeof(cl_uint), BranchNonces + 1, 0, nullptr, profile(ctx, OclProfiler::Read)) != CL_SUCCESS) {
             return OCL_ERR_API;
         }
 
-        if (OclLib::enqueueReadBuffer(ctx->CommandQueues, ctx->ExtraBuffers[4], CL_FALSE, sizeof(cl_uint) * g_intensity, sizeof(cl_uint), BranchNonces + 2, 0, nullptr, nullptr) != CL_SUCCESS) {
+        if (OclLib::enqueueReadBuffer(ctx->CommandQueues, ctx->ExtraBuffers[4], CL_FALSE, sizeof(cl_uint) * g_intensity, sizeof(cl_uint), BranchNonces + 2, 0, nullptr, profile(ctx, OclProfiler::Read)) != CL_SUCCESS) {
             return OCL_ERR_API;
         }
 
-        if (OclLib::enqueueReadBuffer(ctx->CommandQueues, ctx->ExtraBuffers[5], CL_FALSE, sizeof(cl_uint) * g_intensity, sizeof(cl_uint), BranchNonces + 3, 0, nullptr, nullptr) != CL_SUCCESS) {
+        if (OclLib::enqueueReadBuffer(ctx->CommandQueues, ctx->ExtraBuffers[5], CL_FALSE, sizeof(cl_uint) * g_intensity, sizeof(cl_uint), BranchNonces + 3, 0, nullptr, profile(ctx, OclProfiler::Read)) != CL_SUCCESS) {
             return OCL_ERR_API;
         }
 
@@ -842,7 +1290,7 @@ size_t XMRRunJob(GpuContext *ctx, cl_uint *HashOutput, xmrig::Variant variant)
                 // number of global threads must be a multiple of the work group size (w_size)
                 assert(BranchNonces[i] % w_size == 0);
                 size_t tmpNonce = ctx->Nonce;
-                if ((ret = OclLib::enqueueNDRangeKernel(ctx->CommandQueues, ctx->Kernels[i + 3], 1, &tmpNonce, BranchNonces + i, &w_size, 0, nullptr, nullptr)) != CL_SUCCESS) {
+                if ((ret = OclLib::enqueueNDRangeKernel(ctx->CommandQueues, ctx->Kernels[i + 3], 1, &tmpNonce, BranchNonces + i, &w_size, 0, nullptr, profile(ctx, static_cast<OclProfiler::Stage>(OclProfiler::Blake + i)))) != CL_SUCCESS) {
                     LOG_ERR("Error %s when calling clEnqueueNDRangeKernel for kernel %d.", err_to_str(ret), i + 3);
                     return OCL_ERR_API;
                 }
@@ -850,7 +1298,7 @@ size_t XMRRunJob(GpuContext *ctx, cl_uint *HashOutput, xmrig::Variant variant)
         }
     }
 
-    if (OclLib::enqueueReadBuffer(ctx->CommandQueues, ctx->OutputBuffer, CL_TRUE, 0, sizeof(cl_uint) * 0x100, HashOutput, 0, nullptr, nullptr) != CL_SUCCESS) {
+    if (OclLib::enqueueReadBuffer(ctx->CommandQueues, ctx->OutputBuffer, CL_TRUE, 0, sizeof(cl_uint) * 0x100, HashOutput, 0, nullptr, profile(ctx, OclProfiler::Read)) != CL_SUCCESS) {
         return OCL_ERR_API;
     }
 
@@ -861,23 +1309,103 @@ size_t XMRRunJob(GpuContext *ctx, cl_uint *HashOutput, xmrig::Variant variant)
         numHashValues = 0xFF;
     }
 
-    ctx->Nonce += (uint32_t) g_intensity;
+    ctx->Hashes = hashes;
+    ctx->Nonce += (uint32_t) hashes;
+
+    if (ctx->profiler) {
+        ctx->profiler->collect();
+    }
 
     return OCL_ERR_SUCCESS;
 }
 
 
+// Runs test vector number index of the variant through all kernels of the thread, from cn0 to the final hashes.
+// Kernels only report nonces with the upper 64 bits of the hash at or below the target, the test nonce must be
+// reported with the expected value as the target and must not be with one less, so those bits match exactly.
+size_t XMRSelfTest(GpuContext *ctx, xmrig::Algo algorithm, xmrig::Variant variant, size_t index)
+{
+    CryptoNight::TestVector vector;
+    if (!CryptoNight::testVector(algorithm, variant, index, vector)) {
+        return OCL_ERR_BAD_PARAMS;
+    }
+
+    uint8_t blob[128] = { 0 };
+    memcpy(blob, vector.input, vector.size);
+
+    uint32_t nonce;
+    memcpy(&nonce, vector.input + 39, sizeof(nonce));
+
+    uint64_t expected;
+    memcpy(&expected, vector.reference + 24, sizeof(expected));
+
+    // a single work group starting at the nonce of the test input, not queued and not profiled
+    const bool pipeline    = ctx->pipeline;
+    const size_t intensity = ctx->intensity;
+    OclProfiler *profiler  = ctx->profiler;
+
+    ctx->pipeline  = false;
+    ctx->intensity = OclCache::worksize(ctx, variant);
+    ctx->profiler  = nullptr;
+
+    bool found[2] = { false, false };
+    size_t ret    = OCL_ERR_SUCCESS;
+
+    for (size_t i = 0; i < 2 && ret == OCL_ERR_SUCCESS; ++i) {
+        cl_uint results[0x100] = { 0 };
+        ctx->Nonce = nonce;
+
+        if ((ret = XMRSetJob(ctx, blob, vector.size, expected - i, variant, vector.height)) != OCL_ERR_SUCCESS ||
+            (ret = XMRRunJob(ctx, results, variant)) != OCL_ERR_SUCCESS) {
+            break;
+        }
+
+        // a full result buffer may have dropped the test nonce, with the exact target that can not be told apart from a mismatch
+        found[i] = std::find(results, results + results[0xFF], nonce) != results + results[0xFF] || (i == 0 && results[0xFF] == 0xFF);
+    }
+
+    ctx->pipeline  = pipeline;
+    ctx->intensity = intensity;
+    ctx->profiler  = profiler;
+    ctx->Nonce     = 0;
+
+    if (ret != OCL_ERR_SUCCESS) {
+        return ret;
+    }
+
+    return found[0] && !found[1] ? OCL_ERR_SUCCESS : OCL_ERR_MISMATCH;
+}
+
+
 void ReleaseOpenCl(GpuContext* ctx)
 {
-    OclLib::releaseMemObject(ctx->InputBuffer);
-    OclLib::releaseMemObject(ctx->OutputBuffer);
+    resetPipeline(ctx);
+    CryptonightR_release(ctx);
 
-    int buffer_count = sizeof(ctx->ExtraBuffers) / sizeof(ctx->ExtraBuffers[0]);
-    for (int b = 0; b < buffer_count; ++b) {
-        OclLib::releaseMemObject(ctx->ExtraBuffers[b]);
+    // Contexts may be partially initialized when InitOpenCL failed
+    if (ctx->InputBuffer) {
+        OclLib::releaseMemObject(ctx->InputBuffer);
     }
 
-    OclLib::releaseProgram(ctx->Program);
+    if (ctx->OutputBuffer) {
+        OclLib::releaseMemObject(ctx->OutputBuffer);
+    }
+
+    for (cl_mem buffer : ctx->ExtraBuffers) {
+        if (buffer) {
+            OclLib::releaseMemObject(buffer);
+        }
+    }
+
+    for (cl_mem buffer : ctx->PipelineBuffers) {
+        if (buffer) {
+            OclLib::releaseMemObject(buffer);
+        }
+    }
+
+    if (ctx->Program) {
+        OclLib::releaseProgram(ctx->Program);
+    }
 
     int kernel_count = sizeof(ctx->Kernels) / sizeof(ctx->Kernels[0]);
     for (int k = 0; k < kernel_count; ++k) {
@@ -886,11 +1414,22 @@ void ReleaseOpenCl(GpuContext* ctx)
         }
     }
 
-    OclLib::releaseCommandQueue(ctx->CommandQueues);
+    delete ctx->profiler;
+    ctx->profiler = nullptr;
+
+    if (ctx->CommandQueues) {
+        OclLib::releaseCommandQueue(ctx->CommandQueues);
+    }
+
+    if (ctx->PipelineQueue) {
+        OclLib::releaseCommandQueue(ctx->PipelineQueue);
+    }
 }
 
 
 void ReleaseOpenClContext(cl_context opencl_ctx)
 {
-    OclLib::releaseContext(opencl_ctx);
+    if (opencl_ctx) {
+        OclLib::releaseContext(opencl_ctx);
+    }
 }
@@ -51,11 +51,17 @@ private:
 };
 
 
+// Returns true when the batch in flight is no longer needed, checked between cn1 dispatches of a split batch.
+typedef bool (*XMRAbortFun)(void *data);
+
+
 void printPlatforms();
 
 size_t InitOpenCL(const std::vector<GpuContext *> &contexts, xmrig::Config *config, cl_context *opencl_ctx);
+size_t XMRBatchSize(const GpuContext *ctx, xmrig::Variant variant);
 size_t XMRSetJob(GpuContext *ctx, uint8_t *input, size_t input_len, uint64_t target, xmrig::Variant variant, uint64_t height);
-size_t XMRRunJob(GpuContext *ctx, cl_uint *HashOutput, xmrig::Variant variant);
+size_t XMRRunJob(GpuContext *ctx, cl_uint *HashOutput, xmrig::Variant variant, XMRAbortFun abort = nullptr, void *data = nullptr);
+size_t XMRSelfTest(GpuContext *ctx, xmrig::Algo algorithm, xmrig::Variant variant, size_t index = 0);
 void ReleaseOpenCl(GpuContext* ctx);
 void ReleaseOpenClContext(cl_context opencl_ctx);
 #endif /* XMRIG_OCLGPU_H */
@@ -28,10 +28,13 @@
 
 #include "amd/OclError.h"
 #include "amd/OclLib.h"
+#include "amd/OclVirtual.h"
 #include "common/log/Log.h"
 
 
 static uv_lib_t oclLib;
+static bool isVirtual = false;
+static bool isAllDevices = false;
 
 static const char *kErrorTemplate                    = "Error %s when calling %s.";
 
@@ -47,6 +50,7 @@ static const char *kEnqueueNDRangeKernel             = "clEnqueueNDRangeKernel";
 static const char *kEnqueueReadBuffer                = "clEnqueueReadBuffer";
 static const char *kEnqueueWriteBuffer               = "clEnqueueWriteBuffer";
 static const char *kFinish                           = "clFinish";
+static const char *kFlush                            = "clFlush";
 static const char *kGetDeviceIDs                     = "clGetDeviceIDs";
 static const char *kGetDeviceInfo                    = "clGetDeviceInfo";
 static const char *kGetKernelInfo                    = "clGetKernelInfo";
@@ -54,12 +58,17 @@ static const char *kGetPlatformIDs                   = "clGetPlatformIDs";
 static const char *kGetPlatformInfo                  = "clGetPlatformInfo";
 static const char *kGetProgramBuildInfo              = "clGetProgramBuildInfo";
 static const char *kGetProgramInfo                   = "clGetProgramInfo";
+static const char *kGetEventProfilingInfo            = "clGetEventProfilingInfo";
 static const char *kReleaseCommandQueue              = "clReleaseCommandQueue";
 static const char *kReleaseContext                   = "clReleaseContext";
+static const char *kReleaseEvent                     = "clReleaseEvent";
 static const char *kReleaseKernel                    = "clReleaseKernel";
 static const char *kReleaseMemObject                 = "clReleaseMemObject";
 static const char *kReleaseProgram                   = "clReleaseProgram";
+static const char *kRetainEvent                      = "clRetainEvent";
+static const char *kSetEventCallback                 = "clSetEventCallback";
 static const char *kSetKernelArg                     = "clSetKernelArg";
+static const char *kWaitForEvents                    = "clWaitForEvents";
 
 #if defined(CL_VERSION_2_0)
 typedef cl_command_queue (CL_API_CALL *createCommandQueueWithProperties_t)(cl_context, cl_device_id, const cl_queue_properties *, cl_int *);
@@ -72,8 +81,10 @@ typedef cl_int (CL_API_CALL *enqueueNDRangeKernel_t)(cl_command_queue, cl_kernel
 typedef cl_int (CL_API_CALL *enqueueReadBuffer_t)(cl_command_queue, cl_mem, cl_bool, size_t, size_t, void *, cl_uint, const cl_event *, cl_event *);
 typedef cl_int (CL_API_CALL *enqueueWriteBuffer_t)(cl_command_queue, cl_mem, cl_bool, size_t, size_t, const void *, cl_uint, const cl_event *, cl_event *);
 typedef cl_int (CL_API_CALL *finish_t)(cl_command_queue);
+typedef cl_int (CL_API_CALL *flush_t)(cl_command_queue);
 typedef cl_int (CL_API_CALL *getDeviceIDs_t)(cl_platform_id, cl_device_type, cl_uint, cl_device_id *, cl_uint *);
 typedef cl_int (CL_API_CALL *getDeviceInfo_t)(cl_device_id, cl_device_info, size_t, void *, size_t *);
+typedef cl_int (CL_API_CALL *getEventProfilingInfo_t)(cl_event, cl_profiling_info, size_t, void *, size_t *);
 typedef cl_int (CL_API_CALL *getKernelInfo_t)(cl_kernel, cl_kernel_info, size_t, void *, size_t *);
 typedef cl_int (CL_API_CALL *getPlatformIDs_t)(cl_uint, cl_platform_id *, cl_uint *);
 typedef cl_int (CL_API_CALL *getPlatformInfo_t)(cl_platform_id, cl_platform_info, size_t, void *, size_t *);
@@ -81,10 +92,14 @@ typedef cl_int (CL_API_CALL *getProgramBuildInfo_t)(cl_program, cl_device_id, cl
 typedef cl_int (CL_API_CALL *getProgramInfo_t)(cl_program, cl_program_info, size_t, void *, size_t *);
 typedef cl_int (CL_API_CALL *releaseCommandQueue_t)(cl_command_queue);
 typedef cl_int (CL_API_CALL *releaseContext_t)(cl_context);
+typedef cl_int (CL_API_CALL *releaseEvent_t)(cl_event);
 typedef cl_int (CL_API_CALL *releaseKernel_t)(cl_kernel);
 typedef cl_int (CL_API_CALL *releaseMemObject_t)(cl_mem);
 typedef cl_int (CL_API_CALL *releaseProgram_t)(cl_program);
+typedef cl_int (CL_API_CALL *retainEvent_t)(cl_event);
+typedef cl_int (CL_API_CALL *setEventCallback_t)(cl_event, cl_int, void (CL_CALLBACK *pfn_notify)(cl_event, cl_int, void *), void *);
 typedef cl_int (CL_API_CALL *setKernelArg_t)(cl_kernel, cl_uint, size_t, const void *);
+typedef cl_int (CL_API_CALL *waitForEvents_t)(cl_uint, const cl_event *);
 typedef cl_kernel (CL_API_CALL *createKernel_t)(cl_program, const char *, cl_int *);
 typedef cl_mem (CL_API_CALL *createBuffer_t)(cl_context, cl_mem_flags, size_t, void *, cl_int *);
 typedef cl_program (CL_API_CALL *createProgramWithBinary_t)(cl_context, cl_uint, const cl_device_id *, const size_t *, const unsigned char **, cl_int *, cl_int *);
@@ -106,8 +121,10 @@ static enqueueNDRangeKernel_t pEnqueueNDRangeKernel                         = nu
 static enqueueReadBuffer_t pEnqueueReadBuffer                               = nullptr;
 static enqueueWriteBuffer_t pEnqueueWriteBuffer                             = nullptr;
 static finish_t pFinish                                                     = nullptr;
+static flush_t pFlush                                                       = nullptr;
 static getDeviceIDs_t pGetDeviceIDs                                         = nullptr;
 static getDeviceInfo_t pGetDeviceInfo                                       = nullptr;
+static getEventProfilingInfo_t pGetEventProfilingInfo                       = nullptr;
 static getKernelInfo_t pGetKernelInfo                                       = nullptr;
 static getPlatformIDs_t pGetPlatformIDs                                     = nullptr;
 static getPlatformInfo_t pGetPlatformInfo                                   = nullptr;
@@ -115,16 +132,40 @@ static getProgramBuildInfo_t pGetProgramBuildInfo                           = nu
 static getProgramInfo_t pGetProgramInfo                                     = nullptr;
 static releaseCommandQueue_t pReleaseCommandQueue                           = nullptr;
 static releaseContext_t pReleaseContext                                     = nullptr;
+static releaseEvent_t pReleaseEvent                                         = nullptr;
 static releaseKernel_t pReleaseKernel                                       = nullptr;
 static releaseMemObject_t pReleaseMemObject                                 = nullptr;
 static releaseProgram_t pReleaseProgram                                     = nullptr;
+static retainEvent_t pRetainEvent                                           = nullptr;
+static setEventCallback_t pSetEventCallback                                 = nullptr;
 static setKernelArg_t pSetKernelArg                                         = nullptr;
+static waitForEvents_t pWaitForEvents                                       = nullptr;
 
-#define DLSYM(x) if (uv_dlsym(&oclLib, k##x, reinterpret_cast<void**>(&p##x)) == -1) { return false; }
+#define DLSYM(x) if (!resolve(k##x, reinterpret_cast<void**>(&p##x))) { return false; }
 
 
-bool OclLib::init(const char *fileName)
+static bool resolve(const char *name, void **ptr)
 {
+    if (isVirtual) {
+        *ptr = OclVirtual::symbol(name);
+
+        return *ptr != nullptr;
+    }
+
+    return uv_dlsym(&oclLib, name, ptr) == 0;
+}
+
+
+bool OclLib::init(const char *fileName, bool allDevices)
+{
+    isAllDevices = allDevices;
+
+    if (OclVirtual::isVirtual(fileName)) {
+        isVirtual = true;
+
+        return OclVirtual::init(fileName) && load();
+    }
+
     if (uv_dlopen(fileName, &oclLib) == -1 || !load()) {
         LOG_ERR("Failed to load OpenCL runtime: %s", uv_dlerror(&oclLib));
         return false;
@@ -143,8 +184,10 @@ bool OclLib::load()
     DLSYM(EnqueueReadBuffer);
     DLSYM(EnqueueWriteBuffer);
     DLSYM(Finish);
+    DLSYM(Flush);
     DLSYM(GetDeviceIDs);
     DLSYM(GetDeviceInfo);
+    DLSYM(GetEventProfilingInfo);
     DLSYM(GetPlatformInfo);
     DLSYM(GetPlatformIDs);
     DLSYM(GetProgramBuildInfo);
@@ -160,28 +203,32 @@ bool OclLib::load()
     DLSYM(ReleaseCommandQueue);
     DLSYM(ReleaseContext);
     DLSYM(GetKernelInfo);
+    DLSYM(ReleaseEvent);
+    DLSYM(RetainEvent);
+    DLSYM(WaitForEvents);
+
+    resolve(kSetEventCallback, reinterpret_cast<void**>(&pSetEventCallback));
 
 #   if defined(CL_VERSION_2_0)
-    uv_dlsym(&oclLib, kCreateCommandQueueWithProperties, reinterpret_cast<void**>(&pCreateCommandQueueWithProperties));
+    resolve(kCreateCommandQueueWithProperties, reinterpret_cast<void**>(&pCreateCommandQueueWithProperties));
 #   endif
 
     return true;
 }
 
 
-cl_command_queue OclLib::createCommandQueue(cl_context context, cl_device_id device, cl_int *errcode_ret)
+cl_command_queue OclLib::createCommandQueue(cl_context context, cl_device_id device, cl_int *errcode_ret, cl_command_queue_properties properties)
 {
     cl_command_queue result;
 
 #   if defined(CL_VERSION_2_0)
     if (pCreateCommandQueueWithProperties) {
-        const cl_queue_properties commandQueueProperties[] = { 0, 0, 0 };
+        const cl_queue_properties commandQueueProperties[] = { properties ? static_cast<cl_queue_properties>(CL_QUEUE_PROPERTIES) : 0, properties, 0 };
         result = pCreateCommandQueueWithProperties(context, device, commandQueueProperties, errcode_ret);
     }
     else {
 #   endif
-        const cl_command_queue_properties commandQueueProperties = { 0 };
-        result = pCreateCommandQueue(context, device, commandQueueProperties, errcode_ret);
+        result = pCreateCommandQueue(context, device, properties, errcode_ret);
 #   if defined(CL_VERSION_2_0)
     }
 #   endif
@@ -257,11 +304,27 @@ cl_int OclLib::finish(cl_command_queue command_queue)
 }
 
 
+cl_int OclLib::flush(cl_command_queue command_queue)
+{
+    assert(pFlush != nullptr);
+
+    return pFlush(command_queue);
+}
+
+
 cl_int OclLib::getDeviceIDs(cl_platform_id platform, cl_device_type device_type, cl_uint num_entries, cl_device_id *devices, cl_uint *num_devices)
 {
     assert(pGetDeviceIDs != nullptr);
 
-    return pGetDeviceIDs(platform, device_type, num_entries, devices, num_devices);
+    const cl_int ret = pGetDeviceIDs(platform, device_type, num_entries, devices, num_devices);
+
+    // benchmarks may run on platforms without GPUs (CPU only ICDs such as PoCL), which expose their devices under other types,
+    // mining always stays on GPU devices
+    if (ret == CL_DEVICE_NOT_FOUND && device_type == CL_DEVICE_TYPE_GPU && (isAllDevices || isVirtual)) {
+        return pGetDeviceIDs(platform, CL_DEVICE_TYPE_ALL, num_entries, devices, num_devices);
+    }
+
+    return ret;
 }
 
 
@@ -278,6 +341,15 @@ cl_int OclLib::getDeviceInfo(cl_device_id device, cl_device_info param_name, siz
 }
 
 
+// Silent, events of commands which did not complete yet have no profiling info.
+cl_int OclLib::getEventProfilingInfo(cl_event event, cl_profiling_info param_name, size_t param_value_size, void *param_value, size_t *param_value_size_ret)
+{
+    assert(pGetEventProfilingInfo != nullptr);
+
+    return pGetEventProfilingInfo(event, param_name, param_value_size, param_value, param_value_size_ret);
+}
+
+
 cl_int OclLib::getPlatformIDs(cl_uint num_entries, cl_platform_id *platforms, cl_uint *num_platforms)
 {
     assert(pGetPlatformIDs != nullptr);
@@ -346,6 +418,19 @@ cl_int OclLib::releaseContext(cl_context context)
 }
 
 
+cl_int OclLib::releaseEvent(cl_event event)
+{
+    assert(pReleaseEvent != nullptr);
+
+    const cl_int ret = pReleaseEvent(event);
+    if (ret != CL_SUCCESS) {
+        LOG_ERR(kErrorTemplate, OclError::toString(ret), kReleaseEvent);
+    }
+
+    return ret;
+}
+
+
 cl_int OclLib::releaseKernel(cl_kernel kernel)
 {
     assert(pReleaseKernel != nullptr);
@@ -389,6 +474,34 @@ cl_int OclLib::releaseProgram(cl_program program)
 }
 
 
+cl_int OclLib::retainEvent(cl_event event)
+{
+    assert(pRetainEvent != nullptr);
+
+    const cl_int ret = pRetainEvent(event);
+    if (ret != CL_SUCCESS) {
+        LOG_ERR(kErrorTemplate, OclError::toString(ret), kRetainEvent);
+    }
+
+    return ret;
+}
+
+
+cl_int OclLib::setEventCallback(cl_event event, cl_int command_exec_callback_type, void (CL_CALLBACK *pfn_notify)(cl_event, cl_int, void *), void *user_data)
+{
+    if (!pSetEventCallback) {
+        return CL_INVALID_OPERATION;
+    }
+
+    const cl_int ret = pSetEventCallback(event, command_exec_callback_type, pfn_notify, user_data);
+    if (ret != CL_SUCCESS) {
+        LOG_ERR(kErrorTemplate, OclError::toString(ret), kSetEventCallback);
+    }
+
+    return ret;
+}
+
+
 cl_int OclLib::setKernelArg(cl_kernel kernel, cl_uint arg_index, size_t arg_size, const void *arg_value)
 {
     assert(pSetKernelArg != nullptr);
@@ -397,6 +510,19 @@ cl_int OclLib::setKernelArg(cl_kernel kernel, cl_uint arg_index, size_t arg_size
 }
 
 
+cl_int OclLib::waitForEvents(cl_uint num_events, const cl_event *event_list)
+{
+    assert(pWaitForEvents != nullptr);
+
+    const cl_int ret = pWaitForEvents(num_events, event_list);
+    if (ret != CL_SUCCESS) {
+        LOG_ERR(kErrorTemplate, OclError::toString(ret), kWaitForEvents);
+    }
+
+    return ret;
+}
+
+
 cl_kernel OclLib::createKernel(cl_program program, const char *kernel_name, cl_int *errcode_ret)
 {
     assert(pCreateKernel != nullptr);
@@ -43,16 +43,18 @@
 class OclLib
 {
 public:
-    static bool init(const char *fileName);
+    static bool init(const char *fileName, bool allDevices = false);
 
-    static cl_command_queue createCommandQueue(cl_context context, cl_device_id device, cl_int *errcode_ret);
+    static cl_command_queue createCommandQueue(cl_context context, cl_device_id device, cl_int *errcode_ret, cl_command_queue_properties properties = 0);
     static cl_context createContext(const cl_context_properties *properties, cl_uint num_devices, const cl_device_id *devices, void (CL_CALLBACK *pfn_notify)(const char *, const void *, size_t, void *), void *user_data, cl_int *errcode_ret);
     static cl_int buildProgram(cl_program program, cl_uint num_devices, const cl_device_id *device_list, const char *options = nullptr, void (CL_CALLBACK *pfn_notify)(cl_program program, void *user_data) = nullptr, void *user_data = nullptr);
     static cl_int enqueueNDRangeKernel(cl_command_queue command_queue, cl_kernel kernel, cl_uint work_dim, const size_t *global_work_offset, const size_t *global_work_size, const size_t *local_work_size, cl_uint num_events_in_wait_list, const cl_event *event_wait_list, cl_event *event);
     static cl_int enqueueReadBuffer(cl_command_queue command_queue, cl_mem buffer, cl_bool blocking_read, size_t offset, size_t size, void *ptr, cl_uint num_events_in_wait_list, const cl_event *event_wait_list, cl_event *event);
     static cl_int enqueueWriteBuffer(cl_command_queue command_queue, cl_mem buffer, cl_bool blocking_write, size_t offset, size_t size, const void *ptr, cl_uint num_events_in_wait_list, const cl_event *event_wait_list, cl_event *event);
     static cl_int finish(cl_command_queue command_queue);
+    static cl_int flush(cl_command_queue command_queue);
     static cl_int getDeviceIDs(cl_platform_id platform, cl_device_type device_type, cl_uint num_entries, cl_device_id *devices, cl_uint *num_devices);
+    static cl_int getEventProfilingInfo(cl_event event, cl_profiling_info param_name, size_t param_value_size, void *param_value, size_t *param_value_size_ret = nullptr);
     static cl_int getDeviceInfo(cl_device_id device, cl_device_info param_name, size_t param_value_size, void *param_value, size_t *param_value_size_ret = nullptr);
     static cl_int getPlatformIDs(cl_uint num_entries, cl_platform_id *platforms, cl_uint *num_platforms);
     static cl_int getPlatformInfo(cl_platform_id platform, cl_platform_info param_name, size_t param_value_size, void *param_value, size_t *param_value_size_ret);
@@ -60,10 +62,14 @@ public:
     static cl_int getProgramInfo(cl_program program, cl_program_info param_name, size_t param_value_size, void *param_value, size_t *param_value_size_ret = nullptr);
     static cl_int releaseCommandQueue(cl_command_queue command_queue);
     static cl_int releaseContext(cl_context context);
+    static cl_int releaseEvent(cl_event event);
     static cl_int releaseKernel(cl_kernel kernel);
     static cl_int releaseMemObject(cl_mem mem_obj);
     static cl_int releaseProgram(cl_program program);
+    static cl_int retainEvent(cl_event event);
+    static cl_int setEventCallback(cl_event event, cl_int command_exec_callback_type, void (CL_CALLBACK *pfn_notify)(cl_event, cl_int, void *), void *user_data);
     static cl_int setKernelArg(cl_kernel kernel, cl_uint arg_index, size_t arg_size, const void *arg_value);
+    static cl_int waitForEvents(cl_uint num_events, const cl_event *event_list);
     static cl_kernel createKernel(cl_program program, const char *kernel_name, cl_int *errcode_ret);
     static cl_mem createBuffer(cl_context context, cl_mem_flags flags, size_t size, void *host_ptr, cl_int *errcode_ret);
     static cl_program createProgramWithBinary(cl_context context, cl_uint num_devices, const cl_device_id *device_list, const size_t *lengths, const unsigned char **binaries, cl_int *binary_status, cl_int *errcode_ret);
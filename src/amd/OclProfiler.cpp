@@ -0,0 +1,226 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <algorithm>
+#include <string.h>
+
+
+#include "amd/OclLib.h"
+#include "amd/OclProfiler.h"
+#include "common/log/Log.h"
+
+
+#ifndef XMRIG_NO_API
+#   include "rapidjson/document.h"
+#endif
+
+
+static const char *kStageNames[OclProfiler::StageMax] = { "cn0", "cn1", "cn2", "blake", "groestl", "jh", "skein", "read", "write", "idle" };
+
+
+static inline size_t bucket(uint64_t ns)
+{
+    uint64_t us = ns / 1000;
+    size_t index = 0;
+
+    while (us > 1 && index < OclProfiler::kBuckets - 1) {
+        us >>= 1;
+        index++;
+    }
+
+    return index;
+}
+
+
+OclProfiler::OclProfiler(size_t deviceIdx, size_t threadIdx) :
+    m_lastEnd(0),
+    m_deviceIdx(deviceIdx),
+    m_threadIdx(threadIdx)
+{
+    memset(m_stats, 0, sizeof(m_stats));
+    m_pending.reserve(32);
+
+    uv_mutex_init(&m_mutex);
+}
+
+
+OclProfiler::~OclProfiler()
+{
+    for (const Pending &pending : m_pending) {
+        if (pending.event) {
+            OclLib::releaseEvent(pending.event);
+        }
+    }
+
+    uv_mutex_destroy(&m_mutex);
+}
+
+
+// Slot for the event of the next command, filled by the enqueue call.
+cl_event *OclProfiler::event(Stage stage)
+{
+    m_pending.push_back({ stage, nullptr });
+
+    return &m_pending.back().event;
+}
+
+
+// Adds an event owned by somebody else, it is retained until collected.
+void OclProfiler::add(Stage stage, cl_event event)
+{
+    if (event && OclLib::retainEvent(event) == CL_SUCCESS) {
+        m_pending.push_back({ stage, event });
+    }
+}
+
+
+// Called by the worker thread after a blocking read, commands still running have no profiling info yet and are kept for the next call.
+void OclProfiler::collect()
+{
+    std::vector<Pending> running;
+    running.reserve(m_pending.capacity());
+
+    for (const Pending &pending : m_pending) {
+        if (!pending.event) {
+            continue;
+        }
+
+        cl_ulong times[4] = { 0 };
+        const cl_profiling_info params[4] = { CL_PROFILING_COMMAND_QUEUED, CL_PROFILING_COMMAND_SUBMIT, CL_PROFILING_COMMAND_START, CL_PROFILING_COMMAND_END };
+
+        cl_int ret = CL_SUCCESS;
+        for (size_t i = 0; i < 4 && ret == CL_SUCCESS; ++i) {
+            ret = OclLib::getEventProfilingInfo(pending.event, params[i], sizeof(cl_ulong), times + i);
+        }
+
+        if (ret == CL_PROFILING_INFO_NOT_AVAILABLE) {
+            running.push_back(pending);
+            continue;
+        }
+
+        OclLib::releaseEvent(pending.event);
+
+        if (ret == CL_SUCCESS) {
+            add(pending.stage, times[0], times[1], times[2], times[3]);
+        }
+    }
+
+    m_pending.swap(running);
+}
+
+
+void OclProfiler::print() const
+{
+    char buf[512] = { 0 };
+    int size      = 0;
+
+    uv_mutex_lock(&m_mutex);
+
+    for (int i = 0; i < StageMax && size < static_cast<int>(sizeof(buf)); ++i) {
+        if (m_stats[i].count) {
+            size += snprintf(buf + size, sizeof(buf) - size, " %s %.2f", kStageNames[i], m_stats[i].exec / 1000000.0 / m_stats[i].count);
+        }
+    }
+
+    uv_mutex_unlock(&m_mutex);
+
+    if (size > 0) {
+        LOG_INFO("profile GPU #%zu thread #%zu, avg ms:%s", m_deviceIdx, m_threadIdx, buf);
+    }
+}
+
+
+#ifndef XMRIG_NO_API
+rapidjson::Value OclProfiler::toAPI(rapidjson::Document &doc) const
+{
+    using namespace rapidjson;
+    auto &allocator = doc.GetAllocator();
+
+    uv_mutex_lock(&m_mutex);
+    Stats stats[StageMax];
+    memcpy(stats, m_stats, sizeof(stats));
+    uv_mutex_unlock(&m_mutex);
+
+    Value stages(kObjectType);
+    for (int i = 0; i < StageMax; ++i) {
+        const Stats &s = stats[i];
+        if (!s.count) {
+            continue;
+        }
+
+        Value histogram(kArrayType);
+        for (size_t j = 0; j < kBuckets; ++j) {
+            histogram.PushBack(s.buckets[j], allocator);
+        }
+
+        Value stage(kObjectType);
+        stage.AddMember("count",     s.count, allocator);
+        stage.AddMember("queued",    s.queued / s.count / 1000, allocator);
+        stage.AddMember("submit",    s.submit / s.count / 1000, allocator);
+        stage.AddMember("exec",      s.exec / s.count / 1000, allocator);
+        stage.AddMember("max",       s.max / 1000, allocator);
+        stage.AddMember("histogram", histogram, allocator);
+
+        stages.AddMember(StringRef(kStageNames[i]), stage, allocator);
+    }
+
+    Value obj(kObjectType);
+    obj.AddMember("device", static_cast<uint64_t>(m_deviceIdx), allocator);
+    obj.AddMember("thread", static_cast<uint64_t>(m_threadIdx), allocator);
+    obj.AddMember("stages", stages, allocator);
+
+    return obj;
+}
+#endif
+
+
+void OclProfiler::addTime(Stats &stats, uint64_t exec)
+{
+    stats.count++;
+    stats.exec += exec;
+    stats.max   = std::max(stats.max, exec);
+    stats.buckets[bucket(exec)]++;
+}
+
+
+void OclProfiler::add(Stage stage, cl_ulong queued, cl_ulong submit, cl_ulong start, cl_ulong end)
+{
+    uv_mutex_lock(&m_mutex);
+
+    // the queue is in-order, a gap to the previous command means the device had nothing of this thread to run
+    if (m_lastEnd && start > m_lastEnd) {
+        addTime(m_stats[Idle], start - m_lastEnd);
+    }
+
+    m_lastEnd = std::max(m_lastEnd, end);
+
+    Stats &s = m_stats[stage];
+    s.queued += submit > queued ? submit - queued : 0;
+    s.submit += start > submit ? start - submit : 0;
+
+    addTime(s, end > start ? end - start : 0);
+
+    uv_mutex_unlock(&m_mutex);
+}
@@ -0,0 +1,109 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef XMRIG_OCLPROFILER_H
+#define XMRIG_OCLPROFILER_H
+
+
+#include <uv.h>
+#include <vector>
+
+
+#include "amd/GpuContext.h"
+#include "rapidjson/fwd.h"
+
+
+/**
+ * Per-kernel timings of one GPU thread, only created with --opencl-profile.
+ *
+ * The command queue of the thread is created with CL_QUEUE_PROFILING_ENABLE and every command of a batch gets an
+ * event. Events are collected once the queue is drained, their queued, submit, start and end times are added to
+ * the stage statistics and a log2 histogram of execution times. Gaps between the end of one command and the start
+ * of the next one are counted as idle time, it is mostly the host round trip between batches.
+ */
+class OclProfiler
+{
+public:
+    enum Stage {
+        Cn0,
+        Cn1,
+        Cn2,
+        Blake,
+        Groestl,
+        Jh,
+        Skein,
+        Read,
+        Write,
+        Idle,
+        StageMax
+    };
+
+    static const size_t kBuckets = 24; // bucket i counts times in [2^i, 2^(i+1)) microseconds
+
+    OclProfiler(size_t deviceIdx, size_t threadIdx);
+    ~OclProfiler();
+
+    cl_event *event(Stage stage);
+    void add(Stage stage, cl_event event);
+    void collect();
+    void print() const;
+
+    inline size_t deviceIdx() const { return m_deviceIdx; }
+    inline size_t threadIdx() const { return m_threadIdx; }
+
+#   ifndef XMRIG_NO_API
+    rapidjson::Value toAPI(rapidjson::Document &doc) const;
+#   endif
+
+private:
+    struct Pending
+    {
+        Stage stage;
+        cl_event event;
+    };
+
+    struct Stats
+    {
+        uint64_t buckets[kBuckets];
+        uint64_t count;
+        uint64_t exec;
+        uint64_t max;
+        uint64_t queued;
+        uint64_t submit;
+    };
+
+    static void addTime(Stats &stats, uint64_t exec);
+
+    void add(Stage stage, cl_ulong queued, cl_ulong submit, cl_ulong start, cl_ulong end);
+
+    cl_ulong m_lastEnd;
+    const size_t m_deviceIdx;
+    const size_t m_threadIdx;
+    mutable uv_mutex_t m_mutex;
+    Stats m_stats[StageMax];
+    std::vector<Pending> m_pending;
+};
+
+
+#endif /* XMRIG_OCLPROFILER_H */
@@ -0,0 +1,259 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <algorithm>
+#include <math.h>
+
+
+#include "amd/OclLib.h"
+#include "amd/OclScheduler.h"
+#include "rapidjson/document.h"
+
+
+// Longer gaps mean there was no job or mining was paused, they are not counted as idle device time.
+static const uint64_t kMaxGap = 1000000000ULL;
+
+
+std::vector<OclScheduler *> OclScheduler::m_schedulers;
+
+
+OclScheduler::OclScheduler(size_t deviceIdx) :
+    m_tracking(true),
+    m_last(nullptr),
+    m_deviceIdx(deviceIdx),
+    m_threads(0),
+    m_pending(0),
+    m_aborted(0),
+    m_completed(0),
+    m_switches(0),
+    m_switchMax(0),
+    m_switchTime(0),
+    m_batches(0),
+    m_excluded(0),
+    m_idle(0),
+    m_stalls(0),
+    m_started(0)
+{
+    uv_mutex_init(&m_mutex);
+}
+
+
+cl_int OclScheduler::enqueue(cl_command_queue queue, cl_kernel kernel, cl_uint work_dim, const size_t *global_work_offset, const size_t *global_work_size, const size_t *local_work_size, cl_event *out)
+{
+    uv_mutex_lock(&m_mutex);
+
+    cl_event event = nullptr;
+    const cl_int ret = OclLib::enqueueNDRangeKernel(queue, kernel, work_dim, global_work_offset, global_work_size, local_work_size, m_last ? 1 : 0, m_last ? &m_last : nullptr, &event);
+    if (ret != CL_SUCCESS) {
+        uv_mutex_unlock(&m_mutex);
+        return ret;
+    }
+
+    const uint64_t now = uv_hrtime();
+    if (m_started == 0) {
+        m_started = now;
+    }
+    else if (m_tracking && m_pending == 0) {
+        const uint64_t completed = m_completed;
+        const uint64_t gap       = now > completed ? now - completed : 0;
+
+        if (gap > kMaxGap) {
+            m_excluded += gap;
+        }
+        else {
+            m_idle += gap;
+            m_stalls++;
+        }
+    }
+
+    m_batches++;
+
+    if (m_last) {
+        OclLib::releaseEvent(m_last);
+    }
+
+    m_last = event;
+
+    if (out && OclLib::retainEvent(event) == CL_SUCCESS) {
+        *out = event;
+    }
+
+    if (m_tracking) {
+        m_pending++;
+
+        if (OclLib::setEventCallback(event, CL_COMPLETE, OclScheduler::onComplete, this) != CL_SUCCESS) {
+            m_pending--;
+            m_tracking = false;
+        }
+    }
+
+    uv_mutex_unlock(&m_mutex);
+
+    OclLib::flush(queue);
+
+    return CL_SUCCESS;
+}
+
+
+double OclScheduler::occupancy() const
+{
+    uv_mutex_lock(&m_mutex);
+
+    if (!m_tracking || m_started == 0) {
+        uv_mutex_unlock(&m_mutex);
+        return 0.0;
+    }
+
+    const uint64_t now = uv_hrtime();
+    uint64_t excluded  = m_excluded;
+    uint64_t idle      = m_idle;
+
+    if (m_pending == 0) {
+        const uint64_t completed = m_completed;
+        const uint64_t gap       = now > completed ? now - completed : 0;
+
+        if (gap > kMaxGap) {
+            excluded += gap;
+        }
+        else {
+            idle += gap;
+        }
+    }
+
+    uv_mutex_unlock(&m_mutex);
+
+    const uint64_t elapsed = now - m_started - std::min(excluded, now - m_started);
+    if (elapsed == 0) {
+        return 0.0;
+    }
+
+    return 100.0 * static_cast<double>(elapsed - std::min(idle, elapsed)) / elapsed;
+}
+
+
+// Average time from a new job to the first kernel launch on it, milliseconds.
+double OclScheduler::switchTime() const
+{
+    const uint64_t switches = m_switches.load(std::memory_order_relaxed);
+
+    return switches ? m_switchTime.load(std::memory_order_relaxed) / 1000.0 / switches : 0.0;
+}
+
+
+void OclScheduler::addAborted()
+{
+    m_aborted++;
+}
+
+
+void OclScheduler::addSwitch(uint64_t latency)
+{
+    m_switchTime += latency;
+    m_switches++;
+
+    uint64_t max = m_switchMax.load(std::memory_order_relaxed);
+    while (latency > max && !m_switchMax.compare_exchange_weak(max, latency, std::memory_order_relaxed)) {}
+}
+
+
+void OclScheduler::release()
+{
+    uv_mutex_lock(&m_mutex);
+
+    if (m_last) {
+        OclLib::releaseEvent(m_last);
+        m_last = nullptr;
+    }
+
+    uv_mutex_unlock(&m_mutex);
+}
+
+
+#ifndef XMRIG_NO_API
+rapidjson::Value OclScheduler::toAPI(rapidjson::Document &doc) const
+{
+    using namespace rapidjson;
+    auto &allocator = doc.GetAllocator();
+
+    uv_mutex_lock(&m_mutex);
+    const bool tracking    = m_tracking;
+    const uint64_t batches = m_batches;
+    const uint64_t stalls  = m_stalls;
+    const uint64_t idle    = m_idle;
+    uv_mutex_unlock(&m_mutex);
+
+    Value obj(kObjectType);
+    obj.AddMember("index",     static_cast<uint64_t>(m_deviceIdx), allocator);
+    obj.AddMember("threads",   static_cast<uint64_t>(m_threads), allocator);
+    obj.AddMember("batches",   batches, allocator);
+    obj.AddMember("occupancy", tracking ? Value(floor(occupancy() * 100.0) / 100.0).Move() : Value(kNullType).Move(), allocator);
+    obj.AddMember("stalls",    stalls, allocator);
+    obj.AddMember("idle_time", idle / 1000000, allocator);
+    obj.AddMember("aborted",   m_aborted.load(std::memory_order_relaxed), allocator);
+
+    Value jobSwitch(kObjectType);
+    jobSwitch.AddMember("count", m_switches.load(std::memory_order_relaxed), allocator);
+    jobSwitch.AddMember("avg",   floor(switchTime() * 100.0) / 100.0, allocator);
+    jobSwitch.AddMember("max",   floor(m_switchMax.load(std::memory_order_relaxed) / 10.0) / 100.0, allocator);
+    obj.AddMember("job_switch", jobSwitch, allocator);
+
+    return obj;
+}
+#endif
+
+
+void OclScheduler::create(const std::vector<GpuContext *> &contexts)
+{
+    for (GpuContext *ctx : contexts) {
+        auto it = std::find_if(m_schedulers.begin(), m_schedulers.end(), [ctx](const OclScheduler *scheduler) { return scheduler->deviceIdx() == ctx->deviceIdx; });
+
+        OclScheduler *scheduler = it != m_schedulers.end() ? *it : nullptr;
+        if (!scheduler) {
+            scheduler = new OclScheduler(ctx->deviceIdx);
+            m_schedulers.push_back(scheduler);
+        }
+
+        scheduler->m_threads++;
+        ctx->scheduler = scheduler;
+    }
+}
+
+
+void OclScheduler::releaseAll()
+{
+    for (OclScheduler *scheduler : m_schedulers) {
+        scheduler->release();
+    }
+}
+
+
+void CL_CALLBACK OclScheduler::onComplete(cl_event, cl_int, void *data)
+{
+    auto scheduler = static_cast<OclScheduler *>(data);
+
+    // May be called from the OpenCL runtime thread or synchronously from enqueue(), so the mutex is not used here.
+    scheduler->m_completed.store(uv_hrtime());
+    scheduler->m_pending--;
+}
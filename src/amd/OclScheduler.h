@@ -0,0 +1,95 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef XMRIG_OCLSCHEDULER_H
+#define XMRIG_OCLSCHEDULER_H
+
+
+#include <atomic>
+#include <uv.h>
+#include <vector>
+
+
+#include "amd/GpuContext.h"
+#include "rapidjson/fwd.h"
+
+
+/**
+ * Orders the main hash loop (cn1) of all threads sharing one GPU.
+ *
+ * Each cn1 dispatch waits for the completion event of the previous one on the same device, so heavy kernels of
+ * different threads run back to back and the host round trip of one thread overlaps with the kernels of others.
+ * Completion callbacks are used to measure how long the device stays without queued work.
+ */
+class OclScheduler
+{
+public:
+    OclScheduler(size_t deviceIdx);
+
+    cl_int enqueue(cl_command_queue queue, cl_kernel kernel, cl_uint work_dim, const size_t *global_work_offset, const size_t *global_work_size, const size_t *local_work_size, cl_event *event = nullptr);
+    double occupancy() const;
+    double switchTime() const;
+    void addAborted();
+    void addSwitch(uint64_t latency);
+    void release();
+
+    inline size_t deviceIdx() const  { return m_deviceIdx; }
+    inline size_t threads() const    { return m_threads; }
+    inline uint64_t aborted() const  { return m_aborted.load(std::memory_order_relaxed); }
+    inline uint64_t switches() const { return m_switches.load(std::memory_order_relaxed); }
+
+#   ifndef XMRIG_NO_API
+    rapidjson::Value toAPI(rapidjson::Document &doc) const;
+#   endif
+
+    static inline const std::vector<OclScheduler *> &schedulers() { return m_schedulers; }
+
+    static void create(const std::vector<GpuContext *> &contexts);
+    static void releaseAll();
+
+private:
+    static void CL_CALLBACK onComplete(cl_event event, cl_int status, void *data);
+
+    bool m_tracking;
+    cl_event m_last;
+    const size_t m_deviceIdx;
+    mutable uv_mutex_t m_mutex;
+    size_t m_threads;
+    std::atomic<size_t> m_pending;
+    std::atomic<uint64_t> m_aborted;
+    std::atomic<uint64_t> m_completed;
+    std::atomic<uint64_t> m_switches;
+    std::atomic<uint64_t> m_switchMax;
+    std::atomic<uint64_t> m_switchTime;
+    uint64_t m_batches;
+    uint64_t m_excluded;
+    uint64_t m_idle;
+    uint64_t m_stalls;
+    uint64_t m_started;
+
+    static std::vector<OclScheduler *> m_schedulers;
+};
+
+
+#endif /* XMRIG_OCLSCHEDULER_H */
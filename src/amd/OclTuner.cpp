@@ -0,0 +1,628 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <inttypes.h>
+#include <stdio.h>
+#include <thread>
+
+
+#include "amd/OclCache.h"
+#include "amd/OclError.h"
+#include "amd/OclGPU.h"
+#include "amd/OclLib.h"
+#include "amd/OclTuner.h"
+#include "common/log/Log.h"
+#include "core/Config.h"
+#include "core/Controller.h"
+#include "crypto/CryptoNight.h"
+#include "crypto/CryptoNight_constants.h"
+#include "net/JobResult.h"
+#include "rapidjson/document.h"
+#include "rapidjson/prettywriter.h"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+#include "workers/Benchmark.h"
+#include "workers/OclThread.h"
+
+
+static const double kMinGain      = 1.02;  // a candidate must be at least 2% faster to replace the current best
+static const size_t kMaxPasses    = 2;
+static const size_t kMaxTrials    = 32;    // per device
+static const size_t kMaxVerify    = 64;    // found nonces checked on the CPU per trial
+static const size_t kMinExpected  = 16;    // a trial without results is rejected once this many were expected
+static const uint64_t kTrialTime  = 2000;  // ms, excluding the warm-up batch
+static const size_t kReservedMem  = 128u * 1024u * 1024u;
+
+
+OclTuner::OclTuner(xmrig::Controller *controller) :
+    m_started(false),
+    m_ctx(nullptr),
+    m_exitCode(1),
+    m_stop(false),
+    m_thread(),
+    m_controller(controller),
+    m_job(Benchmark::createJob(controller->config()->algorithm()))
+{
+    m_memory = Mem::create(&m_ctx, m_job.algorithm().algo(), 1);
+
+    m_async.data = this;
+    uv_async_init(uv_default_loop(), &m_async, OclTuner::onFinished);
+}
+
+
+OclTuner::~OclTuner()
+{
+    m_stop = true;
+
+    if (m_started) {
+        uv_thread_join(&m_thread);
+    }
+
+    Mem::release(&m_ctx, 1, m_memory);
+}
+
+
+void OclTuner::start()
+{
+    LOG_INFO(m_controller->config()->isColors() ? "tune " WHITE_BOLD("%s") ", up to " WHITE_BOLD("%zu") " trials of " WHITE_BOLD("%.1fs") " per GPU"
+                                                : "tune %s, up to %zu trials of %.1fs per GPU",
+             m_job.algorithm().name(), kMaxTrials, kTrialTime / 1000.0);
+
+    m_started = uv_thread_create(&m_thread, OclTuner::onRun, this) == 0;
+}
+
+
+void OclTuner::stop()
+{
+    m_stop = true;
+}
+
+
+bool OclTuner::load(Device &device) const
+{
+    using namespace rapidjson;
+
+    std::string data;
+    if (!OclCache::read(OclCache::fileName(device.cacheName, ".json"), data)) {
+        return false;
+    }
+
+    Document doc;
+    if (doc.Parse(data.c_str()).HasParseError() || !doc.IsObject()) {
+        LOG_WARN("tune GPU #%zu ignores a corrupted cache entry", device.info.deviceIdx);
+        return false;
+    }
+
+    const char *keys[] = { "intensity", "worksize", "strided_index", "mem_chunk", "unroll" };
+    for (const char *key : keys) {
+        if (!doc.HasMember(key) || !doc[key].IsUint()) {
+            LOG_WARN("tune GPU #%zu ignores a cache entry without a valid \"%s\"", device.info.deviceIdx, key);
+            return false;
+        }
+    }
+
+    Params params;
+    params.intensity    = doc["intensity"].GetUint();
+    params.worksize     = doc["worksize"].GetUint();
+    params.stridedIndex = static_cast<int>(doc["strided_index"].GetUint());
+    params.memChunk     = static_cast<int>(doc["mem_chunk"].GetUint());
+    params.unrollFactor = static_cast<int>(doc["unroll"].GetUint());
+
+    // the same limits the tuner and OclThread apply, a cache written for another driver or by hand may exceed them
+    if (params.worksize == 0 || params.worksize > device.maxWorksize ||
+        params.intensity == 0 || params.intensity > device.maxIntensity || params.intensity % params.worksize != 0 ||
+        params.stridedIndex > 2 || (params.stridedIndex == 1 && m_controller->config()->isCNv2()) ||
+        params.memChunk > 18 || params.unrollFactor < 1 || params.unrollFactor > 128) {
+        LOG_WARN("tune GPU #%zu ignores a cache entry out of range, intensity %zu worksize %zu %d/%d/%d",
+                 device.info.deviceIdx, params.intensity, params.worksize, params.stridedIndex, params.memChunk, params.unrollFactor);
+        return false;
+    }
+
+    device.params = params;
+
+    LOG_INFO(m_controller->config()->isColors() ? "tune GPU " WHITE_BOLD("#%zu") " loaded from cache, intensity " WHITE_BOLD("%zu") " worksize " WHITE_BOLD("%zu") " " CYAN_BOLD("%.1f H/s")
+                                                : "tune GPU #%zu loaded from cache, intensity %zu worksize %zu %.1f H/s",
+             device.info.deviceIdx, params.intensity, params.worksize, doc.HasMember("hashrate") && doc["hashrate"].IsNumber() ? doc["hashrate"].GetDouble() : 0.0);
+
+    return true;
+}
+
+
+bool OclTuner::prepare()
+{
+    xmrig::Config *config                       = m_controller->config();
+    const std::vector<cl_platform_id> platforms = OclLib::getPlatformIDs();
+
+    if (platforms.size() <= static_cast<size_t>(config->platformIndex())) {
+        return false;
+    }
+
+    cl_platform_id platform = platforms[config->platformIndex()];
+    cl_uint entries         = 0;
+
+    if (OclLib::getDeviceIDs(platform, CL_DEVICE_TYPE_GPU, 0, nullptr, &entries) != CL_SUCCESS || entries == 0) {
+        return false;
+    }
+
+    std::vector<cl_device_id> list(entries);
+    OclLib::getDeviceIDs(platform, CL_DEVICE_TYPE_GPU, entries, list.data(), nullptr);
+
+    char platformVersion[256] = { 0 };
+    OclLib::getPlatformInfo(platform, CL_PLATFORM_VERSION, sizeof(platformVersion) - 1, platformVersion, nullptr);
+
+    const size_t perThread = xmrig::cn_select_memory(m_job.algorithm().algo()) + 224u;
+
+    for (const xmrig::IThread *thread : config->threads()) {
+        const xmrig::OclThread *oclThread = static_cast<const xmrig::OclThread *>(thread);
+
+        auto it = std::find_if(m_devices.begin(), m_devices.end(), [oclThread](const Device &device) { return device.info.deviceIdx == oclThread->index(); });
+        if (it != m_devices.end()) {
+            it->threads++;
+            continue;
+        }
+
+        if (oclThread->index() >= entries) {
+            return false;
+        }
+
+        Device device;
+        device.affinity  = oclThread->affinity();
+        device.threads   = 1;
+
+        GpuContext &info = device.info;
+        info.deviceIdx   = oclThread->index();
+        info.platformIdx = config->platformIndex();
+        info.DeviceID    = list[info.deviceIdx];
+        info.vendor      = OclLib::getDeviceVendor(info.DeviceID);
+
+        OclLib::getDeviceInfo(info.DeviceID, CL_DEVICE_MAX_MEM_ALLOC_SIZE, sizeof(size_t), &info.freeMem);
+        OclLib::getDeviceInfo(info.DeviceID, CL_DEVICE_GLOBAL_MEM_SIZE,    sizeof(size_t), &info.globalMem);
+
+        size_t maxWorksize = 0;
+        OclLib::getDeviceInfo(info.DeviceID, CL_DEVICE_MAX_WORK_GROUP_SIZE, sizeof(size_t), &maxWorksize);
+        device.maxWorksize = m_job.algorithm().variant() == xmrig::VARIANT_GPU ? maxWorksize / 16 : maxWorksize;
+
+        device.params.intensity    = oclThread->intensity();
+        device.params.worksize     = oclThread->worksize();
+        device.params.stridedIndex = oclThread->stridedIndex();
+        device.params.memChunk     = oclThread->memChunk();
+        device.params.unrollFactor = oclThread->unrollFactor();
+
+        char driverVersion[256] = { 0 };
+        OclLib::getDeviceInfo(info.DeviceID, CL_DRIVER_VERSION, sizeof(driverVersion) - 1, driverVersion);
+        OclCache::get_device_string(info.platformIdx, info.DeviceID, info.DeviceString);
+
+        device.cacheName = info.DeviceString + driverVersion + platformVersion + std::to_string(info.globalMem);
+        m_devices.push_back(device);
+    }
+
+    for (Device &device : m_devices) {
+        const GpuContext &info = device.info;
+        const size_t available = info.globalMem > kReservedMem ? info.globalMem - kReservedMem : info.globalMem / 2;
+
+        device.maxIntensity = std::min(info.freeMem / perThread, available / perThread / device.threads);
+
+        char options[64] = { 0 };
+        snprintf(options, sizeof(options), "threads=%zu", device.threads);
+
+        std::string hash;
+        OclCache::calc_hash(device.cacheName, m_job.algorithm().name(), options, hash);
+        device.cacheName = "tune_" + hash;
+    }
+
+    return !m_devices.empty();
+}
+
+
+double OclTuner::trial(const Device &device, const Params &params)
+{
+    struct Result
+    {
+        bool failed;
+        double hashrate;
+        uint64_t hashes;
+        std::vector<uint32_t> nonces;
+    };
+
+    xmrig::Config *config       = m_controller->config();
+    const xmrig::Variant variant = m_job.algorithm().variant();
+    const size_t count           = device.threads;
+
+    std::vector<GpuContext> contexts(count);
+    std::vector<GpuContext *> list;
+
+    for (GpuContext &ctx : contexts) {
+        ctx.deviceIdx    = device.info.deviceIdx;
+        ctx.rawIntensity = params.intensity;
+        ctx.workSize     = params.worksize;
+        ctx.threads      = count;
+        ctx.stridedIndex = params.stridedIndex;
+        ctx.memChunk     = params.memChunk;
+        ctx.compMode     = 0;
+        ctx.unrollFactor = params.unrollFactor;
+        ctx.pipeline     = false;
+        ctx.cache        = config->isOclCache();
+        ctx.vendor       = device.info.vendor;
+
+        list.push_back(&ctx);
+    }
+
+    cl_context opencl_ctx = nullptr;
+    const char *error     = nullptr;
+    std::vector<Result> results(count);
+
+    if (InitOpenCL(list, config, &opencl_ctx) != OCL_ERR_SUCCESS) {
+        error = "initialization failed";
+    }
+    else {
+        std::vector<std::thread> threads;
+
+        for (size_t i = 0; i < count; ++i) {
+            threads.emplace_back([this, &list, &results, variant, count, i]() {
+                GpuContext *ctx = list[i];
+                Result &result  = results[i];
+                result          = { true, 0.0, 0, {} };
+                ctx->Nonce      = 0xffffffffU / count * i;
+
+                uint8_t blob[xmrig::Job::kMaxBlobSize];
+                memcpy(blob, m_job.blob(), sizeof(blob));
+
+                if (XMRSetJob(ctx, blob, m_job.size(), m_job.target(), variant, m_job.height()) != OCL_ERR_SUCCESS) {
+                    return;
+                }
+
+                cl_uint output[0x100];
+                uint64_t started = 0;
+                uint64_t elapsed = 0;
+
+                // the first batch is a warm-up, its results are verified but it is not timed
+                while (!m_stop && elapsed < kTrialTime) {
+                    memset(output, 0, sizeof(output));
+
+                    if (XMRRunJob(ctx, output, variant) != OCL_ERR_SUCCESS) {
+                        return;
+                    }
+
+                    for (size_t k = 0; k < output[0xFF] && result.nonces.size() < kMaxVerify; ++k) {
+                        result.nonces.push_back(output[k]);
+                    }
+
+                    if (started == 0) {
+                        started = uv_hrtime();
+                        continue;
+                    }
+
+                    result.hashes += ctx->Hashes;
+                    elapsed = (uv_hrtime() - started) / 1000000;
+                }
+
+                result.hashrate = elapsed ? result.hashes * 1000.0 / elapsed : 0.0;
+                result.failed   = false;
+            });
+        }
+
+        for (std::thread &thread : threads) {
+            thread.join();
+        }
+    }
+
+    for (GpuContext &ctx : contexts) {
+        ReleaseOpenCl(&ctx);
+    }
+
+    ReleaseOpenClContext(opencl_ctx);
+
+    double hashrate = 0.0;
+    uint64_t hashes = 0;
+    size_t found    = 0;
+    size_t invalid  = 0;
+
+    for (const Result &result : results) {
+        if (error || m_stop) {
+            break;
+        }
+
+        if (result.failed) {
+            error = "batch failed";
+            break;
+        }
+
+        hashrate += result.hashrate;
+        hashes   += result.hashes;
+        found    += result.nonces.size();
+
+        for (uint32_t nonce : result.nonces) {
+            xmrig::Job job(m_job);
+            *job.nonce() = nonce;
+
+            xmrig::JobResult check(job);
+            if (!CryptoNight::hash(job, check, m_ctx)) {
+                invalid++;
+            }
+        }
+    }
+
+    if (!error && invalid > 0) {
+        error = "invalid results";
+    }
+
+    if (!error && found == 0 && hashes / m_job.diff() >= kMinExpected) {
+        error = "no results";
+    }
+
+    const bool colors = config->isColors();
+
+    if (error || m_stop) {
+        hashrate = 0.0;
+
+        if (!m_stop) {
+            LOG_WARN(colors ? "tune GPU " WHITE_BOLD("#%zu") " i:%zu w:%zu si:%d/%d u:%d " RED_BOLD("rejected") ", %s (%zu of %zu)"
+                            : "tune GPU #%zu i:%zu w:%zu si:%d/%d u:%d rejected, %s (%zu of %zu)",
+                     device.info.deviceIdx, params.intensity, params.worksize, params.stridedIndex, params.memChunk, params.unrollFactor, error, invalid, found);
+        }
+    }
+    else {
+        LOG_INFO(colors ? "tune GPU " WHITE_BOLD("#%zu") " i:%zu w:%zu si:%d/%d u:%d " CYAN_BOLD("%.1f H/s") ", verified %zu"
+                        : "tune GPU #%zu i:%zu w:%zu si:%d/%d u:%d %.1f H/s, verified %zu",
+                 device.info.deviceIdx, params.intensity, params.worksize, params.stridedIndex, params.memChunk, params.unrollFactor, hashrate, found);
+    }
+
+    m_trials[params.key()] = hashrate;
+
+    return hashrate;
+}
+
+
+OclTuner::Params OclTuner::normalize(const Device &device, Params params) const
+{
+    params.worksize  = std::max<size_t>(std::min(params.worksize, device.maxWorksize), 1);
+    params.intensity = std::min(params.intensity, device.maxIntensity) / params.worksize * params.worksize;
+
+    if (params.intensity == 0) {
+        params.intensity = params.worksize;
+    }
+
+    return params;
+}
+
+
+std::vector<OclTuner::Params> OclTuner::candidates(const Device &device, const Params &base, int dimension) const
+{
+    std::vector<Params> list;
+    Params params = base;
+
+    switch (dimension) {
+    case 0:
+        for (size_t percent : { 50, 75, 125, 150 }) {
+            params.intensity = base.intensity * percent / 100;
+            list.push_back(params);
+        }
+        break;
+
+    case 1:
+        for (size_t worksize : { 8, 16, 32, 64 }) {
+            if (worksize <= device.maxWorksize) {
+                params.worksize = worksize;
+                list.push_back(params);
+            }
+        }
+        break;
+
+    case 2:
+        for (const std::pair<int, int> &value : { std::make_pair(0, 2), std::make_pair(1, 2), std::make_pair(2, 1), std::make_pair(2, 2), std::make_pair(2, 3) }) {
+            // strided_index 1 is not compatible with CryptoNight variant 2
+            if (value.first == 1 && m_controller->config()->isCNv2()) {
+                continue;
+            }
+
+            params.stridedIndex = value.first;
+            params.memChunk     = value.second;
+            list.push_back(params);
+        }
+        break;
+
+    default:
+        for (int unroll : { 1, 2, 4, 8 }) {
+            params.unrollFactor = unroll;
+            list.push_back(params);
+        }
+        break;
+    }
+
+    return list;
+}
+
+
+void OclTuner::finish()
+{
+    uv_close(reinterpret_cast<uv_handle_t*>(&m_async), nullptr);
+
+    if (m_stop) {
+        LOG_WARN("tune interrupted, configuration not changed");
+    }
+    else if (!m_devices.empty()) {
+        write();
+        m_exitCode = 0;
+    }
+    else {
+        LOG_ERR("tune no OpenCL devices to tune");
+    }
+
+    uv_stop(uv_default_loop());
+}
+
+
+void OclTuner::run()
+{
+    if (!prepare()) {
+        m_devices.clear();
+        uv_async_send(&m_async);
+        return;
+    }
+
+    for (Device &device : m_devices) {
+        if (m_stop) {
+            break;
+        }
+
+        if (!load(device)) {
+            search(device);
+        }
+    }
+
+    uv_async_send(&m_async);
+}
+
+
+void OclTuner::save(const Device &device, double hashrate) const
+{
+    using namespace rapidjson;
+
+    Document doc(kObjectType);
+    auto &allocator = doc.GetAllocator();
+
+    doc.AddMember("intensity",     static_cast<uint64_t>(device.params.intensity), allocator);
+    doc.AddMember("worksize",      static_cast<uint64_t>(device.params.worksize), allocator);
+    doc.AddMember("strided_index", device.params.stridedIndex, allocator);
+    doc.AddMember("mem_chunk",     device.params.memChunk, allocator);
+    doc.AddMember("unroll",        device.params.unrollFactor, allocator);
+    doc.AddMember("hashrate",      hashrate, allocator);
+
+    StringBuffer buffer(nullptr, 512);
+    Writer<StringBuffer> writer(buffer);
+    doc.Accept(writer);
+
+    OclCache::write(OclCache::fileName(device.cacheName, ".json"), buffer.GetString());
+}
+
+
+void OclTuner::search(Device &device)
+{
+    m_trials.clear();
+
+    Params best     = normalize(device, device.params);
+    double bestRate = trial(device, best);
+
+    for (size_t pass = 0; pass < kMaxPasses && !m_stop; ++pass) {
+        bool improved = false;
+
+        for (int dimension = 0; dimension < 4; ++dimension) {
+            for (const Params &candidate : candidates(device, best, dimension)) {
+                if (m_stop || m_trials.size() >= kMaxTrials) {
+                    break;
+                }
+
+                const Params params = normalize(device, candidate);
+                if (m_trials.count(params.key())) {
+                    continue;
+                }
+
+                const double hashrate = trial(device, params);
+                if (hashrate > bestRate * kMinGain) {
+                    best     = params;
+                    bestRate = hashrate;
+                    improved = true;
+                }
+            }
+        }
+
+        if (!improved) {
+            break;
+        }
+    }
+
+    if (m_stop) {
+        return;
+    }
+
+    if (bestRate == 0.0) {
+        LOG_ERR("tune GPU #%zu no valid configuration found, keeping the configured values", device.info.deviceIdx);
+        return;
+    }
+
+    device.params = best;
+    save(device, bestRate);
+
+    LOG_NOTICE(m_controller->config()->isColors() ? "tune GPU " WHITE_BOLD("#%zu") " best intensity " WHITE_BOLD("%zu") " worksize " WHITE_BOLD("%zu") " strided_index " WHITE_BOLD("%d") " mem_chunk " WHITE_BOLD("%d") " unroll " WHITE_BOLD("%d") " " CYAN_BOLD("%.1f H/s") " after %zu trials"
+                                                  : "tune GPU #%zu best intensity %zu worksize %zu strided_index %d mem_chunk %d unroll %d %.1f H/s after %zu trials",
+               device.info.deviceIdx, best.intensity, best.worksize, best.stridedIndex, best.memChunk, best.unrollFactor, bestRate, m_trials.size());
+}
+
+
+void OclTuner::write()
+{
+    using namespace rapidjson;
+
+    xmrig::Config *config = m_controller->config();
+    std::vector<xmrig::IThread *> threads;
+
+    for (const xmrig::IThread *thread : config->threads()) {
+        auto it = std::find_if(m_devices.begin(), m_devices.end(), [thread](const Device &device) { return device.info.deviceIdx == thread->index(); });
+        const Params &params = it->params;
+
+        xmrig::OclThread *oclThread = new xmrig::OclThread(it->info.deviceIdx, params.intensity, params.worksize, thread->affinity());
+        oclThread->setStridedIndex(params.stridedIndex);
+        oclThread->setMemChunk(params.memChunk);
+        oclThread->setUnrollFactor(params.unrollFactor);
+        oclThread->setCompMode(false);
+
+        threads.push_back(oclThread);
+    }
+
+    config->setThreads(threads);
+
+    if (config->save()) {
+        return;
+    }
+
+    Document doc(kObjectType);
+    auto &allocator = doc.GetAllocator();
+
+    Value list(kArrayType);
+    for (const xmrig::IThread *thread : config->threads()) {
+        list.PushBack(thread->toConfig(doc), allocator);
+    }
+
+    doc.AddMember("threads", list, allocator);
+
+    StringBuffer buffer(nullptr, 4096);
+    PrettyWriter<StringBuffer> writer(buffer);
+    doc.Accept(writer);
+
+    printf("%s\n", buffer.GetString());
+    fflush(stdout);
+}
+
+
+void OclTuner::onFinished(uv_async_t *handle)
+{
+    static_cast<OclTuner*>(handle->data)->finish();
+}
+
+
+void OclTuner::onRun(void *arg)
+{
+    static_cast<OclTuner*>(arg)->run();
+}
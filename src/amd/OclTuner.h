@@ -0,0 +1,119 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef XMRIG_OCLTUNER_H
+#define XMRIG_OCLTUNER_H
+
+
+#include <atomic>
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <tuple>
+#include <uv.h>
+#include <vector>
+
+
+#include "amd/GpuContext.h"
+#include "common/net/Job.h"
+#include "Mem.h"
+
+
+namespace xmrig {
+    class Controller;
+    class IThread;
+}
+
+
+/**
+ * Per GPU search of intensity, worksize, strided_index/mem_chunk and unroll, used when --tune is set.
+ *
+ * Every candidate runs short timed batches of a synthetic job through XMRRunJob, all found nonces are checked again
+ * with CryptoNight::hash and a configuration that produces invalid results is rejected. The search is a bounded
+ * coordinate descent started from the configured (or auto configured) thread, the best result is cached per device
+ * string and driver in the OpenCL cache directory and written back to the config as the "threads" array.
+ */
+class OclTuner
+{
+public:
+    OclTuner(xmrig::Controller *controller);
+    ~OclTuner();
+
+    inline int exitCode() const { return m_exitCode; }
+
+    void start();
+    void stop();
+
+private:
+    struct Params
+    {
+        size_t intensity;
+        size_t worksize;
+        int stridedIndex;
+        int memChunk;
+        int unrollFactor;
+
+        inline std::tuple<size_t, size_t, int, int, int> key() const { return std::make_tuple(intensity, worksize, stridedIndex, memChunk, unrollFactor); }
+    };
+
+    struct Device
+    {
+        GpuContext info;
+        int64_t affinity;
+        Params params;
+        size_t maxIntensity;
+        size_t maxWorksize;
+        size_t threads;
+        std::string cacheName;
+    };
+
+    bool load(Device &device) const;
+    bool prepare();
+    double trial(const Device &device, const Params &params);
+    Params normalize(const Device &device, Params params) const;
+    std::vector<Params> candidates(const Device &device, const Params &base, int dimension) const;
+    void finish();
+    void run();
+    void save(const Device &device, double hashrate) const;
+    void search(Device &device);
+    void write();
+
+    static void onFinished(uv_async_t *handle);
+    static void onRun(void *arg);
+
+    bool m_started;
+    cryptonight_ctx *m_ctx;
+    int m_exitCode;
+    MemInfo m_memory;
+    std::atomic<bool> m_stop;
+    std::map<std::tuple<size_t, size_t, int, int, int>, double> m_trials;
+    std::vector<Device> m_devices;
+    uv_async_t m_async;
+    uv_thread_t m_thread;
+    xmrig::Controller *m_controller;
+    xmrig::Job m_job;
+};
+
+
+#endif /* XMRIG_OCLTUNER_H */
@@ -0,0 +1,1287 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <algorithm>
+#include <assert.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <uv.h>
+#include <vector>
+
+
+#include "amd/OclLib.h"
+#include "amd/OclVirtual.h"
+#include "common/log/Log.h"
+#include "crypto/CryptoNight.h"
+#include "Mem.h"
+
+
+enum VirtualKernel {
+    KERNEL_NOP,
+    KERNEL_CN0,
+    KERNEL_CN1,
+    KERNEL_CN1_GPU,
+    KERNEL_CN2,
+    KERNEL_CN2_GPU,
+    KERNEL_FINAL
+};
+
+
+struct _cl_platform_id
+{
+    cl_uint index;
+};
+
+
+struct _cl_device_id
+{
+    cl_uint index;
+};
+
+
+struct _cl_context
+{
+    std::vector<cl_device_id> devices;
+    std::atomic<uint64_t> allocated;
+};
+
+
+struct _cl_command_queue
+{
+    cl_device_id device;
+    cryptonight_ctx *ctx[1];
+    MemInfo memory;
+    xmrig::Algo algo;
+    bool profiling;
+    uint64_t ready; // device clock, when everything enqueued so far is complete
+};
+
+
+struct _cl_mem
+{
+    inline uint8_t *data()
+    {
+        if (bytes.empty()) {
+            bytes.resize(size);
+        }
+
+        return bytes.data();
+    }
+
+    cl_context context;
+    size_t size;
+    std::vector<uint8_t> bytes;
+};
+
+
+struct _cl_program
+{
+    bool built;
+    cl_context context;
+    std::string binary;
+    std::vector<cl_device_id> devices;
+    uint64_t height;
+    xmrig::Algo algo;
+};
+
+
+struct _cl_kernel
+{
+    template<typename T>
+    inline T arg(cl_uint index) const
+    {
+        T value = T();
+        if (index < args.size() && args[index].size() == sizeof(T)) {
+            memcpy(&value, args[index].data(), sizeof(T));
+        }
+
+        return value;
+    }
+
+    VirtualKernel type;
+    std::string name;
+    std::vector<std::vector<uint8_t>> args;
+    uint64_t height;
+    xmrig::Algo algo;
+};
+
+
+// Commands run on the host at enqueue time, start and end are the device clock of the queue, the event completes at end.
+struct _cl_event
+{
+    cl_int status;
+    std::atomic<int> refs;
+    bool profiling;
+    cl_ulong start;
+    cl_ulong end;
+};
+
+
+// Layout of one thread in the states buffer: padded blob with the nonce, then the final hash.
+static const size_t kStateSize  = 200;
+static const size_t kBlobSize   = 128;
+static const size_t kHashOffset = 128;
+
+static const char *kBinaryMagic = "xmrig-virtual ";
+static const char *kPrefix      = "virtual";
+
+
+static bool enabled            = false;
+static cl_uint devicesCount    = 1;
+static cl_uint computeUnits    = 8;
+static uint64_t batchLatency   = 0;
+static uint64_t roundTrip      = 0;
+static uint64_t deviceMemory   = 1024;
+static xmrig::OclVendor vendor = xmrig::OCL_VENDOR_AMD;
+
+static _cl_platform_id platform = { 0 };
+static std::vector<_cl_device_id> devices;
+
+
+// Callbacks of events that complete later on the device clock, called from a thread of the virtual runtime like a real one does.
+// The thread runs until the process exits, so its state is allocated once and never destroyed.
+struct Notifier
+{
+    struct Notification
+    {
+        cl_event event;
+        void (CL_CALLBACK *callback)(cl_event, cl_int, void *);
+        void *data;
+    };
+
+    std::condition_variable condition;
+    std::multimap<uint64_t, Notification> queue;
+    std::mutex mutex;
+};
+
+static Notifier *notifier = nullptr;
+static std::once_flag notifierFlag;
+
+
+static cl_int copyInfo(const void *value, size_t size, size_t param_value_size, void *param_value, size_t *param_value_size_ret)
+{
+    if (param_value_size_ret) {
+        *param_value_size_ret = size;
+    }
+
+    if (param_value) {
+        if (param_value_size < size) {
+            return CL_INVALID_VALUE;
+        }
+
+        memcpy(param_value, value, size);
+    }
+
+    return CL_SUCCESS;
+}
+
+
+static inline cl_int copyString(const char *value, size_t param_value_size, void *param_value, size_t *param_value_size_ret)
+{
+    return copyInfo(value, strlen(value) + 1, param_value_size, param_value, param_value_size_ret);
+}
+
+
+template<typename T>
+static inline cl_int copyValue(T value, size_t param_value_size, void *param_value, size_t *param_value_size_ret)
+{
+    return copyInfo(&value, sizeof(T), param_value_size, param_value, param_value_size_ret);
+}
+
+
+static inline uint64_t memorySize()
+{
+    return deviceMemory * 1024u * 1024u;
+}
+
+
+static const char *vendorName()
+{
+    switch (vendor) {
+    case xmrig::OCL_VENDOR_NVIDIA:
+        return "NVIDIA Corporation";
+
+    case xmrig::OCL_VENDOR_INTEL:
+        return "Intel(R) Corporation";
+
+    default:
+        break;
+    }
+
+    return "Advanced Micro Devices, Inc.";
+}
+
+
+static uint64_t defineValue(const std::string &options, const char *name, uint64_t defaultValue)
+{
+    const size_t pos = options.find(name);
+    if (pos == std::string::npos) {
+        return defaultValue;
+    }
+
+    return strtoull(options.c_str() + pos + strlen(name), nullptr, 10);
+}
+
+
+static void setBuildOptions(cl_program program, const std::string &options)
+{
+    program->binary = kBinaryMagic + options;
+    program->algo   = static_cast<xmrig::Algo>(defineValue(options, "-DALGO=", xmrig::CRYPTONIGHT));
+    program->built  = true;
+}
+
+
+static size_t blobSize(const uint8_t *blob)
+{
+    // XMRSetJob terminates the blob with 0x01 and pads it with zeros.
+    size_t size = kBlobSize;
+    while (size > 0 && blob[size - 1] == 0) {
+        --size;
+    }
+
+    return size > 0 ? size - 1 : 0;
+}
+
+
+static inline bool hasStates(cl_mem states, size_t count)
+{
+    return states && states->size >= count * kStateSize;
+}
+
+
+static inline bool hasCounter(cl_mem buffer, size_t index)
+{
+    return buffer && buffer->size >= (index + 1) * sizeof(cl_uint);
+}
+
+
+static void addResult(cl_mem output, const uint8_t *hash, cl_ulong target, cl_uint nonce)
+{
+    uint64_t value;
+    memcpy(&value, hash + 24, sizeof(value));
+
+    if (value > target) {
+        return;
+    }
+
+    cl_uint *data        = reinterpret_cast<cl_uint *>(output->data());
+    const cl_uint outIdx = data[0xFF]++;
+    if (outIdx < 0xFF) {
+        data[outIdx] = nonce;
+    }
+}
+
+
+static cl_int runCn0(cl_kernel kernel, size_t offset, size_t global)
+{
+    cl_mem input       = kernel->arg<cl_mem>(0);
+    cl_mem states      = kernel->arg<cl_mem>(2);
+    const size_t count = std::min<size_t>(global, kernel->arg<cl_uint>(3));
+
+    if (!input || input->size < kBlobSize || !hasStates(states, count)) {
+        return CL_INVALID_KERNEL_ARGS;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        uint8_t *blob        = states->data() + i * kStateSize;
+        const uint32_t nonce = static_cast<uint32_t>(offset + i);
+
+        memcpy(blob, input->data(), kBlobSize);
+        memcpy(blob + 39, &nonce, sizeof(nonce));
+    }
+
+    return CL_SUCCESS;
+}
+
+
+// cn1 gets the index of its first thread as the offset, so a batch may come in several dispatches, cn_gpu gets the nonce.
+static cl_int runCn1(cl_command_queue queue, cl_kernel kernel, size_t offset, size_t global, uint64_t &duration)
+{
+    const bool gpu               = kernel->type == KERNEL_CN1_GPU;
+    cl_mem states                = kernel->arg<cl_mem>(1);
+    const size_t threads         = kernel->arg<cl_uint>(gpu ? 2 : 4);
+    const size_t first           = gpu ? 0 : std::min(offset, threads);
+    const size_t count           = std::min(gpu ? global / 16 : global, threads - first);
+    const xmrig::Variant variant = gpu ? xmrig::VARIANT_GPU : static_cast<xmrig::Variant>(kernel->arg<cl_uint>(2));
+
+    if (!hasStates(states, first + count)) {
+        return CL_INVALID_KERNEL_ARGS;
+    }
+
+    if (queue->algo != kernel->algo) {
+        if (queue->algo != xmrig::INVALID_ALGO) {
+            Mem::release(queue->ctx, 1, queue->memory);
+        }
+
+        queue->memory = Mem::create(queue->ctx, kernel->algo, 1);
+        queue->algo   = kernel->algo;
+    }
+
+    CryptoNight::cn_hash_fun fn = CryptoNight::fn(variant);
+
+    for (size_t i = first; i < first + count; ++i) {
+        uint8_t *blob = states->data() + i * kStateSize;
+
+        if (fn) {
+            fn(blob, blobSize(blob), blob + kHashOffset, queue->ctx, kernel->height);
+        }
+        else {
+            memset(blob + kHashOffset, 0xFF, 32);
+        }
+    }
+
+    if (threads) {
+        duration = batchLatency * 1000000u * count / threads;
+    }
+
+    return CL_SUCCESS;
+}
+
+
+static cl_int runCn2(cl_kernel kernel, size_t global)
+{
+    cl_mem states         = kernel->arg<cl_mem>(1);
+    const cl_uint threads = kernel->arg<cl_uint>(6);
+    const size_t count    = std::min<size_t>(global, threads);
+
+    if (!hasStates(states, count)) {
+        return CL_INVALID_KERNEL_ARGS;
+    }
+
+    cl_mem branches[4];
+    for (cl_uint i = 0; i < 4; ++i) {
+        branches[i] = kernel->arg<cl_mem>(i + 2);
+
+        if (!hasCounter(branches[i], threads)) {
+            return CL_INVALID_KERNEL_ARGS;
+        }
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        // Spread threads over the final hash kernels like the real cn2 does, using the hash instead of the Keccak state.
+        cl_uint *branch      = reinterpret_cast<cl_uint *>(branches[states->data()[i * kStateSize + kHashOffset] & 3]->data());
+        const cl_uint outIdx = branch[threads]++;
+
+        branch[outIdx] = static_cast<cl_uint>(i);
+    }
+
+    return CL_SUCCESS;
+}
+
+
+static cl_int runCn2Gpu(cl_kernel kernel, size_t offset, size_t global)
+{
+    cl_mem states         = kernel->arg<cl_mem>(1);
+    cl_mem output         = kernel->arg<cl_mem>(2);
+    const cl_ulong target = kernel->arg<cl_ulong>(3);
+    const size_t count    = std::min<size_t>(global, kernel->arg<cl_uint>(4));
+
+    if (!hasStates(states, count) || !hasCounter(output, 0xFF)) {
+        return CL_INVALID_KERNEL_ARGS;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        addResult(output, states->data() + i * kStateSize + kHashOffset, target, static_cast<cl_uint>(offset + i));
+    }
+
+    return CL_SUCCESS;
+}
+
+
+static cl_int runFinal(cl_kernel kernel, size_t offset, size_t global)
+{
+    cl_mem states         = kernel->arg<cl_mem>(0);
+    cl_mem branch         = kernel->arg<cl_mem>(1);
+    cl_mem output         = kernel->arg<cl_mem>(2);
+    const cl_ulong target = kernel->arg<cl_ulong>(3);
+    const size_t count    = std::min<size_t>(global, kernel->arg<cl_uint>(4));
+
+    if (!hasCounter(branch, count) || !hasCounter(output, 0xFF)) {
+        return CL_INVALID_KERNEL_ARGS;
+    }
+
+    const cl_uint *indexes = reinterpret_cast<const cl_uint *>(branch->data());
+
+    for (size_t i = 0; i < count; ++i) {
+        if (!hasStates(states, indexes[i] + 1)) {
+            return CL_INVALID_KERNEL_ARGS;
+        }
+
+        addResult(output, states->data() + indexes[i] * kStateSize + kHashOffset, target, indexes[i] + static_cast<cl_uint>(offset));
+    }
+
+    return CL_SUCCESS;
+}
+
+
+// A waiting host thread returns one round trip after the device finished, as when a driver wakes it up.
+static void waitUntil(uint64_t time)
+{
+    const uint64_t now = uv_hrtime();
+    if (time + roundTrip > now) {
+        std::this_thread::sleep_for(std::chrono::nanoseconds(time + roundTrip - now));
+    }
+}
+
+
+/**
+ * @brief Advances the device clock of the queue by a command issued at the given time.
+ *
+ * The command starts once the device finished the previous commands of the queue and the events it waits for,
+ * it never ends before the host computed its result.
+ */
+static void schedule(cl_command_queue queue, cl_ulong issued, uint64_t duration, cl_uint num_events, const cl_event *event_list, cl_event *event)
+{
+    uint64_t start = std::max<uint64_t>(issued, queue->ready);
+    for (cl_uint i = 0; event_list && i < num_events; ++i) {
+        start = std::max<uint64_t>(start, event_list[i]->end);
+    }
+
+    queue->ready = std::max<uint64_t>(start + duration, uv_hrtime());
+
+    if (event) {
+        *event = new _cl_event{ CL_COMPLETE, { 1 }, queue->profiling, start, queue->ready };
+    }
+}
+
+
+static cl_int CL_API_CALL virtualBuildProgram(cl_program program, cl_uint, const cl_device_id *, const char *options, void (CL_CALLBACK *pfn_notify)(cl_program, void *), void *user_data)
+{
+    if (!program) {
+        return CL_INVALID_PROGRAM;
+    }
+
+    // Programs created from a binary already carry their build options.
+    if (!program->built) {
+        setBuildOptions(program, options ? options : "");
+    }
+
+    if (pfn_notify) {
+        pfn_notify(program, user_data);
+    }
+
+    return CL_SUCCESS;
+}
+
+
+static cl_mem CL_API_CALL virtualCreateBuffer(cl_context context, cl_mem_flags, size_t size, void *, cl_int *errcode_ret)
+{
+    if (!context || size == 0 || size > memorySize()) {
+        *errcode_ret = CL_INVALID_BUFFER_SIZE;
+        return nullptr;
+    }
+
+    if (context->allocated.fetch_add(size) + size > memorySize() * context->devices.size()) {
+        context->allocated.fetch_sub(size);
+        *errcode_ret = CL_MEM_OBJECT_ALLOCATION_FAILURE;
+        return nullptr;
+    }
+
+    *errcode_ret = CL_SUCCESS;
+
+    return new _cl_mem{ context, size, std::vector<uint8_t>() };
+}
+
+
+static cl_command_queue CL_API_CALL virtualCreateCommandQueue(cl_context context, cl_device_id device, cl_command_queue_properties properties, cl_int *errcode_ret)
+{
+    if (!context || std::find(context->devices.begin(), context->devices.end(), device) == context->devices.end()) {
+        *errcode_ret = CL_INVALID_DEVICE;
+        return nullptr;
+    }
+
+    *errcode_ret = CL_SUCCESS;
+
+    return new _cl_command_queue{ device, { nullptr }, MemInfo(), xmrig::INVALID_ALGO, (properties & CL_QUEUE_PROFILING_ENABLE) != 0, 0 };
+}
+
+
+static cl_context CL_API_CALL virtualCreateContext(const cl_context_properties *, cl_uint num_devices, const cl_device_id *devices, void (CL_CALLBACK *)(const char *, const void *, size_t, void *), void *, cl_int *errcode_ret)
+{
+    if (num_devices == 0 || !devices) {
+        *errcode_ret = CL_INVALID_VALUE;
+        return nullptr;
+    }
+
+    cl_context context = new _cl_context();
+    context->devices.assign(devices, devices + num_devices);
+    context->allocated = 0;
+
+    *errcode_ret = CL_SUCCESS;
+
+    return context;
+}
+
+
+static cl_kernel CL_API_CALL virtualCreateKernel(cl_program program, const char *kernel_name, cl_int *errcode_ret)
+{
+    if (!program || !program->built) {
+        *errcode_ret = CL_INVALID_PROGRAM_EXECUTABLE;
+        return nullptr;
+    }
+
+    const std::string name = kernel_name;
+    VirtualKernel type;
+    uint64_t height = 0;
+
+    if (name == "cn0" || name == "cn0_cn_gpu") {
+        type = KERNEL_CN0;
+    }
+    else if (name == "cn00_cn_gpu") {
+        type = KERNEL_NOP;
+    }
+    else if (name == "cn1_cn_gpu") {
+        type = KERNEL_CN1_GPU;
+    }
+    else if (name.compare(0, 3, "cn1") == 0) {
+        type = KERNEL_CN1;
+
+        // CryptonightR programs contain 10 kernels, one per height.
+        if (name.compare(0, 18, "cn1_cryptonight_r_") == 0) {
+            height = program->height + strtoul(name.c_str() + 18, nullptr, 10);
+        }
+    }
+    else if (name == "cn2") {
+        type = KERNEL_CN2;
+    }
+    else if (name == "cn2_cn_gpu") {
+        type = KERNEL_CN2_GPU;
+    }
+    else if (name == "Blake" || name == "Groestl" || name == "JH" || name == "Skein") {
+        type = KERNEL_FINAL;
+    }
+    else {
+        *errcode_ret = CL_INVALID_KERNEL_NAME;
+        return nullptr;
+    }
+
+    *errcode_ret = CL_SUCCESS;
+
+    return new _cl_kernel{ type, name, std::vector<std::vector<uint8_t>>(), height, program->algo };
+}
+
+
+static cl_program CL_API_CALL virtualCreateProgramWithBinary(cl_context context, cl_uint num_devices, const cl_device_id *device_list, const size_t *lengths, const unsigned char **binaries, cl_int *binary_status, cl_int *errcode_ret)
+{
+    const size_t magicSize = strlen(kBinaryMagic);
+
+    for (cl_uint i = 0; i < num_devices; ++i) {
+        const bool valid = lengths[i] >= magicSize && memcmp(binaries[i], kBinaryMagic, magicSize) == 0;
+
+        if (binary_status) {
+            binary_status[i] = valid ? CL_SUCCESS : CL_INVALID_BINARY;
+        }
+
+        if (!valid) {
+            *errcode_ret = CL_INVALID_BINARY;
+            return nullptr;
+        }
+    }
+
+    if (!context || num_devices == 0) {
+        *errcode_ret = CL_INVALID_VALUE;
+        return nullptr;
+    }
+
+    cl_program program = new _cl_program{ false, context, std::string(), std::vector<cl_device_id>(device_list, device_list + num_devices), 0, xmrig::CRYPTONIGHT };
+    setBuildOptions(program, std::string(reinterpret_cast<const char *>(binaries[0]) + magicSize, lengths[0] - magicSize));
+
+    *errcode_ret = CL_SUCCESS;
+
+    return program;
+}
+
+
+static cl_program CL_API_CALL virtualCreateProgramWithSource(cl_context context, cl_uint, const char **, const size_t *, cl_int *errcode_ret)
+{
+    if (!context) {
+        *errcode_ret = CL_INVALID_CONTEXT;
+        return nullptr;
+    }
+
+    *errcode_ret = CL_SUCCESS;
+
+    return new _cl_program{ false, context, std::string(), context->devices, 0, xmrig::CRYPTONIGHT };
+}
+
+
+static cl_int CL_API_CALL virtualEnqueueNDRangeKernel(cl_command_queue command_queue, cl_kernel kernel, cl_uint work_dim, const size_t *global_work_offset, const size_t *global_work_size, const size_t *, cl_uint num_events_in_wait_list, const cl_event *event_wait_list, cl_event *event)
+{
+    if (!command_queue) {
+        return CL_INVALID_COMMAND_QUEUE;
+    }
+
+    if (!kernel) {
+        return CL_INVALID_KERNEL;
+    }
+
+    if (work_dim == 0 || !global_work_size) {
+        return CL_INVALID_WORK_DIMENSION;
+    }
+
+    const size_t offset    = global_work_offset ? global_work_offset[0] : 0;
+    const size_t global    = global_work_size[0];
+    const cl_ulong started = uv_hrtime();
+    uint64_t duration      = 0;
+    cl_int ret             = CL_SUCCESS;
+
+    switch (kernel->type) {
+    case KERNEL_CN0:
+        ret = runCn0(kernel, offset, global);
+        break;
+
+    case KERNEL_CN1:
+    case KERNEL_CN1_GPU:
+        ret = runCn1(command_queue, kernel, offset, global, duration);
+        break;
+
+    case KERNEL_CN2:
+        ret = runCn2(kernel, global);
+        break;
+
+    case KERNEL_CN2_GPU:
+        ret = runCn2Gpu(kernel, offset, global);
+        break;
+
+    case KERNEL_FINAL:
+        ret = runFinal(kernel, offset, global);
+        break;
+
+    default:
+        break;
+    }
+
+    if (ret == CL_SUCCESS) {
+        schedule(command_queue, started, duration, num_events_in_wait_list, event_wait_list, event);
+    }
+
+    return ret;
+}
+
+
+static cl_int CL_API_CALL virtualEnqueueReadBuffer(cl_command_queue command_queue, cl_mem buffer, cl_bool blocking_read, size_t offset, size_t size, void *ptr, cl_uint num_events_in_wait_list, const cl_event *event_wait_list, cl_event *event)
+{
+    if (!command_queue) {
+        return CL_INVALID_COMMAND_QUEUE;
+    }
+
+    if (!buffer || !ptr || offset + size > buffer->size) {
+        return CL_INVALID_VALUE;
+    }
+
+    const cl_ulong started = uv_hrtime();
+
+    memcpy(ptr, buffer->data() + offset, size);
+    schedule(command_queue, started, 0, num_events_in_wait_list, event_wait_list, event);
+
+    if (blocking_read) {
+        waitUntil(command_queue->ready);
+    }
+
+    return CL_SUCCESS;
+}
+
+
+static cl_int CL_API_CALL virtualEnqueueWriteBuffer(cl_command_queue command_queue, cl_mem buffer, cl_bool blocking_write, size_t offset, size_t size, const void *ptr, cl_uint num_events_in_wait_list, const cl_event *event_wait_list, cl_event *event)
+{
+    if (!command_queue) {
+        return CL_INVALID_COMMAND_QUEUE;
+    }
+
+    if (!buffer || !ptr || offset + size > buffer->size) {
+        return CL_INVALID_VALUE;
+    }
+
+    const cl_ulong started = uv_hrtime();
+
+    memcpy(buffer->data() + offset, ptr, size);
+    schedule(command_queue, started, 0, num_events_in_wait_list, event_wait_list, event);
+
+    if (blocking_write) {
+        waitUntil(command_queue->ready);
+    }
+
+    return CL_SUCCESS;
+}
+
+
+static cl_int CL_API_CALL virtualFinish(cl_command_queue command_queue)
+{
+    if (!command_queue) {
+        return CL_INVALID_COMMAND_QUEUE;
+    }
+
+    waitUntil(command_queue->ready);
+
+    return CL_SUCCESS;
+}
+
+
+static cl_int CL_API_CALL virtualFlush(cl_command_queue command_queue)
+{
+    return command_queue ? CL_SUCCESS : CL_INVALID_COMMAND_QUEUE;
+}
+
+
+static cl_int CL_API_CALL virtualGetDeviceIDs(cl_platform_id platform, cl_device_type device_type, cl_uint num_entries, cl_device_id *devices_list, cl_uint *num_devices)
+{
+    if (!platform) {
+        return CL_INVALID_PLATFORM;
+    }
+
+    if ((device_type & (CL_DEVICE_TYPE_GPU | CL_DEVICE_TYPE_DEFAULT)) == 0) {
+        return CL_DEVICE_NOT_FOUND;
+    }
+
+    if (num_devices) {
+        *num_devices = devicesCount;
+    }
+
+    for (cl_uint i = 0; devices_list && i < std::min(num_entries, devicesCount); ++i) {
+        devices_list[i] = &devices[i];
+    }
+
+    return CL_SUCCESS;
+}
+
+
+static cl_int CL_API_CALL virtualGetDeviceInfo(cl_device_id device, cl_device_info param_name, size_t param_value_size, void *param_value, size_t *param_value_size_ret)
+{
+    if (!device) {
+        return CL_INVALID_DEVICE;
+    }
+
+    switch (param_name) {
+    case CL_DEVICE_NAME:
+        return copyString("virtual", param_value_size, param_value, param_value_size_ret);
+
+    case CL_DEVICE_VENDOR:
+        return copyString(vendorName(), param_value_size, param_value, param_value_size_ret);
+
+    case CL_DRIVER_VERSION:
+        return copyString("1.0 (virtual)", param_value_size, param_value, param_value_size_ret);
+
+    case CL_DEVICE_MAX_COMPUTE_UNITS:
+        return copyValue<cl_uint>(computeUnits, param_value_size, param_value, param_value_size_ret);
+
+    case CL_DEVICE_MAX_WORK_GROUP_SIZE:
+        return copyValue<size_t>(256, param_value_size, param_value, param_value_size_ret);
+
+    case CL_DEVICE_GLOBAL_MEM_SIZE:
+    case CL_DEVICE_MAX_MEM_ALLOC_SIZE:
+        return copyValue<cl_ulong>(memorySize(), param_value_size, param_value, param_value_size_ret);
+
+    default:
+        break;
+    }
+
+    return CL_INVALID_VALUE;
+}
+
+
+static cl_int CL_API_CALL virtualGetEventProfilingInfo(cl_event event, cl_profiling_info param_name, size_t param_value_size, void *param_value, size_t *param_value_size_ret)
+{
+    if (!event) {
+        return CL_INVALID_EVENT;
+    }
+
+    if (!event->profiling || event->end > uv_hrtime()) {
+        return CL_PROFILING_INFO_NOT_AVAILABLE;
+    }
+
+    switch (param_name) {
+    case CL_PROFILING_COMMAND_QUEUED:
+    case CL_PROFILING_COMMAND_SUBMIT:
+    case CL_PROFILING_COMMAND_START:
+        return copyValue(event->start, param_value_size, param_value, param_value_size_ret);
+
+    case CL_PROFILING_COMMAND_END:
+        return copyValue(event->end, param_value_size, param_value, param_value_size_ret);
+
+    default:
+        break;
+    }
+
+    return CL_INVALID_VALUE;
+}
+
+
+static cl_int CL_API_CALL virtualGetKernelInfo(cl_kernel kernel, cl_kernel_info param_name, size_t param_value_size, void *param_value, size_t *param_value_size_ret)
+{
+    if (!kernel) {
+        return CL_INVALID_KERNEL;
+    }
+
+    if (param_name == CL_KERNEL_FUNCTION_NAME) {
+        return copyString(kernel->name.c_str(), param_value_size, param_value, param_value_size_ret);
+    }
+
+    if (param_name == CL_KERNEL_NUM_ARGS) {
+        return copyValue<cl_uint>(static_cast<cl_uint>(kernel->args.size()), param_value_size, param_value, param_value_size_ret);
+    }
+
+    return CL_INVALID_VALUE;
+}
+
+
+static cl_int CL_API_CALL virtualGetPlatformIDs(cl_uint num_entries, cl_platform_id *platforms, cl_uint *num_platforms)
+{
+    if (num_platforms) {
+        *num_platforms = 1;
+    }
+
+    if (platforms && num_entries > 0) {
+        platforms[0] = &platform;
+    }
+
+    return CL_SUCCESS;
+}
+
+
+static cl_int CL_API_CALL virtualGetPlatformInfo(cl_platform_id platform, cl_platform_info param_name, size_t param_value_size, void *param_value, size_t *param_value_size_ret)
+{
+    if (!platform) {
+        return CL_INVALID_PLATFORM;
+    }
+
+    switch (param_name) {
+    case CL_PLATFORM_VENDOR:
+        return copyString(vendorName(), param_value_size, param_value, param_value_size_ret);
+
+    case CL_PLATFORM_NAME:
+        return copyString("XMRig virtual OpenCL", param_value_size, param_value, param_value_size_ret);
+
+    case CL_PLATFORM_VERSION:
+        return copyString("OpenCL 1.2 virtual", param_value_size, param_value, param_value_size_ret);
+
+    case CL_PLATFORM_PROFILE:
+        return copyString("FULL_PROFILE", param_value_size, param_value, param_value_size_ret);
+
+    default:
+        break;
+    }
+
+    return CL_INVALID_VALUE;
+}
+
+
+static cl_int CL_API_CALL virtualGetProgramBuildInfo(cl_program program, cl_device_id, cl_program_build_info param_name, size_t param_value_size, void *param_value, size_t *param_value_size_ret)
+{
+    if (!program) {
+        return CL_INVALID_PROGRAM;
+    }
+
+    if (param_name == CL_PROGRAM_BUILD_STATUS) {
+        return copyValue<cl_build_status>(program->built ? CL_BUILD_SUCCESS : CL_BUILD_NONE, param_value_size, param_value, param_value_size_ret);
+    }
+
+    if (param_name == CL_PROGRAM_BUILD_LOG) {
+        return copyString("", param_value_size, param_value, param_value_size_ret);
+    }
+
+    return CL_INVALID_VALUE;
+}
+
+
+static cl_int CL_API_CALL virtualGetProgramInfo(cl_program program, cl_program_info param_name, size_t param_value_size, void *param_value, size_t *param_value_size_ret)
+{
+    if (!program) {
+        return CL_INVALID_PROGRAM;
+    }
+
+    const size_t count = program->devices.size();
+
+    switch (param_name) {
+    case CL_PROGRAM_NUM_DEVICES:
+        return copyValue<cl_uint>(static_cast<cl_uint>(count), param_value_size, param_value, param_value_size_ret);
+
+    case CL_PROGRAM_DEVICES:
+        return copyInfo(program->devices.data(), sizeof(cl_device_id) * count, param_value_size, param_value, param_value_size_ret);
+
+    case CL_PROGRAM_BINARY_SIZES:
+        {
+            const std::vector<size_t> sizes(count, program->binary.size());
+
+            return copyInfo(sizes.data(), sizeof(size_t) * count, param_value_size, param_value, param_value_size_ret);
+        }
+
+    case CL_PROGRAM_BINARIES:
+        if (!program->built) {
+            return CL_INVALID_PROGRAM_EXECUTABLE;
+        }
+
+        if (param_value_size_ret) {
+            *param_value_size_ret = sizeof(unsigned char *) * count;
+        }
+
+        if (param_value) {
+            if (param_value_size < sizeof(unsigned char *) * count) {
+                return CL_INVALID_VALUE;
+            }
+
+            for (size_t i = 0; i < count; ++i) {
+                unsigned char *binary = static_cast<unsigned char **>(param_value)[i];
+                if (binary) {
+                    memcpy(binary, program->binary.data(), program->binary.size());
+                }
+            }
+        }
+
+        return CL_SUCCESS;
+
+    default:
+        break;
+    }
+
+    return CL_INVALID_VALUE;
+}
+
+
+static cl_int CL_API_CALL virtualReleaseCommandQueue(cl_command_queue command_queue)
+{
+    if (!command_queue) {
+        return CL_INVALID_COMMAND_QUEUE;
+    }
+
+    if (command_queue->algo != xmrig::INVALID_ALGO) {
+        Mem::release(command_queue->ctx, 1, command_queue->memory);
+    }
+
+    delete command_queue;
+
+    return CL_SUCCESS;
+}
+
+
+static cl_int CL_API_CALL virtualReleaseContext(cl_context context)
+{
+    if (!context) {
+        return CL_INVALID_CONTEXT;
+    }
+
+    delete context;
+
+    return CL_SUCCESS;
+}
+
+
+static cl_int CL_API_CALL virtualReleaseEvent(cl_event event)
+{
+    if (!event) {
+        return CL_INVALID_EVENT;
+    }
+
+    if (event->refs.fetch_sub(1) == 1) {
+        delete event;
+    }
+
+    return CL_SUCCESS;
+}
+
+
+static cl_int CL_API_CALL virtualReleaseKernel(cl_kernel kernel)
+{
+    if (!kernel) {
+        return CL_INVALID_KERNEL;
+    }
+
+    delete kernel;
+
+    return CL_SUCCESS;
+}
+
+
+static cl_int CL_API_CALL virtualReleaseMemObject(cl_mem mem_obj)
+{
+    if (!mem_obj) {
+        return CL_INVALID_MEM_OBJECT;
+    }
+
+    mem_obj->context->allocated.fetch_sub(mem_obj->size);
+    delete mem_obj;
+
+    return CL_SUCCESS;
+}
+
+
+static cl_int CL_API_CALL virtualReleaseProgram(cl_program program)
+{
+    if (!program) {
+        return CL_INVALID_PROGRAM;
+    }
+
+    delete program;
+
+    return CL_SUCCESS;
+}
+
+
+static cl_int CL_API_CALL virtualRetainEvent(cl_event event)
+{
+    if (!event) {
+        return CL_INVALID_EVENT;
+    }
+
+    event->refs++;
+
+    return CL_SUCCESS;
+}
+
+
+static void notify()
+{
+    std::unique_lock<std::mutex> lock(notifier->mutex);
+
+    for (;;) {
+        if (notifier->queue.empty()) {
+            notifier->condition.wait(lock);
+            continue;
+        }
+
+        const uint64_t now = uv_hrtime();
+        auto it            = notifier->queue.begin();
+
+        if (it->first > now) {
+            notifier->condition.wait_for(lock, std::chrono::nanoseconds(it->first - now));
+            continue;
+        }
+
+        const Notifier::Notification notification = it->second;
+        notifier->queue.erase(it);
+
+        lock.unlock();
+        notification.callback(notification.event, notification.event->status, notification.data);
+        virtualReleaseEvent(notification.event);
+        lock.lock();
+    }
+}
+
+
+static cl_int CL_API_CALL virtualSetEventCallback(cl_event event, cl_int, void (CL_CALLBACK *pfn_notify)(cl_event, cl_int, void *), void *user_data)
+{
+    if (!event) {
+        return CL_INVALID_EVENT;
+    }
+
+    if (!pfn_notify) {
+        return CL_SUCCESS;
+    }
+
+    if (event->end <= uv_hrtime()) {
+        pfn_notify(event, event->status, user_data);
+
+        return CL_SUCCESS;
+    }
+
+    std::call_once(notifierFlag, []() {
+        notifier = new Notifier();
+        std::thread(notify).detach();
+    });
+
+    event->refs++;
+
+    std::lock_guard<std::mutex> lock(notifier->mutex);
+    notifier->queue.insert({ event->end, { event, pfn_notify, user_data } });
+    notifier->condition.notify_one();
+
+    return CL_SUCCESS;
+}
+
+
+static cl_int CL_API_CALL virtualSetKernelArg(cl_kernel kernel, cl_uint arg_index, size_t arg_size, const void *arg_value)
+{
+    if (!kernel) {
+        return CL_INVALID_KERNEL;
+    }
+
+    if (kernel->args.size() <= arg_index) {
+        kernel->args.resize(arg_index + 1);
+    }
+
+    const uint8_t *value = static_cast<const uint8_t *>(arg_value);
+    kernel->args[arg_index].assign(value, value ? value + arg_size : value);
+
+    return CL_SUCCESS;
+}
+
+
+static cl_int CL_API_CALL virtualWaitForEvents(cl_uint num_events, const cl_event *event_list)
+{
+    if (num_events == 0 || !event_list) {
+        return CL_INVALID_VALUE;
+    }
+
+    for (cl_uint i = 0; i < num_events; ++i) {
+        waitUntil(event_list[i]->end);
+    }
+
+    return CL_SUCCESS;
+}
+
+
+struct VirtualSymbol
+{
+    const char *name;
+    void *address;
+};
+
+
+static const VirtualSymbol kSymbols[] = {
+    { "clBuildProgram",            reinterpret_cast<void *>(virtualBuildProgram)            },
+    { "clCreateBuffer",            reinterpret_cast<void *>(virtualCreateBuffer)            },
+    { "clCreateCommandQueue",      reinterpret_cast<void *>(virtualCreateCommandQueue)      },
+    { "clCreateContext",           reinterpret_cast<void *>(virtualCreateContext)           },
+    { "clCreateKernel",            reinterpret_cast<void *>(virtualCreateKernel)            },
+    { "clCreateProgramWithBinary", reinterpret_cast<void *>(virtualCreateProgramWithBinary) },
+    { "clCreateProgramWithSource", reinterpret_cast<void *>(virtualCreateProgramWithSource) },
+    { "clEnqueueNDRangeKernel",    reinterpret_cast<void *>(virtualEnqueueNDRangeKernel)    },
+    { "clEnqueueReadBuffer",       reinterpret_cast<void *>(virtualEnqueueReadBuffer)       },
+    { "clEnqueueWriteBuffer",      reinterpret_cast<void *>(virtualEnqueueWriteBuffer)      },
+    { "clFinish",                  reinterpret_cast<void *>(virtualFinish)                  },
+    { "clFlush",                   reinterpret_cast<void *>(virtualFlush)                   },
+    { "clGetDeviceIDs",            reinterpret_cast<void *>(virtualGetDeviceIDs)            },
+    { "clGetDeviceInfo",           reinterpret_cast<void *>(virtualGetDeviceInfo)           },
+    { "clGetEventProfilingInfo",   reinterpret_cast<void *>(virtualGetEventProfilingInfo)   },
+    { "clGetKernelInfo",           reinterpret_cast<void *>(virtualGetKernelInfo)           },
+    { "clGetPlatformIDs",          reinterpret_cast<void *>(virtualGetPlatformIDs)          },
+    { "clGetPlatformInfo",         reinterpret_cast<void *>(virtualGetPlatformInfo)         },
+    { "clGetProgramBuildInfo",     reinterpret_cast<void *>(virtualGetProgramBuildInfo)     },
+    { "clGetProgramInfo",          reinterpret_cast<void *>(virtualGetProgramInfo)          },
+    { "clReleaseCommandQueue",     reinterpret_cast<void *>(virtualReleaseCommandQueue)     },
+    { "clReleaseContext",          reinterpret_cast<void *>(virtualReleaseContext)          },
+    { "clReleaseEvent",            reinterpret_cast<void *>(virtualReleaseEvent)            },
+    { "clReleaseKernel",           reinterpret_cast<void *>(virtualReleaseKernel)           },
+    { "clReleaseMemObject",        reinterpret_cast<void *>(virtualReleaseMemObject)        },
+    { "clReleaseProgram",          reinterpret_cast<void *>(virtualReleaseProgram)          },
+    { "clRetainEvent",             reinterpret_cast<void *>(virtualRetainEvent)             },
+    { "clSetEventCallback",        reinterpret_cast<void *>(virtualSetEventCallback)        },
+    { "clSetKernelArg",            reinterpret_cast<void *>(virtualSetKernelArg)            },
+    { "clWaitForEvents",           reinterpret_cast<void *>(virtualWaitForEvents)           },
+    { nullptr,                     nullptr                                                  }
+};
+
+
+bool OclVirtual::init(const char *loader)
+{
+    assert(isVirtual(loader));
+
+    const char *options = loader + strlen(kPrefix);
+    if (*options == ':') {
+        options++;
+    }
+
+    std::string list = options;
+    size_t start     = 0;
+
+    while (start < list.size()) {
+        size_t end = list.find(',', start);
+        if (end == std::string::npos) {
+            end = list.size();
+        }
+
+        const std::string option = list.substr(start, end - start);
+        const size_t sep         = option.find('=');
+        const std::string key    = option.substr(0, sep);
+        const char *value        = sep == std::string::npos ? "" : option.c_str() + sep + 1;
+
+        if (key == "devices") {
+            devicesCount = static_cast<cl_uint>(strtoul(value, nullptr, 10));
+        }
+        else if (key == "cu") {
+            computeUnits = static_cast<cl_uint>(strtoul(value, nullptr, 10));
+        }
+        else if (key == "memory") {
+            deviceMemory = strtoull(value, nullptr, 10);
+        }
+        else if (key == "latency") {
+            batchLatency = strtoull(value, nullptr, 10);
+        }
+        else if (key == "rtt") {
+            roundTrip = strtoull(value, nullptr, 10) * 1000000u;
+        }
+        else if (key == "vendor") {
+            vendor = strcmp(value, "nvidia") == 0 ? xmrig::OCL_VENDOR_NVIDIA : (strcmp(value, "intel") == 0 ? xmrig::OCL_VENDOR_INTEL : xmrig::OCL_VENDOR_AMD);
+        }
+        else {
+            LOG_ERR("Invalid virtual OpenCL option \"%s\".", option.c_str());
+            return false;
+        }
+
+        start = end + 1;
+    }
+
+    if (devicesCount == 0 || devicesCount > 64 || computeUnits == 0 || deviceMemory == 0) {
+        LOG_ERR("Invalid virtual OpenCL configuration \"%s\".", options);
+        return false;
+    }
+
+    if (devices.empty()) {
+        for (cl_uint i = 0; i < devicesCount; ++i) {
+            devices.push_back({ i });
+        }
+    }
+
+    devicesCount = std::min<cl_uint>(devicesCount, static_cast<cl_uint>(devices.size()));
+    enabled      = true;
+
+    return true;
+}
+
+
+bool OclVirtual::isVirtual(const char *loader)
+{
+    const size_t size = strlen(kPrefix);
+
+    return loader && strncmp(loader, kPrefix, size) == 0 && (loader[size] == '\0' || loader[size] == ':');
+}
+
+
+// CryptonightR programs are emulated with the CPU implementation, which needs the first block height of the program.
+// Real build options do not carry it, the generator passes it here for programs built from source and from binaries.
+void OclVirtual::setProgramHeight(cl_program program, uint64_t height)
+{
+    if (enabled && program) {
+        program->height = height;
+    }
+}
+
+
+void *OclVirtual::symbol(const char *name)
+{
+    for (const VirtualSymbol *symbol = kSymbols; symbol->name; ++symbol) {
+        if (strcmp(symbol->name, name) == 0) {
+            return symbol->address;
+        }
+    }
+
+    return nullptr;
+}
@@ -0,0 +1,66 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef XMRIG_OCLVIRTUAL_H
+#define XMRIG_OCLVIRTUAL_H
+
+
+#include <stdint.h>
+
+
+#if defined(__APPLE__)
+#   include <OpenCL/cl.h>
+#else
+#   include "3rdparty/CL/cl.h"
+#endif
+
+
+/**
+ * Built-in OpenCL runtime without a GPU, selected by "opencl-loader": "virtual[:options]".
+ *
+ * Implements the subset of the API used by OclLib, kernels are emulated on the host: cn0 prepares blobs, cn1 hashes them
+ * with the CPU CryptoNight implementation and the final kernels compare results with the target, so workers, scheduling,
+ * nonce allocation and result submission behave as with a real device. Commands are executed on the host at enqueue time,
+ * a device clock per command queue tells when they complete: clFinish, clWaitForEvents and blocking reads wait for it and
+ * event callbacks are called then, so the host overlaps with the emulated GPU like with a real one.
+ *
+ * Options are comma separated key=value pairs:
+ *   devices=N   number of devices (default 1).
+ *   cu=N        compute units per device (default 8).
+ *   memory=MB   device memory, larger allocations fail with CL_MEM_OBJECT_ALLOCATION_FAILURE (default 1024).
+ *   latency=MS  minimum device time of a full batch, the device is busy at least this long after cn1 starts (default 0).
+ *   rtt=MS      host round trip, clFinish, clWaitForEvents and blocking reads return this long after the device finished (default 0).
+ *   vendor=NAME reported vendor: amd, nvidia or intel (default amd).
+ */
+class OclVirtual
+{
+public:
+    static bool init(const char *loader);
+    static bool isVirtual(const char *loader);
+    static void *symbol(const char *name);
+    static void setProgramHeight(cl_program program, uint64_t height);
+};
+
+
+#endif /* XMRIG_OCLVIRTUAL_H */
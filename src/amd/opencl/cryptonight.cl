@@ -343,6 +343,13 @@ inline ulong getIdx()
 #   endif
 }
 
+// cn1 gets the index of its first thread as the global offset instead of the nonce,
+// so one batch can be split into several dispatches.
+inline ulong getCn1Idx()
+{
+    return get_global_id(0);
+}
+
 //#include "opencl/cryptonight_gpu.cl"
 XMRIG_INCLUDE_CN_GPU
 
@@ -527,7 +534,7 @@ __kernel void cn1_monero(__global uint4 *Scratchpad, __global ulong *states, uin
     ulong a[2], b[2];
     __local uint AES0[256], AES1[256];
 
-    const ulong gIdx = getIdx();
+    const ulong gIdx = getCn1Idx();
 
     for (int i = get_local_id(0); i < 256; i += WORKSIZE) {
         const uint tmp = AES0_C[i];
@@ -554,7 +561,7 @@ __kernel void cn1_monero(__global uint4 *Scratchpad, __global ulong *states, uin
             Scratchpad += gIdx;
 #       endif
 #       elif (STRIDED_INDEX == 2)
-        Scratchpad += get_group_id(0) * (MEMORY >> 4) * WORKSIZE + MEM_CHUNK * get_local_id(0);
+        Scratchpad += (gIdx / WORKSIZE) * (MEMORY >> 4) * WORKSIZE + MEM_CHUNK * get_local_id(0);
 #       endif
 
         a[0] = states[0] ^ states[4];
@@ -618,7 +625,7 @@ __kernel void cn1_v2_monero(__global uint4 *Scratchpad, __global ulong *states,
     ulong a[2], b[4];
     __local uint AES0[256], AES1[256], AES2[256], AES3[256];
     
-    const ulong gIdx = getIdx();
+    const ulong gIdx = getCn1Idx();
 
     for(int i = get_local_id(0); i < 256; i += WORKSIZE)
     {
@@ -646,7 +653,7 @@ __kernel void cn1_v2_monero(__global uint4 *Scratchpad, __global ulong *states,
 #           elif (STRIDED_INDEX == 1)
                 Scratchpad += gIdx;
 #           elif (STRIDED_INDEX == 2)
-                Scratchpad += get_group_id(0) * (MEMORY >> 4) * WORKSIZE + MEM_CHUNK * get_local_id(0);
+                Scratchpad += (gIdx / WORKSIZE) * (MEMORY >> 4) * WORKSIZE + MEM_CHUNK * get_local_id(0);
 #           endif
 #       endif
 
@@ -778,7 +785,7 @@ __kernel void cn1_v2_half(__global uint4 *Scratchpad, __global ulong *states, ui
     ulong a[2], b[4];
     __local uint AES0[256], AES1[256], AES2[256], AES3[256];
 
-    const ulong gIdx = getIdx();
+    const ulong gIdx = getCn1Idx();
 
     for(int i = get_local_id(0); i < 256; i += WORKSIZE)
     {
@@ -806,7 +813,7 @@ __kernel void cn1_v2_half(__global uint4 *Scratchpad, __global ulong *states, ui
 #           elif (STRIDED_INDEX == 1)
                 Scratchpad += gIdx;
 #           elif (STRIDED_INDEX == 2)
-                Scratchpad += get_group_id(0) * (MEMORY >> 4) * WORKSIZE + MEM_CHUNK * get_local_id(0);
+                Scratchpad += (gIdx / WORKSIZE) * (MEMORY >> 4) * WORKSIZE + MEM_CHUNK * get_local_id(0);
 #           endif
 #       endif
 
@@ -938,7 +945,7 @@ __kernel void cn1_msr(__global uint4 *Scratchpad, __global ulong *states, uint v
     ulong a[2], b[2];
     __local uint AES0[256], AES1[256];
 
-    const ulong gIdx = getIdx();
+    const ulong gIdx = getCn1Idx();
 
     for (int i = get_local_id(0); i < 256; i += WORKSIZE) {
         const uint tmp = AES0_C[i];
@@ -960,12 +967,12 @@ __kernel void cn1_msr(__global uint4 *Scratchpad, __global ulong *states, uint v
         Scratchpad += gIdx * (MEMORY >> 4);
 #       elif (STRIDED_INDEX == 1)
 #       if (ALGO == CRYPTONIGHT_HEAVY)
-            Scratchpad += get_group_id(0) * (MEMORY >> 4) * WORKSIZE + get_local_id(0);
+            Scratchpad += (gIdx / WORKSIZE) * (MEMORY >> 4) * WORKSIZE + get_local_id(0);
 #       else
             Scratchpad += gIdx;
 #       endif
 #       elif (STRIDED_INDEX == 2)
-        Scratchpad += get_group_id(0) * (MEMORY >> 4) * WORKSIZE + MEM_CHUNK * get_local_id(0);
+        Scratchpad += (gIdx / WORKSIZE) * (MEMORY >> 4) * WORKSIZE + MEM_CHUNK * get_local_id(0);
 #       endif
 
         a[0] = states[0] ^ states[4];
@@ -1026,7 +1033,7 @@ __kernel void cn1_tube(__global uint4 *Scratchpad, __global ulong *states, uint
     ulong a[2], b[2];
     __local uint AES0[256], AES1[256];
 
-    const ulong gIdx = getIdx();
+    const ulong gIdx = getCn1Idx();
 
     for (int i = get_local_id(0); i < 256; i += WORKSIZE) {
         const uint tmp = AES0_C[i];
@@ -1048,12 +1055,12 @@ __kernel void cn1_tube(__global uint4 *Scratchpad, __global ulong *states, uint
         Scratchpad += gIdx * (MEMORY >> 4);
 #       elif (STRIDED_INDEX == 1)
 #       if (ALGO == CRYPTONIGHT_HEAVY)
-            Scratchpad += get_group_id(0) * (MEMORY >> 4) * WORKSIZE + get_local_id(0);
+            Scratchpad += (gIdx / WORKSIZE) * (MEMORY >> 4) * WORKSIZE + get_local_id(0);
 #       else
             Scratchpad += gIdx;
 #       endif
 #       elif (STRIDED_INDEX == 2)
-        Scratchpad += get_group_id(0) * (MEMORY >> 4) * WORKSIZE + MEM_CHUNK * get_local_id(0);
+        Scratchpad += (gIdx / WORKSIZE) * (MEMORY >> 4) * WORKSIZE + MEM_CHUNK * get_local_id(0);
 #       endif
 
         a[0] = states[0] ^ states[4];
@@ -1125,7 +1132,7 @@ __kernel void cn1(__global uint4 *Scratchpad, __global ulong *states, uint varia
     ulong a[2], b[2];
     __local uint AES0[256], AES1[256];
 
-    const ulong gIdx = getIdx();
+    const ulong gIdx = getCn1Idx();
 
     for (int i = get_local_id(0); i < 256; i += WORKSIZE) {
         const uint tmp = AES0_C[i];
@@ -1146,12 +1153,12 @@ __kernel void cn1(__global uint4 *Scratchpad, __global ulong *states, uint varia
         Scratchpad += gIdx * (MEMORY >> 4);
 #       elif (STRIDED_INDEX == 1)
 #       if (ALGO == CRYPTONIGHT_HEAVY)
-            Scratchpad += get_group_id(0) * (MEMORY >> 4) * WORKSIZE + get_local_id(0);
+            Scratchpad += (gIdx / WORKSIZE) * (MEMORY >> 4) * WORKSIZE + get_local_id(0);
 #       else
             Scratchpad += gIdx;
 #       endif
 #       elif(STRIDED_INDEX == 2)
-        Scratchpad += get_group_id(0) * (MEMORY >> 4) * WORKSIZE + MEM_CHUNK * get_local_id(0);
+        Scratchpad += (gIdx / WORKSIZE) * (MEMORY >> 4) * WORKSIZE + MEM_CHUNK * get_local_id(0);
 #       endif
 
         a[0] = states[0] ^ states[4];
@@ -1221,7 +1228,7 @@ __kernel void cn1_xao(__global uint4 *Scratchpad, __global ulong *states, uint v
     ulong a[2], b[2];
     __local uint AES0[256], AES1[256];
 
-    const ulong gIdx = getIdx();
+    const ulong gIdx = getCn1Idx();
 
     for (int i = get_local_id(0); i < 256; i += WORKSIZE) {
         const uint tmp = AES0_C[i];
@@ -1242,12 +1249,12 @@ __kernel void cn1_xao(__global uint4 *Scratchpad, __global ulong *states, uint v
         Scratchpad += gIdx * (MEMORY >> 4);
 #       elif (STRIDED_INDEX == 1)
 #       if (ALGO == CRYPTONIGHT_HEAVY)
-            Scratchpad += get_group_id(0) * (MEMORY >> 4) * WORKSIZE + get_local_id(0);
+            Scratchpad += (gIdx / WORKSIZE) * (MEMORY >> 4) * WORKSIZE + get_local_id(0);
 #       else
             Scratchpad += gIdx;
 #       endif
 #       elif(STRIDED_INDEX == 2)
-        Scratchpad += get_group_id(0) * (MEMORY >> 4) * WORKSIZE + MEM_CHUNK * get_local_id(0);
+        Scratchpad += (gIdx / WORKSIZE) * (MEMORY >> 4) * WORKSIZE + MEM_CHUNK * get_local_id(0);
 #       endif
 
         a[0] = states[0] ^ states[4];
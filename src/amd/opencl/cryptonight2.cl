@@ -7,7 +7,7 @@ __kernel void cn1_v2_rwz(__global uint4 *Scratchpad, __global ulong *states, uin
     ulong a[2], b[4];
     __local uint AES0[256], AES1[256], AES2[256], AES3[256];
 
-    const ulong gIdx = getIdx();
+    const ulong gIdx = getCn1Idx();
 
     for(int i = get_local_id(0); i < 256; i += WORKSIZE)
     {
@@ -35,7 +35,7 @@ __kernel void cn1_v2_rwz(__global uint4 *Scratchpad, __global ulong *states, uin
 #           elif (STRIDED_INDEX == 1)
                 Scratchpad += gIdx;
 #           elif (STRIDED_INDEX == 2)
-                Scratchpad += get_group_id(0) * (MEMORY >> 4) * WORKSIZE + MEM_CHUNK * get_local_id(0);
+                Scratchpad += (gIdx / WORKSIZE) * (MEMORY >> 4) * WORKSIZE + MEM_CHUNK * get_local_id(0);
 #           endif
 #       endif
 
@@ -167,7 +167,7 @@ __kernel void cn1_v2_zls(__global uint4 *Scratchpad, __global ulong *states, uin
     ulong a[2], b[4];
     __local uint AES0[256], AES1[256], AES2[256], AES3[256];
 
-    const ulong gIdx = getIdx();
+    const ulong gIdx = getCn1Idx();
 
     for(int i = get_local_id(0); i < 256; i += WORKSIZE)
     {
@@ -195,7 +195,7 @@ __kernel void cn1_v2_zls(__global uint4 *Scratchpad, __global ulong *states, uin
 #           elif (STRIDED_INDEX == 1)
                 Scratchpad += gIdx;
 #           elif (STRIDED_INDEX == 2)
-                Scratchpad += get_group_id(0) * (MEMORY >> 4) * WORKSIZE + MEM_CHUNK * get_local_id(0);
+                Scratchpad += (gIdx / WORKSIZE) * (MEMORY >> 4) * WORKSIZE + MEM_CHUNK * get_local_id(0);
 #           endif
 #       endif
 
@@ -327,7 +327,7 @@ __kernel void cn1_v2_double(__global uint4 *Scratchpad, __global ulong *states,
     ulong a[2], b[4];
     __local uint AES0[256], AES1[256], AES2[256], AES3[256];
 
-    const ulong gIdx = getIdx();
+    const ulong gIdx = getCn1Idx();
 
     for(int i = get_local_id(0); i < 256; i += WORKSIZE)
     {
@@ -355,7 +355,7 @@ __kernel void cn1_v2_double(__global uint4 *Scratchpad, __global ulong *states,
 #           elif (STRIDED_INDEX == 1)
                 Scratchpad += gIdx;
 #           elif (STRIDED_INDEX == 2)
-                Scratchpad += get_group_id(0) * (MEMORY >> 4) * WORKSIZE + MEM_CHUNK * get_local_id(0);
+                Scratchpad += (gIdx / WORKSIZE) * (MEMORY >> 4) * WORKSIZE + MEM_CHUNK * get_local_id(0);
 #           endif
 #       endif
 
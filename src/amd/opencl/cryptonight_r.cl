@@ -5,7 +5,7 @@ __kernel void cn1_cryptonight_r_N(__global uint4 *Scratchpad, __global ulong *st
 	ulong a[2], b[4];
 	__local uint AES0[256], AES1[256], AES2[256], AES3[256];
 
-	const ulong gIdx = get_global_id(0) - get_global_offset(0);
+	const ulong gIdx = get_global_id(0);
 
 	for(int i = get_local_id(0); i < 256; i += WORKSIZE)
 	{
@@ -33,7 +33,7 @@ __kernel void cn1_cryptonight_r_N(__global uint4 *Scratchpad, __global ulong *st
 #			elif (STRIDED_INDEX == 1)
 				Scratchpad += gIdx;
 #			elif (STRIDED_INDEX == 2)
-				Scratchpad += get_group_id(0) * (MEMORY >> 4) * WORKSIZE + MEM_CHUNK * get_local_id(0);
+				Scratchpad += (gIdx / WORKSIZE) * (MEMORY >> 4) * WORKSIZE + MEM_CHUNK * get_local_id(0);
 #			endif
 #		endif
 
@@ -71,3 +71,13 @@ void Api::tick(const xmrig::NetworkState &network)
 
     m_router->tick(network);
 }
+
+
+void Api::updateMetrics()
+{
+    if (!m_router) {
+        return;
+    }
+
+    m_router->updateMetrics();
+}
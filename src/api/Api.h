@@ -49,6 +49,7 @@ public:
 
     static void exec(const xmrig::HttpRequest &req, xmrig::HttpReply &reply);
     static void tick(const xmrig::NetworkState &results);
+    static void updateMetrics();
 
 private:
     static ApiRouter *m_router;
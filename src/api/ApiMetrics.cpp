@@ -0,0 +1,300 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <algorithm>
+#include <inttypes.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+
+#include "amd/OclScheduler.h"
+#include "api/ApiMetrics.h"
+#include "api/NetworkState.h"
+#include "common/api/HttpReply.h"
+#include "common/net/Client.h"
+#include "core/Config.h"
+#include "core/Controller.h"
+#include "interfaces/IThread.h"
+#include "workers/Hashrate.h"
+#include "workers/Verifier.h"
+#include "workers/Workers.h"
+
+
+static const char *kContentType = "application/openmetrics-text; version=1.0.0; charset=utf-8";
+static const char *kWindows[3]  = { "10s", "60s", "15m" };
+static const int kIntervals[3]  = { Hashrate::ShortInterval, Hashrate::MediumInterval, Hashrate::LargeInterval };
+
+
+static void append(std::string &out, const char *format, ...)
+{
+    char buf[512];
+
+    va_list args;
+    va_start(args, format);
+    const int size = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+
+    if (size > 0) {
+        out.append(buf, std::min<size_t>(static_cast<size_t>(size), sizeof(buf) - 1));
+    }
+}
+
+
+static inline void appendFamily(std::string &out, const char *name, const char *type, const char *help)
+{
+    append(out, "# TYPE xmrig_%s %s\n# HELP xmrig_%s %s\n", name, type, name, help);
+}
+
+
+// Hashrate is not a number until enough samples are collected, OpenMetrics spells it NaN.
+static inline void appendValue(std::string &out, double value)
+{
+    if (isnan(value) || isinf(value)) {
+        out.append(" NaN\n");
+        return;
+    }
+
+    append(out, " %.10g\n", value);
+}
+
+
+static inline void appendThread(std::string &out, const char *name, size_t index, int device)
+{
+    if (device < 0) {
+        append(out, "xmrig_%s{thread=\"%zu\",device=\"cpu\"", name, index);
+        return;
+    }
+
+    append(out, "xmrig_%s{thread=\"%zu\",device=\"%d\"", name, index, device);
+}
+
+
+ApiMetrics::ApiMetrics(xmrig::Controller *controller) :
+    m_firstHash(0.0),
+    m_highest(0.0),
+    m_pending(0),
+    m_invalid(0),
+    m_outdated(0),
+    m_controller(controller)
+{
+    m_buf.reserve(16 * 1024);
+}
+
+
+void ApiMetrics::render(const xmrig::NetworkState &network, xmrig::HttpReply &reply) const
+{
+    m_buf.clear();
+
+    renderWorkers();
+    renderNetwork(network);
+
+    m_buf.append("# EOF\n");
+
+    reply.buf         = strdup(m_buf.c_str());
+    reply.size        = m_buf.size();
+    reply.contentType = kContentType;
+}
+
+
+// Called from Workers::onTick, on the same loop thread as the HTTP requests.
+void ApiMetrics::update()
+{
+    const Hashrate *hr = Workers::hashrate();
+    if (!hr) {
+        return;
+    }
+
+    const std::vector<xmrig::IThread *> &threads = Workers::gpuThreads();
+
+    m_threads.resize(Workers::threads());
+    for (size_t i = 0; i < m_threads.size(); ++i) {
+        Thread &thread = m_threads[i];
+
+        thread.device    = i < threads.size() ? static_cast<int>(threads[i]->index()) : -1;
+        thread.batchTime = Workers::batchTime(i) / 1000.0;
+        thread.hashes    = Workers::hashCount(i);
+        thread.intensity = Workers::intensity(i);
+
+        for (size_t j = 0; j < 3; ++j) {
+            thread.hashrate[j] = hr->calc(i, kIntervals[j]);
+        }
+    }
+
+    m_devices.clear();
+    for (const OclScheduler *scheduler : OclScheduler::schedulers()) {
+        m_devices.push_back({ scheduler->occupancy() / 100.0, scheduler->switchTime() / 1000.0, scheduler->deviceIdx(), scheduler->aborted(), scheduler->switches() });
+    }
+
+    m_firstHash = Workers::firstHashTime();
+    m_highest   = hr->highest();
+
+    if (Workers::verifier()) {
+        m_pending  = Workers::verifier()->pending();
+        m_invalid  = Workers::verifier()->invalid();
+        m_outdated = Workers::verifier()->outdated();
+    }
+}
+
+
+void ApiMetrics::renderNetwork(const xmrig::NetworkState &network) const
+{
+    appendFamily(m_buf, "shares", "counter", "Shares sent to the pool by result");
+    append(m_buf, "xmrig_shares_total{result=\"accepted\"} %" PRIu64 "\n", network.accepted);
+    append(m_buf, "xmrig_shares_total{result=\"rejected\"} %" PRIu64 "\n", network.rejected);
+
+    appendFamily(m_buf, "share_difficulty", "counter", "Sum of the difficulty of accepted shares");
+    append(m_buf, "xmrig_share_difficulty_total %" PRIu64 "\n", network.total);
+
+    appendFamily(m_buf, "share_latency_seconds", "histogram", "Time from submit to the pool response for accepted shares");
+
+    // powers of two are exact bucket edges of the latency histogram
+    const xmrig::LatencyHistogram &latency = network.totalLatency();
+    for (uint32_t bound = 16; bound <= 8192; bound *= 2) {
+        append(m_buf, "xmrig_share_latency_seconds_bucket{le=\"%.3f\"} %" PRIu64 "\n", bound / 1000.0, latency.countUpTo(bound));
+    }
+
+    append(m_buf, "xmrig_share_latency_seconds_bucket{le=\"+Inf\"} %" PRIu64 "\n", latency.count());
+    append(m_buf, "xmrig_share_latency_seconds_count %" PRIu64 "\n", latency.count());
+    append(m_buf, "xmrig_share_latency_seconds_sum %.3f\n", latency.sum() / 1000.0);
+
+    appendFamily(m_buf, "pool_difficulty", "gauge", "Difficulty of the current job");
+    append(m_buf, "xmrig_pool_difficulty %u\n", network.diff);
+
+    appendFamily(m_buf, "pool_uptime_seconds", "gauge", "Time since the pool connection was established, 0 when disconnected");
+    append(m_buf, "xmrig_pool_uptime_seconds %d\n", network.connectionTime());
+
+    appendFamily(m_buf, "pool_failures", "counter", "Pool connection failures");
+    append(m_buf, "xmrig_pool_failures_total %" PRIu64 "\n", network.failures);
+
+    appendFamily(m_buf, "pool_write_queued_bytes", "gauge", "Bytes handed to the socket and not written yet");
+    append(m_buf, "xmrig_pool_write_queued_bytes %" PRIu64 "\n", xmrig::Client::queuedBytes());
+
+    appendFamily(m_buf, "pool_coalesced_requests", "counter", "Requests sent in one write with an earlier request");
+    append(m_buf, "xmrig_pool_coalesced_requests_total %" PRIu64 "\n", xmrig::Client::coalescedWrites());
+
+    appendFamily(m_buf, "pool_dropped_requests", "counter", "Requests that were not written to the pool");
+    append(m_buf, "xmrig_pool_dropped_requests_total %" PRIu64 "\n", xmrig::Client::droppedWrites());
+
+    const std::vector<xmrig::Client::TlsStats> tls = xmrig::Client::tlsStats();
+
+    appendFamily(m_buf, "pool_tls_handshakes", "counter", "Completed TLS handshakes with a pool by session reuse");
+    for (const xmrig::Client::TlsStats &stats : tls) {
+        append(m_buf, "xmrig_pool_tls_handshakes_total{pool=\"%s\",resumed=\"false\"} %" PRIu64 "\n", stats.url, stats.handshakes - stats.resumed);
+        append(m_buf, "xmrig_pool_tls_handshakes_total{pool=\"%s\",resumed=\"true\"} %" PRIu64 "\n", stats.url, stats.resumed);
+    }
+
+    appendFamily(m_buf, "pool_tls_handshake_seconds", "counter", "Time spent in completed TLS handshakes with a pool");
+    for (const xmrig::Client::TlsStats &stats : tls) {
+        append(m_buf, "xmrig_pool_tls_handshake_seconds_total{pool=\"%s\"} %.3f\n", stats.url, stats.time / 1000.0);
+    }
+}
+
+
+void ApiMetrics::renderWorkers() const
+{
+    appendFamily(m_buf, "hashrate", "gauge", "Hashes per second of a thread over the window");
+    for (size_t i = 0; i < m_threads.size(); ++i) {
+        for (size_t j = 0; j < 3; ++j) {
+            appendThread(m_buf, "hashrate", i, m_threads[i].device);
+            append(m_buf, ",window=\"%s\"}", kWindows[j]);
+            appendValue(m_buf, m_threads[i].hashrate[j]);
+        }
+    }
+
+    appendFamily(m_buf, "device_hashrate", "gauge", "Hashes per second of a GPU over the window");
+    for (const Device &device : m_devices) {
+        for (size_t j = 0; j < 3; ++j) {
+            double sum = 0.0;
+            for (const Thread &thread : m_threads) {
+                if (thread.device == static_cast<int>(device.index) && isnormal(thread.hashrate[j])) {
+                    sum += thread.hashrate[j];
+                }
+            }
+
+            append(m_buf, "xmrig_device_hashrate{device=\"%zu\",window=\"%s\"}", device.index, kWindows[j]);
+            appendValue(m_buf, sum);
+        }
+    }
+
+    appendFamily(m_buf, "hashrate_highest", "gauge", "Highest total hashes per second over 10 seconds");
+    m_buf.append("xmrig_hashrate_highest");
+    appendValue(m_buf, m_highest);
+
+    appendFamily(m_buf, "first_hash_seconds", "gauge", "Time from the start of the OpenCL initialization to the first finished batch");
+    m_buf.append("xmrig_first_hash_seconds");
+    appendValue(m_buf, m_firstHash);
+
+    appendFamily(m_buf, "hashes", "counter", "Hashes computed by a thread");
+    for (size_t i = 0; i < m_threads.size(); ++i) {
+        appendThread(m_buf, "hashes_total", i, m_threads[i].device);
+        append(m_buf, "} %" PRIu64 "\n", m_threads[i].hashes);
+    }
+
+    appendFamily(m_buf, "batch_seconds", "gauge", "Average time of one batch of a thread");
+    for (size_t i = 0; i < m_threads.size(); ++i) {
+        appendThread(m_buf, "batch_seconds", i, m_threads[i].device);
+        m_buf.append("}");
+        appendValue(m_buf, m_threads[i].batchTime);
+    }
+
+    appendFamily(m_buf, "intensity", "gauge", "Hashes in the next batch of a thread");
+    for (size_t i = 0; i < m_threads.size(); ++i) {
+        appendThread(m_buf, "intensity", i, m_threads[i].device);
+        append(m_buf, "} %" PRIu64 "\n", m_threads[i].intensity);
+    }
+
+    appendFamily(m_buf, "job_switches", "counter", "Job switches of all threads of a GPU");
+    for (const Device &device : m_devices) {
+        append(m_buf, "xmrig_job_switches_total{device=\"%zu\"} %" PRIu64 "\n", device.index, device.switches);
+    }
+
+    appendFamily(m_buf, "job_switch_seconds", "gauge", "Average time from a new job to its first batch");
+    for (const Device &device : m_devices) {
+        append(m_buf, "xmrig_job_switch_seconds{device=\"%zu\"}", device.index);
+        appendValue(m_buf, device.switchTime);
+    }
+
+    appendFamily(m_buf, "aborted_batches", "counter", "Batches dropped for a new block");
+    for (const Device &device : m_devices) {
+        append(m_buf, "xmrig_aborted_batches_total{device=\"%zu\"} %" PRIu64 "\n", device.index, device.aborted);
+    }
+
+    appendFamily(m_buf, "device_occupancy_ratio", "gauge", "Share of time the GPU had queued cn1 work");
+    for (const Device &device : m_devices) {
+        append(m_buf, "xmrig_device_occupancy_ratio{device=\"%zu\"}", device.index);
+        appendValue(m_buf, device.occupancy);
+    }
+
+    appendFamily(m_buf, "verifier_pending", "gauge", "Found nonces waiting for CPU verification");
+    append(m_buf, "xmrig_verifier_pending %" PRId64 "\n", m_pending);
+
+    appendFamily(m_buf, "verifier_invalid", "counter", "Found nonces rejected by CPU verification");
+    append(m_buf, "xmrig_verifier_invalid_total %" PRIu64 "\n", m_invalid);
+
+    appendFamily(m_buf, "verifier_outdated", "counter", "Verified results of the previous job");
+    append(m_buf, "xmrig_verifier_outdated_total %" PRIu64 "\n", m_outdated);
+}
@@ -0,0 +1,88 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef XMRIG_APIMETRICS_H
+#define XMRIG_APIMETRICS_H
+
+
+#include <string>
+#include <vector>
+
+
+namespace xmrig {
+    class Controller;
+    class HttpReply;
+    class NetworkState;
+}
+
+
+/**
+ * OpenMetrics text for the /metrics endpoint.
+ *
+ * Worker counters are sampled on the Workers tick, a scrape only formats the last sample and the network state
+ * into a reused buffer, so polling many rigs does not build a JSON document for every request.
+ */
+class ApiMetrics
+{
+public:
+    ApiMetrics(xmrig::Controller *controller);
+
+    void render(const xmrig::NetworkState &network, xmrig::HttpReply &reply) const;
+    void update();
+
+private:
+    struct Thread
+    {
+        double batchTime;
+        double hashrate[3];
+        int device;         // -1 for CPU threads
+        uint64_t hashes;
+        uint64_t intensity;
+    };
+
+    struct Device
+    {
+        double occupancy;
+        double switchTime;
+        size_t index;
+        uint64_t aborted;
+        uint64_t switches;
+    };
+
+    void renderNetwork(const xmrig::NetworkState &network) const;
+    void renderWorkers() const;
+
+    double m_firstHash;
+    double m_highest;
+    int64_t m_pending;
+    mutable std::string m_buf;
+    std::vector<Device> m_devices;
+    std::vector<Thread> m_threads;
+    uint64_t m_invalid;
+    uint64_t m_outdated;
+    xmrig::Controller *m_controller;
+};
+
+
+#endif /* XMRIG_APIMETRICS_H */
@@ -38,6 +38,7 @@
 #include "common/api/HttpRequest.h"
 #include "common/cpu/Cpu.h"
 #include "common/crypto/keccak.h"
+#include "common/net/Client.h"
 #include "common/net/Job.h"
 #include "common/Platform.h"
 #include "core/Config.h"
@@ -51,6 +52,19 @@
 #include "workers/Workers.h"
 
 
+// Hashrate is created when the workers start, the API is up during the OpenCL initialization already.
+static inline double calc(const Hashrate *hr, size_t ms)
+{
+    return hr ? hr->calc(ms) : nan("");
+}
+
+
+static inline double calc(const Hashrate *hr, size_t threadId, size_t ms)
+{
+    return hr ? hr->calc(threadId, ms) : nan("");
+}
+
+
 static inline rapidjson::Value normalize(double d)
 {
     using namespace rapidjson;
@@ -63,7 +77,21 @@ static inline rapidjson::Value normalize(double d)
 }
 
 
+static rapidjson::Value latencyToJSON(const xmrig::LatencyHistogram &histogram, rapidjson::Document::AllocatorType &allocator)
+{
+    rapidjson::Value value(rapidjson::kObjectType);
+    value.AddMember("count", histogram.count(), allocator);
+    value.AddMember("p50",   histogram.percentile(0.5), allocator);
+    value.AddMember("p90",   histogram.percentile(0.9), allocator);
+    value.AddMember("p99",   histogram.percentile(0.99), allocator);
+    value.AddMember("max",   histogram.max(), allocator);
+
+    return value;
+}
+
+
 ApiRouter::ApiRouter(xmrig::Controller *controller) :
+    m_metrics(controller),
     m_controller(controller)
 {
     memset(m_workerId, 0, sizeof(m_workerId));
@@ -80,6 +108,10 @@ ApiRouter::~ApiRouter()
 
 void ApiRouter::ApiRouter::get(const xmrig::HttpRequest &req, xmrig::HttpReply &reply) const
 {
+    if (req.match("/metrics")) {
+        return m_metrics.render(m_network, reply);
+    }
+
     rapidjson::Document doc;
 
     if (req.match("/1/config")) {
@@ -99,6 +131,13 @@ void ApiRouter::ApiRouter::get(const xmrig::HttpRequest &req, xmrig::HttpReply &
         return finalize(reply, doc);
     }
 
+    if (req.match("/1/profile")) {
+        doc.SetObject();
+        Workers::profileSummary(doc);
+
+        return finalize(reply, doc);
+    }
+
     doc.SetObject();
 
     getIdentify(doc);
@@ -128,6 +167,12 @@ void ApiRouter::tick(const xmrig::NetworkState &network)
 }
 
 
+void ApiRouter::updateMetrics()
+{
+    m_metrics.update();
+}
+
+
 void ApiRouter::onConfigChanged(xmrig::Config *config, xmrig::Config *previousConfig)
 {
     updateWorkerId(config->apiWorkerId(), previousConfig->apiWorkerId());
@@ -198,6 +243,34 @@ void ApiRouter::getConnection(rapidjson::Document &doc) const
     connection.AddMember("failures",  m_network.failures, allocator);
     connection.AddMember("error_log", rapidjson::Value(rapidjson::kArrayType), allocator);
 
+    rapidjson::Value latency(rapidjson::kObjectType);
+    latency.AddMember("1m",      latencyToJSON(m_network.latency(60 * 1000), allocator), allocator);
+    latency.AddMember("15m",     latencyToJSON(m_network.latency(15 * 60 * 1000), allocator), allocator);
+    latency.AddMember("session", latencyToJSON(m_network.sessionLatency(), allocator), allocator);
+
+    connection.AddMember("latency", latency, allocator);
+
+    rapidjson::Value writes(rapidjson::kObjectType);
+    writes.AddMember("queued",    xmrig::Client::queuedBytes(), allocator);
+    writes.AddMember("coalesced", xmrig::Client::coalescedWrites(), allocator);
+    writes.AddMember("dropped",   xmrig::Client::droppedWrites(), allocator);
+
+    connection.AddMember("writes", writes, allocator);
+
+    rapidjson::Value tls(rapidjson::kArrayType);
+    for (const xmrig::Client::TlsStats &stats : xmrig::Client::tlsStats()) {
+        rapidjson::Value value(rapidjson::kObjectType);
+        value.AddMember("pool",       rapidjson::Value(stats.url, allocator), allocator);
+        value.AddMember("handshakes", stats.handshakes, allocator);
+        value.AddMember("resumed",    stats.resumed, allocator);
+        value.AddMember("avg",        stats.time / stats.handshakes, allocator);
+        value.AddMember("last",       stats.last, allocator);
+
+        tls.PushBack(value, allocator);
+    }
+
+    connection.AddMember("tls", tls, allocator);
+
     doc.AddMember("connection", connection, allocator);
 }
 
@@ -212,21 +285,21 @@ void ApiRouter::getHashrate(rapidjson::Document &doc) const
 
     const Hashrate *hr = Workers::hashrate();
 
-    total.PushBack(normalize(hr->calc(Hashrate::ShortInterval)),  allocator);
-    total.PushBack(normalize(hr->calc(Hashrate::MediumInterval)), allocator);
-    total.PushBack(normalize(hr->calc(Hashrate::LargeInterval)),  allocator);
+    total.PushBack(normalize(calc(hr, Hashrate::ShortInterval)),  allocator);
+    total.PushBack(normalize(calc(hr, Hashrate::MediumInterval)), allocator);
+    total.PushBack(normalize(calc(hr, Hashrate::LargeInterval)),  allocator);
 
     for (size_t i = 0; i < Workers::threads(); i++) {
         rapidjson::Value thread(rapidjson::kArrayType);
-        thread.PushBack(normalize(hr->calc(i, Hashrate::ShortInterval)),  allocator);
-        thread.PushBack(normalize(hr->calc(i, Hashrate::MediumInterval)), allocator);
-        thread.PushBack(normalize(hr->calc(i, Hashrate::LargeInterval)),  allocator);
+        thread.PushBack(normalize(calc(hr, i, Hashrate::ShortInterval)),  allocator);
+        thread.PushBack(normalize(calc(hr, i, Hashrate::MediumInterval)), allocator);
+        thread.PushBack(normalize(calc(hr, i, Hashrate::LargeInterval)),  allocator);
 
         threads.PushBack(thread, allocator);
     }
 
     hashrate.AddMember("total",   total, allocator);
-    hashrate.AddMember("highest", normalize(hr->highest()), allocator);
+    hashrate.AddMember("highest", normalize(hr ? hr->highest() : nan("")), allocator);
     hashrate.AddMember("threads", threads, allocator);
     doc.AddMember("hashrate", hashrate, allocator);
 }
@@ -292,7 +365,10 @@ void ApiRouter::getThreads(rapidjson::Document &doc) const
 
     Workers::threadsSummary(doc);
 
-    const std::vector<xmrig::IThread *> &threads = m_controller->config()->threads();
+    // CPU threads follow the GPU threads, same order as the hashrate rows
+    std::vector<xmrig::IThread *> threads = Workers::gpuThreads();
+    threads.insert(threads.end(), m_controller->config()->cpuThreads().begin(), m_controller->config()->cpuThreads().end());
+
     rapidjson::Value list(rapidjson::kArrayType);
 
     size_t i = 0;
@@ -300,13 +376,17 @@ void ApiRouter::getThreads(rapidjson::Document &doc) const
         rapidjson::Value value = thread->toAPI(doc);
 
         rapidjson::Value hashrate(rapidjson::kArrayType);
-        hashrate.PushBack(normalize(hr->calc(i, Hashrate::ShortInterval)),  allocator);
-        hashrate.PushBack(normalize(hr->calc(i, Hashrate::MediumInterval)), allocator);
-        hashrate.PushBack(normalize(hr->calc(i, Hashrate::LargeInterval)),  allocator);
+        hashrate.PushBack(normalize(calc(hr, i, Hashrate::ShortInterval)),  allocator);
+        hashrate.PushBack(normalize(calc(hr, i, Hashrate::MediumInterval)), allocator);
+        hashrate.PushBack(normalize(calc(hr, i, Hashrate::LargeInterval)),  allocator);
+
+        value.AddMember("hashrate",            hashrate, allocator);
+        value.AddMember("batch_time",          normalize(Workers::batchTime(i)), allocator);
+        value.AddMember("effective_intensity", Workers::intensity(i), allocator);
+        value.AddMember("job_latency",         normalize(Workers::jobLatency(i)), allocator);
 
         i++;
 
-        value.AddMember("hashrate", hashrate, allocator);
         list.PushBack(value, allocator);
     }
 
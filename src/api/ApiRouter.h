@@ -26,6 +26,7 @@
 #define XMRIG_APIROUTER_H
 
 
+#include "api/ApiMetrics.h"
 #include "api/NetworkState.h"
 #include "common/interfaces/IControllerListener.h"
 #include "rapidjson/fwd.h"
@@ -51,6 +52,7 @@ public:
     void exec(const xmrig::HttpRequest &req, xmrig::HttpReply &reply);
 
     void tick(const xmrig::NetworkState &results);
+    void updateMetrics();
 
 protected:
     void onConfigChanged(xmrig::Config *config, xmrig::Config *previousConfig) override;
@@ -68,6 +70,7 @@ private:
     void updateWorkerId(const char *id, const char *previousId);
 
     char m_id[32];
+    ApiMetrics m_metrics;
     char m_workerId[128];
     xmrig::NetworkState m_network;
     xmrig::Controller *m_controller;
@@ -0,0 +1,133 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <algorithm>
+
+
+#include "api/LatencyHistogram.h"
+
+
+xmrig::LatencyHistogram::LatencyHistogram()
+{
+    reset();
+}
+
+
+// Highest value of the bucket that holds the q-th value, never above the largest value seen.
+uint32_t xmrig::LatencyHistogram::percentile(double q) const
+{
+    if (m_count == 0) {
+        return 0;
+    }
+
+    const uint64_t rank = std::max<uint64_t>(static_cast<uint64_t>(q * m_count + 0.5), 1);
+    uint64_t seen       = 0;
+
+    for (size_t i = 0; i < kBuckets; ++i) {
+        seen += m_buckets[i];
+
+        if (seen >= rank) {
+            return std::min(upperBound(i), m_max);
+        }
+    }
+
+    return m_max;
+}
+
+
+// Exact when value is a power of two or below kSub, the bounds exported by the metrics endpoint are chosen that way.
+uint64_t xmrig::LatencyHistogram::countUpTo(uint32_t value) const
+{
+    uint64_t count = 0;
+
+    for (size_t i = 0; i < kBuckets && upperBound(i) <= value; ++i) {
+        count += m_buckets[i];
+    }
+
+    return count;
+}
+
+
+void xmrig::LatencyHistogram::add(uint64_t value)
+{
+    const uint32_t clamped = value > kMaxValue ? kMaxValue : static_cast<uint32_t>(value);
+
+    m_buckets[bucket(clamped)]++;
+    m_max = std::max(m_max, clamped);
+    m_count++;
+    m_sum += value;
+}
+
+
+void xmrig::LatencyHistogram::merge(const LatencyHistogram &other)
+{
+    for (size_t i = 0; i < kBuckets; ++i) {
+        m_buckets[i] += other.m_buckets[i];
+    }
+
+    m_max    = std::max(m_max, other.m_max);
+    m_count += other.m_count;
+    m_sum   += other.m_sum;
+}
+
+
+void xmrig::LatencyHistogram::reset()
+{
+    m_buckets.fill(0);
+
+    m_max   = 0;
+    m_count = 0;
+    m_sum   = 0;
+}
+
+
+// Buckets are indexed by value - 1, so every bucket ends exactly on its upper bound and 1, 2, 4 ... 65536 are bucket edges.
+size_t xmrig::LatencyHistogram::bucket(uint32_t value)
+{
+    const uint32_t key = value > 0 ? value - 1 : 0;
+    if (key < kSub) {
+        return key;
+    }
+
+    size_t power = kSubBits;
+    while ((key >> (power + 1)) != 0) {
+        power++;
+    }
+
+    return kSub + (power - kSubBits) * kSub + ((key >> (power - kSubBits)) & (kSub - 1));
+}
+
+
+uint32_t xmrig::LatencyHistogram::upperBound(size_t bucket)
+{
+    if (bucket < kSub) {
+        return static_cast<uint32_t>(bucket + 1);
+    }
+
+    const size_t power = (bucket - kSub) / kSub + kSubBits;
+    const size_t sub   = (bucket - kSub) % kSub;
+
+    return static_cast<uint32_t>((kSub + sub + 1) << (power - kSubBits));
+}
@@ -0,0 +1,72 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef XMRIG_LATENCYHISTOGRAM_H
+#define XMRIG_LATENCYHISTOGRAM_H
+
+
+#include <array>
+#include <stddef.h>
+#include <stdint.h>
+
+
+namespace xmrig {
+
+
+// Log-linear histogram of millisecond latencies, 8 sub-buckets per power of two keep the error of a percentile below 12.5%.
+class LatencyHistogram
+{
+public:
+    static const uint32_t kMaxValue = 0xFFFF; // larger values are counted in the last bucket
+    static const size_t kSubBits    = 3;
+    static const size_t kSub        = 1 << kSubBits;
+    static const size_t kBuckets    = kSub + (16 - kSubBits) * kSub;
+
+    LatencyHistogram();
+
+    inline uint32_t max() const   { return m_max; }
+    inline uint64_t count() const { return m_count; }
+    inline uint64_t sum() const   { return m_sum; }
+
+    uint32_t percentile(double q) const;
+    uint64_t countUpTo(uint32_t value) const;
+    void add(uint64_t value);
+    void merge(const LatencyHistogram &other);
+    void reset();
+
+private:
+    static size_t bucket(uint32_t value);
+    static uint32_t upperBound(size_t bucket);
+
+    std::array<uint32_t, kBuckets> m_buckets;
+    uint32_t m_max;
+    uint64_t m_count;
+    uint64_t m_sum;
+};
+
+
+} /* namespace xmrig */
+
+
+#endif /* XMRIG_LATENCYHISTOGRAM_H */
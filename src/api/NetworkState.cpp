@@ -50,27 +50,36 @@ int xmrig::NetworkState::connectionTime() const
 }
 
 
-uint32_t xmrig::NetworkState::avgTime() const
+// Shares accepted within about the last window milliseconds, counted in whole slots including the current one, at most 15 minutes.
+xmrig::LatencyHistogram xmrig::NetworkState::latency(uint64_t window) const
 {
-    if (m_latency.empty()) {
-        return 0;
+    const uint64_t current = uv_now(uv_default_loop()) / kLatencySlotTime + 1;
+    const uint64_t slots   = std::min<uint64_t>((window + kLatencySlotTime - 1) / kLatencySlotTime, kLatencySlots);
+
+    LatencyHistogram histogram;
+    for (size_t i = 0; i < kLatencySlots; ++i) {
+        if (m_slotIndex[i] + slots >= current + 1 && m_slotIndex[i] <= current) {
+            histogram.merge(m_slots[i]);
+        }
     }
 
-    return connectionTime() / (uint32_t)m_latency.size();
+    return histogram;
 }
 
 
-uint32_t xmrig::NetworkState::latency() const
+uint32_t xmrig::NetworkState::avgTime() const
 {
-    const size_t calls = m_latency.size();
-    if (calls == 0) {
+    if (m_session.count() == 0) {
         return 0;
     }
 
-    auto v = m_latency;
-    std::nth_element(v.begin(), v.begin() + calls / 2, v.end());
+    return connectionTime() / (uint32_t)m_session.count();
+}
+
 
-    return v[calls / 2];
+uint32_t xmrig::NetworkState::latency() const
+{
+    return m_session.percentile(0.5);
 }
 
 
@@ -90,7 +99,18 @@ void xmrig::NetworkState::add(const SubmitResult &result, const char *error)
         std::sort(topDiff.rbegin(), topDiff.rend());
     }
 
-    m_latency.push_back(result.elapsed > 0xFFFF ? 0xFFFF : (uint16_t) result.elapsed);
+    // slot indexes start from 1, a zero index marks a slot that was never used
+    const uint64_t index = uv_now(uv_default_loop()) / kLatencySlotTime + 1;
+    const size_t slot    = index % kLatencySlots;
+
+    if (m_slotIndex[slot] != index) {
+        m_slots[slot].reset();
+        m_slotIndex[slot] = index;
+    }
+
+    m_slots[slot].add(result.elapsed);
+    m_session.add(result.elapsed);
+    m_total.add(result.elapsed);
 }
 
 
@@ -109,5 +129,5 @@ void xmrig::NetworkState::stop()
     diff     = 0;
 
     failures++;
-    m_latency.clear();
+    m_session.reset();
 }
@@ -27,7 +27,9 @@
 
 
 #include <array>
-#include <vector>
+
+
+#include "api/LatencyHistogram.h"
 
 
 namespace xmrig {
@@ -39,9 +41,16 @@ class SubmitResult;
 class NetworkState
 {
 public:
+    static const size_t kLatencySlots      = 60;    // 15 minutes of share latency in 15 second slots
+    static const uint64_t kLatencySlotTime = 15000;
+
     NetworkState();
 
+    inline const LatencyHistogram &sessionLatency() const { return m_session; }
+    inline const LatencyHistogram &totalLatency() const   { return m_total; }
+
     int connectionTime() const;
+    LatencyHistogram latency(uint64_t window) const;
     uint32_t avgTime() const;
     uint32_t latency() const;
     void add(const SubmitResult &result, const char *error);
@@ -58,7 +67,10 @@ public:
 
 private:
     bool m_active;
-    std::vector<uint16_t> m_latency;
+    LatencyHistogram m_session;
+    LatencyHistogram m_total;
+    std::array<LatencyHistogram, kLatencySlots> m_slots;
+    std::array<uint64_t, kLatencySlots> m_slotIndex { { } };
     uint64_t m_connectionTime;
 };
 
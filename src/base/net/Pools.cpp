@@ -32,7 +32,8 @@
 
 xmrig::Pools::Pools() :
     m_retries(5),
-    m_retryPause(5)
+    m_retryPause(5),
+    m_standby(0)
 {
 #   ifdef XMRIG_PROXY_PROJECT
     m_retries    = 2;
@@ -53,7 +54,7 @@ xmrig::Pool &xmrig::Pools::current()
 
 bool xmrig::Pools::isEqual(const Pools &other) const
 {
-    if (m_data.size() != other.m_data.size() || m_retries != other.m_retries || m_retryPause != other.m_retryPause) {
+    if (m_data.size() != other.m_data.size() || m_retries != other.m_retries || m_retryPause != other.m_retryPause || m_standby != other.m_standby) {
         return false;
     }
 
@@ -90,7 +91,7 @@ xmrig::IStrategy *xmrig::Pools::createStrategy(IStrategyListener *listener) cons
         }
     }
 
-    FailoverStrategy *strategy = new FailoverStrategy(retryPause(), retries(), listener);
+    FailoverStrategy *strategy = new FailoverStrategy(retryPause(), retries(), listener, false, standby());
     for (const Pool &pool : m_data) {
         if (pool.isEnabled()) {
             strategy->add(pool);
@@ -205,3 +206,11 @@ void xmrig::Pools::setRetryPause(int retryPause)
         m_retryPause = retryPause;
     }
 }
+
+
+void xmrig::Pools::setStandby(int standby)
+{
+    if (standby >= 0 && standby <= kMaxStandby) {
+        m_standby = standby;
+    }
+}
@@ -42,12 +42,15 @@ class IStrategyListener;
 class Pools
 {
 public:
+    constexpr static int kMaxStandby = 4;
+
     Pools();
 
     inline bool setUserpass(const char *userpass)       { return current().setUserpass(userpass); }
     inline const std::vector<Pool> &data() const        { return m_data; }
     inline int retries() const                          { return m_retries; }
     inline int retryPause() const                       { return m_retryPause; }
+    inline int standby() const                          { return m_standby; }
     inline void setFingerprint(const char *fingerprint) { current().setFingerprint(fingerprint); }
     inline void setKeepAlive(bool enable)               { current().setKeepAlive(enable); }
     inline void setKeepAlive(int keepAlive)             { current().setKeepAlive(keepAlive); }
@@ -72,12 +75,14 @@ public:
     void print() const;
     void setRetries(int retries);
     void setRetryPause(int retryPause);
+    void setStandby(int standby);
 
 private:
     Pool &current();
 
     int m_retries;
     int m_retryPause;
+    int m_standby;
     std::vector<Pool> m_data;
 };
 
@@ -37,11 +37,13 @@ class HttpReply
 public:
     HttpReply() :
         buf(nullptr),
+        contentType("application/json"),
         status(200),
         size(0)
     {}
 
     char *buf;
+    const char *contentType;
     int status;
     size_t size;
 };
@@ -131,20 +131,20 @@ const char *xmrig::HttpRequest::body() const
 int xmrig::HttpRequest::end(const HttpReply &reply)
 {
     if (reply.buf) {
-        return end(reply.status, MHD_create_response_from_buffer(reply.size ? reply.size : strlen(reply.buf), (void*) reply.buf, MHD_RESPMEM_MUST_FREE));
+        return end(reply.status, MHD_create_response_from_buffer(reply.size ? reply.size : strlen(reply.buf), (void*) reply.buf, MHD_RESPMEM_MUST_FREE), reply.contentType);
     }
 
-    return end(reply.status, nullptr);
+    return end(reply.status, nullptr, reply.contentType);
 }
 
 
-int xmrig::HttpRequest::end(int status, MHD_Response *rsp)
+int xmrig::HttpRequest::end(int status, MHD_Response *rsp, const char *contentType)
 {
     if (!rsp) {
         rsp = MHD_create_response_from_buffer(0, nullptr, MHD_RESPMEM_PERSISTENT);
     }
 
-    MHD_add_response_header(rsp, "Content-Type", "application/json");
+    MHD_add_response_header(rsp, "Content-Type", contentType);
     MHD_add_response_header(rsp, "Access-Control-Allow-Origin", "*");
     MHD_add_response_header(rsp, "Access-Control-Allow-Methods", "GET, PUT");
     MHD_add_response_header(rsp, "Access-Control-Allow-Headers", "Authorization, Content-Type");
@@ -61,7 +61,7 @@ public:
     bool process(const char *accessToken, bool restricted, xmrig::HttpReply &reply);
     const char *body() const;
     int end(const HttpReply &reply);
-    int end(int status, MHD_Response *rsp);
+    int end(int status, MHD_Response *rsp, const char *contentType = "application/json");
 
 private:
     int auth(const char *accessToken);
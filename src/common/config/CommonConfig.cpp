@@ -321,6 +321,7 @@ bool xmrig::CommonConfig::parseString(int key, const char *arg)
 
     case RetriesKey:     /* --retries */
     case RetryPauseKey:  /* --retry-pause */
+    case StandbyKey:     /* --standby */
     case ApiPort:        /* --api-port */
     case PrintTimeKey:   /* --print-time */
         return parseUint64(key, strtol(arg, nullptr, 10));
@@ -388,6 +389,10 @@ bool xmrig::CommonConfig::parseInt(int key, int arg)
         m_pools.setRetryPause(arg);
         break;
 
+    case StandbyKey: /* --standby */
+        m_pools.setStandby(arg);
+        break;
+
     case KeepAliveKey: /* --keepalive */
         m_pools.setKeepAlive(arg);
         break;
@@ -69,6 +69,7 @@ public:
         TlsKey            = 1013,
         FingerprintKey    = 1014,
         AutoSaveKey       = 1016,
+        StandbyKey        = 1017,
 
         // xmrig common
         CPUPriorityKey    = 1021,
@@ -98,6 +99,21 @@ public:
         OclMemChunkKey    = 1408,
         OclUnrollKey      = 1409,
         OclCompModeKey    = 1410,
+        VerifyThreadsKey  = 1411,
+        VerifyAffinityKey = 1412,
+        OclPipelineKey    = 1413,
+        OclRWorkersKey    = 1414,
+        BenchKey          = 1415,
+        BenchHashesKey    = 1416,
+        BenchReportKey    = 1417,
+        TuneKey           = 1418,
+        CpuThreadsKey     = 1419,
+        CpuWaysKey        = 1420,
+        CpuAffinityKey    = 1421,
+        OclBatchTimeKey   = 1422,
+        OclFastSwitchKey  = 1423,
+        OclProfileKey     = 1424,
+        OclSelfTestKey    = 1425,
 
         // xmrig-proxy
         AccessLogFileKey   = 'A',
@@ -24,7 +24,9 @@
 
 #include <assert.h>
 #include <inttypes.h>
+#include <algorithm>
 #include <iterator>
+#include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
 #include <utility>
@@ -40,6 +42,9 @@
 #include "common/interfaces/IClientListener.h"
 #include "common/log/Log.h"
 #include "common/net/Client.h"
+#include "common/net/Connector.h"
+#include "common/net/DnsCache.h"
+#include "common/net/WriteBuffer.h"
 #include "net/JobResult.h"
 #include "rapidjson/document.h"
 #include "rapidjson/error/en.h"
@@ -56,10 +61,36 @@ namespace xmrig {
 
 int64_t Client::m_sequence = 1;
 Storage<Client> Client::m_storage;
+std::vector<uintptr_t> Client::m_flushQueue;
+uint64_t Client::m_coalesced = 0;
+uint64_t Client::m_dropped   = 0;
+uint64_t Client::m_queued    = 0;
+uv_check_t *Client::m_flush  = nullptr;
 
 } /* namespace xmrig */
 
 
+static const char *kSubmit     = "{\"id\":%" PRId64 ",\"jsonrpc\":\"2.0\",\"method\":\"submit\",\"params\":{\"id\":\"%s\",\"job_id\":\"%s\",\"nonce\":\"%s\",\"result\":\"%s\"}}\n";
+static const char *kSubmitAlgo = "{\"id\":%" PRId64 ",\"jsonrpc\":\"2.0\",\"method\":\"submit\",\"params\":{\"id\":\"%s\",\"job_id\":\"%s\",\"nonce\":\"%s\",\"result\":\"%s\",\"algo\":\"%s\"}}\n";
+
+
+// Job and login ids are pasted into submit and keepalived requests as is, so only printable characters that need no JSON escaping are accepted.
+static bool isValidId(const rapidjson::Value &value)
+{
+    if (!value.IsString() || value.GetStringLength() == 0) {
+        return false;
+    }
+
+    for (const char *c = value.GetString(); *c != '\0'; ++c) {
+        if (*c <= ' ' || *c > '~' || *c == '"' || *c == '\\') {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
 #ifdef APP_DEBUG
 static const char *states[] = {
     "unconnected",
@@ -77,21 +108,27 @@ xmrig::Client::Client(int id, const char *agent, IClientListener *listener) :
     m_nicehash(false),
     m_quiet(false),
     m_agent(agent),
+    m_connector(nullptr),
     m_listener(listener),
     m_extensions(0),
     m_id(id),
     m_retries(5),
     m_retryPause(5000),
     m_failures(0),
+    m_pingId(0),
     m_recvBufPos(0),
+    m_tlsMessages(0),
     m_state(UnconnectedState),
     m_tls(nullptr),
     m_expire(0),
     m_jobs(0),
     m_keepAlive(0),
+    m_latency(0),
+    m_pingTime(0),
     m_key(0),
     m_stream(nullptr),
-    m_socket(nullptr)
+    m_socket(nullptr),
+    m_pending(nullptr)
 {
     m_key = m_storage.add(this);
 
@@ -111,7 +148,20 @@ xmrig::Client::Client(int id, const char *agent, IClientListener *listener) :
 
 xmrig::Client::~Client()
 {
+    dropPending();
+
+    if (m_connector) {
+        m_connector->cancel();
+    }
+
     delete m_socket;
+
+    // the flush handle is shared by all clients, the last one closes it.
+    if (m_flush && m_storage.isEmpty()) {
+        uv_check_stop(m_flush);
+        uv_close(reinterpret_cast<uv_handle_t*>(m_flush), Client::onFlushClose);
+        m_flush = nullptr;
+    }
 }
 
 
@@ -198,6 +248,18 @@ bool xmrig::Client::disconnect()
 }
 
 
+bool xmrig::Client::isTlsResumed() const
+{
+#   ifndef XMRIG_NO_TLS
+    if (isTLS()) {
+        return m_tls->isResumed();
+    }
+#   endif
+
+    return false;
+}
+
+
 const char *xmrig::Client::tlsFingerprint() const
 {
 #   ifndef XMRIG_NO_TLS
@@ -222,6 +284,28 @@ const char *xmrig::Client::tlsVersion() const
 }
 
 
+std::vector<xmrig::Client::TlsStats> xmrig::Client::tlsStats()
+{
+#   ifndef XMRIG_NO_TLS
+    return Tls::stats();
+#   else
+    return std::vector<TlsStats>();
+#   endif
+}
+
+
+uint64_t xmrig::Client::tlsHandshakeTime() const
+{
+#   ifndef XMRIG_NO_TLS
+    if (isTLS()) {
+        return m_tls->handshakeTime();
+    }
+#   endif
+
+    return 0;
+}
+
+
 int64_t xmrig::Client::submit(const JobResult &result)
 {
 #   ifndef XMRIG_PROXY_PROJECT
@@ -230,14 +314,12 @@ int64_t xmrig::Client::submit(const JobResult &result)
     }
 #   endif
 
-    using namespace rapidjson;
-
 #   ifdef XMRIG_PROXY_PROJECT
     const char *nonce = result.nonce;
     const char *data  = result.result;
 #   else
-    char *nonce = m_sendBuf;
-    char *data  = m_sendBuf + 16;
+    char nonce[9];
+    char data[65];
 
     Job::toHex(reinterpret_cast<const unsigned char*>(&result.nonce), 4, nonce);
     nonce[8] = '\0';
@@ -246,32 +328,26 @@ int64_t xmrig::Client::submit(const JobResult &result)
     data[64] = '\0';
 #   endif
 
-    Document doc(kObjectType);
-    auto &allocator = doc.GetAllocator();
-
-    doc.AddMember("id",      m_sequence, allocator);
-    doc.AddMember("jsonrpc", "2.0", allocator);
-    doc.AddMember("method",  "submit", allocator);
-
-    Value params(kObjectType);
-    params.AddMember("id",     StringRef(m_rpcId.data()), allocator);
-    params.AddMember("job_id", StringRef(result.jobId.data()), allocator);
-    params.AddMember("nonce",  StringRef(nonce), allocator);
-    params.AddMember("result", StringRef(data), allocator);
-
-    if (m_extensions & AlgoExt) {
-        params.AddMember("algo", StringRef(result.algorithm.shortName()), allocator);
+    // formatted straight into the outgoing buffer, shares found in the same loop iteration go out in one write
+    const int64_t id = sendf((m_extensions & AlgoExt) ? kSubmitAlgo : kSubmit, m_sequence, m_rpcId.data(), result.jobId.data(), nonce, data, result.algorithm.shortName());
+    if (id < 0) {
+        return -1;
     }
 
-    doc.AddMember("params", params, allocator);
-
 #   ifdef XMRIG_PROXY_PROJECT
-    m_results[m_sequence] = SubmitResult(m_sequence, result.diff, result.actualDiff(), result.id);
+    m_results[id] = SubmitResult(id, result.diff, result.actualDiff(), result.id);
 #   else
-    m_results[m_sequence] = SubmitResult(m_sequence, result.diff, result.actualDiff());
+    m_results[id] = SubmitResult(id, result.diff, result.actualDiff());
 #   endif
 
-    return send(doc);
+    return id;
+}
+
+
+// Round trip of submits and keepalives, a standby pool without shares is still measured by its keepalives.
+void xmrig::Client::addLatency(uint64_t latency)
+{
+    m_latency = m_latency ? (m_latency * 7 + latency) / 8 : latency;
 }
 
 
@@ -281,6 +357,15 @@ bool xmrig::Client::close()
         return m_socket != nullptr;
     }
 
+    // nothing is established yet, the remaining attempts are closed by the connector itself
+    if (m_connector) {
+        m_connector->cancel();
+        m_connector = nullptr;
+
+        setState(UnconnectedState);
+        return false;
+    }
+
     if (m_state == UnconnectedState || m_socket == nullptr) {
         return false;
     }
@@ -327,6 +412,12 @@ bool xmrig::Client::isTLS() const
 }
 
 
+bool xmrig::Client::isWritable() const
+{
+    return state() == ConnectedState && m_stream && uv_is_writable(m_stream);
+}
+
+
 bool xmrig::Client::parseJob(const rapidjson::Value &params, int *code)
 {
     if (!params.IsObject()) {
@@ -336,7 +427,7 @@ bool xmrig::Client::parseJob(const rapidjson::Value &params, int *code)
 
     Job job(m_id, m_nicehash, m_pool.algorithm(), m_rpcId);
 
-    if (!job.setId(params["job_id"].GetString())) {
+    if (!params.HasMember("job_id") || !isValidId(params["job_id"]) || !job.setId(params["job_id"].GetString())) {
         *code = 3;
         return false;
     }
@@ -404,7 +495,7 @@ bool xmrig::Client::parseJob(const rapidjson::Value &params, int *code)
 
 bool xmrig::Client::parseLogin(const rapidjson::Value &result, int *code)
 {
-    if (!m_rpcId.setId(result["id"].GetString())) {
+    if (!result.HasMember("id") || !isValidId(result["id"]) || !m_rpcId.setId(result["id"].GetString())) {
         *code = 1;
         return false;
     }
@@ -435,17 +526,18 @@ bool xmrig::Client::send(BIO *bio)
     LOG_DEBUG("[%s] TLS send     (%d bytes)", m_pool.url(), static_cast<int>(buf.len));
 
     bool result = false;
-    if (state() == ConnectedState && uv_is_writable(m_stream)) {
-        result = uv_try_write(m_stream, &buf, 1) > 0;
+    if (isWritable()) {
+        WriteBuffer *buffer = WriteBuffer::get(m_key);
+        buffer->append(buf.base, buf.len, m_tlsMessages);
 
-        if (!result) {
-            close();
-        }
+        result = write(buffer);
     }
     else {
+        m_dropped += m_tlsMessages;
         LOG_DEBUG_ERR("[%s] send failed, invalid state: %d", m_pool.url(), m_state);
     }
 
+    m_tlsMessages = 0;
     (void) BIO_reset(bio);
 
     return result;
@@ -482,6 +574,29 @@ bool xmrig::Client::verifyAlgorithm(const Algorithm &algorithm) const
 }
 
 
+bool xmrig::Client::write(WriteBuffer *buffer)
+{
+    uv_buf_t buf = buffer->buf();
+    m_queued    += buffer->size();
+
+    const int rc = uv_write(buffer->request(), m_stream, &buf, 1, Client::onWrite);
+    if (rc < 0) {
+        if (!isQuiet()) {
+            LOG_ERR("[%s] write error: \"%s\"", m_pool.url(), uv_strerror(rc));
+        }
+
+        m_queued  -= buffer->size();
+        m_dropped += buffer->messages();
+        WriteBuffer::release(buffer);
+
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+
 int xmrig::Client::resolve(const char *host)
 {
     setState(HostLookupState);
@@ -492,6 +607,13 @@ int xmrig::Client::resolve(const char *host)
         m_failures = 0;
     }
 
+    std::vector<sockaddr_storage> addresses;
+    if (DnsCache::get(host, addresses)) {
+        connect(addresses);
+
+        return 0;
+    }
+
     const int r = uv_getaddrinfo(uv_default_loop(), &m_resolver, Client::onResolved, host, nullptr, &m_hints);
     if (r) {
         if (!isQuiet()) {
@@ -504,6 +626,22 @@ int xmrig::Client::resolve(const char *host)
 }
 
 
+int64_t xmrig::Client::send(const char *data, size_t size)
+{
+    WriteBuffer *buffer = queue(size);
+    if (!buffer) {
+        return -1;
+    }
+
+    LOG_DEBUG("[%s] send (%d bytes): \"%.*s\"", m_pool.url(), size, static_cast<int>(size), data);
+
+    buffer->append(data, size);
+
+    m_expire = uv_now(uv_default_loop()) + kResponseTimeout;
+    return m_sequence++;
+}
+
+
 int64_t xmrig::Client::send(const rapidjson::Document &doc)
 {
     using namespace rapidjson;
@@ -511,91 +649,126 @@ int64_t xmrig::Client::send(const rapidjson::Document &doc)
     StringBuffer buffer(0, 512);
     Writer<StringBuffer> writer(buffer);
     doc.Accept(writer);
+    buffer.Put('\n');
+
+    return send(buffer.GetString(), buffer.GetSize());
+}
+
 
-    const size_t size = buffer.GetSize();
-    if (size > (sizeof(m_sendBuf) - 2)) {
-        LOG_ERR("[%s] send failed: \"send buffer overflow: %zu > %zu\"", m_pool.url(), size, (sizeof(m_sendBuf) - 2));
+// Formatted on the stack, the shared write buffer grows only by the length of the request.
+int64_t xmrig::Client::sendf(const char *format, ...)
+{
+    char data[kMaxMessageSize];
+
+    va_list args;
+    va_start(args, format);
+    const int size = vsnprintf(data, sizeof(data), format, args);
+    va_end(args);
+
+    if (size <= 0 || static_cast<size_t>(size) >= sizeof(data)) {
+        LOG_ERR("[%s] send failed: \"send buffer overflow: %d > %zu\"", m_pool.url(), size, sizeof(data) - 1);
         close();
         return -1;
     }
 
-    memcpy(m_sendBuf, buffer.GetString(), size);
-    m_sendBuf[size]     = '\n';
-    m_sendBuf[size + 1] = '\0';
-
-    return send(size + 1);
+    return send(data, static_cast<size_t>(size));
 }
 
 
-int64_t xmrig::Client::send(size_t size)
+// Buffer that collects requests until the end of the current loop iteration, nullptr if the request must be dropped.
+xmrig::WriteBuffer *xmrig::Client::queue(size_t size)
 {
-    LOG_DEBUG("[%s] send (%d bytes): \"%s\"", m_pool.url(), size, m_sendBuf);
+    if (!isWritable()) {
+        m_dropped++;
+        LOG_DEBUG_ERR("[%s] send failed, invalid state: %d", m_pool.url(), m_state);
 
-#   ifndef XMRIG_NO_TLS
-    if (isTLS()) {
-        if (!m_tls->send(m_sendBuf, size)) {
-            return -1;
-        }
+        return nullptr;
     }
-    else
-#   endif
-    {
-        if (state() != ConnectedState || !uv_is_writable(m_stream)) {
-            LOG_DEBUG_ERR("[%s] send failed, invalid state: %d", m_pool.url(), m_state);
-            return -1;
-        }
 
-        uv_buf_t buf = uv_buf_init(m_sendBuf, (unsigned int) size);
+    // the pool does not read, more data would only wait in memory until the response timeout
+    const size_t pending = m_pending ? m_pending->size() : 0;
+    if (m_stream->write_queue_size + pending + size > kMaxQueueSize) {
+        m_dropped++;
 
-        if (uv_try_write(m_stream, &buf, 1) < 0) {
-            close();
-            return -1;
+        if (!isQuiet()) {
+            LOG_ERR("[%s] send failed: \"write queue is full: %zu bytes\"", m_pool.url(), m_stream->write_queue_size + pending);
         }
+
+        close();
+        return nullptr;
     }
 
-    m_expire = uv_now(uv_default_loop()) + kResponseTimeout;
-    return m_sequence++;
+    if (m_pending) {
+        m_coalesced++;
+
+        return m_pending;
+    }
+
+    if (!m_flush) {
+        m_flush = new uv_check_t;
+        uv_check_init(uv_default_loop(), m_flush);
+    }
+
+    if (m_flushQueue.empty()) {
+        uv_check_start(m_flush, Client::onFlush);
+    }
+
+    m_pending = WriteBuffer::get(m_key);
+    m_flushQueue.push_back(m_key);
+
+    return m_pending;
 }
 
 
-void xmrig::Client::connect(const std::vector<addrinfo*> &ipv4, const std::vector<addrinfo*> &ipv6)
+void xmrig::Client::connect(const std::vector<sockaddr_storage> &addresses)
 {
-    addrinfo *addr = nullptr;
-    m_ipv6         = ipv4.empty() && !ipv6.empty();
+    setState(ConnectingState);
 
-    if (m_ipv6) {
-        addr = ipv6[ipv6.size() == 1 ? 0 : rand() % ipv6.size()];
-        uv_ip6_name(reinterpret_cast<sockaddr_in6*>(addr->ai_addr), m_ip, 45);
-    }
-    else {
-        addr = ipv4[ipv4.size() == 1 ? 0 : rand() % ipv4.size()];
-        uv_ip4_name(reinterpret_cast<sockaddr_in*>(addr->ai_addr), m_ip, 16);
+    m_connector = new Connector(m_storage.ptr(m_key), addresses, m_pool.port(), Client::onConnect);
+}
+
+
+void xmrig::Client::dropPending()
+{
+    if (!m_pending) {
+        return;
     }
 
-    connect(addr->ai_addr);
+    m_dropped += m_pending->messages();
+    WriteBuffer::release(m_pending);
+    m_pending = nullptr;
+
+    m_flushQueue.erase(std::remove(m_flushQueue.begin(), m_flushQueue.end(), m_key), m_flushQueue.end());
 }
 
 
-void xmrig::Client::connect(sockaddr *addr)
+void xmrig::Client::flush()
 {
-    setState(ConnectingState);
+    WriteBuffer *buffer = m_pending;
+    m_pending           = nullptr;
 
-    reinterpret_cast<sockaddr_in*>(addr)->sin_port = htons(m_pool.port());
+    if (!buffer) {
+        return;
+    }
 
-    uv_connect_t *req = new uv_connect_t;
-    req->data = m_storage.ptr(m_key);
+    if (!isWritable()) {
+        m_dropped += buffer->messages();
+        WriteBuffer::release(buffer);
 
-    m_socket = new uv_tcp_t;
-    m_socket->data = m_storage.ptr(m_key);
+        return;
+    }
 
-    uv_tcp_init(uv_default_loop(), m_socket);
-    uv_tcp_nodelay(m_socket, 1);
+#   ifndef XMRIG_NO_TLS
+    if (isTLS()) {
+        m_tlsMessages = buffer->messages();
+        m_tls->send(buffer->data(), buffer->size());
 
-#   ifndef WIN32
-    uv_tcp_keepalive(m_socket, 1, 60);
+        WriteBuffer::release(buffer);
+        return;
+    }
 #   endif
 
-    uv_tcp_connect(req, m_socket, reinterpret_cast<const sockaddr*>(addr), Client::onConnect);
+    write(buffer);
 }
 
 
@@ -657,6 +830,8 @@ void xmrig::Client::login()
 
 void xmrig::Client::onClose()
 {
+    dropPending();
+
     delete m_socket;
 
     m_stream = nullptr;
@@ -774,6 +949,7 @@ void xmrig::Client::parseResponse(int64_t id, const rapidjson::Value &result, co
         auto it = m_results.find(id);
         if (it != m_results.end()) {
             it->second.done();
+            addLatency(it->second.elapsed);
             m_listener->onResultAccepted(this, it->second, message);
             m_results.erase(it);
         }
@@ -809,9 +985,16 @@ void xmrig::Client::parseResponse(int64_t id, const rapidjson::Value &result, co
         return;
     }
 
+    if (id == m_pingId) {
+        addLatency(uv_now(uv_default_loop()) - m_pingTime);
+        m_pingId = 0;
+        return;
+    }
+
     auto it = m_results.find(id);
     if (it != m_results.end()) {
         it->second.done();
+        addLatency(it->second.elapsed);
         m_listener->onResultAccepted(this, it->second, nullptr);
         m_results.erase(it);
     }
@@ -820,8 +1003,8 @@ void xmrig::Client::parseResponse(int64_t id, const rapidjson::Value &result, co
 
 void xmrig::Client::ping()
 {
-    send(snprintf(m_sendBuf, sizeof(m_sendBuf), "{\"id\":%" PRId64 ",\"jsonrpc\":\"2.0\",\"method\":\"keepalived\",\"params\":{\"id\":\"%s\"}}\n", m_sequence, m_rpcId.data()));
-
+    m_pingId    = sendf("{\"id\":%" PRId64 ",\"jsonrpc\":\"2.0\",\"method\":\"keepalived\",\"params\":{\"id\":\"%s\"}}\n", m_sequence, m_rpcId.data());
+    m_pingTime  = uv_now(uv_default_loop());
     m_keepAlive = 0;
 }
 
@@ -857,6 +1040,11 @@ void xmrig::Client::read()
 
 void xmrig::Client::reconnect()
 {
+    if (m_connector) {
+        m_connector->cancel();
+        m_connector = nullptr;
+    }
+
     if (!m_listener) {
         m_storage.remove(m_key);
 
@@ -940,32 +1128,66 @@ void xmrig::Client::onClose(uv_handle_t *handle)
 }
 
 
-void xmrig::Client::onConnect(uv_connect_t *req, int status)
+bool xmrig::Client::onConnect(void *data, uv_tcp_t *socket, const sockaddr *addr, int status)
 {
-    auto client = getClient(req->data);
+    auto client = getClient(data);
     if (!client) {
-        delete req;
-        return;
+        return false;
     }
 
+    client->m_connector = nullptr;
+
     if (status < 0) {
         if (!client->isQuiet()) {
             LOG_ERR("[%s] connect error: \"%s\"", client->m_pool.url(), uv_strerror(status));
         }
 
-        delete req;
-        client->close();
-        return;
+        // every known address failed, the pool may have moved
+        DnsCache::expire(client->m_pool.host());
+
+        client->onClose();
+        return false;
+    }
+
+    client->m_ipv6 = addr->sa_family == AF_INET6;
+    if (client->m_ipv6) {
+        uv_ip6_name(reinterpret_cast<const sockaddr_in6*>(addr), client->m_ip, 45);
+    }
+    else {
+        uv_ip4_name(reinterpret_cast<const sockaddr_in*>(addr), client->m_ip, 16);
     }
 
-    client->m_stream = static_cast<uv_stream_t*>(req->handle);
-    client->m_stream->data = req->data;
+    client->m_socket       = socket;
+    client->m_socket->data = data;
+    client->m_stream       = reinterpret_cast<uv_stream_t*>(socket);
     client->setState(ConnectedState);
 
     uv_read_start(client->m_stream, Client::onAllocBuffer, Client::onRead);
-    delete req;
 
     client->handshake();
+    return true;
+}
+
+
+void xmrig::Client::onFlush(uv_check_t *handle)
+{
+    std::vector<uintptr_t> keys;
+    keys.swap(m_flushQueue);
+
+    uv_check_stop(handle);
+
+    for (uintptr_t key : keys) {
+        auto client = getClient(m_storage.ptr(key));
+        if (client) {
+            client->flush();
+        }
+    }
+}
+
+
+void xmrig::Client::onFlushClose(uv_handle_t *handle)
+{
+    delete reinterpret_cast<uv_check_t*>(handle);
 }
 
 
@@ -1024,7 +1246,18 @@ void xmrig::Client::onResolved(uv_getaddrinfo_t *req, int status, struct addrinf
         return client->reconnect();
     }
 
+    std::vector<sockaddr_storage> addresses;
+
     if (status < 0) {
+        // an outdated answer is better than no connection while the resolver is down
+        if (DnsCache::get(client->m_pool.host(), addresses, true)) {
+            if (!client->isQuiet()) {
+                LOG_WARN("[%s] DNS error: \"%s\", using previously resolved addresses", client->m_pool.url(), uv_strerror(status));
+            }
+
+            return client->connect(addresses);
+        }
+
         if (!client->isQuiet()) {
             LOG_ERR("[%s] DNS error: \"%s\"", client->m_pool.url(), uv_strerror(status));
         }
@@ -1032,31 +1265,39 @@ void xmrig::Client::onResolved(uv_getaddrinfo_t *req, int status, struct addrinf
         return client->reconnect();
     }
 
-    addrinfo *ptr = res;
-    std::vector<addrinfo*> ipv4;
-    std::vector<addrinfo*> ipv6;
-
-    while (ptr != nullptr) {
-        if (ptr->ai_family == AF_INET) {
-            ipv4.push_back(ptr);
-        }
-
-        if (ptr->ai_family == AF_INET6) {
-            ipv6.push_back(ptr);
-        }
-
-        ptr = ptr->ai_next;
-    }
+    DnsCache::set(client->m_pool.host(), res, kDnsTtl);
+    uv_freeaddrinfo(res);
 
-    if (ipv4.empty() && ipv6.empty()) {
+    if (!DnsCache::get(client->m_pool.host(), addresses)) {
         if (!client->isQuiet()) {
             LOG_ERR("[%s] DNS error: \"No IPv4 (A) or IPv6 (AAAA) records found\"", client->m_pool.url());
         }
 
-        uv_freeaddrinfo(res);
         return client->reconnect();
     }
 
-    client->connect(ipv4, ipv6);
-    uv_freeaddrinfo(res);
+    client->connect(addresses);
+}
+
+
+void xmrig::Client::onWrite(uv_write_t *req, int status)
+{
+    WriteBuffer *buffer = static_cast<WriteBuffer *>(req->data);
+    m_queued           -= buffer->size();
+
+    if (status < 0) {
+        m_dropped += buffer->messages();
+
+        // cancelled writes belong to a socket that is already closing
+        auto client = status != UV_ECANCELED ? getClient(m_storage.ptr(buffer->key())) : nullptr;
+        if (client) {
+            if (!client->isQuiet()) {
+                LOG_ERR("[%s] write error: \"%s\"", client->m_pool.url(), uv_strerror(status));
+            }
+
+            client->close();
+        }
+    }
+
+    WriteBuffer::release(buffer);
 }
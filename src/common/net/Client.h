@@ -46,8 +46,10 @@ typedef struct bio_st BIO;
 namespace xmrig {
 
 
+class Connector;
 class IClientListener;
 class JobResult;
+class WriteBuffer;
 
 
 class Client
@@ -63,7 +65,10 @@ public:
     };
 
     constexpr static uint64_t kConnectTimeout  = 20 * 1000;
+    constexpr static uint64_t kDnsTtl          = 60 * 1000; // resolved addresses are reused this long, getaddrinfo does not return record TTLs
     constexpr static uint64_t kResponseTimeout = 20 * 1000;
+    constexpr static size_t kMaxMessageSize    = 1024;      // formatted requests, submit and keepalived
+    constexpr static size_t kMaxQueueSize      = 64 * 1024; // bytes waiting for the socket before new requests are dropped
 
 #   ifndef XMRIG_NO_TLS
     constexpr static size_t kInputBufferSize = 1024 * 16;
@@ -71,13 +76,24 @@ public:
     constexpr static size_t kInputBufferSize = 1024 * 2;
 #   endif
 
+    struct TlsStats
+    {
+        const char *url;
+        uint64_t handshakes;
+        uint64_t resumed;
+        uint64_t time;
+        uint64_t last;
+    };
+
     Client(int id, const char *agent, IClientListener *listener);
     ~Client();
 
     bool disconnect();
+    bool isTlsResumed() const;
     const char *tlsFingerprint() const;
     const char *tlsVersion() const;
     int64_t submit(const JobResult &result);
+    uint64_t tlsHandshakeTime() const;
     void connect();
     void connect(const Pool &pool);
     void deleteLater();
@@ -91,11 +107,18 @@ public:
     inline int id() const                             { return m_id; }
     inline SocketState state() const                  { return m_state; }
     inline uint16_t port() const                      { return m_pool.port(); }
+    inline uint64_t latency() const                   { return m_latency; }
     inline void setAlgo(const Algorithm &algo)        { m_pool.setAlgo(algo); }
     inline void setQuiet(bool quiet)                  { m_quiet = quiet; }
     inline void setRetries(int retries)               { m_retries = retries; }
     inline void setRetryPause(int ms)                 { m_retryPause = ms; }
 
+    static inline uint64_t coalescedWrites()          { return m_coalesced; }
+    static inline uint64_t droppedWrites()            { return m_dropped; }
+    static inline uint64_t queuedBytes()              { return m_queued; }
+
+    static std::vector<TlsStats> tlsStats();
+
 private:
     class Tls;
 
@@ -108,17 +131,23 @@ private:
     bool close();
     bool isCriticalError(const char *message);
     bool isTLS() const;
+    bool isWritable() const;
     bool parseJob(const rapidjson::Value &params, int *code);
     bool parseLogin(const rapidjson::Value &result, int *code);
     bool send(BIO *bio);
     bool verifyAlgorithm(const Algorithm &algorithm) const;
+    bool write(WriteBuffer *buffer);
     int resolve(const char *host);
+    int64_t send(const char *data, size_t size);
     int64_t send(const rapidjson::Document &doc);
-    int64_t send(size_t size);
-    void connect(const std::vector<addrinfo*> &ipv4, const std::vector<addrinfo*> &ipv6);
-    void connect(sockaddr *addr);
+    int64_t sendf(const char *format, ...);
+    WriteBuffer *queue(size_t size);
+    void connect(const std::vector<sockaddr_storage> &addresses);
+    void dropPending();
+    void flush();
     void handshake();
     void login();
+    void addLatency(uint64_t latency);
     void onClose();
     void parse(char *line, size_t len);
     void parseExtensions(const rapidjson::Value &value);
@@ -134,9 +163,12 @@ private:
 
     static void onAllocBuffer(uv_handle_t *handle, size_t suggested_size, uv_buf_t *buf);
     static void onClose(uv_handle_t *handle);
-    static void onConnect(uv_connect_t *req, int status);
+    static bool onConnect(void *data, uv_tcp_t *socket, const sockaddr *addr, int status);
+    static void onFlush(uv_check_t *handle);
+    static void onFlushClose(uv_handle_t *handle);
     static void onRead(uv_stream_t *stream, ssize_t nread, const uv_buf_t *buf);
     static void onResolved(uv_getaddrinfo_t *req, int status, struct addrinfo *res);
+    static void onWrite(uv_write_t *req, int status);
 
     static inline Client *getClient(void *data) { return m_storage.get(data); }
 
@@ -146,32 +178,42 @@ private:
     bool m_quiet;
     char m_buf[kInputBufferSize];
     char m_ip[46];
-    char m_sendBuf[2048];
     const char *m_agent;
+    Connector *m_connector;
     IClientListener *m_listener;
     int m_extensions;
     int m_id;
     int m_retries;
     int m_retryPause;
     int64_t m_failures;
+    int64_t m_pingId;
     Job m_job;
     Pool m_pool;
     size_t m_recvBufPos;
+    size_t m_tlsMessages;
     SocketState m_state;
     std::map<int64_t, SubmitResult> m_results;
     Tls *m_tls;
     uint64_t m_expire;
     uint64_t m_jobs;
     uint64_t m_keepAlive;
+    uint64_t m_latency;
+    uint64_t m_pingTime;
     uintptr_t m_key;
     uv_buf_t m_recvBuf;
     uv_getaddrinfo_t m_resolver;
     uv_stream_t *m_stream;
     uv_tcp_t *m_socket;
     Id m_rpcId;
+    WriteBuffer *m_pending;
 
     static int64_t m_sequence;
     static Storage<Client> m_storage;
+    static std::vector<uintptr_t> m_flushQueue;
+    static uint64_t m_coalesced;
+    static uint64_t m_dropped;
+    static uint64_t m_queued;
+    static uv_check_t *m_flush;
 };
 
 
@@ -0,0 +1,218 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <algorithm>
+#include <stdlib.h>
+
+
+#include "common/net/Connector.h"
+
+
+xmrig::Connector::Connector(void *data, const std::vector<sockaddr_storage> &addresses, uint16_t port, Callback callback) :
+    m_done(false),
+    m_callback(callback),
+    m_status(UV_EAI_NODATA),
+    m_handles(1),
+    m_next(0),
+    m_data(data)
+{
+    std::vector<sockaddr_storage> ipv4;
+    std::vector<sockaddr_storage> ipv6;
+
+    for (sockaddr_storage addr : addresses) {
+        if (addr.ss_family == AF_INET6) {
+            reinterpret_cast<sockaddr_in6*>(&addr)->sin6_port = htons(port);
+            ipv6.push_back(addr);
+        }
+        else {
+            reinterpret_cast<sockaddr_in*>(&addr)->sin_port = htons(port);
+            ipv4.push_back(addr);
+        }
+    }
+
+    // pools publish several addresses to spread the load, every connect starts from a random one
+    if (ipv4.size() > 1) {
+        std::rotate(ipv4.begin(), ipv4.begin() + rand() % ipv4.size(), ipv4.end());
+    }
+
+    if (ipv6.size() > 1) {
+        std::rotate(ipv6.begin(), ipv6.begin() + rand() % ipv6.size(), ipv6.end());
+    }
+
+    // families alternate, IPv4 goes first as it always did
+    for (size_t i = 0; i < std::max(ipv4.size(), ipv6.size()); ++i) {
+        if (i < ipv4.size()) {
+            m_addresses.push_back(ipv4[i]);
+        }
+
+        if (i < ipv6.size()) {
+            m_addresses.push_back(ipv6[i]);
+        }
+    }
+
+    m_timer.data = this;
+    uv_timer_init(uv_default_loop(), &m_timer);
+
+    // the first attempt starts from the loop, the callback never runs before the owner got the pointer
+    uv_timer_start(&m_timer, Connector::onTimer, 0, 0);
+}
+
+
+void xmrig::Connector::cancel()
+{
+    m_callback = nullptr;
+
+    if (!m_done) {
+        stop();
+    }
+}
+
+
+void xmrig::Connector::close(uv_tcp_t *socket)
+{
+    if (uv_is_closing(reinterpret_cast<uv_handle_t*>(socket)) == 0) {
+        uv_close(reinterpret_cast<uv_handle_t*>(socket), Connector::onClose);
+    }
+}
+
+
+void xmrig::Connector::finish(uv_tcp_t *socket, const sockaddr *addr, int status)
+{
+    stop();
+
+    if (m_callback && m_callback(m_data, socket, addr, status)) {
+        return;
+    }
+
+    if (socket) {
+        m_handles++;
+        close(socket);
+    }
+}
+
+
+void xmrig::Connector::next()
+{
+    while (m_next < m_addresses.size()) {
+        Attempt *attempt   = new Attempt();
+        attempt->connector = this;
+        attempt->index     = m_next++;
+        attempt->req.data  = attempt;
+        attempt->socket    = new uv_tcp_t;
+
+        uv_tcp_init(uv_default_loop(), attempt->socket);
+        uv_tcp_nodelay(attempt->socket, 1);
+
+#       ifndef WIN32
+        uv_tcp_keepalive(attempt->socket, 1, 60);
+#       endif
+
+        attempt->socket->data = this;
+        m_handles++;
+
+        const int rc = uv_tcp_connect(&attempt->req, attempt->socket, reinterpret_cast<const sockaddr*>(&m_addresses[attempt->index]), Connector::onConnect);
+        if (rc == 0) {
+            m_attempts.push_back(attempt);
+            uv_timer_start(&m_timer, Connector::onTimer, kAttemptDelay, 0);
+
+            return;
+        }
+
+        m_status = rc;
+        close(attempt->socket);
+        delete attempt;
+    }
+
+    if (m_attempts.empty()) {
+        finish(nullptr, nullptr, m_status);
+    }
+}
+
+
+void xmrig::Connector::onConnect(Attempt *attempt, int status)
+{
+    m_attempts.erase(std::remove(m_attempts.begin(), m_attempts.end(), attempt), m_attempts.end());
+
+    if (m_done) {
+        close(attempt->socket);
+        return;
+    }
+
+    if (status == 0) {
+        m_handles--;
+
+        return finish(attempt->socket, reinterpret_cast<const sockaddr*>(&m_addresses[attempt->index]), 0);
+    }
+
+    m_status = status;
+    close(attempt->socket);
+
+    // a refused or unreachable address does not wait for the timer
+    uv_timer_stop(&m_timer);
+    next();
+}
+
+
+void xmrig::Connector::stop()
+{
+    m_done = true;
+
+    for (Attempt *attempt : m_attempts) {
+        close(attempt->socket);
+    }
+
+    uv_timer_stop(&m_timer);
+    uv_close(reinterpret_cast<uv_handle_t*>(&m_timer), Connector::onClose);
+}
+
+
+void xmrig::Connector::onClose(uv_handle_t *handle)
+{
+    Connector *connector = static_cast<Connector*>(handle->data);
+
+    if (handle != reinterpret_cast<uv_handle_t*>(&connector->m_timer)) {
+        delete reinterpret_cast<uv_tcp_t*>(handle);
+    }
+
+    if (--connector->m_handles == 0) {
+        delete connector;
+    }
+}
+
+
+void xmrig::Connector::onConnect(uv_connect_t *req, int status)
+{
+    Attempt *attempt = static_cast<Attempt*>(req->data);
+    attempt->connector->onConnect(attempt, status);
+
+    delete attempt;
+}
+
+
+void xmrig::Connector::onTimer(uv_timer_t *handle)
+{
+    static_cast<Connector*>(handle->data)->next();
+}
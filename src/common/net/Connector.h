@@ -0,0 +1,92 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef XMRIG_CONNECTOR_H
+#define XMRIG_CONNECTOR_H
+
+
+#include <uv.h>
+#include <vector>
+
+
+namespace xmrig {
+
+
+/**
+ * @brief Races TCP connections to all resolved addresses of a pool (RFC 8305 "Happy Eyeballs").
+ *
+ * Attempts start kAttemptDelay apart, or immediately after the previous one failed, earlier attempts are
+ * kept running. The first established socket is passed to the callback, the rest are closed.
+ * The object deletes itself once its handles are closed, cancel() stops it without a callback.
+ */
+class Connector
+{
+public:
+    constexpr static uint64_t kAttemptDelay = 250;
+
+    // returns false if the socket was not taken, it is closed by the connector then
+    typedef bool (*Callback)(void *data, uv_tcp_t *socket, const sockaddr *addr, int status);
+
+    Connector(void *data, const std::vector<sockaddr_storage> &addresses, uint16_t port, Callback callback);
+
+    void cancel();
+
+private:
+    struct Attempt
+    {
+        Connector *connector;
+        size_t index;
+        uv_connect_t req;
+        uv_tcp_t *socket;
+    };
+
+    inline ~Connector() {}
+
+    void close(uv_tcp_t *socket);
+    void finish(uv_tcp_t *socket, const sockaddr *addr, int status);
+    void next();
+    void onConnect(Attempt *attempt, int status);
+    void stop();
+
+    static void onClose(uv_handle_t *handle);
+    static void onConnect(uv_connect_t *req, int status);
+    static void onTimer(uv_timer_t *handle);
+
+    bool m_done;
+    Callback m_callback;
+    int m_status;
+    size_t m_handles;
+    size_t m_next;
+    std::vector<Attempt *> m_attempts;
+    std::vector<sockaddr_storage> m_addresses;
+    uv_timer_t m_timer;
+    void *m_data;
+};
+
+
+} /* namespace xmrig */
+
+
+#endif /* XMRIG_CONNECTOR_H */
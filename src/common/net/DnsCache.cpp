@@ -0,0 +1,96 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <string.h>
+
+
+#include "common/net/DnsCache.h"
+
+
+namespace xmrig {
+
+std::vector<DnsCache::Record> DnsCache::m_records;
+
+} /* namespace xmrig */
+
+
+bool xmrig::DnsCache::get(const char *host, std::vector<sockaddr_storage> &addresses, bool stale)
+{
+    for (const Record &record : m_records) {
+        if (record.host == host && (stale || uv_now(uv_default_loop()) < record.expire)) {
+            addresses = record.addresses;
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+void xmrig::DnsCache::expire(const char *host)
+{
+    for (Record &record : m_records) {
+        if (record.host == host) {
+            record.expire = 0;
+        }
+    }
+}
+
+
+void xmrig::DnsCache::set(const char *host, const addrinfo *res, uint64_t ttl)
+{
+    std::vector<sockaddr_storage> addresses;
+
+    for (const addrinfo *ptr = res; ptr != nullptr; ptr = ptr->ai_next) {
+        if ((ptr->ai_family != AF_INET && ptr->ai_family != AF_INET6) || ptr->ai_addrlen > sizeof(sockaddr_storage)) {
+            continue;
+        }
+
+        sockaddr_storage addr;
+        memset(&addr, 0, sizeof(addr));
+        memcpy(&addr, ptr->ai_addr, ptr->ai_addrlen);
+
+        addresses.push_back(addr);
+    }
+
+    if (addresses.empty()) {
+        return;
+    }
+
+    const uint64_t expire = uv_now(uv_default_loop()) + ttl;
+
+    for (Record &record : m_records) {
+        if (record.host == host) {
+            record.addresses = addresses;
+            record.expire    = expire;
+
+            return;
+        }
+    }
+
+    m_records.push_back({ host, addresses, expire });
+}
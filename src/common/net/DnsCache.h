@@ -0,0 +1,63 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef XMRIG_DNSCACHE_H
+#define XMRIG_DNSCACHE_H
+
+
+#include <uv.h>
+#include <vector>
+
+
+#include "base/tools/String.h"
+
+
+namespace xmrig {
+
+
+// Resolved pool addresses, reused on reconnect and as a fallback when the resolver fails.
+class DnsCache
+{
+public:
+    static bool get(const char *host, std::vector<sockaddr_storage> &addresses, bool stale = false);
+    static void expire(const char *host);
+    static void set(const char *host, const addrinfo *res, uint64_t ttl);
+
+private:
+    struct Record
+    {
+        String host;
+        std::vector<sockaddr_storage> addresses;
+        uint64_t expire;
+    };
+
+    static std::vector<Record> m_records;
+};
+
+
+} /* namespace xmrig */
+
+
+#endif /* XMRIG_DNSCACHE_H */
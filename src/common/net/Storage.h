@@ -50,6 +50,7 @@ public:
     }
 
 
+    inline bool isEmpty() const { return m_data.empty(); }
     inline static void *ptr(uintptr_t id) { return reinterpret_cast<void *>(id); }
 
 
@@ -25,6 +25,8 @@
 
 
 #include <assert.h>
+#include <string.h>
+#include <uv.h>
 
 
 #include "common/net/Client.h"
@@ -37,15 +39,46 @@
 #endif
 
 
+std::vector<xmrig::Client::Tls::Context *> xmrig::Client::Tls::m_contexts;
+
+
+xmrig::Client::Tls::Context::Context(const Pool &pool) :
+    fingerprint(),
+    session(nullptr),
+    pinned(pool.fingerprint()),
+    url(pool.url()),
+    handshakes(0),
+    resumed(0),
+    time(0),
+    last(0)
+{
+    ctx = SSL_CTX_new(SSLv23_method());
+    assert(ctx != nullptr);
+
+    if (!ctx) {
+        return;
+    }
+
+    SSL_CTX_set_options(ctx, SSL_OP_NO_SSLv2 | SSL_OP_NO_SSLv3);
+
+    // sessions are kept by Context, the internal cache of a client SSL_CTX is never looked up
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+    SSL_CTX_sess_set_new_cb(ctx, Tls::onNewSession);
+}
+
+
 xmrig::Client::Tls::Tls(Client *client) :
     m_ready(false),
+    m_resumed(false),
     m_buf(),
     m_fingerprint(),
     m_client(client),
-    m_ssl(nullptr)
+    m_ssl(nullptr),
+    m_session(nullptr),
+    m_start(0),
+    m_time(0)
 {
-    m_ctx = SSL_CTX_new(SSLv23_method());
-    assert(m_ctx != nullptr);
+    m_ctx = context(client->m_pool);
 
     if (!m_ctx) {
         return;
@@ -53,31 +86,43 @@ xmrig::Client::Tls::Tls(Client *client) :
 
     m_writeBio = BIO_new(BIO_s_mem());
     m_readBio  = BIO_new(BIO_s_mem());
-    SSL_CTX_set_options(m_ctx, SSL_OP_NO_SSLv2 | SSL_OP_NO_SSLv3);
 }
 
 
 xmrig::Client::Tls::~Tls()
 {
-    if (m_ctx) {
-        SSL_CTX_free(m_ctx);
-    }
-
     if (m_ssl) {
+        // pools usually drop the connection without close_notify, OpenSSL would not resume such a session otherwise
+        if (m_ready) {
+            SSL_set_shutdown(m_ssl, SSL_SENT_SHUTDOWN | SSL_RECEIVED_SHUTDOWN);
+        }
+
         SSL_free(m_ssl);
     }
+
+    if (m_session) {
+        SSL_SESSION_free(m_session);
+    }
 }
 
 
 bool xmrig::Client::Tls::handshake()
 {
-    m_ssl = SSL_new(m_ctx);
+    m_ssl = m_ctx ? SSL_new(m_ctx->ctx) : nullptr;
     assert(m_ssl != nullptr);
 
     if (!m_ssl) {
         return false;
     }
 
+    SSL_set_app_data(m_ssl, this);
+
+    if (m_ctx->session) {
+        SSL_set_session(m_ssl, m_ctx->session);
+    }
+
+    m_start = uv_hrtime();
+
     SSL_set_connect_state(m_ssl);
     SSL_set_bio(m_ssl, m_readBio, m_writeBio);
     SSL_do_handshake(m_ssl);
@@ -116,16 +161,12 @@ void xmrig::Client::Tls::read(const char *data, size_t size)
         if (rc < 0 && SSL_get_error(m_ssl, rc) == SSL_ERROR_WANT_READ) {
             send();
         } else if (rc == 1) {
-            X509 *cert = SSL_get_peer_certificate(m_ssl);
-            if (!verify(cert)) {
-                X509_free(cert);
+            if (!finish()) {
                 m_client->close();
 
                 return;
             }
 
-            X509_free(cert);
-            m_ready = true;
             m_client->login();
       }
 
@@ -145,6 +186,60 @@ bool xmrig::Client::Tls::send()
 }
 
 
+std::vector<xmrig::Client::TlsStats> xmrig::Client::Tls::stats()
+{
+    std::vector<TlsStats> out;
+
+    for (const Context *ctx : m_contexts) {
+        if (ctx->handshakes > 0) {
+            out.push_back({ ctx->url.data(), ctx->handshakes, ctx->resumed, ctx->time, ctx->last });
+        }
+    }
+
+    return out;
+}
+
+
+/**
+ * @brief Completes the handshake, the certificate of a resumed session was already verified on the full handshake that created it.
+ */
+bool xmrig::Client::Tls::finish()
+{
+    m_resumed = SSL_session_reused(m_ssl) == 1;
+
+    if (m_resumed) {
+        memcpy(m_fingerprint, m_ctx->fingerprint, sizeof(m_fingerprint));
+    }
+    else {
+        X509 *cert = SSL_get_peer_certificate(m_ssl);
+        const bool valid = verify(cert);
+        X509_free(cert);
+
+        if (!valid) {
+            return false;
+        }
+
+        memcpy(m_ctx->fingerprint, m_fingerprint, sizeof(m_fingerprint));
+    }
+
+    m_time  = (uv_hrtime() - m_start) / 1000000;
+    m_ready = true;
+
+    m_ctx->handshakes++;
+    m_ctx->resumed += m_resumed ? 1 : 0;
+    m_ctx->time    += m_time;
+    m_ctx->last     = m_time;
+
+    // TLS 1.2 delivers the session before the certificate is checked, it is shared only now
+    if (m_session) {
+        setSession(m_session);
+        m_session = nullptr;
+    }
+
+    return true;
+}
+
+
 bool xmrig::Client::Tls::verify(X509 *cert)
 {
     if (cert == nullptr) {
@@ -188,3 +283,50 @@ bool xmrig::Client::Tls::verifyFingerprint(X509 *cert)
 
     return fingerprint == nullptr || strncasecmp(m_fingerprint, fingerprint, 64) == 0;
 }
+
+
+void xmrig::Client::Tls::setSession(SSL_SESSION *session)
+{
+    SSL_SESSION **target = m_ready ? &m_ctx->session : &m_session;
+
+    if (*target && *target != session) {
+        SSL_SESSION_free(*target);
+    }
+
+    *target = session;
+}
+
+
+xmrig::Client::Tls::Context *xmrig::Client::Tls::context(const Pool &pool)
+{
+    for (Context *ctx : m_contexts) {
+        if (ctx->url == pool.url() && ctx->pinned == pool.fingerprint()) {
+            return ctx;
+        }
+    }
+
+    Context *ctx = new Context(pool);
+    if (!ctx->ctx) {
+        delete ctx;
+
+        return nullptr;
+    }
+
+    // contexts live until exit, pools are reconnected and donation rotates until then
+    m_contexts.push_back(ctx);
+
+    return ctx;
+}
+
+
+int xmrig::Client::Tls::onNewSession(SSL *ssl, SSL_SESSION *session)
+{
+    Tls *tls = static_cast<Tls *>(SSL_get_app_data(ssl));
+    if (!tls) {
+        return 0;
+    }
+
+    tls->setSession(session);
+
+    return 1;
+}
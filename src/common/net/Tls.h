@@ -27,8 +27,10 @@
 
 
 #include <openssl/ssl.h>
+#include <vector>
 
 
+#include "base/tools/String.h"
 #include "common/net/Client.h"
 
 
@@ -47,19 +49,51 @@ public:
     const char *version() const;
     void read(const char *data, size_t size);
 
+    inline bool isResumed() const          { return m_resumed; }
+    inline uint64_t handshakeTime() const  { return m_time; }
+
+    static std::vector<TlsStats> stats();
+
 private:
+    // One SSL_CTX and the last verified session per pool url and pinned fingerprint, shared by all connections to that pool.
+    struct Context
+    {
+        Context(const Pool &pool);
+
+        char fingerprint[32 * 2 + 8];
+        SSL_CTX *ctx;
+        SSL_SESSION *session;
+        String pinned;
+        String url;
+        uint64_t handshakes;
+        uint64_t resumed;
+        uint64_t time;
+        uint64_t last;
+    };
+
+    bool finish();
     bool send();
     bool verify(X509 *cert);
     bool verifyFingerprint(X509 *cert);
+    void setSession(SSL_SESSION *session);
+
+    static Context *context(const Pool &pool);
+    static int onNewSession(SSL *ssl, SSL_SESSION *session);
 
     BIO *m_readBio;
     BIO *m_writeBio;
     bool m_ready;
+    bool m_resumed;
     char m_buf[1024 * 2];
     char m_fingerprint[32 * 2 + 8];
     Client *m_client;
+    Context *m_ctx;
     SSL *m_ssl;
-    SSL_CTX *m_ctx;
+    SSL_SESSION *m_session;
+    uint64_t m_start;
+    uint64_t m_time;
+
+    static std::vector<Context *> m_contexts;
 };
 
 
@@ -0,0 +1,94 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "common/net/WriteBuffer.h"
+
+
+namespace xmrig {
+
+std::vector<WriteBuffer *> WriteBuffer::m_pool;
+
+} /* namespace xmrig */
+
+
+xmrig::WriteBuffer::WriteBuffer() :
+    m_messages(0),
+    m_key(0)
+{
+    m_data.reserve(kCapacity);
+
+    m_request.data = this;
+}
+
+
+xmrig::WriteBuffer *xmrig::WriteBuffer::get(uintptr_t key)
+{
+    WriteBuffer *buffer = nullptr;
+
+    if (m_pool.empty()) {
+        buffer = new WriteBuffer();
+    }
+    else {
+        buffer = m_pool.back();
+        m_pool.pop_back();
+    }
+
+    buffer->m_key = key;
+
+    return buffer;
+}
+
+
+// Buffers grown by a large TLS record go back to the system, the pool keeps only kCapacity sized ones.
+void xmrig::WriteBuffer::release(WriteBuffer *buffer)
+{
+    if (!buffer) {
+        return;
+    }
+
+    if (m_pool.size() >= kPoolSize || buffer->m_data.capacity() > kCapacity) {
+        delete buffer;
+        return;
+    }
+
+    buffer->m_data.clear();
+    buffer->m_messages = 0;
+    buffer->m_key      = 0;
+
+    m_pool.push_back(buffer);
+}
+
+
+void xmrig::WriteBuffer::append(const char *data, size_t size, size_t messages)
+{
+    m_data.insert(m_data.end(), data, data + size);
+    m_messages += messages;
+}
+
+
+uv_buf_t xmrig::WriteBuffer::buf()
+{
+    return uv_buf_init(m_data.data(), static_cast<unsigned int>(m_data.size()));
+}
@@ -0,0 +1,73 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef XMRIG_WRITEBUFFER_H
+#define XMRIG_WRITEBUFFER_H
+
+
+#include <stddef.h>
+#include <stdint.h>
+#include <uv.h>
+#include <vector>
+
+
+namespace xmrig {
+
+
+// Pooled outgoing data of one uv_write, the request and the bytes live together until the write callback.
+class WriteBuffer
+{
+public:
+    constexpr static size_t kCapacity = 4096; // initial capacity, enough for about 15 submits in one loop iteration
+    constexpr static size_t kPoolSize = 16;
+
+    static WriteBuffer *get(uintptr_t key);
+    static void release(WriteBuffer *buffer);
+
+    inline bool isEmpty() const        { return m_data.empty(); }
+    inline char *data()                { return m_data.data(); }
+    inline size_t messages() const     { return m_messages; }
+    inline size_t size() const         { return m_data.size(); }
+    inline uintptr_t key() const       { return m_key; }
+    inline uv_write_t *request()       { return &m_request; }
+
+    void append(const char *data, size_t size, size_t messages = 1);
+    uv_buf_t buf();
+
+private:
+    WriteBuffer();
+
+    size_t m_messages;
+    std::vector<char> m_data;
+    uintptr_t m_key;
+    uv_write_t m_request;
+
+    static std::vector<WriteBuffer *> m_pool;
+};
+
+
+} /* namespace xmrig */
+
+
+#endif /* XMRIG_WRITEBUFFER_H */
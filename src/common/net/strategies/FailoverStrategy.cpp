@@ -23,19 +23,31 @@
  */
 
 
+#include <uv.h>
+
+
 #include "common/interfaces/IStrategyListener.h"
+#include "common/log/Log.h"
 #include "common/net/Client.h"
 #include "common/net/strategies/FailoverStrategy.h"
 #include "common/Platform.h"
 
 
+static const double kDelayBias     = 0.2; // weight of the last block in the job delay average
+static const uint64_t kMinBlocks   = 3;   // blocks seen by a standby pool before it is ranked by latency
+static const uint64_t kSwitchDelta = 100; // milliseconds a ranked pool must be faster to take over
+
+
 xmrig::FailoverStrategy::FailoverStrategy(const std::vector<Pool> &pools, int retryPause, int retries, IStrategyListener *listener, bool quiet) :
     m_quiet(quiet),
     m_retries(retries),
     m_retryPause(retryPause),
+    m_standby(0),
     m_active(-1),
     m_index(0),
-    m_listener(listener)
+    m_listener(listener),
+    m_height(0),
+    m_heightTime(0)
 {
     for (const Pool &pool : pools) {
         add(pool);
@@ -43,13 +55,16 @@ xmrig::FailoverStrategy::FailoverStrategy(const std::vector<Pool> &pools, int re
 }
 
 
-xmrig::FailoverStrategy::FailoverStrategy(int retryPause, int retries, IStrategyListener *listener, bool quiet) :
+xmrig::FailoverStrategy::FailoverStrategy(int retryPause, int retries, IStrategyListener *listener, bool quiet, int standby) :
     m_quiet(quiet),
     m_retries(retries),
     m_retryPause(retryPause),
+    m_standby(static_cast<size_t>(standby > 0 ? standby : 0)),
     m_active(-1),
     m_index(0),
-    m_listener(listener)
+    m_listener(listener),
+    m_height(0),
+    m_heightTime(0)
 {
 }
 
@@ -65,12 +80,24 @@ xmrig::FailoverStrategy::~FailoverStrategy()
 void xmrig::FailoverStrategy::add(const Pool &pool)
 {
     Client *client = new Client(static_cast<int>(m_pools.size()), Platform::userAgent(), this);
-    client->setPool(pool);
     client->setRetries(m_retries);
     client->setRetryPause(m_retryPause * 1000);
     client->setQuiet(m_quiet);
 
+    // standby pools (indices 1..standby) send no shares, keepalives keep them logged in and measure their round trip,
+    // the primary pool keeps its own setting
+    const size_t index = m_pools.size();
+    if (index >= 1 && index <= m_standby && pool.keepAlive() == 0) {
+        Pool copy(pool);
+        copy.setKeepAlive(true);
+        client->setPool(copy);
+    }
+    else {
+        client->setPool(pool);
+    }
+
     m_pools.push_back(client);
+    m_stats.push_back(Stats());
 }
 
 
@@ -86,6 +113,16 @@ int64_t xmrig::FailoverStrategy::submit(const JobResult &result)
 
 void xmrig::FailoverStrategy::connect()
 {
+    if (m_standby) {
+        m_index = static_cast<int>(hotCount()) - 1;
+
+        for (size_t i = 0; i < hotCount(); ++i) {
+            m_pools[i]->connect();
+        }
+
+        return;
+    }
+
     m_pools[static_cast<size_t>(m_index)]->connect();
 }
 
@@ -137,7 +174,25 @@ void xmrig::FailoverStrategy::onClose(Client *client, int failures)
 
     if (m_active == client->id()) {
         m_active = -1;
-        m_listener->onPause(this);
+
+        // a logged in standby pool already has a job, mining continues without a pause
+        Client *next = m_standby ? best(client) : nullptr;
+        if (next) {
+            activate(next);
+            m_listener->onJob(this, next, next->job());
+        }
+        else {
+            m_listener->onPause(this);
+        }
+    }
+
+    if (m_standby) {
+        // pools of the standby set retry on their own, the next backup is connected only when none of them is left
+        if (!isActive() && m_index == client->id() && failures >= m_retries && (m_pools.size() - static_cast<size_t>(m_index)) > 1) {
+            m_pools[static_cast<size_t>(++m_index)]->connect();
+        }
+
+        return;
     }
 
     if (m_index == 0 && failures < m_retries) {
@@ -152,6 +207,15 @@ void xmrig::FailoverStrategy::onClose(Client *client, int failures)
 
 void xmrig::FailoverStrategy::onJobReceived(Client *client, const Job &job)
 {
+    if (m_standby && addJob(client, job) && isActive() && m_active != client->id() && isPreferred(client, active())) {
+        if (!m_quiet) {
+            LOG_INFO("%s:%d delivers new blocks %.0f ms earlier than %s:%d", client->host(), client->port(),
+                     score(active()) - score(client), active()->host(), active()->port());
+        }
+
+        activate(client);
+    }
+
     if (m_active == client->id()) {
         m_listener->onJob(this, client, job);
     }
@@ -160,6 +224,17 @@ void xmrig::FailoverStrategy::onJobReceived(Client *client, const Job &job)
 
 void xmrig::FailoverStrategy::onLoginSuccess(Client *client)
 {
+    if (m_standby) {
+        // the login job is late by the connection time, timing starts with the next block
+        m_stats[static_cast<size_t>(client->id())].height = client->job().height();
+
+        if (!isActive() || isPreferred(client, active())) {
+            activate(client);
+        }
+
+        return;
+    }
+
     int active = m_active;
 
     if (client->id() == 0 || !isActive()) {
@@ -183,3 +258,91 @@ void xmrig::FailoverStrategy::onResultAccepted(Client *client, const SubmitResul
 {
     m_listener->onResultAccepted(this, client, result, error);
 }
+
+
+// Pool that should take over from the excluded one: ready with a job, the fastest ranked one or the first one in the list.
+xmrig::Client *xmrig::FailoverStrategy::best(const Client *exclude) const
+{
+    Client *best = nullptr;
+
+    for (Client *client : m_pools) {
+        if (client == exclude || !client->isReady() || !client->job().isValid()) {
+            continue;
+        }
+
+        if (!best || isPreferred(client, best)) {
+            best = client;
+        }
+    }
+
+    return best;
+}
+
+
+// Records how long after the first pool a pool delivered a new block, returns true for a new block of the pool.
+bool xmrig::FailoverStrategy::addJob(const Client *client, const Job &job)
+{
+    Stats &stats = m_stats[static_cast<size_t>(client->id())];
+    if (job.height() == 0 || job.height() <= stats.height) {
+        return false;
+    }
+
+    stats.height = job.height();
+
+    const uint64_t now = uv_now(uv_default_loop());
+    if (job.height() > m_height) {
+        m_height     = job.height();
+        m_heightTime = now;
+    }
+    else if (job.height() < m_height) {
+        return false;
+    }
+
+    const double delay = static_cast<double>(now - m_heightTime);
+
+    stats.delay = stats.blocks ? stats.delay * (1.0 - kDelayBias) + delay * kDelayBias : delay;
+    stats.blocks++;
+
+    return true;
+}
+
+
+// Milliseconds until a new block reaches the miner and a share found on it reaches the pool.
+double xmrig::FailoverStrategy::score(const Client *client) const
+{
+    return m_stats[static_cast<size_t>(client->id())].delay + client->latency();
+}
+
+
+// Ranked pools compare by score with some margin against flapping, otherwise the list order decides.
+bool xmrig::FailoverStrategy::isPreferred(const Client *client, const Client *than) const
+{
+    const Stats &a = m_stats[static_cast<size_t>(client->id())];
+    const Stats &b = m_stats[static_cast<size_t>(than->id())];
+
+    if (a.blocks >= kMinBlocks && b.blocks >= kMinBlocks) {
+        return score(client) + kSwitchDelta < score(than);
+    }
+
+    return client->id() < than->id();
+}
+
+
+void xmrig::FailoverStrategy::activate(Client *client)
+{
+    m_active = client->id();
+    m_index  = std::max(m_index, m_active);
+
+    // a backup outside of the standby set is only kept while it is the active one
+    for (size_t i = hotCount(); i < m_pools.size(); ++i) {
+        if (m_active != static_cast<int>(i)) {
+            m_pools[i]->disconnect();
+        }
+    }
+
+    if (m_index >= static_cast<int>(hotCount()) && m_active < static_cast<int>(hotCount())) {
+        m_index = static_cast<int>(hotCount()) - 1;
+    }
+
+    m_listener->onActive(this, client);
+}
@@ -26,6 +26,7 @@
 #define XMRIG_FAILOVERSTRATEGY_H
 
 
+#include <algorithm>
 #include <vector>
 
 
@@ -45,7 +46,7 @@ class FailoverStrategy : public IStrategy, public IClientListener
 {
 public:
     FailoverStrategy(const std::vector<Pool> &pool, int retryPause, int retries, IStrategyListener *listener, bool quiet = false);
-    FailoverStrategy(int retryPause, int retries, IStrategyListener *listener, bool quiet = false);
+    FailoverStrategy(int retryPause, int retries, IStrategyListener *listener, bool quiet = false, int standby = 0);
     ~FailoverStrategy() override;
 
     void add(const Pool &pool);
@@ -67,15 +68,35 @@ protected:
     void onResultAccepted(Client *client, const SubmitResult &result, const char *error) override;
 
 private:
-    inline Client *active() const { return m_pools[static_cast<size_t>(m_active)]; }
+    struct Stats
+    {
+        inline Stats() : delay(0.0), blocks(0), height(0) {}
+
+        double delay;    // average milliseconds behind the first pool with a new block
+        uint64_t blocks;
+        uint64_t height;
+    };
+
+    inline Client *active() const    { return m_pools[static_cast<size_t>(m_active)]; }
+    inline size_t hotCount() const   { return std::min(m_standby + 1, m_pools.size()); }
+
+    bool addJob(const Client *client, const Job &job);
+    bool isPreferred(const Client *client, const Client *than) const;
+    Client *best(const Client *exclude) const;
+    double score(const Client *client) const;
+    void activate(Client *client);
 
     const bool m_quiet;
     const int m_retries;
     const int m_retryPause;
+    const size_t m_standby;
     int m_active;
     int m_index;
     IStrategyListener *m_listener;
     std::vector<Client*> m_pools;
+    std::vector<Stats> m_stats;
+    uint64_t m_height;
+    uint64_t m_heightTime;
 };
 
 
@@ -36,6 +36,7 @@
 #include "rapidjson/document.h"
 #include "rapidjson/filewritestream.h"
 #include "rapidjson/prettywriter.h"
+#include "workers/CpuThread.h"
 #include "workers/OclThread.h"
 
 
@@ -55,8 +56,23 @@ static const char *vendors[] = {
 xmrig::Config::Config() : xmrig::CommonConfig(),
     m_autoConf(false),
     m_cache(true),
+    m_pipeline(false),
+    m_profile(false),
+    m_selfTest(false),
+    m_selfTestAll(false),
     m_shouldSave(false),
+    m_tune(false),
     m_platformIndex(0),
+    m_benchHashes(0),
+    m_benchTime(0),
+    m_batchTime(0),
+    m_verifyAffinity(-1),
+    m_cpuThreadsCount(0),
+    m_cpuWays(1),
+    m_cpuAffinity(0),
+    m_cnrWorkers(1),
+    m_splits(0),
+    m_verifyThreads(1),
 #   if defined(__APPLE__)
     m_loader("/System/Library/Frameworks/OpenCL.framework/OpenCL"),
 #   elif defined(_WIN32)
@@ -113,6 +129,8 @@ bool xmrig::Config::oclInit()
     }
 
     m_threads = filterThreads();
+    createCpuThreads();
+
     return !m_threads.empty();
 }
 
@@ -123,6 +141,17 @@ bool xmrig::Config::reload(const char *json)
 }
 
 
+void xmrig::Config::setThreads(const std::vector<IThread *> &threads)
+{
+    for (IThread *thread : m_threads) {
+        delete thread;
+    }
+
+    m_threads    = threads;
+    m_shouldSave = true;
+}
+
+
 void xmrig::Config::getJSON(rapidjson::Document &doc) const
 {
     using namespace rapidjson;
@@ -150,10 +179,24 @@ void xmrig::Config::getJSON(rapidjson::Document &doc) const
     doc.AddMember("log-file",        logFile() ? Value(StringRef(logFile())).Move() : Value(kNullType).Move(), allocator);
     doc.AddMember("opencl-platform", vendor() == OCL_VENDOR_MANUAL ? Value(platformIndex()).Move() : Value(StringRef(vendorName(vendor()))).Move(), allocator);
     doc.AddMember("opencl-loader",   StringRef(loader()), allocator);
+    doc.AddMember("opencl-pipeline", isOclPipeline(), allocator);
+    doc.AddMember("opencl-r-workers", static_cast<uint64_t>(cnrWorkers()), allocator);
+    doc.AddMember("opencl-batch-time", oclBatchTime(), allocator);
+    doc.AddMember("opencl-fast-switch", static_cast<uint64_t>(oclSplits()), allocator);
+    doc.AddMember("opencl-profile",  isOclProfile(), allocator);
+
+    if (isOclSelfTestAll()) {
+        doc.AddMember("opencl-self-test", "all", allocator);
+    }
+    else {
+        doc.AddMember("opencl-self-test", isOclSelfTest(), allocator);
+    }
+
     doc.AddMember("pools",           m_pools.toJSON(doc), allocator);
     doc.AddMember("print-time",      printTime(), allocator);
     doc.AddMember("retries",         m_pools.retries(), allocator);
     doc.AddMember("retry-pause",     m_pools.retryPause(), allocator);
+    doc.AddMember("standby",         m_pools.standby(), allocator);
 
     Value threads(kArrayType);
     for (const IThread *thread : m_threads) {
@@ -161,9 +204,17 @@ void xmrig::Config::getJSON(rapidjson::Document &doc) const
     }
     doc.AddMember("threads", threads, allocator);
 
-    doc.AddMember("user-agent", userAgent() ? Value(StringRef(userAgent())).Move() : Value(kNullType).Move(), allocator);
-    doc.AddMember("syslog",     isSyslog(), allocator);
-    doc.AddMember("watch",      m_watch, allocator);
+    Value cpuThreads(kArrayType);
+    for (const IThread *thread : m_cpuThreads) {
+        cpuThreads.PushBack(thread->toConfig(doc), allocator);
+    }
+    doc.AddMember("cpu-threads", cpuThreads, allocator);
+
+    doc.AddMember("user-agent",      userAgent() ? Value(StringRef(userAgent())).Move() : Value(kNullType).Move(), allocator);
+    doc.AddMember("syslog",          isSyslog(), allocator);
+    doc.AddMember("verify-threads",  static_cast<uint64_t>(verifyThreads()), allocator);
+    doc.AddMember("verify-affinity", verifyAffinity() >= 0 ? Value(verifyAffinity()).Move() : Value(kNullType).Move(), allocator);
+    doc.AddMember("watch",           m_watch, allocator);
 }
 
 
@@ -189,6 +240,12 @@ bool xmrig::Config::finalize()
         return CommonConfig::finalize();
     }
 
+    // benchmark, tuning and the full kernel self-test run offline, a pool is not required
+    if (isOffline() && m_algorithm.isValid() && !m_pools.active()) {
+        m_state = ReadyState;
+        return true;
+    }
+
     if (!CommonConfig::finalize()) {
         return false;
     }
@@ -208,6 +265,23 @@ bool xmrig::Config::parseBoolean(int key, bool enable)
         m_cache = enable;
         break;
 
+    case OclPipelineKey: /* opencl-pipeline */
+        m_pipeline = enable;
+        break;
+
+    case OclProfileKey: /* opencl-profile */
+        m_profile = enable;
+        break;
+
+    case OclSelfTestKey: /* opencl-self-test */
+        m_selfTest    = enable;
+        m_selfTestAll = false;
+        break;
+
+    case TuneKey: /* --tune */
+        m_tune = enable;
+        break;
+
     default:
         break;
     }
@@ -254,6 +328,16 @@ bool xmrig::Config::parseString(int key, const char *arg)
     case OclCacheKey: /* --no-cache */
         return parseBoolean(key, false);
 
+    case OclPipelineKey: /* --opencl-pipeline */
+    case OclProfileKey:  /* --opencl-profile */
+    case TuneKey:        /* --tune */
+        return parseBoolean(key, true);
+
+    case OclSelfTestKey: /* --opencl-self-test[=all] */
+        parseBoolean(key, true);
+        m_selfTestAll = arg && strcmp(arg, "all") == 0;
+        break;
+
     case OclPrintKey: /* --print-platforms */
         if (OclLib::init(loader())) {
             printPlatforms();
@@ -268,6 +352,28 @@ bool xmrig::Config::parseString(int key, const char *arg)
         m_loader = arg;
         break;
 
+    case BenchReportKey: /* --bench-report */
+        m_benchReport = arg;
+        break;
+
+    case BenchKey:       /* --bench */
+    case BenchHashesKey: /* --bench-hashes */
+        return parseUint64(key, strtoull(arg, nullptr, 10));
+
+    case VerifyThreadsKey: /* --verify-threads */
+    case OclRWorkersKey:   /* --opencl-r-workers */
+    case OclBatchTimeKey:  /* --opencl-batch-time */
+    case OclFastSwitchKey: /* --opencl-fast-switch */
+        return parseUint64(key, strtol(arg, nullptr, 10));
+
+    case VerifyAffinityKey: /* --verify-affinity */
+    case CpuAffinityKey:    /* --cpu-affinity */
+        return parseUint64(key, strtoull(arg, nullptr, 0));
+
+    case CpuThreadsKey: /* --cpu-threads */
+    case CpuWaysKey:    /* --cpu-ways */
+        return parseUint64(key, strtol(arg, nullptr, 10));
+
     default:
         break;
     }
@@ -287,6 +393,58 @@ bool xmrig::Config::parseUint64(int key, uint64_t arg)
         setPlatformIndex(static_cast<int>(arg));
         break;
 
+    case VerifyThreadsKey: /* --verify-threads */
+        if (arg >= 1 && arg <= 64) {
+            m_verifyThreads = static_cast<size_t>(arg);
+        }
+        break;
+
+    case VerifyAffinityKey: /* --verify-affinity */
+        m_verifyAffinity = static_cast<int64_t>(arg);
+        break;
+
+    case OclRWorkersKey: /* --opencl-r-workers */
+        if (arg >= 1 && arg <= 16) {
+            m_cnrWorkers = static_cast<size_t>(arg);
+        }
+        break;
+
+    case OclBatchTimeKey: /* --opencl-batch-time */
+        if (arg <= 10000) {
+            m_batchTime = static_cast<uint32_t>(arg);
+        }
+        break;
+
+    case OclFastSwitchKey: /* --opencl-fast-switch */
+        if (arg <= 64) {
+            m_splits = static_cast<size_t>(arg);
+        }
+        break;
+
+    case BenchKey: /* --bench */
+        m_benchTime = arg;
+        break;
+
+    case BenchHashesKey: /* --bench-hashes */
+        m_benchHashes = arg;
+        break;
+
+    case CpuThreadsKey: /* --cpu-threads */
+        if (arg <= 256) {
+            m_cpuThreadsCount = static_cast<size_t>(arg);
+        }
+        break;
+
+    case CpuWaysKey: /* --cpu-ways */
+        if (arg >= IThread::SingleWay && arg <= IThread::PentaWay) {
+            m_cpuWays = static_cast<size_t>(arg);
+        }
+        break;
+
+    case CpuAffinityKey: /* --cpu-affinity */
+        m_cpuAffinity = arg;
+        break;
+
     default:
         break;
     }
@@ -312,6 +470,16 @@ void xmrig::Config::parseJSON(const rapidjson::Document &doc)
             }
         }
     }
+
+    const rapidjson::Value &cpuThreads = doc["cpu-threads"];
+
+    if (cpuThreads.IsArray()) {
+        for (const rapidjson::Value &value : cpuThreads.GetArray()) {
+            if (value.IsObject()) {
+                m_cpuThreads.push_back(new CpuThread(value, m_algorithm.algo()));
+            }
+        }
+    }
 }
 
 
@@ -349,6 +517,33 @@ std::vector<xmrig::IThread *> xmrig::Config::filterThreads() const
 }
 
 
+void xmrig::Config::createCpuThreads()
+{
+    if (m_cpuThreads.empty()) {
+        for (size_t i = 0; i < m_cpuThreadsCount; ++i) {
+            m_cpuThreads.push_back(new CpuThread(i, m_algorithm.algo(), static_cast<IThread::Multiway>(m_cpuWays), CpuThread::affinity(m_cpuAffinity, i)));
+        }
+
+        return;
+    }
+
+    std::vector<IThread *> threads;
+    for (size_t i = 0; i < m_cpuThreads.size(); ++i) {
+        IThread *thread = m_cpuThreads[i];
+        if (!thread->isValid()) {
+            LOG_ERR("CPU thread #%zu: \"low_power_mode\" must be 1-5, thread disabled.", i);
+            delete thread;
+            continue;
+        }
+
+        static_cast<CpuThread *>(thread)->setIndex(threads.size());
+        threads.push_back(thread);
+    }
+
+    m_cpuThreads = threads;
+}
+
+
 void xmrig::Config::parseThread(const rapidjson::Value &object)
 {
     m_threads.push_back(new OclThread(object));
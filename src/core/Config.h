@@ -52,15 +52,32 @@ public:
     bool isCNv2() const;
     bool oclInit();
     bool reload(const char *json);
+    void setThreads(const std::vector<IThread *> &threads);
 
     void getJSON(rapidjson::Document &doc) const override;
 
-    inline bool isOclCache() const                       { return m_cache; }
-    inline bool isShouldSave() const                     { return m_shouldSave && isAutoSave(); }
-    inline const char *loader() const                    { return m_loader.data(); }
-    inline const std::vector<IThread *> &threads() const { return m_threads; }
-    inline int platformIndex() const                     { return m_platformIndex; }
-    inline xmrig::OclVendor vendor() const               { return m_vendor; }
+    inline bool isBench() const                             { return m_benchTime > 0 || m_benchHashes > 0; }
+    inline bool isOffline() const                           { return isBench() || isTune() || isOclSelfTestAll(); }
+    inline bool isOclCache() const                          { return m_cache; }
+    inline bool isOclPipeline() const                       { return m_pipeline; }
+    inline bool isOclProfile() const                        { return m_profile; }
+    inline bool isOclSelfTest() const                       { return m_selfTest; }
+    inline bool isOclSelfTestAll() const                    { return m_selfTestAll; }
+    inline bool isShouldSave() const                        { return m_shouldSave && isAutoSave(); }
+    inline bool isTune() const                              { return m_tune; }
+    inline const char *benchReport() const                  { return m_benchReport.data(); }
+    inline const char *loader() const                       { return m_loader.data(); }
+    inline const std::vector<IThread *> &cpuThreads() const { return m_cpuThreads; }
+    inline const std::vector<IThread *> &threads() const    { return m_threads; }
+    inline int platformIndex() const                        { return m_platformIndex; }
+    inline uint64_t benchHashes() const                     { return m_benchHashes; }
+    inline uint64_t benchTime() const                       { return m_benchTime; }
+    inline size_t cnrWorkers() const                        { return m_cnrWorkers; }
+    inline uint32_t oclBatchTime() const                    { return m_batchTime; }
+    inline size_t oclSplits() const                         { return m_splits; }
+    inline int64_t verifyAffinity() const                   { return m_verifyAffinity; }
+    inline size_t verifyThreads() const                     { return m_verifyThreads; }
+    inline xmrig::OclVendor vendor() const                  { return m_vendor; }
 
     static Config *load(Process *process, IConfigListener *listener);
     static const char *vendorName(xmrig::OclVendor vendor);
@@ -74,16 +91,34 @@ protected:
 
 private:
     std::vector<IThread *> filterThreads() const;
+    void createCpuThreads();
     void parseThread(const rapidjson::Value &object);
     void setPlatformIndex(const char *name);
     void setPlatformIndex(int index);
 
     bool m_autoConf;
     bool m_cache;
+    bool m_pipeline;
+    bool m_profile;
+    bool m_selfTest;
+    bool m_selfTestAll;
     bool m_shouldSave;
+    bool m_tune;
     int m_platformIndex;
+    uint64_t m_benchHashes;
+    uint64_t m_benchTime;
+    uint32_t m_batchTime;
+    int64_t m_verifyAffinity;
+    size_t m_cpuThreadsCount;
+    size_t m_cpuWays;
+    uint64_t m_cpuAffinity;
     OclCLI m_oclCLI;
+    size_t m_cnrWorkers;
+    size_t m_splits;
+    size_t m_verifyThreads;
+    std::vector<IThread *> m_cpuThreads;
     std::vector<IThread *> m_threads;
+    xmrig::String m_benchReport;
     xmrig::String m_loader;
     xmrig::OclVendor m_vendor;
 };
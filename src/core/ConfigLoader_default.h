@@ -49,6 +49,8 @@ R"===(
     "donate-level": 5,
     "log-file": null,
     "opencl-platform": "AMD",
+    "opencl-pipeline": false,
+    "opencl-r-workers": 1,
     "pools": [
         {
             "url": "donate.v2.xmrig.com:3333",
@@ -69,6 +71,8 @@ R"===(
     "threads": null,
     "user-agent": null,
     "syslog": false,
+    "verify-threads": 1,
+    "verify-affinity": null,
     "watch": true
 }
 )===";
@@ -65,6 +65,7 @@ static struct option const options[] = {
     { "print-time",           1, nullptr, xmrig::IConfig::PrintTimeKey      },
     { "retries",              1, nullptr, xmrig::IConfig::RetriesKey        },
     { "retry-pause",          1, nullptr, xmrig::IConfig::RetryPauseKey     },
+    { "standby",              1, nullptr, xmrig::IConfig::StandbyKey        },
     { "syslog",               0, nullptr, xmrig::IConfig::SyslogKey         },
     { "url",                  1, nullptr, xmrig::IConfig::UrlKey            },
     { "user",                 1, nullptr, xmrig::IConfig::UserKey           },
@@ -82,9 +83,24 @@ static struct option const options[] = {
     { "opencl-unroll-factor", 1, nullptr, xmrig::IConfig::OclUnrollKey      },
     { "opencl-unroll",        1, nullptr, xmrig::IConfig::OclUnrollKey      },
     { "opencl-comp-mode",     1, nullptr, xmrig::IConfig::OclCompModeKey    },
+    { "opencl-pipeline",      0, nullptr, xmrig::IConfig::OclPipelineKey    },
+    { "opencl-r-workers",     1, nullptr, xmrig::IConfig::OclRWorkersKey    },
+    { "opencl-batch-time",    1, nullptr, xmrig::IConfig::OclBatchTimeKey   },
+    { "opencl-fast-switch",   1, nullptr, xmrig::IConfig::OclFastSwitchKey  },
+    { "opencl-profile",       0, nullptr, xmrig::IConfig::OclProfileKey     },
+    { "opencl-self-test",     2, nullptr, xmrig::IConfig::OclSelfTestKey    },
+    { "bench",                1, nullptr, xmrig::IConfig::BenchKey          },
+    { "bench-hashes",         1, nullptr, xmrig::IConfig::BenchHashesKey    },
+    { "bench-report",         1, nullptr, xmrig::IConfig::BenchReportKey    },
+    { "tune",                 0, nullptr, xmrig::IConfig::TuneKey           },
     { "no-cache",             0, nullptr, xmrig::IConfig::OclCacheKey       },
     { "print-platforms",      0, nullptr, xmrig::IConfig::OclPrintKey       },
     { "opencl-loader",        1, nullptr, xmrig::IConfig::OclLoaderKey      },
+    { "verify-threads",       1, nullptr, xmrig::IConfig::VerifyThreadsKey  },
+    { "verify-affinity",      1, nullptr, xmrig::IConfig::VerifyAffinityKey },
+    { "cpu-threads",          1, nullptr, xmrig::IConfig::CpuThreadsKey     },
+    { "cpu-ways",             1, nullptr, xmrig::IConfig::CpuWaysKey        },
+    { "cpu-affinity",         1, nullptr, xmrig::IConfig::CpuAffinityKey    },
     { nullptr,                0, nullptr, 0 }
 };
 
@@ -99,13 +115,25 @@ static struct option const config_options[] = {
     { "print-time",        1, nullptr, xmrig::IConfig::PrintTimeKey   },
     { "retries",           1, nullptr, xmrig::IConfig::RetriesKey     },
     { "retry-pause",       1, nullptr, xmrig::IConfig::RetryPauseKey  },
+    { "standby",           1, nullptr, xmrig::IConfig::StandbyKey     },
     { "syslog",            0, nullptr, xmrig::IConfig::SyslogKey      },
     { "user-agent",        1, nullptr, xmrig::IConfig::UserAgentKey   },
     { "watch",             0, nullptr, xmrig::IConfig::WatchKey       },
     { "opencl-platform",   1, nullptr, xmrig::IConfig::OclPlatformKey },
     { "cache",             0, nullptr, xmrig::IConfig::OclCacheKey    },
     { "opencl-loader",     1, nullptr, xmrig::IConfig::OclLoaderKey   },
+    { "opencl-pipeline",   0, nullptr, xmrig::IConfig::OclPipelineKey },
+    { "opencl-r-workers",  1, nullptr, xmrig::IConfig::OclRWorkersKey },
+    { "opencl-batch-time", 1, nullptr, xmrig::IConfig::OclBatchTimeKey },
+    { "opencl-fast-switch", 1, nullptr, xmrig::IConfig::OclFastSwitchKey },
+    { "opencl-profile",    0, nullptr, xmrig::IConfig::OclProfileKey  },
+    { "opencl-self-test",  2, nullptr, xmrig::IConfig::OclSelfTestKey },
     { "autosave",          0, nullptr, xmrig::IConfig::AutoSaveKey    },
+    { "verify-threads",    1, nullptr, xmrig::IConfig::VerifyThreadsKey  },
+    { "verify-affinity",   1, nullptr, xmrig::IConfig::VerifyAffinityKey },
+    { "cpu-threads",       1, nullptr, xmrig::IConfig::CpuThreadsKey     },
+    { "cpu-ways",          1, nullptr, xmrig::IConfig::CpuWaysKey        },
+    { "cpu-affinity",      1, nullptr, xmrig::IConfig::CpuAffinityKey    },
     { nullptr,             0, nullptr, 0 }
 };
 
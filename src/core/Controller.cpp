@@ -83,13 +83,13 @@ xmrig::Controller::~Controller()
 
 bool xmrig::Controller::isReady() const
 {
-    return d_ptr->config && d_ptr->network;
+    return d_ptr->config && (d_ptr->network || d_ptr->config->isOffline());
 }
 
 
 bool xmrig::Controller::oclInit()
 {
-    return OclLib::init(config()->loader()) && config()->oclInit();
+    return OclLib::init(config()->loader(), config()->isBench()) && config()->oclInit();
 }
 
 
@@ -127,7 +127,10 @@ int xmrig::Controller::init()
     }
 #   endif
 
-    d_ptr->network = new Network(this);
+    if (!config()->isOffline()) {
+        d_ptr->network = new Network(this);
+    }
+
     return 0;
 }
 
@@ -57,6 +57,7 @@ Options:\n\
       --tls-fingerprint=F      pool TLS certificate fingerprint, if set enable strict certificate pinning\n\
   -r, --retries=N              number of times to retry before switch to backup server (default: 5)\n\
   -R, --retry-pause=N          time to pause between retries (default: 5)\n\
+      --standby=N              number of backup pools kept logged in for instant failover (default: 0)\n\
       --opencl-devices=N       list of OpenCL devices to use.\n\
       --opencl-launch=IxW      list of launch config, intensity and worksize\n\
       --opencl-strided-index=N list of strided_index option values for each thread\n\
@@ -65,8 +66,21 @@ Options:\n\
       --opencl-affinity=N      list of affinity GPU threads to a CPU\n\
       --opencl-platform=N      OpenCL platform index\n\
       --opencl-loader=N        path to OpenCL-ICD-Loader (OpenCL.dll or libOpenCL.so)\n\
+                               \"virtual[:devices=N,cu=N,memory=MB,latency=MS,rtt=MS]\" emulates GPUs on the CPU\n\
+      --opencl-pipeline        keep two batches in flight per GPU thread to hide host round trips\n\
+      --opencl-r-workers=N     number of threads precompiling CryptonightR programs (default: 1)\n\
+      --opencl-batch-time=N    adapt intensity of every GPU thread to a batch time of N ms (default: 0, fixed intensity)\n\
+      --opencl-fast-switch=N   split cn1 of every batch into N dispatches and drop the batch on a new job (default: 0, disabled)\n\
+      --opencl-profile         measure every kernel and transfer with OpenCL profiling events, see /1/profile in the API\n\
+      --opencl-self-test       check the kernels of every GPU thread against known hashes at startup, failing threads are disabled\n\
+      --opencl-self-test=all   same check with every test vector of every variant of the algorithm\n\
       --print-platforms        print available OpenCL platforms and exit\n\
       --no-cache               disable OpenCL cache\n\
+      --verify-threads=N       number of CPU threads for share verification (default: 1)\n\
+      --verify-affinity=N      set process affinity for share verification threads (CPU mask)\n\
+      --cpu-threads=N          number of CPU mining threads next to the GPUs (default: 0, disabled)\n\
+      --cpu-ways=N             hashes computed at once by every CPU thread, 1-5 (default: 1)\n\
+      --cpu-affinity=N         set process affinity for CPU mining threads (CPU mask)\n\
       --no-color               disable colored output\n\
       --variant                algorithm PoW variant\n\
       --donate-level=N         donate level, default 5%% (5 minutes in 100 minutes)\n\
@@ -87,6 +101,10 @@ Options:\n\
       --api-ipv6               enable IPv6 support for API\n\
       --api-no-restricted      enable full remote access (only if API token set)\n\
       --dry-run                test configuration and exit\n\
+      --bench=N                run an offline benchmark for N seconds and exit\n\
+      --bench-hashes=N         stop the benchmark after N hashes\n\
+      --bench-report=FILE      save the benchmark report as JSON to FILE (default: stdout)\n\
+      --tune                   search the best threads for every GPU, save them to the config and exit\n\
   -h, --help                   display this help and exit\n\
   -V, --version                output version information and exit\n\
 ";
@@ -24,8 +24,12 @@
  */
 
 
+#include <algorithm>
 #include <assert.h>
+#include <atomic>
 #include <sstream>
+#include <thread>
+#include <vector>
 
 
 #include "common/cpu/Cpu.h"
@@ -38,7 +42,6 @@
 #include "net/JobResult.h"
 
 
-alignas(16) cryptonight_ctx *CryptoNight::m_ctx = nullptr;
 xmrig::Algo CryptoNight::m_algorithm = xmrig::CRYPTONIGHT;
 xmrig::AlgoVerify CryptoNight::m_av  = xmrig::VERIFY_HW_AES;
 
@@ -369,81 +372,346 @@ CryptoNight::cn_hash_fun CryptoNight::fn(xmrig::Algo algorithm, xmrig::AlgoVerif
 }
 
 
-bool CryptoNight::selfTest() {
+template<xmrig::Algo ALGO, xmrig::Variant VARIANT>
+static CryptoNight::cn_hash_fun cryptonight_multi_hash(size_t ways)
+{
+    switch (ways) {
+    case 2:
+        return cryptonight_double_hash<ALGO, false, VARIANT>;
+
+    case 3:
+        return cryptonight_triple_hash<ALGO, false, VARIANT>;
+
+    case 4:
+        return cryptonight_quad_hash<ALGO, false, VARIANT>;
+
+    case 5:
+        return cryptonight_penta_hash<ALGO, false, VARIANT>;
+
+    default:
+        break;
+    }
+
+    return nullptr;
+}
+
+
+CryptoNight::cn_hash_fun CryptoNight::fn(xmrig::Algo algorithm, xmrig::AlgoVerify av, xmrig::Variant variant, size_t ways)
+{
     using namespace xmrig;
 
-    Mem::create(&m_ctx, m_algorithm, 1);
-
-    if (m_algorithm == xmrig::CRYPTONIGHT) {
-        const bool rc = verify(VARIANT_0,      test_output_v0)   &&
-                        verify(VARIANT_1,      test_output_v1)   &&
-                        verify(VARIANT_2,      test_output_v2)   &&
-                        verify(VARIANT_XTL,    test_output_xtl)  &&
-                        verify(VARIANT_MSR,    test_output_msr)  &&
-                        verify(VARIANT_XAO,    test_output_xao)  &&
-                        verify(VARIANT_RTO,    test_output_rto)  &&
-                        verify(VARIANT_HALF,   test_output_half) &&
-                        verify2(VARIANT_WOW,   test_output_wow)  &&
-                        verify2(VARIANT_4,     test_output_r)    &&
-                        verify(VARIANT_RWZ,    test_output_rwz)  &&
-                        verify(VARIANT_ZLS,    test_output_zls)  &&
-                        verify(VARIANT_DOUBLE, test_output_double);
+    assert(variant >= VARIANT_0 && variant < VARIANT_MAX);
 
-#       ifndef XMRIG_NO_CN_GPU
-        if (!rc) {
-            return rc;
-        }
+    if (ways <= 1) {
+        return fn(algorithm, av, variant);
+    }
 
-        return verify(VARIANT_GPU, test_output_gpu);
+    // multi-way hashing is only provided for CPUs with hardware AES.
+    if (av != VERIFY_HW_AES || ways > kMaxWays) {
+        return nullptr;
+    }
+
+    using cn_multi_fun = cn_hash_fun (*)(size_t ways);
+
+    static const cn_multi_fun func_table[] = {
+        cryptonight_multi_hash<CRYPTONIGHT, VARIANT_0>,
+        cryptonight_multi_hash<CRYPTONIGHT, VARIANT_1>,
+        nullptr, // VARIANT_TUBE
+        cryptonight_multi_hash<CRYPTONIGHT, VARIANT_XTL>,
+        cryptonight_multi_hash<CRYPTONIGHT, VARIANT_MSR>,
+        nullptr, // VARIANT_XHV
+        cryptonight_multi_hash<CRYPTONIGHT, VARIANT_XAO>,
+        cryptonight_multi_hash<CRYPTONIGHT, VARIANT_RTO>,
+        cryptonight_multi_hash<CRYPTONIGHT, VARIANT_2>,
+        cryptonight_multi_hash<CRYPTONIGHT, VARIANT_HALF>,
+        nullptr, // VARIANT_TRTL
+        nullptr, // VARIANT_GPU
+        cryptonight_multi_hash<CRYPTONIGHT, VARIANT_WOW>,
+        cryptonight_multi_hash<CRYPTONIGHT, VARIANT_4>,
+        cryptonight_multi_hash<CRYPTONIGHT, VARIANT_RWZ>,
+        cryptonight_multi_hash<CRYPTONIGHT, VARIANT_ZLS>,
+        cryptonight_multi_hash<CRYPTONIGHT, VARIANT_DOUBLE>,
+#       ifndef XMRIG_NO_AEON
+        cryptonight_multi_hash<CRYPTONIGHT_LITE, VARIANT_0>,
+        cryptonight_multi_hash<CRYPTONIGHT_LITE, VARIANT_1>,
+        nullptr, // VARIANT_TUBE
+        nullptr, // VARIANT_XTL
+        nullptr, // VARIANT_MSR
+        nullptr, // VARIANT_XHV
+        nullptr, // VARIANT_XAO
+        nullptr, // VARIANT_RTO
+        nullptr, // VARIANT_2
+        nullptr, // VARIANT_HALF
+        nullptr, // VARIANT_TRTL
+        nullptr, // VARIANT_GPU
+        nullptr, // VARIANT_WOW
+        nullptr, // VARIANT_4
+        nullptr, // VARIANT_RWZ
+        nullptr, // VARIANT_ZLS
+        nullptr, // VARIANT_DOUBLE
+#       else
+        nullptr, nullptr, nullptr, nullptr,
+        nullptr, nullptr, nullptr, nullptr,
+        nullptr, nullptr, nullptr, nullptr,
+        nullptr, nullptr, nullptr, nullptr,
+        nullptr,
+#       endif
+#       ifndef XMRIG_NO_SUMO
+        cryptonight_multi_hash<CRYPTONIGHT_HEAVY, VARIANT_0>,
+        nullptr, // VARIANT_1
+        cryptonight_multi_hash<CRYPTONIGHT_HEAVY, VARIANT_TUBE>,
+        nullptr, // VARIANT_XTL
+        nullptr, // VARIANT_MSR
+        cryptonight_multi_hash<CRYPTONIGHT_HEAVY, VARIANT_XHV>,
+        nullptr, // VARIANT_XAO
+        nullptr, // VARIANT_RTO
+        nullptr, // VARIANT_2
+        nullptr, // VARIANT_HALF
+        nullptr, // VARIANT_TRTL
+        nullptr, // VARIANT_GPU
+        nullptr, // VARIANT_WOW
+        nullptr, // VARIANT_4
+        nullptr, // VARIANT_RWZ
+        nullptr, // VARIANT_ZLS
+        nullptr, // VARIANT_DOUBLE
 #       else
-        return rc;
+        nullptr, nullptr, nullptr, nullptr,
+        nullptr, nullptr, nullptr, nullptr,
+        nullptr, nullptr, nullptr, nullptr,
+        nullptr, nullptr, nullptr, nullptr,
+        nullptr,
+#       endif
+#       ifndef XMRIG_NO_CN_PICO
+        nullptr, // VARIANT_0
+        nullptr, // VARIANT_1
+        nullptr, // VARIANT_TUBE
+        nullptr, // VARIANT_XTL
+        nullptr, // VARIANT_MSR
+        nullptr, // VARIANT_XHV
+        nullptr, // VARIANT_XAO
+        nullptr, // VARIANT_RTO
+        nullptr, // VARIANT_2
+        nullptr, // VARIANT_HALF
+        cryptonight_multi_hash<CRYPTONIGHT_PICO, VARIANT_TRTL>,
+        nullptr, // VARIANT_GPU
+        nullptr, // VARIANT_WOW
+        nullptr, // VARIANT_4
+        nullptr, // VARIANT_RWZ
+        nullptr, // VARIANT_ZLS
+        nullptr, // VARIANT_DOUBLE
+#       else
+        nullptr, nullptr, nullptr, nullptr,
+        nullptr, nullptr, nullptr, nullptr,
+        nullptr, nullptr, nullptr, nullptr,
+        nullptr, nullptr, nullptr, nullptr,
+        nullptr,
 #       endif
+    };
+
+    static_assert((VARIANT_MAX * ALGO_MAX) == sizeof(func_table) / sizeof(func_table[0]), "func_table size mismatch");
+
+    const cn_multi_fun func = func_table[VARIANT_MAX * algorithm + variant];
+
+    return func ? func(ways) : nullptr;
+}
+
+
+struct VariantTest
+{
+    xmrig::Variant variant;
+    const uint8_t *reference;
+    bool random;
+};
+
+
+static std::vector<VariantTest> selfTests(xmrig::Algo algorithm)
+{
+    using namespace xmrig;
+
+    std::vector<VariantTest> tests;
+
+    if (algorithm == xmrig::CRYPTONIGHT) {
+        tests = {
+            { VARIANT_0,      test_output_v0,     false },
+            { VARIANT_1,      test_output_v1,     false },
+            { VARIANT_2,      test_output_v2,     false },
+            { VARIANT_XTL,    test_output_xtl,    false },
+            { VARIANT_MSR,    test_output_msr,    false },
+            { VARIANT_XAO,    test_output_xao,    false },
+            { VARIANT_RTO,    test_output_rto,    false },
+            { VARIANT_HALF,   test_output_half,   false },
+            { VARIANT_WOW,    test_output_wow,    true  },
+            { VARIANT_4,      test_output_r,      true  },
+            { VARIANT_RWZ,    test_output_rwz,    false },
+            { VARIANT_ZLS,    test_output_zls,    false },
+            { VARIANT_DOUBLE, test_output_double, false },
+#           ifndef XMRIG_NO_CN_GPU
+            { VARIANT_GPU,    test_output_gpu,    false },
+#           endif
+        };
     }
 
 #   ifndef XMRIG_NO_AEON
-    if (m_algorithm == xmrig::CRYPTONIGHT_LITE) {
-        return verify(VARIANT_0, test_output_v0_lite) &&
-               verify(VARIANT_1, test_output_v1_lite);
+    if (algorithm == xmrig::CRYPTONIGHT_LITE) {
+        tests = {
+            { VARIANT_0, test_output_v0_lite, false },
+            { VARIANT_1, test_output_v1_lite, false }
+        };
     }
 #   endif
 
 #   ifndef XMRIG_NO_SUMO
-    if (m_algorithm == xmrig::CRYPTONIGHT_HEAVY) {
-        return verify(VARIANT_0,    test_output_v0_heavy)  &&
-               verify(VARIANT_XHV,  test_output_xhv_heavy) &&
-               verify(VARIANT_TUBE, test_output_tube_heavy);
+    if (algorithm == xmrig::CRYPTONIGHT_HEAVY) {
+        tests = {
+            { VARIANT_0,    test_output_v0_heavy,   false },
+            { VARIANT_XHV,  test_output_xhv_heavy,  false },
+            { VARIANT_TUBE, test_output_tube_heavy, false }
+        };
     }
 #   endif
 
 #   ifndef XMRIG_NO_CN_PICO
-    if (m_algorithm == xmrig::CRYPTONIGHT_PICO) {
-        return verify(VARIANT_TRTL, test_output_pico_trtl);
+    if (algorithm == xmrig::CRYPTONIGHT_PICO) {
+        tests = {
+            { VARIANT_TRTL, test_output_pico_trtl, false }
+        };
     }
 #   endif
 
+    return tests;
+}
+
+
+// Every variant is checked with its own contexts, the tests are spread over the CPU cores.
+bool CryptoNight::selfTest() {
+    const std::vector<VariantTest> tests = selfTests(m_algorithm);
+
+    if (tests.empty()) {
+        return false;
+    }
+
+    const size_t cores = std::max(std::thread::hardware_concurrency(), 1u);
+    const size_t count = std::min(tests.size(), cores);
+
+    std::atomic<size_t> next(0);
+    std::atomic<bool> passed(true);
+    std::vector<std::thread> pool;
+    pool.reserve(count);
+
+    for (size_t i = 0; i < count; ++i) {
+        pool.emplace_back([&]() {
+            cryptonight_ctx *ctx[kMaxWays] = { nullptr };
+            MemInfo info = Mem::create(ctx, m_algorithm, kMaxWays);
+
+            size_t index;
+            while (passed && (index = next.fetch_add(1)) < tests.size()) {
+                const VariantTest &test = tests[index];
+
+                if (!(test.random ? verify2(test.variant, test.reference, ctx) : verify(test.variant, test.reference, ctx))) {
+                    passed = false;
+                }
+            }
+
+            Mem::release(ctx, kMaxWays, info);
+        });
+    }
+
+    for (std::thread &thread : pool) {
+        thread.join();
+    }
+
+    return passed;
+}
+
+
+// Input number index of the variant with its expected hash, CryptonightR variants use the inputs with a block height.
+// Returns false past the last input.
+bool CryptoNight::testVector(xmrig::Algo algorithm, xmrig::Variant variant, size_t index, TestVector &vector)
+{
+    for (const VariantTest &test : selfTests(algorithm)) {
+        if (test.variant != variant) {
+            continue;
+        }
+
+        if (test.random) {
+            if (index >= sizeof(cn_r_test_input) / sizeof(cn_r_test_input[0])) {
+                return false;
+            }
+
+            vector.input  = cn_r_test_input[index].data;
+            vector.size   = cn_r_test_input[index].size;
+            vector.height = cn_r_test_input[index].height;
+        }
+        else {
+            if (index >= sizeof(test_input) / 76) {
+                return false;
+            }
+
+            vector.input  = test_input + index * 76;
+            vector.size   = 76;
+            vector.height = 0;
+        }
+
+        vector.reference = test.reference + index * 32;
+
+        return true;
+    }
+
     return false;
 }
 
 
-bool CryptoNight::verify(xmrig::Variant variant, const uint8_t *referenceValue)
+std::vector<xmrig::Variant> CryptoNight::testVariants(xmrig::Algo algorithm)
 {
-    if (!m_ctx) {
+    std::vector<xmrig::Variant> variants;
+
+    for (const VariantTest &test : selfTests(algorithm)) {
+        variants.push_back(test.variant);
+    }
+
+    return variants;
+}
+
+
+bool CryptoNight::verify(xmrig::Variant variant, const uint8_t *referenceValue, cryptonight_ctx **ctx)
+{
+    if (!ctx[0]) {
         return false;
     }
 
-    uint8_t output[32];
+    uint8_t output[32 * kMaxWays];
+    uint8_t expected[32 * kMaxWays];
 
     cn_hash_fun func = fn(variant);
     if (!func) {
         return false;
     }
 
-    func(test_input, 76, output, &m_ctx, 0);
+    for (size_t i = 0; i < kMaxWays; ++i) {
+        func(test_input + 76 * i, 76, expected + 32 * i, ctx, 0);
+    }
+
+    if (memcmp(expected, referenceValue, 32) != 0) {
+        return false;
+    }
+
+    for (size_t ways = 2; ways <= kMaxWays; ++ways) {
+        cn_hash_fun multi = fn(variant, ways);
+        if (!multi) {
+            break;
+        }
+
+        multi(test_input, 76, output, ctx, 0);
 
-    return memcmp(output, referenceValue, 32) == 0;
+        if (memcmp(output, expected, 32 * ways) != 0) {
+            return false;
+        }
+    }
+
+    return true;
 }
 
-bool CryptoNight::verify2(xmrig::Variant variant, const uint8_t *referenceValue)
+bool CryptoNight::verify2(xmrig::Variant variant, const uint8_t *referenceValue, cryptonight_ctx **ctx)
 {
     cn_hash_fun func = fn(variant);
     if (!func) {
@@ -452,11 +720,34 @@ bool CryptoNight::verify2(xmrig::Variant variant, const uint8_t *referenceValue)
 
     for (size_t i = 0; i < (sizeof(cn_r_test_input) / sizeof(cn_r_test_input[0])); ++i) {
         uint8_t hash[32];
-        func(cn_r_test_input[i].data, cn_r_test_input[i].size, hash, &m_ctx, cn_r_test_input[i].height);
+        func(cn_r_test_input[i].data, cn_r_test_input[i].size, hash, ctx, cn_r_test_input[i].height);
 
         if (memcmp(hash, referenceValue + i * 32, sizeof hash) != 0) {
             return false;
         }
+
+        const size_t size = cn_r_test_input[i].size;
+        uint8_t input[128 * kMaxWays];
+        uint8_t output[32 * kMaxWays];
+
+        for (size_t ways = 2; ways <= kMaxWays; ++ways) {
+            cn_hash_fun multi = fn(variant, ways);
+            if (!multi) {
+                break;
+            }
+
+            for (size_t k = 0; k < ways; ++k) {
+                memcpy(input + size * k, cn_r_test_input[i].data, size);
+            }
+
+            multi(input, size, output, ctx, cn_r_test_input[i].height);
+
+            for (size_t k = 0; k < ways; ++k) {
+                if (memcmp(output + 32 * k, hash, sizeof hash) != 0) {
+                    return false;
+                }
+            }
+        }
     }
 
     return true;
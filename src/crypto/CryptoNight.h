@@ -28,10 +28,12 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <vector>
 
 
 #include "common/xmrig.h"
 #include "crypto/CryptoNight_constants.h"
+#include "workers/CpuThread.h"
 
 
 #if defined _MSC_VER || defined XMRIG_ARM
@@ -43,10 +45,6 @@
 struct cryptonight_ctx;
 
 namespace xmrig {
-    namespace CpuThread {
-        typedef void(*cn_mainloop_fun)(cryptonight_ctx**);
-    }
-
     class Job;
     class JobResult;
 }
@@ -79,18 +77,31 @@ class CryptoNight
 public:
     typedef void (*cn_hash_fun)(const uint8_t *input, size_t size, uint8_t *output, cryptonight_ctx **ctx, uint64_t height);
 
-    static inline cn_hash_fun fn(xmrig::Variant variant) { return fn(m_algorithm, m_av, variant); }
+    struct TestVector
+    {
+        const uint8_t *input;
+        size_t size;
+        uint64_t height;
+        const uint8_t *reference; // 32 bytes
+    };
+
+    constexpr static size_t kMaxWays = 5;
+
+    static inline cn_hash_fun fn(xmrig::Variant variant)               { return fn(m_algorithm, m_av, variant); }
+    static inline cn_hash_fun fn(xmrig::Variant variant, size_t ways)  { return fn(m_algorithm, m_av, variant, ways); }
 
     static bool hash(const xmrig::Job &job, xmrig::JobResult &result, cryptonight_ctx *ctx);
     static bool init(xmrig::Algo algorithm);
+    static bool testVector(xmrig::Algo algorithm, xmrig::Variant variant, size_t index, TestVector &vector);
     static cn_hash_fun fn(xmrig::Algo algorithm, xmrig::AlgoVerify av, xmrig::Variant variant);
+    static cn_hash_fun fn(xmrig::Algo algorithm, xmrig::AlgoVerify av, xmrig::Variant variant, size_t ways);
+    static std::vector<xmrig::Variant> testVariants(xmrig::Algo algorithm);
 
 private:
     static bool selfTest();
-    static bool verify(xmrig::Variant variant, const uint8_t *referenceValue);
-    static bool verify2(xmrig::Variant variant, const uint8_t *test_data);
+    static bool verify(xmrig::Variant variant, const uint8_t *referenceValue, cryptonight_ctx **ctx);
+    static bool verify2(xmrig::Variant variant, const uint8_t *test_data, cryptonight_ctx **ctx);
 
-    alignas(16) static cryptonight_ctx *m_ctx;
     static xmrig::Algo m_algorithm;
     static xmrig::AlgoVerify m_av;
 };
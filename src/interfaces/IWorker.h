@@ -35,7 +35,10 @@ public:
 
     virtual bool selfTest()            = 0;
     virtual size_t id() const          = 0;
+    virtual uint64_t batchTime() const = 0;
     virtual uint64_t hashCount() const = 0;
+    virtual uint64_t intensity() const = 0;
+    virtual uint64_t jobLatency() const = 0;
     virtual uint64_t timestamp() const = 0;
     virtual void start()               = 0;
 };
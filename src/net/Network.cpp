@@ -102,6 +102,10 @@ void xmrig::Network::onActive(IStrategy *strategy, Client *client)
     if (fingerprint != nullptr) {
         LOG_INFO("%sfingerprint (SHA-256): \"%s\"", isColors() ? "\x1B[1;30m" : "", fingerprint);
     }
+
+    if (tlsVersion) {
+        LOG_INFO("%sTLS handshake %" PRIu64 " ms%s", isColors() ? "\x1B[1;30m" : "", client->tlsHandshakeTime(), client->isTlsResumed() ? ", session resumed" : "");
+    }
 }
 
 
@@ -0,0 +1,329 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <inttypes.h>
+#include <map>
+#include <stdio.h>
+#include <string.h>
+
+
+#include "base/io/Json.h"
+#include "common/log/Log.h"
+#include "core/Config.h"
+#include "core/Controller.h"
+#include "crypto/CryptoNight.h"
+#include "interfaces/IThread.h"
+#include "net/JobResult.h"
+#include "rapidjson/document.h"
+#include "rapidjson/prettywriter.h"
+#include "rapidjson/stringbuffer.h"
+#include "version.h"
+#include "workers/Benchmark.h"
+#include "workers/OclThread.h"
+#include "workers/Verifier.h"
+#include "workers/Workers.h"
+
+
+static const uint64_t kDiff           = 256;
+static const uint64_t kHeight         = 1806260; // first Monero block with CryptonightR, only used by the cn/r random math
+static const uint64_t kSampleInterval = 4;       // every 4th found result is checked again with CryptoNight::hash
+
+
+Benchmark::Benchmark(xmrig::Controller *controller) :
+    m_ctx(nullptr),
+    m_exitCode(1),
+    m_accepted(0),
+    m_mismatch(0),
+    m_startTime(0),
+    m_verified(0),
+    m_controller(controller),
+    m_job(createJob(controller->config()->algorithm()))
+{
+    m_memory = Mem::create(&m_ctx, m_job.algorithm().algo(), 1);
+
+    m_timer.data = this;
+    uv_timer_init(uv_default_loop(), &m_timer);
+}
+
+
+Benchmark::~Benchmark()
+{
+    Mem::release(&m_ctx, 1, m_memory);
+}
+
+
+xmrig::Job Benchmark::createJob(const xmrig::Algorithm &algorithm)
+{
+    uint8_t blob[76] = { 0 };
+    for (size_t i = 0; i < sizeof(blob); ++i) {
+        blob[i] = static_cast<uint8_t>(i * 0x9d + 0x3b);
+    }
+
+    // major version, selects the newest variant when the variant is "auto"
+    blob[0] = 10;
+    blob[1] = 10;
+
+    char hex[sizeof(blob) * 2 + 1] = { 0 };
+    xmrig::Job::toHex(blob, sizeof(blob), hex);
+
+    const uint64_t target = 0xFFFFFFFFFFFFFFFFULL / kDiff;
+    char targetHex[17] = { 0 };
+    xmrig::Job::toHex(reinterpret_cast<const unsigned char *>(&target), sizeof(target), targetHex);
+
+    xmrig::Job job(0, false, algorithm, xmrig::Id("bench"));
+    job.setId("bench");
+    job.setBlob(hex);
+    job.setTarget(targetHex);
+    job.setHeight(kHeight);
+
+    return job;
+}
+
+
+void Benchmark::start()
+{
+    const xmrig::Config *config = m_controller->config();
+
+    // threads are known only after OpenCL initialization, the auto configuration may add them and threads which failed
+    // the kernel self-test are left out, CPU threads are not part of the benchmark, they may stay throttled
+    m_hashes.assign(Workers::gpuThreads().size(), 0);
+
+    LOG_INFO(config->isColors() ? "bench " WHITE_BOLD("%s") ", " WHITE_BOLD("%zu") " threads, time " WHITE_BOLD("%" PRIu64 "s") ", hashes " WHITE_BOLD("%" PRIu64)
+                                : "bench %s, %zu threads, time %" PRIu64 "s, hashes %" PRIu64,
+             m_job.algorithm().name(), m_hashes.size(), config->benchTime(), config->benchHashes());
+
+    Workers::setJob(m_job, false);
+
+    uv_timer_start(&m_timer, Benchmark::onTick, 500, 500);
+}
+
+
+void Benchmark::onJobResult(const xmrig::JobResult &result)
+{
+    if (m_accepted++ % kSampleInterval != 0) {
+        return;
+    }
+
+    xmrig::Job job(m_job);
+    *job.nonce() = result.nonce;
+
+    xmrig::JobResult check(job);
+    CryptoNight::hash(job, check, m_ctx);
+
+    if (memcmp(check.result, result.result, sizeof(result.result)) == 0) {
+        m_verified++;
+        return;
+    }
+
+    m_mismatch++;
+    LOG_ERR("bench result mismatch for nonce %08x", result.nonce);
+}
+
+
+bool Benchmark::isReady() const
+{
+    for (size_t i = 0; i < m_hashes.size(); ++i) {
+        if (Workers::hashCount(i) == 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+void Benchmark::finish()
+{
+    uv_timer_stop(&m_timer);
+    uv_close(reinterpret_cast<uv_handle_t*>(&m_timer), nullptr);
+
+    const uint64_t elapsed = (uv_hrtime() - m_startTime) / 1000000;
+    const uint64_t invalid = Workers::verifier() ? Workers::verifier()->invalid() : 0;
+
+    print(elapsed);
+
+    if (m_verified == 0) {
+        LOG_ERR("bench no results were verified, increase the benchmark time");
+    }
+
+    m_exitCode = (invalid == 0 && m_mismatch == 0 && m_verified > 0) ? 0 : 1;
+
+    report(elapsed);
+
+    Workers::stop();
+    uv_stop(uv_default_loop());
+}
+
+
+void Benchmark::print(uint64_t elapsed) const
+{
+    const bool colors = m_controller->config()->isColors();
+    const std::vector<xmrig::IThread *> &threads = Workers::gpuThreads();
+    const double seconds = elapsed / 1000.0;
+
+    uint64_t total = 0;
+    std::map<size_t, uint64_t> devices;
+
+    for (size_t i = 0; i < threads.size(); ++i) {
+        const uint64_t hashes = Workers::hashCount(i) - m_hashes[i];
+        total += hashes;
+        devices[threads[i]->index()] += hashes;
+
+        LOG_INFO(colors ? "bench " WHITE_BOLD("#%02zu") ", GPU " WHITE_BOLD("#%02zu") " " CYAN_BOLD("%.1f H/s") " (%" PRIu64 " hashes)"
+                        : "bench #%02zu, GPU #%02zu %.1f H/s (%" PRIu64 " hashes)",
+                 i, threads[i]->index(), hashes / seconds, hashes);
+    }
+
+    for (const auto &device : devices) {
+        LOG_INFO(colors ? "bench GPU " WHITE_BOLD("#%02zu") " " CYAN_BOLD("%.1f H/s")
+                        : "bench GPU #%02zu %.1f H/s",
+                 device.first, device.second / seconds);
+    }
+
+    LOG_INFO(colors ? "bench total " CYAN_BOLD("%.1f H/s") " in " WHITE_BOLD("%.3fs") ", results " WHITE_BOLD("%" PRIu64) " verified " WHITE_BOLD("%" PRIu64) " invalid " WHITE_BOLD("%" PRIu64)
+                    : "bench total %.1f H/s in %.3fs, results %" PRIu64 " verified %" PRIu64 " invalid %" PRIu64,
+             total / seconds, seconds, m_accepted, m_verified, m_mismatch + (Workers::verifier() ? Workers::verifier()->invalid() : 0));
+}
+
+
+void Benchmark::report(uint64_t elapsed) const
+{
+    using namespace rapidjson;
+
+    Document doc(kObjectType);
+    auto &allocator = doc.GetAllocator();
+
+    const std::vector<xmrig::IThread *> &threads = Workers::gpuThreads();
+    const double seconds = elapsed / 1000.0;
+
+    uint64_t total = 0;
+    std::map<size_t, std::pair<uint64_t, uint64_t> > devices;
+    Value list(kArrayType);
+
+    for (size_t i = 0; i < threads.size(); ++i) {
+        const xmrig::OclThread *thread = static_cast<const xmrig::OclThread *>(threads[i]);
+        const uint64_t hashes          = Workers::hashCount(i) - m_hashes[i];
+
+        total += hashes;
+        devices[thread->index()].first++;
+        devices[thread->index()].second += hashes;
+
+        Value value(kObjectType);
+        value.AddMember("index",      static_cast<uint64_t>(i), allocator);
+        value.AddMember("device",     static_cast<uint64_t>(thread->index()), allocator);
+        value.AddMember("intensity",  static_cast<uint64_t>(thread->intensity()), allocator);
+        value.AddMember("worksize",   static_cast<uint64_t>(thread->worksize()), allocator);
+        value.AddMember("hashes",     hashes, allocator);
+        value.AddMember("hashrate",   hashes / seconds, allocator);
+        value.AddMember("batch_time", Workers::batchTime(i), allocator);
+
+        list.PushBack(value, allocator);
+    }
+
+    Value gpus(kArrayType);
+    for (const auto &device : devices) {
+        Value value(kObjectType);
+        value.AddMember("index",    static_cast<uint64_t>(device.first), allocator);
+        value.AddMember("threads",  device.second.first, allocator);
+        value.AddMember("hashes",   device.second.second, allocator);
+        value.AddMember("hashrate", device.second.second / seconds, allocator);
+
+        gpus.PushBack(value, allocator);
+    }
+
+    Value results(kObjectType);
+    results.AddMember("found",    m_accepted, allocator);
+    results.AddMember("verified", m_verified, allocator);
+    results.AddMember("mismatch", m_mismatch, allocator);
+    results.AddMember("invalid",  Workers::verifier() ? Workers::verifier()->invalid() : 0, allocator);
+
+    doc.AddMember("version",  APP_VERSION, allocator);
+    doc.AddMember("algo",     StringRef(m_job.algorithm().name()), allocator);
+    doc.AddMember("height",   m_job.height(), allocator);
+    doc.AddMember("diff",     kDiff, allocator);
+    doc.AddMember("pipeline", m_controller->config()->isOclPipeline(), allocator);
+    doc.AddMember("elapsed",  elapsed, allocator);
+    doc.AddMember("hashes",   total, allocator);
+    doc.AddMember("hashrate", total / seconds, allocator);
+    doc.AddMember("threads",  list, allocator);
+    doc.AddMember("devices",  gpus, allocator);
+    doc.AddMember("results",  results, allocator);
+    doc.AddMember("passed",   m_exitCode == 0, allocator);
+
+    const char *fileName = m_controller->config()->benchReport();
+    if (fileName) {
+        if (xmrig::Json::save(fileName, doc)) {
+            LOG_NOTICE("bench report saved to: \"%s\"", fileName);
+        }
+        else {
+            LOG_ERR("bench report could not be saved to: \"%s\"", fileName);
+        }
+
+        return;
+    }
+
+    StringBuffer buffer(nullptr, 4096);
+    PrettyWriter<StringBuffer> writer(buffer);
+    doc.Accept(writer);
+
+    printf("%s\n", buffer.GetString());
+    fflush(stdout);
+}
+
+
+void Benchmark::tick()
+{
+    if (m_startTime == 0) {
+        if (!isReady()) {
+            return;
+        }
+
+        // first batch of every thread includes kernel compilation and warm-up, hashes are counted from here
+        for (size_t i = 0; i < m_hashes.size(); ++i) {
+            m_hashes[i] = Workers::hashCount(i);
+        }
+
+        m_startTime = uv_hrtime();
+        return;
+    }
+
+    const xmrig::Config *config = m_controller->config();
+    const uint64_t elapsed      = (uv_hrtime() - m_startTime) / 1000000;
+
+    uint64_t total = 0;
+    for (size_t i = 0; i < m_hashes.size(); ++i) {
+        total += Workers::hashCount(i) - m_hashes[i];
+    }
+
+    if ((config->benchTime() > 0 && elapsed >= config->benchTime() * 1000) || (config->benchHashes() > 0 && total >= config->benchHashes())) {
+        finish();
+    }
+}
+
+
+void Benchmark::onTick(uv_timer_t *handle)
+{
+    static_cast<Benchmark*>(handle->data)->tick();
+}
@@ -0,0 +1,89 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef XMRIG_BENCHMARK_H
+#define XMRIG_BENCHMARK_H
+
+
+#include <stdint.h>
+#include <uv.h>
+#include <vector>
+
+
+#include "common/net/Job.h"
+#include "interfaces/IJobResultListener.h"
+#include "Mem.h"
+
+
+namespace xmrig {
+    class Controller;
+}
+
+
+/**
+ * Offline benchmark, replaces the network when --bench or --bench-hashes is set.
+ *
+ * A synthetic job for the configured algorithm and variant is fed through the normal Workers path, hashes are counted
+ * once every thread has finished its first batch, found results are checked again with CryptoNight::hash and the
+ * report is printed and saved as JSON.
+ */
+class Benchmark : public xmrig::IJobResultListener
+{
+public:
+    Benchmark(xmrig::Controller *controller);
+    ~Benchmark() override;
+
+    inline int exitCode() const { return m_exitCode; }
+
+    void start();
+
+    static xmrig::Job createJob(const xmrig::Algorithm &algorithm);
+
+protected:
+    void onJobResult(const xmrig::JobResult &result) override;
+
+private:
+    bool isReady() const;
+    void finish();
+    void print(uint64_t elapsed) const;
+    void report(uint64_t elapsed) const;
+    void tick();
+
+    static void onTick(uv_timer_t *handle);
+
+    cryptonight_ctx *m_ctx;
+    int m_exitCode;
+    MemInfo m_memory;
+    std::vector<uint64_t> m_hashes;
+    uint64_t m_accepted;
+    uint64_t m_mismatch;
+    uint64_t m_startTime;
+    uint64_t m_verified;
+    uv_timer_t m_timer;
+    xmrig::Controller *m_controller;
+    xmrig::Job m_job;
+};
+
+
+#endif /* XMRIG_BENCHMARK_H */
@@ -0,0 +1,132 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <inttypes.h>
+
+
+#include "base/io/Json.h"
+#include "common/log/Log.h"
+#include "rapidjson/document.h"
+#include "workers/CpuThread.h"
+
+
+namespace xmrig {
+
+static const char *kAffineToCpu  = "affine_to_cpu";
+static const char *kLowPowerMode = "low_power_mode";
+
+}
+
+
+xmrig::CpuThread::CpuThread(const rapidjson::Value &object, Algo algorithm) :
+    m_algorithm(algorithm),
+    m_affinity(Json::getInt64(object, kAffineToCpu, -1)),
+    m_multiway(SingleWay),
+    m_index(0)
+{
+    const rapidjson::Value &multiway = object[kLowPowerMode];
+    if (multiway.IsBool()) {
+        m_multiway = multiway.IsTrue() ? DoubleWay : SingleWay;
+    }
+    else if (multiway.IsUint()) {
+        m_multiway = static_cast<Multiway>(multiway.GetUint());
+    }
+}
+
+
+xmrig::CpuThread::CpuThread(size_t index, Algo algorithm, Multiway multiway, int64_t affinity) :
+    m_algorithm(algorithm),
+    m_affinity(affinity),
+    m_multiway(multiway),
+    m_index(index)
+{
+}
+
+
+int64_t xmrig::CpuThread::affinity(uint64_t mask, size_t index)
+{
+    if (mask == 0) {
+        return -1;
+    }
+
+    size_t bits = 0;
+    for (uint64_t value = mask; value; value &= value - 1) {
+        bits++;
+    }
+
+    // threads are assigned to the set bits of the mask in order, wrapping around
+    size_t skip = index % bits;
+
+    for (int64_t cpu = 0; cpu < 64; ++cpu) {
+        if ((mask & (1ULL << cpu)) && skip-- == 0) {
+            return cpu;
+        }
+    }
+
+    return -1;
+}
+
+
+#ifdef APP_DEBUG
+void xmrig::CpuThread::print() const
+{
+    LOG_DEBUG(GREEN_BOLD("CPU thread:") " index " WHITE_BOLD("%zu") ", multiway " WHITE_BOLD("%d") ", affine_to_cpu: %" PRId64, index(), multiway(), affinity());
+}
+#endif
+
+
+#ifndef XMRIG_NO_API
+rapidjson::Value xmrig::CpuThread::toAPI(rapidjson::Document &doc) const
+{
+    using namespace rapidjson;
+
+    Value obj = toConfig(doc);
+    auto &allocator = doc.GetAllocator();
+
+    obj.AddMember("type",  "cpu", allocator);
+    obj.AddMember("index", static_cast<uint64_t>(index()), allocator);
+
+    return obj;
+}
+#endif
+
+
+rapidjson::Value xmrig::CpuThread::toConfig(rapidjson::Document &doc) const
+{
+    using namespace rapidjson;
+
+    Value obj(kObjectType);
+    auto &allocator = doc.GetAllocator();
+
+    obj.AddMember(StringRef(kLowPowerMode), static_cast<int>(multiway()), allocator);
+
+    if (affinity() >= 0) {
+        obj.AddMember(StringRef(kAffineToCpu), affinity(), allocator);
+    }
+    else {
+        obj.AddMember(StringRef(kAffineToCpu), false, allocator);
+    }
+
+    return obj;
+}
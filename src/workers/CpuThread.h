@@ -0,0 +1,81 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef XMRIG_CPUTHREAD_H
+#define XMRIG_CPUTHREAD_H
+
+
+#include "common/xmrig.h"
+#include "interfaces/IThread.h"
+
+
+struct cryptonight_ctx;
+
+
+namespace xmrig {
+
+
+class CpuThread : public IThread
+{
+public:
+    typedef void(*cn_mainloop_fun)(cryptonight_ctx **ctx);
+
+    CpuThread(const rapidjson::Value &object, Algo algorithm);
+    CpuThread(size_t index, Algo algorithm, Multiway multiway, int64_t affinity);
+
+    inline void setIndex(size_t index)        { m_index = index; }
+
+    inline Algo algorithm() const override    { return m_algorithm; }
+    inline bool isValid() const override      { return m_multiway >= SingleWay && m_multiway <= PentaWay; }
+    inline int priority() const override      { return 0; }
+    inline int64_t affinity() const override  { return m_affinity; }
+    inline Multiway multiway() const override { return m_multiway; }
+    inline size_t index() const override      { return m_index; }
+    inline Type type() const override         { return CPU; }
+
+    static int64_t affinity(uint64_t mask, size_t index);
+
+protected:
+#   ifdef APP_DEBUG
+    void print() const override;
+#   endif
+
+#   ifndef XMRIG_NO_API
+    rapidjson::Value toAPI(rapidjson::Document &doc) const override;
+#   endif
+
+    rapidjson::Value toConfig(rapidjson::Document &doc) const override;
+
+private:
+    Algo m_algorithm;
+    int64_t m_affinity;
+    Multiway m_multiway;
+    size_t m_index;
+};
+
+
+} /* namespace xmrig */
+
+
+#endif /* XMRIG_CPUTHREAD_H */
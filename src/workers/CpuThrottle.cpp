@@ -0,0 +1,104 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/log/Log.h"
+#include "rapidjson/document.h"
+#include "workers/CpuThrottle.h"
+
+
+static const double kMaxSlowdown    = 1.1;  // GPU cost per hash relative to the baseline
+static const int64_t kMaxPending    = 64;   // results waiting for verification
+static const uint64_t kBackoffTicks = 60;   // no thread is released for 30 seconds after a backoff
+static const uint64_t kStepTicks    = 4;    // one thread released every 2 seconds
+
+
+CpuThrottle::CpuThrottle(size_t threads) :
+    m_threads(threads),
+    m_active(0),
+    m_backoffs(0),
+    m_cooldown(0)
+{
+}
+
+
+void CpuThrottle::update(const std::vector<double> &costs, int64_t pending)
+{
+    if (m_threads == 0) {
+        return;
+    }
+
+    if (m_baseline.size() != costs.size()) {
+        m_baseline.assign(costs.size(), 0.0);
+    }
+
+    const size_t active = m_active.load(std::memory_order_relaxed);
+    bool starving       = pending > kMaxPending;
+
+    for (size_t i = 0; i < costs.size(); ++i) {
+        if (costs[i] <= 0.0) {
+            return;
+        }
+
+        if (active == 0 || m_baseline[i] == 0.0 || costs[i] < m_baseline[i]) {
+            m_baseline[i] = costs[i];
+        }
+        else if (costs[i] > m_baseline[i] * kMaxSlowdown) {
+            starving = true;
+        }
+    }
+
+    if (m_cooldown > 0) {
+        m_cooldown--;
+    }
+
+    if (starving && active > 0) {
+        m_active.store(active - 1, std::memory_order_relaxed);
+        m_cooldown = kBackoffTicks;
+        m_backoffs++;
+
+        LOG_WARN("CPU mining throttled to %zu of %zu threads, GPU or verifier threads starved", active - 1, m_threads);
+        return;
+    }
+
+    if (!starving && m_cooldown == 0 && active < m_threads) {
+        m_active.store(active + 1, std::memory_order_relaxed);
+        m_cooldown = kStepTicks;
+    }
+}
+
+
+#ifndef XMRIG_NO_API
+rapidjson::Value CpuThrottle::toAPI(rapidjson::Document &doc) const
+{
+    using namespace rapidjson;
+    auto &allocator = doc.GetAllocator();
+
+    Value obj(kObjectType);
+    obj.AddMember("threads",  static_cast<uint64_t>(m_threads), allocator);
+    obj.AddMember("active",   static_cast<uint64_t>(active()), allocator);
+    obj.AddMember("backoffs", m_backoffs, allocator);
+
+    return obj;
+}
+#endif
@@ -0,0 +1,68 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef XMRIG_CPUTHROTTLE_H
+#define XMRIG_CPUTHROTTLE_H
+
+
+#include <atomic>
+#include <stdint.h>
+#include <vector>
+
+
+#include "rapidjson/fwd.h"
+
+
+/**
+ * Keeps CPU mining threads from starving the GPU feeder and verifier threads.
+ *
+ * CPU threads are released one at a time once every GPU thread reported its cost per hash, that cost is the baseline
+ * while no CPU thread runs. A CPU thread is parked again when any GPU thread becomes more than 10% slower than its
+ * baseline or when the verifier queue grows, and no thread is released for a while after that.
+ */
+class CpuThrottle
+{
+public:
+    CpuThrottle(size_t threads);
+
+    inline bool isActive(size_t index) const { return index < m_active.load(std::memory_order_relaxed); }
+    inline size_t active() const             { return m_active.load(std::memory_order_relaxed); }
+    inline size_t threads() const            { return m_threads; }
+
+    void update(const std::vector<double> &costs, int64_t pending);
+
+#   ifndef XMRIG_NO_API
+    rapidjson::Value toAPI(rapidjson::Document &doc) const;
+#   endif
+
+private:
+    const size_t m_threads;
+    std::atomic<size_t> m_active;
+    std::vector<double> m_baseline;
+    uint64_t m_backoffs;
+    uint64_t m_cooldown;
+};
+
+
+#endif /* XMRIG_CPUTHROTTLE_H */
@@ -0,0 +1,245 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <string.h>
+#include <thread>
+#include <uv.h>
+
+
+#include "common/Platform.h"
+#include "common/utils/timestamp.h"
+#include "workers/CpuWorker.h"
+#include "workers/Handle.h"
+#include "workers/NonceAllocator.h"
+#include "workers/Workers.h"
+
+
+static const size_t kBatchSize = 16; // hashing iterations between job, throttle and statistics checks
+
+
+std::atomic<size_t> CpuWorker::m_hugePages(0);
+
+
+CpuWorker::CpuWorker(Handle *handle) :
+    m_cpuIndex(handle->config()->index()),
+    m_id(handle->threadId()),
+    m_ways(static_cast<size_t>(handle->config()->multiway())),
+    m_step(1),
+    m_blob(),
+    m_hash(),
+    m_ctx(),
+    m_fn(nullptr),
+    m_memory(),
+    m_batchTime(0),
+    m_hashCount(0),
+    m_jobLatency(0),
+    m_timestamp(0),
+    m_generation(0),
+    m_nonce(0),
+    m_nonceEnd(0),
+    m_count(0),
+    m_sequence(0),
+    m_switchTimestamp(0),
+    m_algorithm(xmrig::INVALID_ALGO)
+{
+    const int64_t affinity = handle->config()->affinity();
+
+    if (affinity >= 0) {
+        Platform::setThreadAffinity(static_cast<uint64_t>(affinity));
+    }
+
+    Platform::setThreadPriority(handle->config()->priority());
+
+    allocate(handle->config()->algorithm());
+}
+
+
+CpuWorker::~CpuWorker()
+{
+    if (m_memory.memory) {
+        Mem::release(m_ctx, m_ways, m_memory);
+    }
+}
+
+
+bool CpuWorker::selfTest()
+{
+    return m_memory.memory != nullptr;
+}
+
+
+uint64_t CpuWorker::intensity() const
+{
+    return kBatchSize * m_ways;
+}
+
+
+void CpuWorker::start()
+{
+    while (Workers::sequence() > 0) {
+        while (!Workers::isOutdated(m_sequence)) {
+            Workers::quiescent(m_id);
+
+            if (!m_fn || !Workers::isCpuActive(m_cpuIndex)) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                continue;
+            }
+
+            const uint64_t started = uv_hrtime();
+
+            if (m_switchTimestamp) {
+                m_jobLatency.store((started - m_switchTimestamp) / 1000, std::memory_order_relaxed);
+                m_switchTimestamp = 0;
+            }
+
+            size_t i = 0;
+            while (i < kBatchSize && !Workers::isOutdated(m_sequence) && hash()) {
+                i++;
+            }
+
+            // nothing left to claim for this job, wait for the next one
+            if (i == 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                continue;
+            }
+
+            storeStats((uv_hrtime() - started) / 1000);
+            std::this_thread::yield();
+        }
+
+        if (Workers::isPaused()) {
+            do {
+                Workers::quiescent(m_id);
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            } while (Workers::isPaused());
+
+            if (Workers::sequence() == 0) {
+                break;
+            }
+        }
+
+        consumeJob();
+    }
+}
+
+
+void CpuWorker::allocate(xmrig::Algo algorithm)
+{
+    if (m_memory.memory) {
+        m_hugePages -= m_memory.hugePages;
+        Mem::release(m_ctx, m_ways, m_memory);
+    }
+
+    m_algorithm = algorithm;
+    m_memory    = Mem::create(m_ctx, algorithm, m_ways);
+    m_hugePages += m_memory.hugePages;
+}
+
+
+void CpuWorker::consumeJob()
+{
+    const Workers::Snapshot *snapshot = Workers::job();
+    m_sequence = Workers::sequence();
+    if (!snapshot) {
+        return;
+    }
+
+    const xmrig::Job &job = snapshot->job;
+    if (m_job.id() == job.id() && m_job.clientId() == job.clientId()) {
+        return;
+    }
+
+    m_switchTimestamp = snapshot->timestamp;
+
+    m_job = job;
+    m_job.setThreadId(m_id);
+
+    if (m_job.algorithm().algo() != m_algorithm) {
+        allocate(m_job.algorithm().algo());
+    }
+
+    // the multi-way implementation is not available for every variant, fall back to single hashes
+    m_fn   = CryptoNight::fn(m_job.algorithm().variant(), m_ways);
+    m_step = m_fn ? m_ways : 1;
+    if (!m_fn) {
+        m_fn = CryptoNight::fn(m_job.algorithm().variant());
+    }
+
+    const size_t size = m_job.size();
+    for (size_t i = 0; i < m_ways; ++i) {
+        memcpy(m_blob + size * i, m_job.blob(), size);
+    }
+
+    // the first hash claims a new range
+    m_nonces   = snapshot->nonces;
+    m_nonce    = 0;
+    m_nonceEnd = 0;
+
+    m_generation = Workers::publish(m_job);
+}
+
+
+bool CpuWorker::hash()
+{
+    // a range covers one batch, CPU threads are slow enough that claiming more would only leave gaps on job switches
+    if (!m_nonces || !m_nonces->reserve(m_nonce, m_nonceEnd, static_cast<uint32_t>(m_ways), static_cast<uint32_t>(kBatchSize * m_ways))) {
+        return false;
+    }
+
+    const size_t size = m_job.size();
+
+    for (size_t i = 0; i < m_ways; ++i) {
+        *reinterpret_cast<uint32_t*>(m_blob + size * i + 39) = m_nonce + static_cast<uint32_t>(i);
+    }
+
+    for (size_t i = 0; i < m_ways; i += m_step) {
+        m_fn(m_blob + size * i, size, m_hash + 32 * i, m_ctx + i, m_job.height());
+    }
+
+    for (size_t i = 0; i < m_ways; ++i) {
+        if (*reinterpret_cast<uint64_t*>(m_hash + 32 * i + 24) < m_job.target()) {
+            Workers::submit(m_id, m_nonce + static_cast<uint32_t>(i), m_generation);
+        }
+    }
+
+    m_nonce += static_cast<uint32_t>(m_ways);
+    m_count += m_ways;
+
+    return true;
+}
+
+
+void CpuWorker::storeStats(uint64_t batchTime)
+{
+    if (Workers::isPaused()) {
+        return;
+    }
+
+    const uint64_t timestamp = static_cast<uint64_t>(xmrig::currentMSecsSinceEpoch());
+
+    m_batchTime.store(batchTime, std::memory_order_relaxed);
+    m_hashCount.store(m_count, std::memory_order_relaxed);
+    m_timestamp.store(timestamp, std::memory_order_relaxed);
+}
@@ -0,0 +1,103 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef XMRIG_CPUWORKER_H
+#define XMRIG_CPUWORKER_H
+
+
+#include <atomic>
+#include <memory>
+
+
+#include "common/net/Job.h"
+#include "common/xmrig.h"
+#include "crypto/CryptoNight.h"
+#include "interfaces/IWorker.h"
+#include "Mem.h"
+
+
+class Handle;
+class NonceAllocator;
+
+
+/**
+ * CPU mining thread scheduled by Workers next to the OpenCL threads.
+ *
+ * Hashes up to CryptoNight::kMaxWays nonces at once with the assembly optimized implementation used by the verifier,
+ * claims its nonces from the allocator shared with the GPU threads and runs with the lowest priority. Found nonces go
+ * through the verifier like GPU results, the thread parks itself while CpuThrottle does not allow it to run.
+ */
+class CpuWorker : public IWorker
+{
+public:
+    CpuWorker(Handle *handle);
+    ~CpuWorker() override;
+
+    static inline size_t hugePages() { return m_hugePages.load(std::memory_order_relaxed); }
+
+protected:
+    inline uint64_t batchTime() const override  { return m_batchTime.load(std::memory_order_relaxed); }
+    inline uint64_t hashCount() const override  { return m_hashCount.load(std::memory_order_relaxed); }
+    inline uint64_t jobLatency() const override { return m_jobLatency.load(std::memory_order_relaxed); }
+    inline uint64_t timestamp() const override  { return m_timestamp.load(std::memory_order_relaxed); }
+    inline size_t id() const override           { return m_id; }
+
+    bool selfTest() override;
+    uint64_t intensity() const override;
+    void start() override;
+
+private:
+    void allocate(xmrig::Algo algorithm);
+    void consumeJob();
+    bool hash();
+    void storeStats(uint64_t batchTime);
+
+    const size_t m_cpuIndex;
+    const size_t m_id;
+    const size_t m_ways;
+    size_t m_step;
+    alignas(16) uint8_t m_blob[xmrig::Job::kMaxBlobSize * CryptoNight::kMaxWays];
+    alignas(16) uint8_t m_hash[32 * CryptoNight::kMaxWays];
+    cryptonight_ctx *m_ctx[CryptoNight::kMaxWays];
+    CryptoNight::cn_hash_fun m_fn;
+    MemInfo m_memory;
+    std::atomic<uint64_t> m_batchTime;
+    std::atomic<uint64_t> m_hashCount;
+    std::atomic<uint64_t> m_jobLatency;
+    std::atomic<uint64_t> m_timestamp;
+    std::shared_ptr<NonceAllocator> m_nonces;
+    uint32_t m_generation;
+    uint32_t m_nonce;
+    uint32_t m_nonceEnd;
+    uint64_t m_count;
+    uint64_t m_sequence;
+    uint64_t m_switchTimestamp;
+    xmrig::Algo m_algorithm;
+    xmrig::Job m_job;
+
+    static std::atomic<size_t> m_hugePages;
+};
+
+
+#endif /* XMRIG_CPUWORKER_H */
@@ -0,0 +1,153 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <algorithm>
+
+
+#include "crypto/CryptoNight.h"
+#include "rapidjson/document.h"
+#include "workers/CtxPool.h"
+
+
+CtxPool::CtxPool() :
+    m_allocTime(0),
+    m_allocTimeMax(0),
+    m_hits(0),
+    m_misses(0),
+    m_algorithm(xmrig::INVALID_ALGO)
+{
+    uv_mutex_init(&m_mutex);
+}
+
+
+CtxPool::~CtxPool()
+{
+    for (Entry &entry : m_free) {
+        destroy(entry);
+    }
+
+    for (Entry &entry : m_busy) {
+        destroy(entry);
+    }
+
+    uv_mutex_destroy(&m_mutex);
+}
+
+
+cryptonight_ctx *CtxPool::acquire(xmrig::Algo algorithm)
+{
+    uv_mutex_lock(&m_mutex);
+
+    if (m_algorithm != algorithm) {
+        for (Entry &entry : m_free) {
+            destroy(entry);
+        }
+
+        m_free.clear();
+        m_algorithm = algorithm;
+    }
+
+    if (!m_free.empty()) {
+        Entry entry = m_free.back();
+        m_free.pop_back();
+        m_busy.push_back(entry);
+        m_hits++;
+
+        uv_mutex_unlock(&m_mutex);
+        return entry.ctx;
+    }
+
+    m_misses++;
+    uv_mutex_unlock(&m_mutex);
+
+    Entry entry;
+    entry.algorithm = algorithm;
+
+    const uint64_t start = uv_hrtime();
+    entry.info = Mem::create(&entry.ctx, algorithm, 1);
+    const uint64_t elapsed = uv_hrtime() - start;
+
+    uv_mutex_lock(&m_mutex);
+    m_allocTime   += elapsed;
+    m_allocTimeMax = std::max(m_allocTimeMax, elapsed);
+    m_busy.push_back(entry);
+    uv_mutex_unlock(&m_mutex);
+
+    return entry.ctx;
+}
+
+
+void CtxPool::release(cryptonight_ctx *ctx)
+{
+    uv_mutex_lock(&m_mutex);
+
+    for (auto it = m_busy.begin(); it != m_busy.end(); ++it) {
+        if (it->ctx != ctx) {
+            continue;
+        }
+
+        Entry entry = *it;
+        m_busy.erase(it);
+
+        if (entry.algorithm == m_algorithm) {
+            m_free.push_back(entry);
+        }
+        else {
+            destroy(entry);
+        }
+
+        break;
+    }
+
+    uv_mutex_unlock(&m_mutex);
+}
+
+
+#ifndef XMRIG_NO_API
+rapidjson::Value CtxPool::toAPI(rapidjson::Document &doc) const
+{
+    using namespace rapidjson;
+    auto &allocator = doc.GetAllocator();
+
+    uv_mutex_lock(&m_mutex);
+
+    Value obj(kObjectType);
+    obj.AddMember("contexts",       static_cast<uint64_t>(m_free.size() + m_busy.size()), allocator);
+    obj.AddMember("hits",           m_hits, allocator);
+    obj.AddMember("misses",         m_misses, allocator);
+    obj.AddMember("alloc_time",     m_allocTime / 1000, allocator);
+    obj.AddMember("alloc_time_max", m_allocTimeMax / 1000, allocator);
+
+    uv_mutex_unlock(&m_mutex);
+
+    return obj;
+}
+#endif
+
+
+void CtxPool::destroy(Entry &entry)
+{
+    Mem::release(&entry.ctx, 1, entry.info);
+}
@@ -0,0 +1,82 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef XMRIG_CTXPOOL_H
+#define XMRIG_CTXPOOL_H
+
+
+#include <stdint.h>
+#include <uv.h>
+#include <vector>
+
+
+#include "common/xmrig.h"
+#include "Mem.h"
+#include "rapidjson/fwd.h"
+
+
+struct cryptonight_ctx;
+
+
+/**
+ * Long-lived pool of CryptoNight contexts used for CPU share verification.
+ *
+ * Contexts are kept between batches and only re-created when the algorithm changes,
+ * so the scratchpad (hugepages, MAP_POPULATE, mlock) is not mapped again for every share.
+ */
+class CtxPool
+{
+public:
+    CtxPool();
+    ~CtxPool();
+
+    cryptonight_ctx *acquire(xmrig::Algo algorithm);
+    void release(cryptonight_ctx *ctx);
+
+#   ifndef XMRIG_NO_API
+    rapidjson::Value toAPI(rapidjson::Document &doc) const;
+#   endif
+
+private:
+    struct Entry
+    {
+        cryptonight_ctx *ctx;
+        MemInfo info;
+        xmrig::Algo algorithm;
+    };
+
+    static void destroy(Entry &entry);
+
+    std::vector<Entry> m_busy;
+    std::vector<Entry> m_free;
+    uint64_t m_allocTime;
+    uint64_t m_allocTimeMax;
+    uint64_t m_hits;
+    uint64_t m_misses;
+    mutable uv_mutex_t m_mutex;
+    xmrig::Algo m_algorithm;
+};
+
+
+#endif /* XMRIG_CTXPOOL_H */
@@ -0,0 +1,73 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "common/net/Job.h"
+#include "workers/NonceAllocator.h"
+
+
+NonceAllocator::NonceAllocator(const xmrig::Job &job) :
+    m_nicehash(job.isNicehash()),
+    m_start(m_nicehash ? (*job.nonce() & 0xff000000U) : 0),
+    m_end(m_start + (m_nicehash ? 0x1000000ULL : 0x100000000ULL)),
+    m_next(m_start)
+{
+}
+
+
+// Lock-free, the range may be shorter than requested at the end of the space.
+bool NonceAllocator::claim(uint32_t size, uint32_t &start, uint32_t &count)
+{
+    const uint64_t first = m_next.fetch_add(size, std::memory_order_relaxed);
+    if (first >= m_end) {
+        return false;
+    }
+
+    start = static_cast<uint32_t>(first);
+    count = static_cast<uint32_t>(std::min<uint64_t>(size, m_end - first));
+
+    return true;
+}
+
+
+// Makes sure the range [nonce, end) of the calling thread has at least size nonces left, otherwise the rest is dropped
+// and a new range of chunk nonces is claimed. The end of the 32 bit space wraps to 0, so the distance is computed modulo 2^32.
+bool NonceAllocator::reserve(uint32_t &nonce, uint32_t &end, uint32_t size, uint32_t chunk)
+{
+    if (static_cast<uint32_t>(end - nonce) >= size) {
+        return true;
+    }
+
+    uint32_t start = 0;
+    uint32_t count = 0;
+
+    if (!claim(std::max(size, chunk), start, count) || count < size) {
+        return false;
+    }
+
+    nonce = start;
+    end   = start + count;
+
+    return true;
+}
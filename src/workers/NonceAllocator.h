@@ -0,0 +1,67 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef XMRIG_NONCEALLOCATOR_H
+#define XMRIG_NONCEALLOCATOR_H
+
+
+#include <algorithm>
+#include <atomic>
+#include <stdint.h>
+
+
+namespace xmrig {
+    class Job;
+}
+
+
+/**
+ * Nonce space of one job shared by all GPU and CPU threads.
+ *
+ * Threads claim ranges sized to their own throughput with a single atomic add, so threads of different speed share
+ * the space without fixed slices. With nicehash only the 24 bits after the pool byte are available and the space
+ * can run out. Workers keep the allocator of recent jobs, a job that comes back continues from the claimed position.
+ */
+class NonceAllocator
+{
+public:
+    NonceAllocator(const xmrig::Job &job);
+
+    bool claim(uint32_t size, uint32_t &start, uint32_t &count);
+    bool reserve(uint32_t &nonce, uint32_t &end, uint32_t size, uint32_t chunk);
+
+    inline bool isExhausted() const { return m_next.load(std::memory_order_relaxed) >= m_end; }
+    inline bool isNicehash() const  { return m_nicehash; }
+    inline uint64_t claimed() const { return std::min(m_next.load(std::memory_order_relaxed), m_end) - m_start; }
+    inline uint64_t size() const    { return m_end - m_start; }
+
+private:
+    const bool m_nicehash;
+    const uint64_t m_start;
+    const uint64_t m_end;
+    std::atomic<uint64_t> m_next;
+};
+
+
+#endif /* XMRIG_NONCEALLOCATOR_H */
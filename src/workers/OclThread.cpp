@@ -208,7 +208,27 @@ void xmrig::OclThread::print() const
 #ifndef XMRIG_NO_API
 rapidjson::Value xmrig::OclThread::toAPI(rapidjson::Document &doc) const
 {
-    return toConfig(doc);
+    using namespace rapidjson;
+
+    Value obj = toConfig(doc);
+    auto &allocator = doc.GetAllocator();
+
+    Value startup(kObjectType);
+    startup.AddMember("buffers", m_ctx->startupBuffers, allocator);
+    startup.AddMember("program", m_ctx->startupProgram, allocator);
+    startup.AddMember("kernels", m_ctx->startupKernels, allocator);
+    startup.AddMember("total",   m_ctx->startupBuffers + m_ctx->startupProgram + m_ctx->startupKernels, allocator);
+
+    if (m_ctx->programSource) {
+        startup.AddMember("source", StringRef(m_ctx->programSource), allocator);
+    }
+    else {
+        startup.AddMember("source", Value(kNullType), allocator);
+    }
+
+    obj.AddMember("startup", startup, allocator);
+
+    return obj;
 }
 #endif
 
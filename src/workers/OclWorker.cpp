@@ -24,45 +24,61 @@
  */
 
 
-#include <inttypes.h>
-#include <mutex>
+#include <algorithm>
 #include <thread>
+#include <uv.h>
 
 
 #include "amd/OclGPU.h"
+#include "amd/OclScheduler.h"
 #include "common/log/Log.h"
 #include "common/Platform.h"
 #include "common/utils/timestamp.h"
 #include "core/Config.h"
 #include "crypto/CryptoNight.h"
 #include "workers/Handle.h"
+#include "workers/NonceAllocator.h"
 #include "workers/OclThread.h"
 #include "workers/OclWorker.h"
 #include "workers/Workers.h"
 
 
-#define MAX_DEVICE_COUNT 32
+// Adaptive intensity never goes below this fraction of the allocated intensity, so launch overhead stays small.
+static const size_t kMinIntensityDivisor = 16;
+static const size_t kAdjustBatches       = 4; // batches measured before every intensity change
+static const uint64_t kClaimTime         = 1000; // milliseconds of work claimed from the shared nonce allocator at once
 
 
-static struct SGPUThreadInterleaveData
+static size_t minIntensity(const GpuContext *ctx)
 {
-    std::mutex m;
+    const size_t workSize = ctx->workSize > 0 ? ctx->workSize : 1;
 
-    double adjustThreshold   = 0.95;
-    double averageRunTime    = 0;
-    int64_t lastRunTimeStamp = 0;
-    int resumeCounter        = 0;
-} GPUThreadInterleaveData[MAX_DEVICE_COUNT];
+    return std::max(ctx->rawIntensity / kMinIntensityDivisor / workSize * workSize, workSize);
+}
 
 
 OclWorker::OclWorker(Handle *handle) :
     m_id(handle->threadId()),
-    m_threads(handle->totalWays()),
+    m_minIntensity(minIntensity(handle->ctx())),
+    m_averageBatchTime(0),
     m_ctx(handle->ctx()),
+    m_batchTime(0),
     m_hashCount(0),
+    m_intensity(handle->ctx()->rawIntensity),
+    m_jobLatency(0),
     m_timestamp(0),
+    m_generation(0),
+    m_nonceEnd(0),
+    m_pausedEnd(0),
+    m_pausedNonce(0),
     m_count(0),
     m_sequence(0),
+    m_switches(0),
+    m_switchTime(0),
+    m_switchTimestamp(0),
+    m_windowBatches(0),
+    m_windowHashes(0),
+    m_windowTime(0),
     m_blob()
 {
     const int64_t affinity = handle->config()->affinity();
@@ -75,57 +91,53 @@ OclWorker::OclWorker(Handle *handle) :
 
 void OclWorker::start()
 {
-    SGPUThreadInterleaveData& interleaveData = GPUThreadInterleaveData[m_ctx->deviceIdx % MAX_DEVICE_COUNT];
     cl_uint results[0x100];
 
     while (Workers::sequence() > 0) {
         while (!Workers::isOutdated(m_sequence)) {
+            Workers::quiescent(m_id);
             memset(results, 0, sizeof(cl_uint) * (0x100));
 
-            const int64_t delay = interleaveAdjustDelay();
-            if (delay > 0) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+            const uint64_t started = uv_hrtime();
+
+            if (m_switchTimestamp) {
+                storeSwitchLatency(started - m_switchTimestamp);
+                m_switchTimestamp = 0;
+            }
 
-#               ifdef APP_INTERLEAVE_DEBUG
-                LOG_WARN("Thread #%zu was paused for %" PRId64 " ms to adjust interleaving", m_id, delay);
-#               endif
+            // nothing left to claim for this job, wait for the next one
+            if (!reserveNonces()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                continue;
             }
 
-            const int64_t t = xmrig::steadyTimestamp();
+            XMRRunJob(m_ctx, results, m_job.algorithm().variant(), OclWorker::isStale, this);
+
+            // the rest of the batch was dropped for a newer job, nothing to count
+            if (m_ctx->Hashes == 0) {
+                continue;
+            }
 
-            XMRRunJob(m_ctx, results, m_job.algorithm().variant());
+            const uint64_t batchTime = (uv_hrtime() - started) / 1000;
 
             for (size_t i = 0; i < results[0xFF]; i++) {
-                *m_job.nonce() = results[i];
-                Workers::submit(m_job);
+                Workers::submit(m_id, results[i], m_generation);
             }
 
-            storeStats(t);
+            storeStats(batchTime);
+            updateIntensity(batchTime);
             std::this_thread::yield();
         }
 
         if (Workers::isPaused()) {
-            {
-                std::lock_guard<std::mutex> g(interleaveData.m);
-                interleaveData.resumeCounter = 0;
-            }
-
             do {
+                Workers::quiescent(m_id);
                 std::this_thread::sleep_for(std::chrono::milliseconds(50));
             } while (Workers::isPaused());
 
             if (Workers::sequence() == 0) {
                 break;
             }
-
-            const int64_t delay = resumeDelay();
-            if (delay > 0) {
-#               ifdef APP_INTERLEAVE_DEBUG
-                LOG_WARN("Thread #%zu will be paused for %" PRId64 " ms to before resuming", m_id, delay);
-#               endif
-
-                std::this_thread::sleep_for(std::chrono::milliseconds(delay));
-            }
         }
 
         consumeJob();
@@ -133,78 +145,66 @@ void OclWorker::start()
 }
 
 
-bool OclWorker::resume(const xmrig::Job &job)
+// Pools also send new jobs for the same block and still accept shares of the previous one,
+// the batch is dropped only when the block changes or the height is unknown.
+bool OclWorker::isStale(void *data)
 {
-    if (m_job.poolId() == -1 && job.poolId() >= 0 && job.id() == m_pausedJob.id()) {
-        m_job        = m_pausedJob;
-        m_ctx->Nonce = m_pausedNonce;
-
-        return true;
+    const OclWorker *worker = static_cast<const OclWorker *>(data);
+    if (!Workers::isOutdated(worker->m_sequence)) {
+        return false;
     }
 
-    return false;
+    const Workers::Snapshot *snapshot = Workers::job();
+
+    return !snapshot || snapshot->job.height() == 0 || snapshot->job.height() != worker->m_job.height();
 }
 
 
-int64_t OclWorker::interleaveAdjustDelay() const
+// Makes sure the next batch fits into the nonce range claimed by this thread, a new range covers about kClaimTime of work.
+bool OclWorker::reserveNonces()
 {
-    SGPUThreadInterleaveData &data = GPUThreadInterleaveData[m_ctx->deviceIdx % MAX_DEVICE_COUNT];
-
-    const int64_t t0 = xmrig::steadyTimestamp();
-    int64_t delay    = 0;
-
-    {
-        std::lock_guard<std::mutex> g(data.m);
-
-        const int64_t dt = t0 - data.lastRunTimeStamp;
-        data.lastRunTimeStamp = t0;
-
-        // The perfect interleaving is when N threads on the same GPU start with T/N interval between each other
-        // If a thread starts earlier than 0.75*T/N ms after the previous thread, delay it to restore perfect interleaving
-        if ((m_ctx->threads > 1) && (dt > 0) && (dt < data.adjustThreshold * (data.averageRunTime / m_ctx->threads))) {
-            delay = static_cast<int64_t>(data.averageRunTime / m_ctx->threads - dt);
-            data.adjustThreshold = 0.75;
-        }
+    if (!m_nonces) {
+        return false;
     }
 
-    if (delay >= 400) {
-        delay = 200;
-    }
+    const size_t size     = XMRBatchSize(m_ctx, m_job.algorithm().variant());
+    const uint64_t chunks = m_averageBatchTime > 0 ? static_cast<uint64_t>(kClaimTime * 1000 / m_averageBatchTime) : 1;
+    const uint64_t chunk  = std::min<uint64_t>(size * std::max<uint64_t>(chunks, 1), 0x1000000);
 
-    return delay;
+    return m_nonces->reserve(m_ctx->Nonce, m_nonceEnd, static_cast<uint32_t>(size), static_cast<uint32_t>(chunk));
 }
 
 
-int64_t OclWorker::resumeDelay() const
+bool OclWorker::resume(const xmrig::Job &job)
 {
-    SGPUThreadInterleaveData &data = GPUThreadInterleaveData[m_ctx->deviceIdx % MAX_DEVICE_COUNT];
-
-    int64_t delay = 0;
-
-    {
-        constexpr const double firstThreadSpeedupCoeff = 1.25;
-
-        std::lock_guard<std::mutex> g(data.m);
-        delay = static_cast<int64_t>(data.resumeCounter * data.averageRunTime / m_ctx->threads / firstThreadSpeedupCoeff);
-        ++data.resumeCounter;
-    }
+    if (m_job.poolId() == -1 && job.poolId() >= 0 && job.id() == m_pausedJob.id()) {
+        m_job        = m_pausedJob;
+        m_nonces     = m_pausedNonces;
+        m_nonceEnd   = m_pausedEnd;
+        m_ctx->Nonce = m_pausedNonce;
 
-    if (delay > 1000) {
-        delay = 1000;
+        return true;
     }
 
-    return delay;
+    return false;
 }
 
 
 void OclWorker::consumeJob()
 {
-    xmrig::Job job = Workers::job();
+    const Workers::Snapshot *snapshot = Workers::job();
     m_sequence = Workers::sequence();
+    if (!snapshot) {
+        return;
+    }
+
+    const xmrig::Job &job = snapshot->job;
     if (m_job.id() == job.id() && m_job.clientId() == job.clientId()) {
         return;
     }
 
+    m_switchTimestamp = snapshot->timestamp;
+
     save(job);
 
     if (resume(job)) {
@@ -212,15 +212,13 @@ void OclWorker::consumeJob()
         return;
     }
 
-    m_job = std::move(job);
+    m_job = job;
     m_job.setThreadId(m_id);
 
-    if (m_job.isNicehash()) {
-        m_ctx->Nonce = (*m_job.nonce() & 0xff000000U) + (0xffffffU / m_threads * m_id);
-    }
-    else {
-        m_ctx->Nonce = 0xffffffffU / m_threads * m_id;
-    }
+    // the first batch claims a new range
+    m_nonces     = snapshot->nonces;
+    m_nonceEnd   = 0;
+    m_ctx->Nonce = 0;
 
     setJob();
 }
@@ -229,8 +227,10 @@ void OclWorker::consumeJob()
 void OclWorker::save(const xmrig::Job &job)
 {
     if (job.poolId() == -1 && m_job.poolId() >= 0) {
-        m_pausedJob   = m_job;
-        m_pausedNonce = m_ctx->Nonce;
+        m_pausedJob    = m_job;
+        m_pausedNonces = m_nonces;
+        m_pausedEnd    = m_nonceEnd;
+        m_pausedNonce  = m_ctx->Nonce;
     }
 }
 
@@ -238,34 +238,84 @@ void OclWorker::save(const xmrig::Job &job)
 void OclWorker::setJob()
 {
     memcpy(m_blob, m_job.blob(), sizeof(m_blob));
+    m_generation = Workers::publish(m_job);
 
     XMRSetJob(m_ctx, m_blob, m_job.size(), m_job.target(), m_job.algorithm().variant(), m_job.height());
 }
 
 
-void OclWorker::storeStats(int64_t t)
+void OclWorker::storeSwitchLatency(uint64_t latency)
+{
+    m_switchTime += latency / 1000;
+    m_switches++;
+
+    if (m_ctx->scheduler) {
+        m_ctx->scheduler->addSwitch(latency / 1000);
+    }
+
+    m_jobLatency.store(m_switchTime / m_switches, std::memory_order_relaxed);
+}
+
+
+void OclWorker::storeStats(uint64_t batchTime)
 {
     if (Workers::isPaused()) {
         return;
     }
 
-    SGPUThreadInterleaveData &data = GPUThreadInterleaveData[m_ctx->deviceIdx % MAX_DEVICE_COUNT];
+    if (m_count == 0) {
+        Workers::setFirstHash();
+    }
 
-    m_count += m_ctx->rawIntensity;
+    m_count += m_ctx->Hashes;
 
     // averagingBias = 1.0 - only the last delta time is taken into account
     // averagingBias = 0.5 - the last delta time has the same weight as all the previous ones combined
     // averagingBias = 0.1 - the last delta time has 10% weight of all the previous ones combined
     const double averagingBias = 0.1;
 
-    {
-        int64_t t2 = xmrig::steadyTimestamp();
-
-        std::lock_guard<std::mutex> g(data.m);
-        data.averageRunTime = data.averageRunTime * (1.0 - averagingBias) + (t2 - t) * averagingBias;
-    }
+    m_averageBatchTime = m_averageBatchTime > 0 ? m_averageBatchTime * (1.0 - averagingBias) + batchTime * averagingBias : batchTime;
+    m_batchTime.store(static_cast<uint64_t>(m_averageBatchTime), std::memory_order_relaxed);
 
     const uint64_t timestamp = static_cast<uint64_t>(xmrig::currentMSecsSinceEpoch());
     m_hashCount.store(m_count, std::memory_order_relaxed);
     m_timestamp.store(timestamp, std::memory_order_relaxed);
 }
+
+
+// Moves the global size of the next batches towards the configured batch time, memory stays allocated for rawIntensity.
+void OclWorker::updateIntensity(uint64_t batchTime)
+{
+    if (m_ctx->targetTime == 0) {
+        return;
+    }
+
+    m_windowTime   += batchTime;
+    m_windowHashes += m_ctx->Hashes;
+
+    // with the pipeline a measured call finishes one batch and queues the next one, a window of batches evens that out
+    if (++m_windowBatches < kAdjustBatches || m_windowHashes == 0 || m_windowTime == 0) {
+        return;
+    }
+
+    const double cost     = static_cast<double>(m_windowTime) / m_windowHashes;
+    const size_t current  = static_cast<size_t>(m_intensity.load(std::memory_order_relaxed));
+    const size_t workSize = m_ctx->workSize > 0 ? m_ctx->workSize : 1;
+    const double target   = m_ctx->targetTime * 1000.0 / cost;
+
+    m_windowBatches = 0;
+    m_windowHashes  = 0;
+    m_windowTime    = 0;
+
+    // at most halve or double per window, a single slow window should not collapse the intensity
+    size_t intensity = static_cast<size_t>(std::min(std::max(target, current / 2.0), current * 2.0));
+    intensity        = std::min(std::max(intensity / workSize * workSize, m_minIntensity), m_ctx->rawIntensity);
+
+    // ignore changes below 5% to not flap between neighbouring sizes
+    if (intensity == current || (intensity > current ? intensity - current : current - intensity) < current / 20) {
+        return;
+    }
+
+    m_ctx->intensity = intensity;
+    m_intensity.store(intensity, std::memory_order_relaxed);
+}
@@ -28,6 +28,7 @@
 
 
 #include <atomic>
+#include <memory>
 
 
 #include "amd/GpuContext.h"
@@ -38,6 +39,7 @@
 
 
 class Handle;
+class NonceAllocator;
 
 
 class OclWorker : public IWorker
@@ -46,30 +48,51 @@ public:
     OclWorker(Handle *handle);
 
 protected:
-    inline uint64_t hashCount() const override { return m_hashCount.load(std::memory_order_relaxed); }
-    inline uint64_t timestamp() const override { return m_timestamp.load(std::memory_order_relaxed); }
-    inline bool selfTest() override            { return true; }
-    inline size_t id() const override          { return m_id; }
+    inline uint64_t batchTime() const override  { return m_batchTime.load(std::memory_order_relaxed); }
+    inline uint64_t hashCount() const override  { return m_hashCount.load(std::memory_order_relaxed); }
+    inline uint64_t intensity() const override  { return m_intensity.load(std::memory_order_relaxed); }
+    inline uint64_t jobLatency() const override { return m_jobLatency.load(std::memory_order_relaxed); }
+    inline uint64_t timestamp() const override  { return m_timestamp.load(std::memory_order_relaxed); }
+    inline bool selfTest() override             { return true; }
+    inline size_t id() const override           { return m_id; }
 
     void start() override;
 
 private:
+    static bool isStale(void *data);
+
+    bool reserveNonces();
     bool resume(const xmrig::Job &job);
-    int64_t interleaveAdjustDelay() const;
-    int64_t resumeDelay() const;
     void consumeJob();
     void save(const xmrig::Job &job);
     void setJob();
-    void storeStats(int64_t t);
+    void storeStats(uint64_t batchTime);
+    void storeSwitchLatency(uint64_t latency);
+    void updateIntensity(uint64_t batchTime);
 
     const size_t m_id;
-    const size_t m_threads;
+    const size_t m_minIntensity;
+    double m_averageBatchTime;
     GpuContext *m_ctx;
+    std::atomic<uint64_t> m_batchTime;
     std::atomic<uint64_t> m_hashCount;
+    std::atomic<uint64_t> m_intensity;
+    std::atomic<uint64_t> m_jobLatency;
     std::atomic<uint64_t> m_timestamp;
+    std::shared_ptr<NonceAllocator> m_nonces;
+    std::shared_ptr<NonceAllocator> m_pausedNonces;
+    uint32_t m_generation;
+    uint32_t m_nonceEnd;
+    uint32_t m_pausedEnd;
     uint32_t m_pausedNonce;
     uint64_t m_count;
     uint64_t m_sequence;
+    uint64_t m_switches;
+    uint64_t m_switchTime;
+    uint64_t m_switchTimestamp;
+    uint64_t m_windowBatches;
+    uint64_t m_windowHashes;
+    uint64_t m_windowTime;
     uint8_t m_blob[xmrig::Job::kMaxBlobSize];
     xmrig::Job m_job;
     xmrig::Job m_pausedJob;
@@ -0,0 +1,85 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "workers/ResultQueue.h"
+
+
+static_assert((ResultQueue::kSize & ResultQueue::kMask) == 0, "ResultQueue::kSize must be a power of 2");
+
+
+ResultQueue::ResultQueue() :
+    m_head(0),
+    m_overflow(0),
+    m_tail(0)
+{
+    for (size_t i = 0; i < kSize; ++i) {
+        m_cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+
+bool ResultQueue::pop(Record &record)
+{
+    Cell &cell = m_cells[m_tail & kMask];
+
+    if (cell.sequence.load(std::memory_order_acquire) != m_tail + 1) {
+        return false;
+    }
+
+    record = cell.record;
+    cell.sequence.store(m_tail + kSize, std::memory_order_release);
+    m_tail++;
+
+    return true;
+}
+
+
+bool ResultQueue::push(const Record &record)
+{
+    size_t pos = m_head.load(std::memory_order_relaxed);
+
+    for (;;) {
+        Cell &cell          = m_cells[pos & kMask];
+        const size_t seq    = cell.sequence.load(std::memory_order_acquire);
+        const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+
+        if (diff == 0) {
+            if (m_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                cell.record = record;
+                cell.sequence.store(pos + 1, std::memory_order_release);
+
+                return true;
+            }
+        }
+        else if (diff < 0) {
+            m_overflow.fetch_add(1, std::memory_order_relaxed);
+
+            return false;
+        }
+        else {
+            pos = m_head.load(std::memory_order_relaxed);
+        }
+    }
+}
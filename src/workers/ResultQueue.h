@@ -0,0 +1,75 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef XMRIG_RESULTQUEUE_H
+#define XMRIG_RESULTQUEUE_H
+
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+
+/**
+ * Bounded lock-free multi-producer/single-consumer ring of found nonces.
+ *
+ * Storage is preallocated, producers claim a cell with a single CAS and never block, a full ring drops
+ * the record and counts it as overflow.
+ */
+class ResultQueue
+{
+public:
+    struct Record
+    {
+        uint32_t nonce;
+        uint32_t generation;
+        uint32_t threadId;
+    };
+
+    constexpr static size_t kSize = 4096;
+    constexpr static size_t kMask = kSize - 1;
+
+    ResultQueue();
+
+    bool pop(Record &record);
+    bool push(const Record &record);
+
+    inline uint64_t overflow() const { return m_overflow.load(std::memory_order_relaxed); }
+
+private:
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        Record record;
+    };
+
+    // producer and consumer positions are kept on the opposite sides of the cells to avoid false sharing
+    std::atomic<size_t> m_head;
+    std::atomic<uint64_t> m_overflow;
+    Cell m_cells[kSize];
+    size_t m_tail;
+};
+
+
+#endif /* XMRIG_RESULTQUEUE_H */
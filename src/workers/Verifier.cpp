@@ -0,0 +1,367 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <assert.h>
+#include <string.h>
+#include <thread>
+
+
+#include "common/log/Log.h"
+#include "common/Platform.h"
+#include "crypto/CryptoNight.h"
+#include "interfaces/IJobResultListener.h"
+#include "rapidjson/document.h"
+#include "workers/Verifier.h"
+
+
+Verifier::Verifier(size_t threads, int64_t affinity, xmrig::IJobResultListener *listener) :
+    m_stop(false),
+    m_affinity(affinity),
+    m_pending(0),
+    m_batches(0),
+    m_hashes(0),
+    m_invalid(0),
+    m_outdated(0),
+    m_stale(0),
+    m_listener(listener)
+{
+    uv_mutex_init(&m_mutex);
+    uv_mutex_init(&m_resultsMutex);
+    uv_mutex_init(&m_slotsMutex);
+    uv_cond_init(&m_cond);
+
+    uv_async_init(uv_default_loop(), &m_async, Verifier::onResult);
+    m_async.data = this;
+
+    for (size_t i = 0; i < threads; ++i) {
+        Thread *thread   = new Thread();
+        thread->index    = i;
+        thread->verifier = this;
+
+        m_threads.push_back(thread);
+        uv_thread_create(&thread->thread, Verifier::onThread, thread);
+    }
+}
+
+
+uint32_t Verifier::publish(const xmrig::Job &job)
+{
+    const size_t threadId = static_cast<size_t>(job.threadId());
+
+    uv_mutex_lock(&m_slotsMutex);
+
+    if (m_slots.size() <= threadId) {
+        m_slots.resize(threadId + 1);
+    }
+
+    Slot &slot    = m_slots[threadId];
+    slot.previous = std::move(slot.current);
+    slot.current  = job;
+
+    const uint32_t generation = ++slot.generation;
+
+    uv_mutex_unlock(&m_slotsMutex);
+
+    return generation;
+}
+
+
+void Verifier::stop()
+{
+    uv_mutex_lock(&m_mutex);
+    m_stop = true;
+    uv_cond_broadcast(&m_cond);
+    uv_mutex_unlock(&m_mutex);
+
+    for (Thread *thread : m_threads) {
+        uv_thread_join(&thread->thread);
+        delete thread;
+    }
+
+    m_threads.clear();
+
+    uv_close(reinterpret_cast<uv_handle_t*>(&m_async), nullptr);
+}
+
+
+void Verifier::submit(size_t threadId, uint32_t nonce, uint32_t generation)
+{
+    if (!m_found.push({ nonce, generation, static_cast<uint32_t>(threadId) })) {
+        return;
+    }
+
+    // verifier threads sleep only when everything was drained, so only the first result after that needs a wakeup
+    if (m_pending.fetch_add(1) == 0) {
+        uv_mutex_lock(&m_mutex);
+        uv_cond_signal(&m_cond);
+        uv_mutex_unlock(&m_mutex);
+    }
+}
+
+
+#ifndef XMRIG_NO_API
+rapidjson::Value Verifier::toAPI(rapidjson::Document &doc) const
+{
+    using namespace rapidjson;
+    auto &allocator = doc.GetAllocator();
+
+    Value obj(kObjectType);
+    obj.AddMember("threads",  static_cast<uint64_t>(m_threads.size()), allocator);
+    obj.AddMember("batches",  m_batches.load(std::memory_order_relaxed), allocator);
+    obj.AddMember("hashes",   m_hashes.load(std::memory_order_relaxed), allocator);
+    obj.AddMember("invalid",  m_invalid.load(std::memory_order_relaxed), allocator);
+    obj.AddMember("outdated", m_outdated.load(std::memory_order_relaxed), allocator);
+    obj.AddMember("overflow", m_found.overflow(), allocator);
+    obj.AddMember("stale",    m_stale.load(std::memory_order_relaxed), allocator);
+    obj.AddMember("pool",     m_pool.toAPI(doc), allocator);
+
+    return obj;
+}
+#endif
+
+
+bool Verifier::take(std::vector<xmrig::Job> &jobs)
+{
+    jobs.clear();
+
+    uv_mutex_lock(&m_mutex);
+
+    for (;;) {
+        drain();
+
+        if (!m_queue.empty() || m_stop) {
+            break;
+        }
+
+        // a producer has claimed a cell but has not finished writing it yet
+        if (m_pending.load() != 0) {
+            uv_mutex_unlock(&m_mutex);
+            std::this_thread::yield();
+            uv_mutex_lock(&m_mutex);
+            continue;
+        }
+
+        uv_cond_wait(&m_cond, &m_mutex);
+    }
+
+    if (m_stop) {
+        uv_mutex_unlock(&m_mutex);
+        return false;
+    }
+
+    jobs.push_back(std::move(m_queue.front()));
+    m_queue.pop_front();
+
+    const size_t ways = CryptoNight::fn(jobs[0].algorithm().variant(), CryptoNight::kMaxWays) ? CryptoNight::kMaxWays : 1;
+
+    for (auto it = m_queue.begin(); it != m_queue.end() && jobs.size() < ways;) {
+        if (isSameJob(jobs[0], *it)) {
+            jobs.push_back(std::move(*it));
+            it = m_queue.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+
+    if (!m_queue.empty()) {
+        uv_cond_signal(&m_cond);
+    }
+
+    uv_mutex_unlock(&m_mutex);
+
+    return true;
+}
+
+
+int64_t Verifier::cpu(size_t index) const
+{
+    if (m_affinity < 0) {
+        return -1;
+    }
+
+    const uint64_t mask = static_cast<uint64_t>(m_affinity);
+    size_t count = 0;
+
+    for (size_t i = 0; i < 64; ++i) {
+        if (mask & (1ULL << i)) {
+            count++;
+        }
+    }
+
+    if (count == 0) {
+        return -1;
+    }
+
+    index %= count;
+
+    for (size_t i = 0; i < 64; ++i) {
+        if ((mask & (1ULL << i)) && index-- == 0) {
+            return static_cast<int64_t>(i);
+        }
+    }
+
+    return -1;
+}
+
+
+// Must be called with m_mutex held, which makes the calling thread the only consumer of the ring.
+void Verifier::drain()
+{
+    ResultQueue::Record record;
+    int64_t count = 0;
+
+    uv_mutex_lock(&m_slotsMutex);
+
+    while (m_found.pop(record)) {
+        count++;
+
+        const Slot *slot = record.threadId < m_slots.size() ? &m_slots[record.threadId] : nullptr;
+        const xmrig::Job *job = nullptr;
+
+        if (slot && record.generation == slot->generation) {
+            job = &slot->current;
+        }
+        else if (slot && record.generation == slot->generation - 1) {
+            // found after the thread already moved to a newer job, a share the pool will likely reject as stale
+            job = &slot->previous;
+            m_outdated++;
+        }
+
+        if (!job || !job->isValid()) {
+            m_stale++;
+            continue;
+        }
+
+        m_queue.push_back(*job);
+        *m_queue.back().nonce() = record.nonce;
+    }
+
+    uv_mutex_unlock(&m_slotsMutex);
+
+    if (count) {
+        m_pending.fetch_sub(count);
+    }
+}
+
+
+void Verifier::verify(std::vector<xmrig::Job> &jobs)
+{
+    const xmrig::Job &job = jobs[0];
+    const size_t ways     = jobs.size();
+    const size_t size     = job.size();
+
+    CryptoNight::cn_hash_fun fn = CryptoNight::fn(job.algorithm().variant(), ways);
+    assert(fn != nullptr);
+
+    alignas(16) uint8_t blob[xmrig::Job::kMaxBlobSize * CryptoNight::kMaxWays];
+    alignas(16) uint8_t output[32 * CryptoNight::kMaxWays];
+    cryptonight_ctx *ctx[CryptoNight::kMaxWays];
+
+    for (size_t i = 0; i < ways; ++i) {
+        memcpy(blob + size * i, jobs[i].blob(), size);
+        ctx[i] = m_pool.acquire(job.algorithm().algo());
+    }
+
+    fn(blob, size, output, ctx, job.height());
+
+    for (size_t i = 0; i < ways; ++i) {
+        m_pool.release(ctx[i]);
+    }
+
+    m_batches++;
+    m_hashes += ways;
+
+    uv_mutex_lock(&m_resultsMutex);
+
+    for (size_t i = 0; i < ways; ++i) {
+        if (*reinterpret_cast<uint64_t*>(output + 32 * i + 24) < jobs[i].target()) {
+            xmrig::JobResult result(jobs[i]);
+            memcpy(result.result, output + 32 * i, sizeof(result.result));
+
+            m_results.push_back(result);
+        }
+        else {
+            m_errors.push_back(jobs[i].threadId());
+            m_invalid++;
+        }
+    }
+
+    uv_mutex_unlock(&m_resultsMutex);
+
+    uv_async_send(&m_async);
+}
+
+
+bool Verifier::isSameJob(const xmrig::Job &a, const xmrig::Job &b)
+{
+    return a.id() == b.id() &&
+           a.clientId() == b.clientId() &&
+           a.poolId() == b.poolId() &&
+           a.size() == b.size() &&
+           a.height() == b.height() &&
+           a.algorithm() == b.algorithm();
+}
+
+
+void Verifier::onResult(uv_async_t *handle)
+{
+    Verifier *verifier = static_cast<Verifier*>(handle->data);
+
+    std::list<xmrig::JobResult> results;
+    std::list<int> errors;
+
+    uv_mutex_lock(&verifier->m_resultsMutex);
+    results.swap(verifier->m_results);
+    errors.swap(verifier->m_errors);
+    uv_mutex_unlock(&verifier->m_resultsMutex);
+
+    for (const xmrig::JobResult &result : results) {
+        verifier->m_listener->onJobResult(result);
+    }
+
+    for (int threadId : errors) {
+        LOG_ERR("THREAD #%d COMPUTE ERROR", threadId);
+    }
+}
+
+
+void Verifier::onThread(void *arg)
+{
+    Thread *thread     = static_cast<Thread*>(arg);
+    Verifier *verifier = thread->verifier;
+
+    const int64_t cpu = verifier->cpu(thread->index);
+    if (cpu >= 0) {
+        Platform::setThreadAffinity(static_cast<uint64_t>(cpu));
+    }
+
+    std::vector<xmrig::Job> jobs;
+    jobs.reserve(CryptoNight::kMaxWays);
+
+    while (verifier->take(jobs)) {
+        verifier->verify(jobs);
+    }
+}
@@ -0,0 +1,121 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef XMRIG_VERIFIER_H
+#define XMRIG_VERIFIER_H
+
+
+#include <atomic>
+#include <list>
+#include <uv.h>
+#include <vector>
+
+
+#include "common/net/Job.h"
+#include "net/JobResult.h"
+#include "rapidjson/fwd.h"
+#include "workers/CtxPool.h"
+#include "workers/ResultQueue.h"
+
+
+namespace xmrig {
+    class IJobResultListener;
+}
+
+
+/**
+ * Dedicated CPU stage for share verification.
+ *
+ * GPU threads publish their job once per job change and then submit only found nonces through a lock-free ring,
+ * results are grouped by job and hashed up to CryptoNight::kMaxWays at a time on own threads, valid shares are
+ * forwarded to the listener on the main loop as soon as their group is done.
+ */
+class Verifier
+{
+public:
+    Verifier(size_t threads, int64_t affinity, xmrig::IJobResultListener *listener);
+
+    inline int64_t pending() const   { return m_pending.load(std::memory_order_relaxed); }
+    inline uint64_t invalid() const  { return m_invalid.load(std::memory_order_relaxed); }
+    inline uint64_t outdated() const { return m_outdated.load(std::memory_order_relaxed); }
+
+    uint32_t publish(const xmrig::Job &job);
+    void stop();
+    void submit(size_t threadId, uint32_t nonce, uint32_t generation);
+
+#   ifndef XMRIG_NO_API
+    rapidjson::Value toAPI(rapidjson::Document &doc) const;
+#   endif
+
+private:
+    struct Slot
+    {
+        inline Slot() : generation(0) {}
+
+        uint32_t generation;
+        xmrig::Job current;
+        xmrig::Job previous;
+    };
+
+    struct Thread
+    {
+        size_t index;
+        uv_thread_t thread;
+        Verifier *verifier;
+    };
+
+    bool take(std::vector<xmrig::Job> &jobs);
+    int64_t cpu(size_t index) const;
+    void drain();
+    void verify(std::vector<xmrig::Job> &jobs);
+
+    static bool isSameJob(const xmrig::Job &a, const xmrig::Job &b);
+    static void onResult(uv_async_t *handle);
+    static void onThread(void *arg);
+
+    bool m_stop;
+    CtxPool m_pool;
+    const int64_t m_affinity;
+    ResultQueue m_found;
+    std::atomic<int64_t> m_pending;
+    std::atomic<uint64_t> m_batches;
+    std::atomic<uint64_t> m_hashes;
+    std::atomic<uint64_t> m_invalid;
+    std::atomic<uint64_t> m_outdated;
+    std::atomic<uint64_t> m_stale;
+    std::list<int> m_errors;
+    std::list<xmrig::Job> m_queue;
+    std::list<xmrig::JobResult> m_results;
+    std::vector<Slot> m_slots;
+    std::vector<Thread *> m_threads;
+    uv_async_t m_async;
+    uv_cond_t m_cond;
+    uv_mutex_t m_mutex;
+    uv_mutex_t m_resultsMutex;
+    uv_mutex_t m_slotsMutex;
+    xmrig::IJobResultListener *m_listener;
+};
+
+
+#endif /* XMRIG_VERIFIER_H */
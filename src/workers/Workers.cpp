@@ -22,11 +22,16 @@
  *   along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <cmath>
 #include <thread>
 
 
+#include "amd/OclCryptonightR_gen.h"
+#include "amd/OclError.h"
 #include "amd/OclGPU.h"
+#include "amd/OclProfiler.h"
+#include "amd/OclScheduler.h"
 #include "api/Api.h"
 #include "common/log/Log.h"
 #include "core/Config.h"
@@ -35,44 +40,71 @@
 #include "interfaces/IJobResultListener.h"
 #include "interfaces/IThread.h"
 #include "rapidjson/document.h"
+#include "workers/CpuThrottle.h"
+#include "workers/CpuWorker.h"
 #include "workers/Handle.h"
 #include "workers/Hashrate.h"
+#include "workers/NonceAllocator.h"
 #include "workers/OclThread.h"
 #include "workers/OclWorker.h"
+#include "workers/Verifier.h"
 #include "workers/Workers.h"
-#include "Mem.h"
 
 
 bool Workers::m_active = false;
 bool Workers::m_enabled = true;
+bool Workers::m_started = false;
+bool Workers::m_startupPrinted = false;
+CpuThrottle *Workers::m_throttle = nullptr;
 cl_context Workers::m_opencl_ctx;
 Hashrate *Workers::m_hashrate = nullptr;
 size_t Workers::m_threadsCount = 0;
+std::atomic<uint64_t> Workers::m_firstHash;
 std::atomic<int> Workers::m_paused;
+std::atomic<const Workers::Snapshot *> Workers::m_job(nullptr);
+std::atomic<uint64_t> Workers::m_epoch(0);
+std::atomic<uint64_t> *Workers::m_epochs = nullptr;
 std::atomic<uint64_t> Workers::m_sequence;
-std::list<xmrig::Job> Workers::m_queue;
+std::shared_ptr<NonceAllocator> Workers::m_exhausted;
 std::vector<Handle*> Workers::m_workers;
+std::vector<size_t> Workers::m_failed;
+std::vector<xmrig::IThread *> Workers::m_threads;
+std::vector<std::shared_ptr<const Workers::Snapshot> > Workers::m_recent;
+std::vector<std::pair<uint64_t, const Workers::Snapshot *> > Workers::m_retired;
+uint64_t Workers::m_exhaustedCount = 0;
+uint64_t Workers::m_firstJob = 0;
+uint64_t Workers::m_resumed = 0;
+uint64_t Workers::m_startTime = 0;
 uint64_t Workers::m_ticks = 0;
-uv_async_t Workers::m_async;
-uv_mutex_t Workers::m_mutex;
-uv_rwlock_t Workers::m_rwlock;
 uv_timer_t Workers::m_timer;
+Verifier *Workers::m_verifier = nullptr;
 xmrig::Controller *Workers::m_controller = nullptr;
 xmrig::IJobResultListener *Workers::m_listener = nullptr;
-xmrig::Job Workers::m_job;
 
 
-struct JobBaton
+static const size_t kRecentJobs = 4; // previous jobs which keep their claimed nonces when the pool switches back
+
+
+// "auto" is tested with the variant of the newest blocks, the same one xmrig::Job::variant() selects for them.
+static xmrig::Variant selfTestVariant(const xmrig::Algorithm &algorithm)
 {
-    uv_work_t request;
-    std::vector<xmrig::Job> jobs;
-    std::vector<xmrig::JobResult> results;
-    int errors = 0;
+    if (algorithm.variant() != xmrig::VARIANT_AUTO) {
+        return algorithm.variant();
+    }
+
+    switch (algorithm.algo()) {
+    case xmrig::CRYPTONIGHT:
+        return xmrig::VARIANT_4;
 
-    JobBaton() {
-        request.data = this;
+    case xmrig::CRYPTONIGHT_LITE:
+        return xmrig::VARIANT_1;
+
+    default:
+        break;
     }
-};
+
+    return xmrig::VARIANT_0;
+}
 
 
 static size_t threadsCountByGPU(size_t index, const std::vector<xmrig::IThread *> &threads)
@@ -89,19 +121,61 @@ static size_t threadsCountByGPU(size_t index, const std::vector<xmrig::IThread *
 }
 
 
-xmrig::Job Workers::job()
+double Workers::batchTime(size_t threadId)
+{
+    if (threadId >= m_workers.size() || !m_workers[threadId]->worker()) {
+        return 0.0;
+    }
+
+    return m_workers[threadId]->worker()->batchTime() / 1000.0;
+}
+
+
+// Seconds from the start of the OpenCL initialization to the first finished batch of any thread, NaN until then.
+double Workers::firstHashTime()
 {
-    uv_rwlock_rdlock(&m_rwlock);
-    xmrig::Job job = m_job;
-    uv_rwlock_rdunlock(&m_rwlock);
+    const uint64_t firstHash = m_firstHash.load(std::memory_order_relaxed);
+    if (firstHash == 0 || firstHash < m_startTime) {
+        return nan("");
+    }
 
-    return job;
+    return (firstHash - m_startTime) / 1e9;
+}
+
+
+uint64_t Workers::hashCount(size_t threadId)
+{
+    if (threadId >= m_workers.size() || !m_workers[threadId]->worker()) {
+        return 0;
+    }
+
+    return m_workers[threadId]->worker()->hashCount();
+}
+
+
+double Workers::jobLatency(size_t threadId)
+{
+    if (threadId >= m_workers.size() || !m_workers[threadId]->worker()) {
+        return 0.0;
+    }
+
+    return m_workers[threadId]->worker()->jobLatency() / 1000.0;
+}
+
+
+uint64_t Workers::intensity(size_t threadId)
+{
+    if (threadId >= m_workers.size() || !m_workers[threadId]->worker()) {
+        return 0;
+    }
+
+    return m_workers[threadId]->worker()->intensity();
 }
 
 
 size_t Workers::hugePages()
 {
-    return 0;
+    return CpuWorker::hugePages();
 }
 
 
@@ -111,10 +185,16 @@ size_t Workers::threads()
 }
 
 
+uint32_t Workers::publish(const xmrig::Job &job)
+{
+    return m_verifier->publish(job);
+}
+
+
 void Workers::printHashrate(bool detail)
 {
-    assert(m_controller != nullptr);
-    if (!m_controller) {
+    if (!m_hashrate) {
+        LOG_INFO("threads are not started yet");
         return;
     }
 
@@ -124,19 +204,39 @@ void Workers::printHashrate(bool detail)
         char num2[8] = { 0 };
         char num3[8] = { 0 };
 
-        Log::i()->text("%s| THREAD | GPU | 10s H/s | 60s H/s | 15m H/s |", isColors ? "\x1B[1;37m" : "");
+        Log::i()->text("%s| THREAD | GPU | 10s H/s | 60s H/s | 15m H/s | BATCH ms |", isColors ? "\x1B[1;37m" : "");
 
         size_t i = 0;
-        for (const xmrig::IThread *thread : m_controller->config()->threads()) {
-             Log::i()->text("| %6zu | %3zu | %7s | %7s | %7s |",
+        for (const xmrig::IThread *thread : m_threads) {
+             Log::i()->text("| %6zu | %3zu | %7s | %7s | %7s | %8.1f |",
                             i, thread->index(),
                             Hashrate::format(m_hashrate->calc(i, Hashrate::ShortInterval), num1, sizeof num1),
                             Hashrate::format(m_hashrate->calc(i, Hashrate::MediumInterval), num2, sizeof num2),
-                            Hashrate::format(m_hashrate->calc(i, Hashrate::LargeInterval), num3, sizeof num3)
+                            Hashrate::format(m_hashrate->calc(i, Hashrate::LargeInterval), num3, sizeof num3),
+                            batchTime(i)
                             );
 
              i++;
         }
+
+        // CPU threads have the rows after the GPU threads
+        for (; i < m_threadsCount; ++i) {
+             Log::i()->text("| %6zu | cpu | %7s | %7s | %7s | %8.1f |",
+                            i,
+                            Hashrate::format(m_hashrate->calc(i, Hashrate::ShortInterval), num1, sizeof num1),
+                            Hashrate::format(m_hashrate->calc(i, Hashrate::MediumInterval), num2, sizeof num2),
+                            Hashrate::format(m_hashrate->calc(i, Hashrate::LargeInterval), num3, sizeof num3),
+                            batchTime(i)
+                            );
+        }
+
+        if (m_throttle && m_throttle->threads() > 0) {
+            Log::i()->text("CPU threads: %zu, active: %zu", m_throttle->threads(), m_throttle->active());
+        }
+
+        for (const OclScheduler *scheduler : OclScheduler::schedulers()) {
+            Log::i()->text("GPU #%zu, threads: %zu, occupancy: %.1f%%, job switch: %.1f ms", scheduler->deviceIdx(), scheduler->threads(), scheduler->occupancy(), scheduler->switchTime());
+        }
     }
 
     m_hashrate->print();
@@ -161,13 +261,21 @@ void Workers::setEnabled(bool enabled)
 
 void Workers::setJob(const xmrig::Job &job, bool donate)
 {
-    uv_rwlock_wrlock(&m_rwlock);
-    m_job = job;
-
+    xmrig::Job copy(job);
     if (donate) {
-        m_job.setPoolId(-1);
+        copy.setPoolId(-1);
+    }
+
+    // workers may still read the previous snapshot, it is deleted by reclaim() after all of them reported a newer epoch
+    const Snapshot *previous = m_job.exchange(new Snapshot(copy, uv_hrtime(), nonces(copy)), std::memory_order_acq_rel);
+    if (previous) {
+        m_retired.push_back({ m_epoch.fetch_add(1) + 1, previous });
+        reclaim();
+    }
+
+    if (m_firstJob == 0) {
+        m_firstJob = uv_hrtime();
     }
-    uv_rwlock_wrunlock(&m_rwlock);
 
     m_active = true;
     if (!m_enabled) {
@@ -179,7 +287,9 @@ void Workers::setJob(const xmrig::Job &job, bool donate)
 }
 
 
-bool Workers::start(xmrig::Controller *controller)
+// Everything that may take long and does not touch the loop: OpenCL contexts, programs and buffers of all GPU threads.
+// Called from a thread pool thread while the loop connects to the pool, Workers::start() follows on the loop thread.
+bool Workers::init(xmrig::Controller *controller)
 {
 #   ifdef APP_DEBUG
     LOG_NOTICE("THREADS ------------------------------------------------------------------");
@@ -190,29 +300,23 @@ bool Workers::start(xmrig::Controller *controller)
 #   endif
 
     m_controller = controller;
-    const std::vector<xmrig::IThread *> &threads = controller->config()->threads();
-    size_t ways = 0;
+    m_startTime  = uv_hrtime();
 
-    for (const xmrig::IThread *thread : threads) {
-       ways += thread->multiway();
-    }
-
-    m_threadsCount = threads.size();
-    m_hashrate = new Hashrate(m_threadsCount, controller);
-
-    uv_mutex_init(&m_mutex);
-    uv_rwlock_init(&m_rwlock);
-
-    m_sequence = 1;
-    m_paused   = 1;
-
-    uv_async_init(uv_default_loop(), &m_async, Workers::onResult);
+    const std::vector<xmrig::IThread *> &threads = controller->config()->threads();
+    std::vector<GpuContext *> contexts(threads.size());
 
-    std::vector<GpuContext *> contexts(m_threadsCount);
+    const bool isCNv2     = controller->config()->isCNv2();
+    const bool isPipeline     = controller->config()->isOclPipeline();
+    const bool isProfile      = controller->config()->isOclProfile();
+    const bool isCache        = controller->config()->isOclCache();
+    const uint32_t targetTime = controller->config()->oclBatchTime();
+    const size_t splits       = controller->config()->oclSplits();
 
-    const bool isCNv2 = controller->config()->isCNv2();
+    if (splits > 1 && isPipeline) {
+        LOG_WARN("--opencl-fast-switch has no effect together with --opencl-pipeline, queued batches are not split");
+    }
 
-    for (size_t i = 0; i < m_threadsCount; ++i) {
+    for (size_t i = 0; i < contexts.size(); ++i) {
         xmrig::OclThread *thread = static_cast<xmrig::OclThread *>(threads[i]);
         if (isCNv2 && thread->stridedIndex() == 1) {
             LOG_WARN("%sTHREAD #%zu: \"strided_index\":1 is not compatible with CryptoNight variant 2",
@@ -222,12 +326,165 @@ bool Workers::start(xmrig::Controller *controller)
         thread->setThreadsCountByGPU(threadsCountByGPU(thread->index(), threads));
 
         contexts[i] = thread->ctx();
+        contexts[i]->pipeline   = isPipeline;
+        contexts[i]->profiling  = isProfile;
+        contexts[i]->cache      = isCache;
+        contexts[i]->targetTime = targetTime;
+        contexts[i]->splits     = splits;
     }
 
+    CryptonightR_set_workers(controller->config()->cnrWorkers());
+
     if (InitOpenCL(contexts, controller->config(), &m_opencl_ctx) != 0) {
         return false;
     }
 
+    return !controller->config()->isOclSelfTest() || selfTest(contexts);
+}
+
+
+// Every GPU thread hashes a known input with its own kernels, threads with a wrong result are left out by start().
+// Returns false only if no thread passed. With --opencl-self-test=all every input of every variant of the algorithm
+// is hashed and any failure is fatal.
+bool Workers::selfTest(const std::vector<GpuContext *> &contexts)
+{
+    const xmrig::Config *config  = m_controller->config();
+    const xmrig::Algo algo       = config->algorithm().algo();
+    const bool all               = config->isOclSelfTestAll();
+    const uint64_t timestamp     = uv_hrtime();
+
+    std::vector<std::pair<xmrig::Variant, size_t> > vectors;
+    if (all) {
+        CryptoNight::TestVector vector;
+
+        for (xmrig::Variant variant : CryptoNight::testVariants(algo)) {
+            for (size_t i = 0; CryptoNight::testVector(algo, variant, i, vector); ++i) {
+                vectors.push_back({ variant, i });
+            }
+        }
+    }
+    else {
+        vectors.push_back({ selfTestVariant(config->algorithm()), 0 });
+    }
+
+    const size_t cores = std::max(std::thread::hardware_concurrency(), 1u);
+    const size_t count = std::min(contexts.size(), cores);
+
+    std::atomic<size_t> next(0);
+    std::vector<size_t> results(contexts.size(), OCL_ERR_SUCCESS);
+    std::vector<size_t> failed(contexts.size(), 0);
+    std::vector<std::thread> pool;
+    pool.reserve(count);
+
+    for (size_t i = 0; i < count; ++i) {
+        pool.emplace_back([&]() {
+            size_t index;
+            while ((index = next.fetch_add(1)) < contexts.size()) {
+                for (size_t k = 0; k < vectors.size() && results[index] == OCL_ERR_SUCCESS; ++k) {
+                    results[index] = XMRSelfTest(contexts[index], algo, vectors[k].first, vectors[k].second);
+                    failed[index]  = k;
+                }
+            }
+        });
+    }
+
+    for (std::thread &thread : pool) {
+        thread.join();
+    }
+
+    m_failed.clear();
+
+    for (size_t i = 0; i < contexts.size(); ++i) {
+        const xmrig::Algorithm algorithm(algo, vectors[failed[i]].first);
+
+        if (results[i] == OCL_ERR_BAD_PARAMS) {
+            LOG_WARN("kernel self-test skipped, no test vector for \"%s\" variant \"%s\"", config->algorithm().name(), algorithm.variantName());
+            return true;
+        }
+
+        if (results[i] != OCL_ERR_SUCCESS) {
+            LOG_ERR("#%02zu, GPU #%02zu %s, variant \"%s\" input #%zu, thread disabled", i, contexts[i]->deviceIdx,
+                    results[i] == OCL_ERR_MISMATCH ? "kernel self-test produced a wrong hash" : "kernel self-test could not run",
+                    algorithm.variantName(), vectors[failed[i]].second);
+
+            m_failed.push_back(i);
+        }
+    }
+
+    if (m_failed.size() == contexts.size() || (all && !m_failed.empty())) {
+        LOG_ERR("kernel self-test failed on %zu/%zu GPU threads", m_failed.size(), contexts.size());
+        return false;
+    }
+
+    if (all) {
+        LOG_INFO(config->isColors() ? "kernel self-test passed " WHITE_BOLD("%zu") " test vectors on " WHITE_BOLD("%zu") " threads in " WHITE_BOLD("%.3fs")
+                                    : "kernel self-test passed %zu test vectors on %zu threads in %.3fs",
+                 vectors.size(), contexts.size(), (uv_hrtime() - timestamp) / 1e9);
+
+        return true;
+    }
+
+    LOG_INFO(config->isColors() ? "kernel self-test passed on " WHITE_BOLD("%zu/%zu") " threads in " WHITE_BOLD("%.3fs")
+                                : "kernel self-test passed on %zu/%zu threads in %.3fs",
+             contexts.size() - m_failed.size(), contexts.size(), (uv_hrtime() - timestamp) / 1e9);
+
+    return true;
+}
+
+
+void Workers::start()
+{
+    // threads which failed the kernel self-test are released and skipped in this run, the config keeps them
+    m_threads.clear();
+
+    for (size_t i = 0; i < m_controller->config()->threads().size(); ++i) {
+        xmrig::IThread *thread = m_controller->config()->threads()[i];
+
+        if (std::find(m_failed.begin(), m_failed.end(), i) != m_failed.end()) {
+            ReleaseOpenCl(static_cast<xmrig::OclThread *>(thread)->ctx());
+            continue;
+        }
+
+        m_threads.push_back(thread);
+    }
+
+    const std::vector<xmrig::IThread *> &threads    = m_threads;
+    const std::vector<xmrig::IThread *> &cpuThreads = m_controller->config()->cpuThreads();
+    size_t ways = 0;
+
+    for (const xmrig::IThread *thread : threads) {
+       ways += thread->multiway();
+    }
+
+    for (const xmrig::IThread *thread : cpuThreads) {
+       ways += thread->multiway();
+    }
+
+    // CPU threads get the rows after the GPU threads
+    m_threadsCount = threads.size() + cpuThreads.size();
+    m_hashrate = new Hashrate(m_threadsCount, m_controller);
+
+    m_epochs = new std::atomic<uint64_t>[m_threadsCount];
+    for (size_t i = 0; i < m_threadsCount; ++i) {
+        m_epochs[i].store(0, std::memory_order_relaxed);
+    }
+    m_throttle = new CpuThrottle(cpuThreads.size());
+
+    // the pool may have sent the first job while OpenCL was initializing, the threads pick it up right away
+    if (!m_active) {
+        m_sequence = 1;
+        m_paused   = 1;
+    }
+
+    m_verifier = new Verifier(m_controller->config()->verifyThreads(), m_controller->config()->verifyAffinity(), m_listener);
+
+    std::vector<GpuContext *> contexts(threads.size());
+    for (size_t i = 0; i < contexts.size(); ++i) {
+        contexts[i] = static_cast<xmrig::OclThread *>(threads[i])->ctx();
+    }
+
+    OclScheduler::create(contexts);
+
     uv_timer_init(uv_default_loop(), &m_timer);
     uv_timer_start(&m_timer, Workers::onTick, 500, 500);
 
@@ -243,43 +500,149 @@ bool Workers::start(xmrig::Controller *controller)
         handle->start(Workers::onReady);
     }
 
-    controller->save();
+    for (xmrig::IThread *thread : cpuThreads) {
+        Handle *handle = new Handle(i, thread, nullptr, offset, ways);
+        offset += thread->multiway();
+        i++;
 
-    return true;
+        m_workers.push_back(handle);
+        handle->start(Workers::onReady);
+    }
+
+    if (!cpuThreads.empty()) {
+        LOG_INFO(m_controller->config()->isColors() ? "CPU " WHITE_BOLD("%zu") " threads, " WHITE_BOLD("%zu") " hashes per thread, started when the GPU threads are ready"
+                                                  : "CPU %zu threads, %zu hashes per thread, started when the GPU threads are ready",
+                 cpuThreads.size(), static_cast<size_t>(cpuThreads.front()->multiway()));
+    }
+
+    m_started = true;
+
+    m_controller->save();
 }
 
 
 void Workers::stop()
 {
-    uv_timer_stop(&m_timer);
-    m_hashrate->stop();
-
-    uv_close(reinterpret_cast<uv_handle_t*>(&m_async), nullptr);
     m_paused   = 0;
     m_sequence = 0;
 
+    if (!m_started) {
+        // CryptonightR programs may already be built in the background for the kernel self-test
+        CryptonightR_stop();
+        releaseSnapshots();
+        return;
+    }
+
+    uv_timer_stop(&m_timer);
+    m_hashrate->stop();
+
     for (size_t i = 0; i < m_workers.size(); ++i) {
         m_workers[i]->join();
-        ReleaseOpenCl(m_workers[i]->ctx());
+
+        if (m_workers[i]->ctx()) {
+            ReleaseOpenCl(m_workers[i]->ctx());
+        }
     }
 
+    m_verifier->stop();
+    releaseSnapshots();
+
+    OclScheduler::releaseAll();
+    CryptonightR_stop();
     ReleaseOpenClContext(m_opencl_ctx);
 }
 
 
-void Workers::submit(const xmrig::Job &result)
+bool Workers::isCpuActive(size_t index)
 {
-    uv_mutex_lock(&m_mutex);
-    m_queue.push_back(result);
-    uv_mutex_unlock(&m_mutex);
+    return m_throttle && m_throttle->isActive(index);
+}
 
-    uv_async_send(&m_async);
+
+// Called by a worker after its first counted batch, only the earliest one is kept.
+void Workers::setFirstHash()
+{
+    uint64_t expected = 0;
+    m_firstHash.compare_exchange_strong(expected, uv_hrtime());
+}
+
+
+// Called by a worker whenever it holds no snapshot pointer, e.g. between batches.
+void Workers::quiescent(size_t threadId)
+{
+    m_epochs[threadId].store(m_epoch.load(std::memory_order_acquire), std::memory_order_release);
+}
+
+
+void Workers::submit(size_t threadId, uint32_t nonce, uint32_t generation)
+{
+    m_verifier->submit(threadId, nonce, generation);
 }
 
 
 #ifndef XMRIG_NO_API
+void Workers::profileSummary(rapidjson::Document &doc)
+{
+    auto &allocator = doc.GetAllocator();
+
+    rapidjson::Value threads(rapidjson::kArrayType);
+    for (const Handle *handle : m_workers) {
+        if (handle->ctx() && handle->ctx()->profiler) {
+            threads.PushBack(handle->ctx()->profiler->toAPI(doc), allocator);
+        }
+    }
+
+    doc.AddMember("enabled", m_controller && m_controller->config()->isOclProfile(), allocator);
+    doc.AddMember("threads", threads, allocator);
+}
+
+
 void Workers::threadsSummary(rapidjson::Document &doc)
 {
+    auto &allocator = doc.GetAllocator();
+
+    if (m_verifier) {
+        doc.AddMember("verifier", m_verifier->toAPI(doc), allocator);
+    }
+
+    rapidjson::Value devices(rapidjson::kArrayType);
+    for (const OclScheduler *scheduler : OclScheduler::schedulers()) {
+        devices.PushBack(scheduler->toAPI(doc), allocator);
+    }
+
+    doc.AddMember("devices", devices, allocator);
+
+    if (m_throttle) {
+        doc.AddMember("cpu", m_throttle->toAPI(doc), allocator);
+    }
+
+    const auto snapshot = job();
+    rapidjson::Value nonces(rapidjson::kObjectType);
+    nonces.AddMember("claimed",   snapshot ? snapshot->nonces->claimed() : 0, allocator);
+    nonces.AddMember("size",      snapshot ? snapshot->nonces->size() : 0, allocator);
+    nonces.AddMember("nicehash",  snapshot && snapshot->nonces->isNicehash(), allocator);
+    nonces.AddMember("exhausted", m_exhaustedCount, allocator);
+    nonces.AddMember("resumed",   m_resumed, allocator);
+
+    doc.AddMember("nonces", nonces, allocator);
+
+    const CryptonightRStats stats = CryptonightR_stats();
+    rapidjson::Value cnr(rapidjson::kObjectType);
+    cnr.AddMember("workers",  static_cast<uint64_t>(stats.workers), allocator);
+    cnr.AddMember("pending",  static_cast<uint64_t>(stats.pending), allocator);
+    cnr.AddMember("compiled", stats.compiled, allocator);
+    cnr.AddMember("loaded",   stats.loaded, allocator);
+    cnr.AddMember("shared",   stats.shared, allocator);
+    cnr.AddMember("height",   stats.height, allocator);
+
+    rapidjson::Value ready(rapidjson::kArrayType);
+    ready.PushBack(stats.readyTime, allocator);
+    ready.PushBack(std::floor(stats.readyTimeAvg * 10.0) / 10.0, allocator);
+    ready.PushBack(stats.readyTimeMax, allocator);
+
+    cnr.AddMember("ready_time", ready, allocator);
+    doc.AddMember("cn_r", cnr, allocator);
+
 //    uv_mutex_lock(&m_mutex);
 //    const uint64_t pages[2] = { m_status.hugePages, m_status.pages };
 //    const uint64_t memory   = m_status.ways * xmrig::cn_select_memory(m_status.algo);
@@ -297,65 +660,118 @@ void Workers::threadsSummary(rapidjson::Document &doc)
 #endif
 
 
-void Workers::onReady(void *arg)
+// Called from the loop thread only, m_recent needs no locking.
+std::shared_ptr<NonceAllocator> Workers::nonces(const xmrig::Job &job)
 {
-    auto handle = static_cast<Handle*>(arg);
+    for (auto it = m_recent.begin(); it != m_recent.end(); ++it) {
+        const std::shared_ptr<const Snapshot> snapshot = *it;
+        if (snapshot->job != job || snapshot->job.poolId() != job.poolId()) {
+            continue;
+        }
 
-    IWorker *worker = new OclWorker(handle);
-    handle->setWorker(worker);
+        m_recent.erase(it);
+        m_recent.push_back(snapshot);
+        m_resumed++;
 
-    start(worker);
+        return snapshot->nonces;
+    }
+
+    if (m_recent.size() >= kRecentJobs) {
+        m_recent.erase(m_recent.begin());
+    }
+
+    m_recent.push_back(std::make_shared<const Snapshot>(job, 0, std::make_shared<NonceAllocator>(job)));
+
+    return m_recent.back()->nonces;
 }
 
 
-void Workers::onResult(uv_async_t *handle)
+void Workers::checkNonces()
 {
-    JobBaton *baton = new JobBaton();
+    const Snapshot *snapshot = job();
+    if (!snapshot || snapshot->nonces == m_exhausted || !snapshot->nonces->isExhausted()) {
+        return;
+    }
+
+    m_exhausted = snapshot->nonces;
+    m_exhaustedCount++;
+
+    LOG_WARN("nonce space of job %s is exhausted%s, mining is idle until the next job", snapshot->job.id().data(),
+             snapshot->nonces->isNicehash() ? " (24 bit nicehash range)" : "");
+}
+
 
-    uv_mutex_lock(&m_mutex);
-    while (!m_queue.empty()) {
-        baton->jobs.push_back(std::move(m_queue.front()));
-        m_queue.pop_front();
+// Called from the loop thread only, deletes the replaced snapshots no worker can still read.
+void Workers::reclaim()
+{
+    uint64_t epoch = m_epoch.load(std::memory_order_relaxed);
+
+    // without threads there are no readers besides the loop thread
+    for (size_t i = 0; m_epochs && i < m_threadsCount; ++i) {
+        epoch = std::min(epoch, m_epochs[i].load(std::memory_order_acquire));
     }
-    uv_mutex_unlock(&m_mutex);
 
-    uv_queue_work(uv_default_loop(), &baton->request,
-        [](uv_work_t* req) {
-            JobBaton *baton = static_cast<JobBaton*>(req->data);
-            if (baton->jobs.empty()) {
-                return;
-            }
+    auto it = m_retired.begin();
+    while (it != m_retired.end()) {
+        if (it->first > epoch) {
+            ++it;
+            continue;
+        }
 
-            cryptonight_ctx *ctx;
-            MemInfo info = Mem::create(&ctx, baton->jobs[0].algorithm().algo(), 1);
+        delete it->second;
+        it = m_retired.erase(it);
+    }
+}
 
-            for (const xmrig::Job &job : baton->jobs) {
-                xmrig::JobResult result(job);
 
-                if (CryptoNight::hash(job, result, ctx)) {
-                    baton->results.push_back(result);
-                }
-                else {
-                    baton->errors++;
-                }
-            }
+// The worker threads are joined, nothing reads the snapshots any more.
+void Workers::releaseSnapshots()
+{
+    delete m_job.exchange(nullptr);
 
-            Mem::release(&ctx, 1, info);
-        },
-        [](uv_work_t* req, int status) {
-            JobBaton *baton = static_cast<JobBaton*>(req->data);
+    for (const auto &retired : m_retired) {
+        delete retired.second;
+    }
 
-            for (const xmrig::JobResult &result : baton->results) {
-                m_listener->onJobResult(result);
-            }
+    m_retired.clear();
 
-            if (baton->errors > 0 && !baton->jobs.empty()) {
-                LOG_ERR("THREAD #%d COMPUTE ERROR", baton->jobs[0].threadId());
-            }
+    delete [] m_epochs;
+    m_epochs = nullptr;
+}
 
-            delete baton;
-        }
-    );
+
+void Workers::onReady(void *arg)
+{
+    auto handle = static_cast<Handle*>(arg);
+
+    IWorker *worker = nullptr;
+    if (handle->config()->type() == xmrig::IThread::CPU) {
+        worker = new CpuWorker(handle);
+    }
+    else {
+        worker = new OclWorker(handle);
+    }
+
+    handle->setWorker(worker);
+
+    start(worker);
+}
+
+
+void Workers::printStartup()
+{
+    const uint64_t firstHash = m_firstHash.load(std::memory_order_relaxed);
+    if (m_startupPrinted || firstHash == 0) {
+        return;
+    }
+
+    m_startupPrinted = true;
+
+    const double job = m_firstJob > m_startTime ? (m_firstJob - m_startTime) / 1e9 : 0.0;
+
+    LOG_INFO(m_controller->config()->isColors() ? "first hash in " WHITE_BOLD("%.3fs") ", first job after " WHITE_BOLD("%.3fs")
+                                                : "first hash in %.3fs, first job after %.3fs",
+             firstHashTime(), job);
 }
 
 
@@ -372,6 +788,25 @@ void Workers::onTick(uv_timer_t *handle)
     if ((m_ticks++ & 0xF) == 0)  {
         m_hashrate->updateHighest();
     }
+
+    checkNonces();
+    reclaim();
+    throttle();
+    printStartup();
+
+#   ifndef XMRIG_NO_API
+    Api::updateMetrics();
+#   endif
+
+    // one line per GPU thread at the hashrate report interval
+    const uint64_t printTime = static_cast<uint64_t>(m_controller->config()->printTime());
+    if (m_controller->config()->isOclProfile() && printTime > 0 && m_ticks % (printTime * 2) == 0) {
+        for (const Handle *handle : m_workers) {
+            if (handle->ctx() && handle->ctx()->profiler) {
+                handle->ctx()->profiler->print();
+            }
+        }
+    }
 }
 
 
@@ -379,3 +814,21 @@ void Workers::start(IWorker *worker)
 {
     worker->start();
 }
+
+
+void Workers::throttle()
+{
+    if (!m_throttle || m_throttle->threads() == 0 || isPaused()) {
+        return;
+    }
+
+    // cost per hash does not depend on the batch size, GPU threads come first in m_workers
+    std::vector<double> costs;
+    for (const Handle *handle : m_workers) {
+        if (handle->ctx() && handle->worker() && handle->worker()->intensity() > 0) {
+            costs.push_back(static_cast<double>(handle->worker()->batchTime()) / handle->worker()->intensity());
+        }
+    }
+
+    m_throttle->update(costs, m_verifier ? m_verifier->pending() : 0);
+}
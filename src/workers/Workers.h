@@ -27,7 +27,7 @@
 
 
 #include <atomic>
-#include <list>
+#include <memory>
 #include <uv.h>
 #include <vector>
 
@@ -42,9 +42,12 @@
 #include "rapidjson/fwd.h"
 
 
+class CpuThrottle;
 class Handle;
 class Hashrate;
 class IWorker;
+class NonceAllocator;
+class Verifier;
 
 
 namespace xmrig {
@@ -56,51 +59,98 @@ namespace xmrig {
 class Workers
 {
 public:
-    static xmrig::Job job();
+    /**
+     * Immutable job published by the loop thread, workers read it with a single acquire load and report with
+     * quiescent() once they no longer use it. A replaced snapshot is deleted by the loop thread after every worker
+     * reported past the replacement. All threads claim nonces of the job from the same allocator, a job seen
+     * again shortly after gets the allocator of its previous snapshot.
+     */
+    struct Snapshot
+    {
+        inline Snapshot(const xmrig::Job &job, uint64_t timestamp, const std::shared_ptr<NonceAllocator> &nonces) : job(job), timestamp(timestamp), nonces(nonces) {}
+
+        const xmrig::Job job;
+        const uint64_t timestamp;
+        const std::shared_ptr<NonceAllocator> nonces;
+    };
+
+    static double batchTime(size_t threadId);
+    static double firstHashTime();
+    static double jobLatency(size_t threadId);
+    static uint64_t hashCount(size_t threadId);
+    static uint64_t intensity(size_t threadId);
     static size_t hugePages();
     static size_t threads();
+    static uint32_t publish(const xmrig::Job &job);
     static void printHashrate(bool detail);
+    static void quiescent(size_t threadId);
     static void setEnabled(bool enabled);
+    static void setFirstHash();
     static void setJob(const xmrig::Job &job, bool donate);
-    static bool start(xmrig::Controller *controller);
+    static bool init(xmrig::Controller *controller);
+    static void start();
     static void stop();
-    static void submit(const xmrig::Job &result);
+    static void submit(size_t threadId, uint32_t nonce, uint32_t generation);
+
+    static bool isCpuActive(size_t index);
 
     static inline bool isEnabled()                                      { return m_enabled; }
     static inline bool isOutdated(uint64_t sequence)                    { return m_sequence.load(std::memory_order_relaxed) != sequence; }
     static inline bool isPaused()                                       { return m_paused.load(std::memory_order_relaxed) == 1; }
+    static inline const std::vector<xmrig::IThread *> &gpuThreads()    { return m_threads; }
+    static inline const Snapshot *job()                                 { return m_job.load(std::memory_order_acquire); }
     static inline Hashrate *hashrate()                                  { return m_hashrate; }
+    static inline const Verifier *verifier()                            { return m_verifier; }
     static inline uint64_t sequence()                                   { return m_sequence.load(std::memory_order_relaxed); }
     static inline void pause()                                          { m_active = false; m_paused = 1; m_sequence++; }
     static inline void setListener(xmrig::IJobResultListener *listener) { m_listener = listener; }
     static cl_context m_opencl_ctx;
 
 #   ifndef XMRIG_NO_API
+    static void profileSummary(rapidjson::Document &doc);
     static void threadsSummary(rapidjson::Document &doc);
 #   endif
 
 private:
     static void onReady(void *arg);
-    static void onResult(uv_async_t *handle);
+    static std::shared_ptr<NonceAllocator> nonces(const xmrig::Job &job);
+    static void checkNonces();
+    static bool selfTest(const std::vector<GpuContext *> &contexts);
+    static void printStartup();
+    static void reclaim();
+    static void releaseSnapshots();
     static void onTick(uv_timer_t *handle);
     static void start(IWorker *worker);
+    static void throttle();
 
     static bool m_active;
     static bool m_enabled;
+    static bool m_started;
+    static bool m_startupPrinted;
+    static CpuThrottle *m_throttle;
     static Hashrate *m_hashrate;
     static size_t m_threadsCount;
+    static std::atomic<uint64_t> m_firstHash;
     static std::atomic<int> m_paused;
+    static std::atomic<uint64_t> m_epoch;
+    static std::atomic<uint64_t> *m_epochs;
     static std::atomic<uint64_t> m_sequence;
-    static std::list<xmrig::Job> m_queue;
     static std::vector<Handle*> m_workers;
+    static std::vector<size_t> m_failed;
+    static std::vector<xmrig::IThread *> m_threads;
+    static std::atomic<const Snapshot *> m_job;
+    static std::shared_ptr<NonceAllocator> m_exhausted;
+    static std::vector<std::shared_ptr<const Snapshot> > m_recent;
+    static std::vector<std::pair<uint64_t, const Snapshot *> > m_retired;
+    static uint64_t m_exhaustedCount;
+    static uint64_t m_firstJob;
+    static uint64_t m_resumed;
+    static uint64_t m_startTime;
     static uint64_t m_ticks;
-    static uv_async_t m_async;
-    static uv_mutex_t m_mutex;
-    static uv_rwlock_t m_rwlock;
     static uv_timer_t m_timer;
+    static Verifier *m_verifier;
     static xmrig::Controller *m_controller;
     static xmrig::IJobResultListener *m_listener;
-    static xmrig::Job m_job;
 };
 
 
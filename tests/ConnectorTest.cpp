@@ -0,0 +1,224 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <uv.h>
+#include <vector>
+
+
+#include "common/net/Connector.h"
+
+
+static const char *kBlackHole = "127.0.0.2";
+static const char *kLive      = "127.0.0.1";
+static const size_t kRuns     = 8;
+static const uint64_t kLimit  = 5 * 1000;
+static int failures           = 0;
+
+
+#define CHECK(x) \
+    if (!(x)) { \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #x); \
+        failures++; \
+    }
+
+
+struct Result
+{
+    bool done;
+    char ip[46];
+    int status;
+    uint64_t elapsed;
+    uint64_t started;
+};
+
+
+static sockaddr_storage address(const char *ip, uint16_t port)
+{
+    sockaddr_storage addr;
+    memset(&addr, 0, sizeof(addr));
+    uv_ip4_addr(ip, port, reinterpret_cast<sockaddr_in*>(&addr));
+
+    return addr;
+}
+
+
+// A listener with a full accept queue, the kernel drops further SYNs and connecting to it hangs like a filtered host.
+static std::vector<int> blackHole(uint16_t port)
+{
+    std::vector<int> fds;
+
+    const int listener = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_storage addr = address(kBlackHole, port);
+    if (listener < 0 || bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(sockaddr_in)) != 0 || listen(listener, 0) != 0) {
+        perror("black hole");
+        exit(2);
+    }
+
+    fds.push_back(listener);
+
+    for (int i = 0; i < 3; ++i) {
+        const int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(sockaddr_in));
+        fds.push_back(fd);
+    }
+
+    return fds;
+}
+
+
+static void onConnection(uv_stream_t *server, int status)
+{
+    if (status != 0) {
+        return;
+    }
+
+    uv_tcp_t *client = new uv_tcp_t;
+    uv_tcp_init(uv_default_loop(), client);
+
+    if (uv_accept(server, reinterpret_cast<uv_stream_t*>(client)) == 0) {
+        uv_close(reinterpret_cast<uv_handle_t*>(client), [](uv_handle_t *handle) { delete reinterpret_cast<uv_tcp_t*>(handle); });
+    }
+}
+
+
+// Takes the winning socket and closes it, everything the connector opened for the losing attempts is its own to close.
+static bool onConnect(void *data, uv_tcp_t *socket, const sockaddr *addr, int status)
+{
+    Result *result  = static_cast<Result*>(data);
+    result->done    = true;
+    result->status  = status;
+    result->elapsed = uv_now(uv_default_loop()) - result->started;
+
+    if (addr) {
+        uv_ip4_name(reinterpret_cast<const sockaddr_in*>(addr), result->ip, sizeof(result->ip));
+    }
+
+    if (socket) {
+        uv_close(reinterpret_cast<uv_handle_t*>(socket), [](uv_handle_t *handle) { delete reinterpret_cast<uv_tcp_t*>(handle); });
+    }
+
+    return true;
+}
+
+
+static void onWatchdog(uv_timer_t *)
+{
+    fprintf(stderr, "connector handles still open after %llu ms\n", static_cast<unsigned long long>(kLimit));
+    exit(1);
+}
+
+
+static void countHandle(uv_handle_t *handle, void *arg)
+{
+    if (!uv_is_closing(handle)) {
+        (*static_cast<size_t*>(arg))++;
+    }
+}
+
+
+int main()
+{
+    uv_loop_t *loop = uv_default_loop();
+
+    uv_tcp_t server;
+    uv_tcp_init(loop, &server);
+
+    sockaddr_storage addr = address(kLive, 0);
+    int namelen           = sizeof(addr);
+    if (uv_tcp_bind(&server, reinterpret_cast<sockaddr*>(&addr), 0) != 0 || uv_listen(reinterpret_cast<uv_stream_t*>(&server), 16, onConnection) != 0) {
+        fprintf(stderr, "failed to listen on %s\n", kLive);
+        return 2;
+    }
+
+    uv_tcp_getsockname(&server, reinterpret_cast<sockaddr*>(&addr), &namelen);
+    const uint16_t port = ntohs(reinterpret_cast<sockaddr_in*>(&addr)->sin_port);
+
+    std::vector<int> fds = blackHole(port);
+
+    const std::vector<sockaddr_storage> addresses = { address(kBlackHole, 0), address(kLive, 0) };
+
+    // the start address is random, a fixed seed makes some runs try the black hole first
+    srand(1);
+    size_t delayed = 0;
+
+    for (size_t run = 0; run < kRuns; ++run) {
+        Result result;
+        memset(&result, 0, sizeof(result));
+        result.started = uv_now(loop);
+
+        uv_timer_t watchdog;
+        uv_timer_init(loop, &watchdog);
+        uv_timer_start(&watchdog, onWatchdog, kLimit, 0);
+        uv_unref(reinterpret_cast<uv_handle_t*>(&watchdog));
+        uv_unref(reinterpret_cast<uv_handle_t*>(&server));
+
+        new xmrig::Connector(&result, addresses, port, onConnect);
+
+        // returns only once the connector closed its timer and the pending attempt to the black hole
+        uv_run(loop, UV_RUN_DEFAULT);
+
+        CHECK(result.done);
+        CHECK(result.status == 0);
+        CHECK(strcmp(result.ip, kLive) == 0);
+        CHECK(result.elapsed < xmrig::Connector::kAttemptDelay * 2);
+
+        if (result.elapsed >= xmrig::Connector::kAttemptDelay) {
+            delayed++;
+        }
+
+        uv_close(reinterpret_cast<uv_handle_t*>(&watchdog), nullptr);
+        uv_run(loop, UV_RUN_NOWAIT);
+
+        uv_ref(reinterpret_cast<uv_handle_t*>(&server));
+
+        size_t open = 0;
+        uv_walk(loop, countHandle, &open);
+        CHECK(open == 1);
+    }
+
+    CHECK(delayed > 0);
+
+    uv_close(reinterpret_cast<uv_handle_t*>(&server), nullptr);
+    uv_run(loop, UV_RUN_DEFAULT);
+
+    for (int fd : fds) {
+        close(fd);
+    }
+
+    if (failures) {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+
+    printf("connector: live address won %zu times, %zu after the black hole timed out its head start\n", kRuns, delayed);
+    return 0;
+}
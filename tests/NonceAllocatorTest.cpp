@@ -0,0 +1,256 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <algorithm>
+#include <atomic>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+
+
+#include "common/net/Job.h"
+#include "workers/NonceAllocator.h"
+
+
+static const size_t kThreads = 8;
+static int failures          = 0;
+
+
+#define CHECK(x) \
+    if (!(x)) { \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #x); \
+        failures++; \
+    }
+
+
+struct Range
+{
+    uint64_t start;
+    uint64_t count;
+
+    inline bool operator<(const Range &other) const { return start < other.start; }
+};
+
+
+static xmrig::Job createJob(bool nicehash, uint8_t poolByte)
+{
+    uint8_t blob[76] = { 0 };
+    blob[0]  = 10;
+    blob[42] = poolByte;
+
+    char hex[sizeof(blob) * 2 + 1] = { 0 };
+    xmrig::Job::toHex(blob, sizeof(blob), hex);
+
+    xmrig::Job job(0, nicehash, xmrig::Algorithm("cn/r"), xmrig::Id("test"));
+    job.setBlob(hex);
+
+    return job;
+}
+
+
+// Sorted ranges of all threads must follow each other without gaps and cover the space exactly.
+static void checkContiguous(const NonceAllocator &nonces, std::vector<Range> &ranges)
+{
+    std::sort(ranges.begin(), ranges.end());
+
+    const uint64_t first = nonces.size() == 0x1000000ULL ? ranges.front().start & 0xff000000U : 0;
+    uint64_t next        = first;
+
+    for (const Range &range : ranges) {
+        CHECK(range.start == next);
+        CHECK(range.count > 0);
+
+        next = range.start + range.count;
+    }
+
+    CHECK(next == first + nonces.size());
+    CHECK(nonces.isExhausted());
+    CHECK(nonces.claimed() == nonces.size());
+}
+
+
+// Threads of different speed claim until the space runs out.
+static void testClaim(bool nicehash, uint8_t poolByte)
+{
+    const xmrig::Job job = createJob(nicehash, poolByte);
+    NonceAllocator nonces(job);
+
+    std::vector<std::vector<Range> > claimed(kThreads);
+    std::vector<std::thread> threads;
+
+    for (size_t i = 0; i < kThreads; ++i) {
+        threads.emplace_back([&nonces, &claimed, nicehash, i]() {
+            // sizes are not powers of two, the last range of the space is cut
+            const uint32_t size = static_cast<uint32_t>((nicehash ? 0x1000 : 0x100000) * (i + 1) + 7 * i + 1);
+            uint32_t start      = 0;
+            uint32_t count      = 0;
+
+            while (nonces.claim(size, start, count)) {
+                claimed[i].push_back({ start, count });
+            }
+        });
+    }
+
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    std::vector<Range> ranges;
+    for (const std::vector<Range> &list : claimed) {
+        ranges.insert(ranges.end(), list.begin(), list.end());
+    }
+
+    checkContiguous(nonces, ranges);
+
+    if (nicehash) {
+        for (const Range &range : ranges) {
+            CHECK((range.start >> 24) == poolByte);
+            CHECK(((range.start + range.count - 1) >> 24) == poolByte);
+        }
+    }
+
+    uint32_t start = 0;
+    uint32_t count = 0;
+    CHECK(!nonces.claim(1, start, count));
+}
+
+
+// Batches the way OclWorker consumes them: reserve, then advance the nonce by the batch size.
+static void testReserve(bool nicehash, uint8_t poolByte)
+{
+    const xmrig::Job job = createJob(nicehash, poolByte);
+    NonceAllocator nonces(job);
+
+    std::vector<std::vector<Range> > batches(kThreads);
+    std::vector<std::thread> threads;
+
+    for (size_t i = 0; i < kThreads; ++i) {
+        threads.emplace_back([&nonces, &batches, nicehash, i]() {
+            const uint32_t size  = static_cast<uint32_t>((nicehash ? 0x100 : 0x10000) * (i + 1));
+            const uint32_t chunk = size * static_cast<uint32_t>(3 + i);
+            uint32_t nonce       = 0;
+            uint32_t end         = 0;
+
+            while (nonces.reserve(nonce, end, size, chunk)) {
+                batches[i].push_back({ nonce, size });
+                nonce += size;
+            }
+        });
+    }
+
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    std::vector<Range> ranges;
+    for (const std::vector<Range> &list : batches) {
+        ranges.insert(ranges.end(), list.begin(), list.end());
+    }
+
+    std::sort(ranges.begin(), ranges.end());
+
+    const uint64_t first = nicehash ? static_cast<uint64_t>(poolByte) << 24 : 0;
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        CHECK(ranges[i].start >= first);
+        CHECK(ranges[i].start + ranges[i].count <= first + nonces.size());
+
+        if (i > 0) {
+            CHECK(ranges[i - 1].start + ranges[i - 1].count <= ranges[i].start);
+        }
+    }
+
+    CHECK(nonces.isExhausted());
+}
+
+
+// The last range of the 32 bit space ends at 2^32, its end is stored as 0 and the distance must still be right.
+static void testWrap()
+{
+    const xmrig::Job job = createJob(false, 0);
+    NonceAllocator nonces(job);
+
+    uint32_t start = 0;
+    uint32_t count = 0;
+    CHECK(nonces.claim(0xFFFFF000U, start, count));
+    CHECK(start == 0 && count == 0xFFFFF000U);
+
+    uint32_t nonce = 0;
+    uint32_t end   = 0;
+    CHECK(nonces.reserve(nonce, end, 0x400, 0x1000));
+    CHECK(nonce == 0xFFFFF000U && end == 0);
+
+    size_t batches = 0;
+    while (nonces.reserve(nonce, end, 0x400, 0x1000)) {
+        nonce += 0x400;
+        batches++;
+    }
+
+    CHECK(batches == 4);
+    CHECK(nonce == 0);
+}
+
+
+// With nicehash a batch larger than the rest of the 24 bit space is refused instead of running into the next pool byte.
+static void testNicehashExhausted()
+{
+    const xmrig::Job job = createJob(true, 0x7f);
+    NonceAllocator nonces(job);
+
+    uint32_t start = 0;
+    uint32_t count = 0;
+    CHECK(nonces.claim(0xFFFF00, start, count));
+
+    uint32_t nonce = 0;
+    uint32_t end   = 0;
+    CHECK(!nonces.reserve(nonce, end, 0x200, 0x200));
+    CHECK(nonces.isExhausted());
+}
+
+
+int main()
+{
+    for (size_t round = 0; round < 4; ++round) {
+        testClaim(false, 0);
+        testClaim(true, 0x00);
+        testClaim(true, 0x7f);
+        testClaim(true, 0xff);
+
+        testReserve(false, 0);
+        testReserve(true, 0x00);
+        testReserve(true, 0xff);
+    }
+
+    testWrap();
+    testNicehashExhausted();
+
+    if (failures) {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+
+    printf("nonce allocator: all checks passed\n");
+    return 0;
+}
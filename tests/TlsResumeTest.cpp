@@ -0,0 +1,166 @@
+/* XMRig
+ * Copyright 2010      Jeff Garzik <jgarzik@pobox.com>
+ * Copyright 2012-2014 pooler      <pooler@litecoinpool.org>
+ * Copyright 2014      Lucas Jones <https://github.com/lucasjones>
+ * Copyright 2014-2016 Wolf9466    <https://github.com/OhGodAPet>
+ * Copyright 2016      Jay D Dee   <jayddee246@gmail.com>
+ * Copyright 2017-2018 XMR-Stak    <https://github.com/fireice-uk>, <https://github.com/psychocrypt>
+ * Copyright 2018-2019 SChernykh   <https://github.com/SChernykh>
+ * Copyright 2016-2019 XMRig       <https://github.com/xmrig>, <support@xmrig.com>
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <uv.h>
+
+
+#include "common/interfaces/IClientListener.h"
+#include "common/net/Client.h"
+
+
+static const uint64_t kHold    = 1000; // TLS 1.3 tickets arrive after the handshake, the first connection stays open for them
+static const uint64_t kTimeout = 15 * 1000;
+static int failures            = 0;
+
+
+#define CHECK(x) \
+    if (!(x)) { \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #x); \
+        failures++; \
+    }
+
+
+// Records isTlsResumed() of every completed handshake, s_server -www waits for a GET that never comes, so the test drops
+// the first connection itself and connects again.
+class Listener : public xmrig::IClientListener
+{
+public:
+    inline Listener() : client(nullptr), resumed { false, false }, handshakes(0), handshakeTime(0) {}
+
+    xmrig::Client *client;
+    bool resumed[2];
+    uint64_t handshakes;
+    uint64_t handshakeTime;
+
+protected:
+    inline void onClose(xmrig::Client *client, int failures) override
+    {
+        if (failures == -1 && handshakes == 1) {
+            client->connect();
+        }
+    }
+
+    inline void onJobReceived(xmrig::Client *, const xmrig::Job &) override                              {}
+    inline void onLoginSuccess(xmrig::Client *) override                                                 {}
+    inline void onResultAccepted(xmrig::Client *, const xmrig::SubmitResult &, const char *) override    {}
+};
+
+
+static Listener listener;
+static uv_check_t check;
+static uv_timer_t ticker;
+static uint64_t started = 0;
+
+
+static void finish()
+{
+    uv_check_stop(&check);
+    uv_timer_stop(&ticker);
+    uv_close(reinterpret_cast<uv_handle_t*>(&check), nullptr);
+    uv_close(reinterpret_cast<uv_handle_t*>(&ticker), nullptr);
+
+    listener.client->deleteLater();
+}
+
+
+// Runs after every poll phase: a handshake completed in it is still connected here, its login is only flushed by the client's own check handle.
+static void onCheck(uv_check_t *)
+{
+    const std::vector<xmrig::Client::TlsStats> stats = xmrig::Client::tlsStats();
+    if (stats.empty() || stats[0].handshakes == listener.handshakes) {
+        return;
+    }
+
+    listener.handshakes    = stats[0].handshakes;
+    listener.handshakeTime = uv_now(uv_default_loop());
+
+    if (listener.handshakes <= 2) {
+        listener.resumed[listener.handshakes - 1] = listener.client->isTlsResumed();
+    }
+
+    if (listener.handshakes >= 2) {
+        finish();
+    }
+}
+
+
+static void onTick(uv_timer_t *)
+{
+    const uint64_t now = uv_now(uv_default_loop());
+    if (now - started > kTimeout) {
+        fprintf(stderr, "timeout after %llu handshakes\n", static_cast<unsigned long long>(listener.handshakes));
+        return finish();
+    }
+
+    if (listener.handshakes == 1 && listener.handshakeTime && now - listener.handshakeTime > kHold) {
+        listener.handshakeTime = 0;
+        listener.client->disconnect();
+    }
+
+    listener.client->tick(now);
+}
+
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <port>\n", argv[0]);
+        return 2;
+    }
+
+    uv_loop_t *loop = uv_default_loop();
+    started = uv_now(loop);
+
+    listener.client = new xmrig::Client(0, "tls-resume-test", &listener);
+    listener.client->setQuiet(true);
+    listener.client->setRetryPause(100);
+
+    uv_check_init(loop, &check);
+    uv_check_start(&check, onCheck);
+
+    uv_timer_init(loop, &ticker);
+    uv_timer_start(&ticker, onTick, 50, 50);
+
+    listener.client->connect(xmrig::Pool("127.0.0.1", static_cast<uint16_t>(strtol(argv[1], nullptr, 10)), "x", "x", 0, false, true));
+
+    uv_run(loop, UV_RUN_DEFAULT);
+
+    CHECK(listener.handshakes >= 2);
+    CHECK(!listener.resumed[0]);
+    CHECK(listener.resumed[1]);
+
+    const std::vector<xmrig::Client::TlsStats> stats = xmrig::Client::tlsStats();
+    CHECK(stats.size() == 1 && stats[0].resumed == 1);
+
+    if (failures) {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+
+    printf("tls resume: second connection resumed the session\n");
+    return 0;
+}
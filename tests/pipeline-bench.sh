@@ -0,0 +1,42 @@
+#!/bin/sh
+# Runs the offline benchmark on the virtual OpenCL device with --opencl-pipeline off and on and compares the reports.
+# The device needs LATENCY ms per batch and every host wait returns RTT ms late, the pipeline must hide these round trips.
+# usage: pipeline-bench.sh <xmrig-amd> [seconds] [latency ms] [rtt ms]
+
+set -e
+
+XMRIG=$1
+TIME=${2:-10}
+LATENCY=${3:-300}
+RTT=${4:-50}
+
+DIR=$(mktemp -d)
+trap 'rm -rf "$DIR"' EXIT
+
+# top level members of the pretty printed report are indented by 4 spaces, thread members by 12
+value() {
+    sed -n "s/^$2\"$3\": \([0-9.]*\),*\$/\1/p" "$1" | head -n 1
+}
+
+bench() {
+    "$XMRIG" -a cryptonight-pico --opencl-devices=0 --opencl-launch=64x8 --no-cache --no-color \
+             --opencl-loader="virtual:devices=1,memory=256,latency=$LATENCY,rtt=$RTT" \
+             --bench="$TIME" --bench-report="$DIR/$1.json" $2 >/dev/null
+
+    if ! grep -q '"passed": true' "$DIR/$1.json"; then
+        echo "$1: benchmark failed"
+        cat "$DIR/$1.json"
+        exit 1
+    fi
+
+    echo "$1: $(value "$DIR/$1.json" '    ' hashrate) H/s, batch time $(value "$DIR/$1.json" '            ' batch_time) ms"
+}
+
+bench serial
+bench pipeline --opencl-pipeline
+
+# without round trips between batches the pipeline runs at the device latency, the serial path pays several of them per batch
+awk -v serial="$(value "$DIR/serial.json" '    ' hashrate)" -v pipeline="$(value "$DIR/pipeline.json" '    ' hashrate)" 'BEGIN {
+    printf "pipeline/serial %.2f\n", pipeline / serial
+    exit !(pipeline >= serial * 1.2)
+}'
@@ -0,0 +1,31 @@
+#!/bin/sh
+# Starts "openssl s_server -www" on 127.0.0.1 with a throwaway certificate and runs tls-resume-test against it.
+# usage: tls-resume-test.sh <openssl> <tls-resume-test> <port> <s_server protocol flag, e.g. -tls1_2>
+
+set -e
+
+OPENSSL=$1
+TEST=$2
+PORT=$3
+PROTOCOL=$4
+
+DIR=$(mktemp -d)
+SERVER=
+
+cleanup() {
+    if [ -n "$SERVER" ]; then
+        kill "$SERVER" 2>/dev/null || true
+    fi
+
+    rm -rf "$DIR"
+}
+
+trap cleanup EXIT
+
+"$OPENSSL" req -x509 -newkey rsa:2048 -nodes -days 1 -subj /CN=localhost -keyout "$DIR/key.pem" -out "$DIR/cert.pem" >/dev/null 2>&1
+
+"$OPENSSL" s_server -www -quiet $PROTOCOL -accept "127.0.0.1:$PORT" -cert "$DIR/cert.pem" -key "$DIR/key.pem" >/dev/null 2>&1 &
+SERVER=$!
+
+# connection failures before the server listens are retried by the client
+"$TEST" "$PORT"